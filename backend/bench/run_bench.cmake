@@ -0,0 +1,14 @@
+# Copyright (C) 2025 Robin Stuart <rstuart114@gmail.com>
+# vim: set ts=4 sw=4 et :
+
+# Run by `bench` target: cmake -DBENCH=<zint_bench> -DOUT=<json_file> -DBASELINE=<baseline_json_file> -P run_bench.cmake
+
+if(EXISTS ${BASELINE})
+    execute_process(COMMAND ${BENCH} -o ${OUT} -b ${BASELINE} RESULT_VARIABLE RESULT)
+else()
+    execute_process(COMMAND ${BENCH} -o ${OUT} RESULT_VARIABLE RESULT)
+endif()
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "zint_bench failed or regressed against \"${BASELINE}\" (see \"${OUT}\")")
+endif()
+message(STATUS "zint_bench results written to \"${OUT}\"")
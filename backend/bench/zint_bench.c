@@ -0,0 +1,663 @@
+/*  zint_bench.c - benchmark encoding and output of a corpus of symbols, reporting as JSON */
+/*
+    libzint - the open source barcode library
+    Copyright (C) 2025 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+/* Usage: zint_bench [-n <iterations>] [-w <warmup>] [-f <filter>] [-o <json_file>] [-b <baseline_json_file>]
+                     [-t <threshold_percent>]
+
+   Encodes every symbology, a set of larger inputs for the 2D symbologies, and a selection of symbols output to
+   every format, timing each operation `iterations` times after `warmup` untimed runs. Results (nanosecond
+   min/mean/percentiles, throughput and bytes allocated per operation, the latter excluding the process-wide raster
+   caches) are written as JSON to `json_file` (default stdout), one result per line. If `baseline_json_file` (a
+   previous output) is given, each result's median is compared against it, and the exit status is 1 if any is
+   slower by more than `threshold_percent` (default 10) */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "zint.h"
+
+#define BENCH_DEFAULT_ITERATIONS    200
+#define BENCH_DEFAULT_WARMUP        10
+#define BENCH_DEFAULT_THRESHOLD     10.0
+#define BENCH_MAX_BASELINE          1024
+
+/* Encode item */
+struct bench_item {
+    int symbology;
+    int input_mode;         /* -1 for default */
+    int option_1;           /* -1 for default */
+    int option_2;           /* -1 for default */
+    int option_3;           /* -1 for default */
+    const char *primary;    /* NULL if none */
+    const char *data;
+    const char *tag;        /* Distinguishes larger inputs, NULL for the default input */
+};
+
+/* Default input for each symbology */
+static const struct bench_item bench_default_items[] = {
+    { BARCODE_CODE11, -1, -1, -1, -1, NULL, "1234567", NULL },
+    { BARCODE_C25STANDARD, -1, -1, -1, -1, NULL, "1234567", NULL },
+    { BARCODE_C25INTER, -1, -1, -1, -1, NULL, "1234567", NULL },
+    { BARCODE_C25IATA, -1, -1, -1, -1, NULL, "1234567", NULL },
+    { BARCODE_C25LOGIC, -1, -1, -1, -1, NULL, "1234567", NULL },
+    { BARCODE_C25IND, -1, -1, -1, -1, NULL, "1234567", NULL },
+    { BARCODE_CODE39, -1, -1, -1, -1, NULL, "CODE39-1234", NULL },
+    { BARCODE_EXCODE39, -1, -1, -1, -1, NULL, "Code39+1234", NULL },
+    { BARCODE_EANX, -1, -1, -1, -1, NULL, "123456789012+12", NULL },
+    { BARCODE_EANX_CHK, -1, -1, -1, -1, NULL, "1234567890128", NULL },
+    { BARCODE_GS1_128, -1, -1, -1, -1, NULL, "[01]09506000134369[10]ABC123", NULL },
+    { BARCODE_CODABAR, -1, -1, -1, -1, NULL, "A123456B", NULL },
+    { BARCODE_CODE128, -1, -1, -1, -1, NULL, "Code128 1234567890", NULL },
+    { BARCODE_DPLEIT, -1, -1, -1, -1, NULL, "1234567890123", NULL },
+    { BARCODE_DPIDENT, -1, -1, -1, -1, NULL, "12345678901", NULL },
+    { BARCODE_CODE16K, -1, -1, -1, -1, NULL, "Code16K 1234567890", NULL },
+    { BARCODE_CODE49, -1, -1, -1, -1, NULL, "CODE49 1234567890", NULL },
+    { BARCODE_CODE93, -1, -1, -1, -1, NULL, "Code93 1234567890", NULL },
+    { BARCODE_FLAT, -1, -1, -1, -1, NULL, "1234567890", NULL },
+    { BARCODE_DBAR_OMN, -1, -1, -1, -1, NULL, "0950600013436", NULL },
+    { BARCODE_DBAR_LTD, -1, -1, -1, -1, NULL, "0950600013436", NULL },
+    { BARCODE_DBAR_EXP, -1, -1, -1, -1, NULL, "[01]09506000134369[10]ABC123", NULL },
+    { BARCODE_TELEPEN, -1, -1, -1, -1, NULL, "Telepen 1234", NULL },
+    { BARCODE_UPCA, -1, -1, -1, -1, NULL, "12345678901+12345", NULL },
+    { BARCODE_UPCA_CHK, -1, -1, -1, -1, NULL, "123456789012", NULL },
+    { BARCODE_UPCE, -1, -1, -1, -1, NULL, "1234567", NULL },
+    { BARCODE_UPCE_CHK, -1, -1, -1, -1, NULL, "00123457", NULL },
+    { BARCODE_POSTNET, -1, -1, -1, -1, NULL, "12345678901", NULL },
+    { BARCODE_MSI_PLESSEY, -1, -1, -1, -1, NULL, "1234567890", NULL },
+    { BARCODE_FIM, -1, -1, -1, -1, NULL, "A", NULL },
+    { BARCODE_LOGMARS, -1, -1, -1, -1, NULL, "LOGMARS-1234", NULL },
+    { BARCODE_PHARMA, -1, -1, -1, -1, NULL, "123456", NULL },
+    { BARCODE_PZN, -1, -1, -1, -1, NULL, "123456", NULL },
+    { BARCODE_PHARMA_TWO, -1, -1, -1, -1, NULL, "123456", NULL },
+    { BARCODE_CEPNET, -1, -1, -1, -1, NULL, "12345678", NULL },
+    { BARCODE_PDF417, -1, -1, -1, -1, NULL, "PDF417 1234567890", NULL },
+    { BARCODE_PDF417COMP, -1, -1, -1, -1, NULL, "PDF417 1234567890", NULL },
+    { BARCODE_MAXICODE, -1, -1, -1, -1, NULL, "MaxiCode 1234567890", NULL },
+    { BARCODE_QRCODE, -1, -1, -1, -1, NULL, "QR Code 1234567890", NULL },
+    { BARCODE_CODE128AB, -1, -1, -1, -1, NULL, "Code128AB 1234567890", NULL },
+    { BARCODE_AUSPOST, -1, -1, -1, -1, NULL, "12345678", NULL },
+    { BARCODE_AUSREPLY, -1, -1, -1, -1, NULL, "12345678", NULL },
+    { BARCODE_AUSROUTE, -1, -1, -1, -1, NULL, "12345678", NULL },
+    { BARCODE_AUSREDIRECT, -1, -1, -1, -1, NULL, "12345678", NULL },
+    { BARCODE_ISBNX, -1, -1, -1, -1, NULL, "9781234567897", NULL },
+    { BARCODE_RM4SCC, -1, -1, -1, -1, NULL, "RM4SCC1234", NULL },
+    { BARCODE_DATAMATRIX, -1, -1, -1, -1, NULL, "Data Matrix 1234567890", NULL },
+    { BARCODE_EAN14, -1, -1, -1, -1, NULL, "1234567890123", NULL },
+    { BARCODE_VIN, -1, -1, -1, -1, NULL, "1FTCR10UXTPA78180", NULL },
+    { BARCODE_CODABLOCKF, -1, -1, -1, -1, NULL, "Codablock-F 1234567890", NULL },
+    { BARCODE_NVE18, -1, -1, -1, -1, NULL, "12345678901234567", NULL },
+    { BARCODE_JAPANPOST, -1, -1, -1, -1, NULL, "15400233-16-4-205", NULL },
+    { BARCODE_KOREAPOST, -1, -1, -1, -1, NULL, "123456", NULL },
+    { BARCODE_DBAR_STK, -1, -1, -1, -1, NULL, "0950600013436", NULL },
+    { BARCODE_DBAR_OMNSTK, -1, -1, -1, -1, NULL, "0950600013436", NULL },
+    { BARCODE_DBAR_EXPSTK, -1, -1, -1, -1, NULL, "[01]09506000134369[10]ABC123", NULL },
+    { BARCODE_PLANET, -1, -1, -1, -1, NULL, "12345678901", NULL },
+    { BARCODE_MICROPDF417, -1, -1, -1, -1, NULL, "MicroPDF417 1234567890", NULL },
+    { BARCODE_USPS_IMAIL, -1, -1, -1, -1, NULL, "01234567094987654321-01234567891", NULL },
+    { BARCODE_PLESSEY, -1, -1, -1, -1, NULL, "1234567890ABCDEF", NULL },
+    { BARCODE_TELEPEN_NUM, -1, -1, -1, -1, NULL, "1234567890", NULL },
+    { BARCODE_ITF14, -1, -1, -1, -1, NULL, "1234567890123", NULL },
+    { BARCODE_KIX, -1, -1, -1, -1, NULL, "2500GG30250", NULL },
+    { BARCODE_AZTEC, -1, -1, -1, -1, NULL, "Aztec Code 1234567890", NULL },
+    { BARCODE_DAFT, -1, -1, -1, -1, NULL, "DAFTDAFTFADT", NULL },
+    { BARCODE_DPD, -1, -1, -1, -1, NULL, "000393206219912345678101040", NULL },
+    { BARCODE_MICROQR, -1, -1, -1, -1, NULL, "MicroQR 12345", NULL },
+    { BARCODE_HIBC_128, -1, -1, -1, -1, NULL, "A123BJC5D6E71", NULL },
+    { BARCODE_HIBC_39, -1, -1, -1, -1, NULL, "A123BJC5D6E71", NULL },
+    { BARCODE_HIBC_DM, -1, -1, -1, -1, NULL, "A123BJC5D6E71", NULL },
+    { BARCODE_HIBC_QR, -1, -1, -1, -1, NULL, "A123BJC5D6E71", NULL },
+    { BARCODE_HIBC_PDF, -1, -1, -1, -1, NULL, "A123BJC5D6E71", NULL },
+    { BARCODE_HIBC_MICPDF, -1, -1, -1, -1, NULL, "A123BJC5D6E71", NULL },
+    { BARCODE_HIBC_BLOCKF, -1, -1, -1, -1, NULL, "A123BJC5D6E71", NULL },
+    { BARCODE_HIBC_AZTEC, -1, -1, -1, -1, NULL, "A123BJC5D6E71", NULL },
+    { BARCODE_DOTCODE, -1, -1, -1, -1, NULL, "DotCode 1234567890", NULL },
+    { BARCODE_HANXIN, -1, -1, -1, -1, NULL, "Han Xin 1234567890", NULL },
+    { BARCODE_MAILMARK_2D, -1, -1, -1, -1, NULL, "JGB 012100123412345678AB19XY1A 0", NULL },
+    { BARCODE_UPU_S10, -1, -1, -1, -1, NULL, "EE876543216CA", NULL },
+    { BARCODE_MAILMARK_4S, -1, -1, -1, -1, NULL, "1100000000000XY11", NULL },
+    { BARCODE_AZRUNE, -1, -1, -1, -1, NULL, "123", NULL },
+    { BARCODE_CODE32, -1, -1, -1, -1, NULL, "12345678", NULL },
+    { BARCODE_EANX_CC, -1, 1, -1, -1, "331234567890", "[21]A12345678", NULL },
+    { BARCODE_GS1_128_CC, -1, 1, -1, -1, "[01]09506000134369", "[21]A12345678", NULL },
+    { BARCODE_DBAR_OMN_CC, -1, 1, -1, -1, "0950600013436", "[21]A12345678", NULL },
+    { BARCODE_DBAR_LTD_CC, -1, 1, -1, -1, "0950600013436", "[21]A12345678", NULL },
+    { BARCODE_DBAR_EXP_CC, -1, 1, -1, -1, "[01]09506000134369", "[21]A12345678", NULL },
+    { BARCODE_UPCA_CC, -1, 1, -1, -1, "12345678901", "[21]A12345678", NULL },
+    { BARCODE_UPCE_CC, -1, 1, -1, -1, "1234567", "[21]A12345678", NULL },
+    { BARCODE_DBAR_STK_CC, -1, 1, -1, -1, "0950600013436", "[21]A12345678", NULL },
+    { BARCODE_DBAR_OMNSTK_CC, -1, 1, -1, -1, "0950600013436", "[21]A12345678", NULL },
+    { BARCODE_DBAR_EXPSTK_CC, -1, 1, -1, -1, "[01]09506000134369", "[21]A12345678", NULL },
+    { BARCODE_CHANNEL, -1, -1, -1, -1, NULL, "12345", NULL },
+    { BARCODE_CODEONE, -1, -1, -1, -1, NULL, "Code One 1234567890", NULL },
+    { BARCODE_GRIDMATRIX, -1, -1, -1, -1, NULL, "Grid Matrix 1234567890", NULL },
+    { BARCODE_UPNQR, -1, -1, -1, -1, NULL, "UPNQR 1234567890", NULL },
+    { BARCODE_ULTRA, -1, -1, -1, -1, NULL, "Ultracode 1234567890", NULL },
+    { BARCODE_RMQR, -1, -1, -1, -1, NULL, "rMQR 1234567890", NULL },
+    { BARCODE_BC412, -1, -1, -1, -1, NULL, "AQ45670", NULL },
+    { BARCODE_DXFILMEDGE, -1, -1, -1, -1, NULL, "112-1/10A", NULL },
+};
+
+#define BENCH_TEXT \
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890abcdefghijklmnopqrstuvwxyz&,:#-.$/+%*=^" \
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ12345678901234567890abcdefghijklmnopqrstuvwxyz" \
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ;<>@[]_`~!||()?{}'123456789012345678901234567890"
+#define BENCH_TEXT_4 BENCH_TEXT BENCH_TEXT BENCH_TEXT BENCH_TEXT
+#define BENCH_TEXT_SHORT "ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890abcdefghijklmnopqrstuvwxyz&,:#-.$/+%*=^1234567890"
+
+/* Larger inputs for symbologies where encodation optimisation dominates */
+static const struct bench_item bench_large_items[] = {
+    { BARCODE_CODE128, -1, -1, -1, -1, NULL, BENCH_TEXT_SHORT, "86 chars" },
+    { BARCODE_PDF417, -1, -1, -1, -1, NULL, BENCH_TEXT_4, "880 chars" },
+    { BARCODE_PDF417, FAST_MODE, -1, -1, -1, NULL, BENCH_TEXT_4, "880 chars fast" },
+    { BARCODE_MICROPDF417, -1, -1, -1, -1, NULL, BENCH_TEXT, "220 chars" },
+    { BARCODE_QRCODE, -1, -1, -1, -1, NULL, BENCH_TEXT_4, "880 chars" },
+    { BARCODE_QRCODE, FAST_MODE, -1, -1, -1, NULL, BENCH_TEXT_4, "880 chars fast" },
+    { BARCODE_DATAMATRIX, -1, -1, -1, -1, NULL, BENCH_TEXT_4, "880 chars" },
+    { BARCODE_DATAMATRIX, FAST_MODE, -1, -1, -1, NULL, BENCH_TEXT_4, "880 chars fast" },
+    { BARCODE_AZTEC, -1, -1, -1, -1, NULL, BENCH_TEXT_4, "880 chars" },
+    { BARCODE_DOTCODE, -1, -1, -1, -1, NULL, BENCH_TEXT, "220 chars" },
+    { BARCODE_HANXIN, -1, -1, -1, -1, NULL, BENCH_TEXT_4, "880 chars" },
+    { BARCODE_GRIDMATRIX, -1, -1, -1, -1, NULL, BENCH_TEXT_4, "880 chars" },
+    { BARCODE_CODEONE, -1, -1, -1, -1, NULL, BENCH_TEXT_4, "880 chars" },
+    { BARCODE_ULTRA, -1, -1, -1, -1, NULL, BENCH_TEXT, "220 chars" },
+    { BARCODE_RMQR, -1, -1, -1, -1, NULL, BENCH_TEXT_SHORT, "86 chars" },
+    { BARCODE_CODABLOCKF, -1, -1, -1, -1, NULL, BENCH_TEXT, "220 chars" },
+};
+
+/* Output operations */
+#define BENCH_OP_ENCODE     0
+#define BENCH_OP_BUFFER     1   /* `ZBarcode_Buffer()` */
+#define BENCH_OP_VECTOR     2   /* `ZBarcode_Buffer_Vector()` */
+#define BENCH_OP_FILE       3   /* `ZBarcode_Print()` to memory file */
+
+static const char *const bench_file_types[] = { "png", "gif", "tif", "bmp", "pcx", "svg", "eps", "emf" };
+
+/* Symbols output to every format, the default inputs of `bench_output_symbologies` and the large inputs indexed by
+   `bench_output_large_idxs` */
+static const int bench_output_symbologies[] = { BARCODE_CODE128, BARCODE_QRCODE, BARCODE_MAXICODE, BARCODE_DOTCODE,
+                                                BARCODE_ULTRA, BARCODE_EANX_CC };
+static const int bench_output_large_idxs[] = { 4 /*QR Code 880 chars*/, 6 /*Data Matrix 880 chars*/ };
+
+/* Result of a benchmark */
+struct bench_result {
+    char name[96];
+    int ret;                /* Last return from zint (error or warning), or -1 if setup failed */
+    int iterations;
+    double ns_min, ns_mean, ns_p50, ns_p90, ns_p99, ns_max;
+    double data_bytes;      /* Size of input data (encode, vector), or of output (buffer, file) */
+    double alloc_bytes;     /* Bytes allocated per operation */
+    double allocs;          /* Number of allocations per operation */
+};
+
+/* Baseline result */
+struct bench_baseline {
+    char name[96];
+    double ns_p50;
+};
+
+static struct bench_baseline baselines[BENCH_MAX_BASELINE];
+static int baseline_count;
+
+/* Allocation counts, maintained by the counting allocator */
+static size_t alloc_bytes;
+static size_t alloc_count;
+
+/* Header prepended to each allocation to record its size, sized to preserve alignment */
+union bench_alloc_hdr {
+    size_t size;
+    double d;
+    void *p;
+    long l;
+};
+
+static void *bench_malloc(void *opaque, size_t size) {
+    union bench_alloc_hdr *hdr = (union bench_alloc_hdr *) malloc(sizeof(union bench_alloc_hdr) + size);
+    (void)opaque;
+    if (!hdr) {
+        return NULL;
+    }
+    hdr->size = size;
+    alloc_bytes += size;
+    alloc_count++;
+    return hdr + 1;
+}
+
+static void *bench_realloc(void *opaque, void *ptr, size_t size) {
+    union bench_alloc_hdr *hdr;
+    (void)opaque;
+    if (!ptr) {
+        return bench_malloc(opaque, size);
+    }
+    hdr = (union bench_alloc_hdr *) ptr - 1;
+    if (size > hdr->size) {
+        alloc_bytes += size - hdr->size;
+    }
+    alloc_count++;
+    if (!(hdr = (union bench_alloc_hdr *) realloc(hdr, sizeof(union bench_alloc_hdr) + size))) {
+        return NULL;
+    }
+    hdr->size = size;
+    return hdr + 1;
+}
+
+static void bench_free(void *opaque, void *ptr) {
+    (void)opaque;
+    if (ptr) {
+        free((union bench_alloc_hdr *) ptr - 1);
+    }
+}
+
+/* Monotonic clock in nanoseconds */
+static double bench_now(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return (double) count.QuadPart * 1e9 / (double) freq.QuadPart;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+#endif
+}
+
+static int bench_cmp_double(const void *a, const void *b) {
+    const double da = *(const double *) a, db = *(const double *) b;
+    return da < db ? -1 : da > db;
+}
+
+/* Nearest-rank percentile `pc` of sorted `times` */
+static double bench_percentile(const double times[], const int count, const int pc) {
+    int idx = (count * pc + 99) / 100 - 1;
+    return times[idx < 0 ? 0 : idx];
+}
+
+/* Set `symbol` options from `item` */
+static void bench_set_symbol(struct zint_symbol *symbol, const struct bench_item *item) {
+    ZBarcode_Reset(symbol);
+    symbol->symbology = item->symbology;
+    if (item->input_mode != -1) {
+        symbol->input_mode = item->input_mode;
+    }
+    if (item->option_1 != -1) {
+        symbol->option_1 = item->option_1;
+    }
+    if (item->option_2 != -1) {
+        symbol->option_2 = item->option_2;
+    }
+    if (item->option_3 != -1) {
+        symbol->option_3 = item->option_3;
+    }
+    if (item->primary) {
+        strcpy(symbol->primary, item->primary);
+    }
+}
+
+/* Do one operation */
+static int bench_op(struct zint_symbol *symbol, const struct bench_item *item, const int op) {
+    if (op == BENCH_OP_ENCODE) {
+        return ZBarcode_Encode(symbol, (const unsigned char *) item->data, (int) strlen(item->data));
+    }
+    if (op == BENCH_OP_BUFFER) {
+        return ZBarcode_Buffer(symbol, 0 /*rotate_angle*/);
+    }
+    if (op == BENCH_OP_VECTOR) {
+        return ZBarcode_Buffer_Vector(symbol, 0 /*rotate_angle*/);
+    }
+    return ZBarcode_Print(symbol, 0 /*rotate_angle*/);
+}
+
+/* Benchmark operation `op` on `item`, to file type `file_type` if BENCH_OP_FILE */
+static void bench_run(struct zint_symbol *symbol, const struct bench_item *item, const int op, const char *file_type,
+            const int iterations, const int warmup, double times[], struct bench_result *result) {
+    int i, ret = 0;
+    size_t total_bytes = 0, total_count = 0;
+
+    result->ret = 0;
+    result->iterations = 0;
+
+    bench_set_symbol(symbol, item);
+    if (op == BENCH_OP_FILE) {
+        symbol->output_options |= BARCODE_MEMORY_FILE;
+        sprintf(symbol->outfile, "mem.%s", file_type);
+    }
+    if (op != BENCH_OP_ENCODE) {
+        /* Encode once */
+        if ((ret = bench_op(symbol, item, BENCH_OP_ENCODE)) >= ZINT_ERROR) {
+            result->ret = ret;
+            return;
+        }
+    }
+
+    for (i = -warmup; i < iterations; i++) {
+        double start;
+        size_t start_bytes, start_count;
+        if (op == BENCH_OP_ENCODE) {
+            /* Reset as encoders feed back options (e.g. QR Code mask in `option_3`), so each iteration the same */
+            bench_set_symbol(symbol, item);
+        }
+        start_bytes = alloc_bytes;
+        start_count = alloc_count;
+        start = bench_now();
+        ret = bench_op(symbol, item, op);
+        if (i >= 0) {
+            times[i] = bench_now() - start;
+            total_bytes += alloc_bytes - start_bytes;
+            total_count += alloc_count - start_count;
+        }
+        if (ret >= ZINT_ERROR) {
+            break;
+        }
+    }
+    result->ret = ret;
+    if (ret >= ZINT_ERROR) {
+        return;
+    }
+
+    qsort(times, iterations, sizeof(double), bench_cmp_double);
+    result->iterations = iterations;
+    result->ns_min = times[0];
+    result->ns_max = times[iterations - 1];
+    result->ns_p50 = bench_percentile(times, iterations, 50);
+    result->ns_p90 = bench_percentile(times, iterations, 90);
+    result->ns_p99 = bench_percentile(times, iterations, 99);
+    result->ns_mean = 0.0;
+    for (i = 0; i < iterations; i++) {
+        result->ns_mean += times[i];
+    }
+    result->ns_mean /= iterations;
+    /* Throughput in input bytes for encoding, output bytes otherwise */
+    if (op == BENCH_OP_FILE) {
+        result->data_bytes = (double) symbol->memfile_size;
+    } else if (op == BENCH_OP_BUFFER) {
+        result->data_bytes = (double) symbol->bitmap_width * symbol->bitmap_height * 3;
+    } else {
+        result->data_bytes = (double) strlen(item->data);
+    }
+    result->alloc_bytes = (double) total_bytes / iterations;
+    result->allocs = (double) total_count / iterations;
+}
+
+/* Form the result name from the symbology, tag and operation */
+static void bench_name(const struct bench_item *item, const int op, const char *file_type, char name[96]) {
+    static const char *const op_names[] = { "encode", "buffer", "vector" };
+    char symbology_name[32];
+
+    ZBarcode_BarcodeName(item->symbology, symbology_name);
+    sprintf(name, "%s%s%s/%s", symbology_name, item->tag ? ":" : "", item->tag ? item->tag : "",
+            op == BENCH_OP_FILE ? file_type : op_names[op]);
+}
+
+/* Output JSON string `str` (escaping quotes and backslashes) */
+static void bench_json_str(FILE *fp, const char *str) {
+    fputc('"', fp);
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\') {
+            fputc('\\', fp);
+        }
+        fputc(*str, fp);
+    }
+    fputc('"', fp);
+}
+
+/* Return baseline median for `name`, or 0 if none */
+static double bench_baseline_p50(const char *name) {
+    int i;
+    for (i = 0; i < baseline_count; i++) {
+        if (strcmp(baselines[i].name, name) == 0) {
+            return baselines[i].ns_p50;
+        }
+    }
+    return 0.0;
+}
+
+/* Load baseline medians from a previous JSON output (one result per line), returning 0 on failure */
+static int bench_load_baseline(const char *filename) {
+    char line[1024];
+    FILE *fp = fopen(filename, "r");
+
+    if (!fp) {
+        fprintf(stderr, "zint_bench: cannot open baseline \"%s\": %s\n", filename, strerror(errno));
+        return 0;
+    }
+    while (baseline_count < BENCH_MAX_BASELINE && fgets(line, sizeof(line), fp)) {
+        const char *name = strstr(line, "\"name\": \"");
+        const char *p50 = strstr(line, "\"ns_p50\": ");
+        const char *end;
+        if (!name || !p50) {
+            continue;
+        }
+        name += 9;
+        if (!(end = strchr(name, '"')) || end - name >= (int) sizeof(baselines[0].name)) {
+            continue;
+        }
+        memcpy(baselines[baseline_count].name, name, end - name);
+        baselines[baseline_count].name[end - name] = '\0';
+        baselines[baseline_count].ns_p50 = atof(p50 + 10);
+        baseline_count++;
+    }
+    fclose(fp);
+
+    return 1;
+}
+
+/* Output result as JSON object on one line, comparing against baseline if any. Returns 1 if regressed */
+static int bench_output(FILE *fp, const struct bench_result *result, const double threshold, const int first) {
+    double base_p50;
+    int regressed = 0;
+
+    fprintf(fp, "%s    { \"name\": ", first ? "" : ",\n");
+    bench_json_str(fp, result->name);
+    if (result->iterations == 0) {
+        fprintf(fp, ", \"error\": %d }", result->ret);
+        return 0;
+    }
+    fprintf(fp, ", \"ret\": %d, \"iterations\": %d, \"ns_min\": %.0f, \"ns_mean\": %.0f, \"ns_p50\": %.0f"
+            ", \"ns_p90\": %.0f, \"ns_p99\": %.0f, \"ns_max\": %.0f, \"ops_per_sec\": %.1f, \"bytes_per_sec\": %.0f"
+            ", \"alloc_bytes\": %.0f, \"allocs\": %.1f",
+            result->ret, result->iterations, result->ns_min, result->ns_mean, result->ns_p50, result->ns_p90,
+            result->ns_p99, result->ns_max, 1e9 / result->ns_mean, result->data_bytes * 1e9 / result->ns_mean,
+            result->alloc_bytes, result->allocs);
+    if (baseline_count && (base_p50 = bench_baseline_p50(result->name)) > 0.0) {
+        const double change = (result->ns_p50 - base_p50) * 100.0 / base_p50;
+        regressed = change > threshold;
+        fprintf(fp, ", \"baseline_ns_p50\": %.0f, \"change_pct\": %.1f%s", base_p50, change,
+                regressed ? ", \"regressed\": true" : "");
+        if (regressed) {
+            fprintf(stderr, "zint_bench: %s regressed %.1f%% (median %.0f ns, baseline %.0f ns)\n", result->name,
+                    change, result->ns_p50, base_p50);
+        }
+    }
+    fputs(" }", fp);
+
+    return regressed;
+}
+
+static void bench_usage(FILE *fp) {
+    fputs("Usage: zint_bench [-n <iterations>] [-w <warmup>] [-f <filter>] [-o <json_file>]\n"
+          "                  [-b <baseline_json_file>] [-t <threshold_percent>]\n"
+          "  -n  Timed iterations per benchmark (default 200)\n"
+          "  -w  Untimed warm-up iterations per benchmark (default 10)\n"
+          "  -f  Only run benchmarks whose name contains <filter>, e.g. \"QRCODE\" or \"/png\"\n"
+          "  -o  Write JSON results to <json_file> (default stdout)\n"
+          "  -b  Compare medians against a previous JSON output, exiting 1 on regression\n"
+          "  -t  Regression threshold in percent (default 10)\n", fp);
+}
+
+/* Run benchmark if its name matches `filter`, outputting result */
+static int bench_do(FILE *fp, struct zint_symbol *symbol, const struct bench_item *item, const int op,
+            const char *file_type, const int iterations, const int warmup, double times[], const char *filter,
+            const double threshold, int *p_count, int *p_errors) {
+    struct bench_result result;
+
+    bench_name(item, op, file_type, result.name);
+    if (filter && !strstr(result.name, filter)) {
+        return 0;
+    }
+    bench_run(symbol, item, op, file_type, iterations, warmup, times, &result);
+    if (result.iterations == 0) {
+        fprintf(stderr, "zint_bench: %s failed (%d): %s\n", result.name, result.ret, symbol->errtxt);
+        (*p_errors)++;
+    }
+    return bench_output(fp, &result, threshold, (*p_count)++ == 0);
+}
+
+int main(int argc, char **argv) {
+    int iterations = BENCH_DEFAULT_ITERATIONS;
+    int warmup = BENCH_DEFAULT_WARMUP;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    const char *filter = NULL;
+    const char *outfile = NULL;
+    const char *baseline = NULL;
+    FILE *fp = stdout;
+    struct zint_symbol *symbol;
+    double *times;
+    int i, j, k, count = 0, errors = 0, regressions = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' || argv[i][1] == 'h') {
+            bench_usage(argv[i][1] == 'h' ? stdout : stderr);
+            return argv[i][1] == 'h' ? 0 : 2;
+        }
+        if (!strchr("nwfobt", argv[i][1])) {
+            bench_usage(stderr);
+            return 2;
+        }
+        if (i + 1 == argc) {
+            fprintf(stderr, "zint_bench: option \"%s\" requires an argument\n", argv[i]);
+            return 2;
+        }
+        switch (argv[i][1]) {
+            case 'n': iterations = atoi(argv[++i]); break;
+            case 'w': warmup = atoi(argv[++i]); break;
+            case 'f': filter = argv[++i]; break;
+            case 'o': outfile = argv[++i]; break;
+            case 'b': baseline = argv[++i]; break;
+            default: threshold = atof(argv[++i]); break;
+        }
+    }
+    if (iterations < 1 || warmup < 0) {
+        fputs("zint_bench: iterations must be at least 1 and warmup not negative\n", stderr);
+        return 2;
+    }
+    if (baseline && !bench_load_baseline(baseline)) {
+        return 2;
+    }
+    if (outfile && !(fp = fopen(outfile, "w"))) {
+        fprintf(stderr, "zint_bench: cannot open \"%s\": %s\n", outfile, strerror(errno));
+        return 2;
+    }
+    if (!(times = (double *) malloc(sizeof(double) * iterations))) {
+        fputs("zint_bench: out of memory\n", stderr);
+        return 2;
+    }
+
+    (void) ZBarcode_SetAllocator(bench_malloc, bench_realloc, bench_free, NULL /*opaque*/);
+    if (!(symbol = ZBarcode_Create())) {
+        fputs("zint_bench: out of memory\n", stderr);
+        free(times);
+        return 2;
+    }
+
+    fprintf(fp, "{\n  \"zint_version\": %d,\n  \"iterations\": %d,\n  \"warmup\": %d,\n  \"results\": [\n",
+            ZBarcode_Version(), iterations, warmup);
+
+    for (i = 0; i < (int) (sizeof(bench_default_items) / sizeof(bench_default_items[0])); i++) {
+        regressions += bench_do(fp, symbol, &bench_default_items[i], BENCH_OP_ENCODE, NULL, iterations, warmup,
+                                times, filter, threshold, &count, &errors);
+    }
+    for (i = 0; i < (int) (sizeof(bench_large_items) / sizeof(bench_large_items[0])); i++) {
+        regressions += bench_do(fp, symbol, &bench_large_items[i], BENCH_OP_ENCODE, NULL, iterations, warmup,
+                                times, filter, threshold, &count, &errors);
+    }
+    for (i = 0; i < (int) (sizeof(bench_output_symbologies) / sizeof(bench_output_symbologies[0]))
+                        + (int) (sizeof(bench_output_large_idxs) / sizeof(bench_output_large_idxs[0])); i++) {
+        const struct bench_item *item = NULL;
+        if (i < (int) (sizeof(bench_output_symbologies) / sizeof(bench_output_symbologies[0]))) {
+            for (j = 0; j < (int) (sizeof(bench_default_items) / sizeof(bench_default_items[0])); j++) {
+                if (bench_default_items[j].symbology == bench_output_symbologies[i]) {
+                    item = &bench_default_items[j];
+                    break;
+                }
+            }
+        } else {
+            item = &bench_large_items[bench_output_large_idxs[i
+                        - (int) (sizeof(bench_output_symbologies) / sizeof(bench_output_symbologies[0]))]];
+        }
+        if (!item) {
+            continue;
+        }
+        for (k = BENCH_OP_BUFFER; k <= BENCH_OP_FILE; k++) {
+            if (k == BENCH_OP_FILE) {
+                for (j = 0; j < (int) (sizeof(bench_file_types) / sizeof(bench_file_types[0])); j++) {
+                    if (j == 0 && ZBarcode_NoPng()) {
+                        continue;
+                    }
+                    regressions += bench_do(fp, symbol, item, k, bench_file_types[j], iterations, warmup, times,
+                                            filter, threshold, &count, &errors);
+                }
+            } else {
+                regressions += bench_do(fp, symbol, item, k, NULL, iterations, warmup, times, filter, threshold,
+                                        &count, &errors);
+            }
+        }
+    }
+
+    fputs("\n  ]\n}\n", fp);
+
+    ZBarcode_Delete(symbol);
+    (void) ZBarcode_SetAllocator(NULL, NULL, NULL, NULL);
+    free(times);
+    if (outfile) {
+        fclose(fp);
+    }
+
+    if (baseline) {
+        fprintf(stderr, "zint_bench: %d benchmarks, %d errors, %d regressions (threshold %.1f%%)\n", count, errors,
+                regressions, threshold);
+    }
+
+    return errors || regressions ? 1 : 0;
+}
+
+/* vim: set ts=4 sw=4 et : */
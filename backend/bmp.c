@@ -38,7 +38,7 @@
 #include "output.h"
 #include "bmp.h"        /* Bitmap header structure */
 
-INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf) {
+INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, struct out_raster_rows *rows) {
     int i, row, column;
     int bits_per_pixel;
     int colour_count;
@@ -91,7 +91,7 @@ INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
         return errtxt(ZINT_ERROR_MEMORY, symbol, 606, "Output size too large for file size field of BMP header");
     }
 
-    if (!(rowbuf = (unsigned char *) malloc(row_size))) {
+    if (!(rowbuf = (unsigned char *) z_malloc(row_size))) {
         return errtxt(ZINT_ERROR_MEMORY, symbol, 602, "Insufficient memory for BMP row buffer");
     }
 
@@ -116,7 +116,7 @@ INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
     /* Open output file in binary mode */
     if (!fm_open(fmp, symbol, "wb")) {
         ZEXT errtxtf(0, symbol, 601, "Could not open BMP output file (%1$d: %2$s)", fmp->err, strerror(fmp->err));
-        free(rowbuf);
+        z_free(rowbuf);
         return ZINT_ERROR_FILE_ACCESS;
     }
 
@@ -138,7 +138,7 @@ INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
     /* Pixel Plotting */
     if (bits_per_pixel == 4) {
         for (row = 0; row < symbol->bitmap_height; row++) {
-            const unsigned char *pb = pixelbuf + ((size_t) symbol->bitmap_width * (symbol->bitmap_height - row - 1));
+            const unsigned char *pb = out_raster_row(rows, symbol->bitmap_height - row - 1);
             memset(rowbuf, 0, row_size);
             for (column = 0; column < symbol->bitmap_width; column++) {
                 rowbuf[column >> 1] |= map[pb[column]] << (!(column & 1) << 2);
@@ -147,7 +147,7 @@ INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
         }
     } else { /* bits_per_pixel == 1 */
         for (row = 0; row < symbol->bitmap_height; row++) {
-            const unsigned char *pb = pixelbuf + ((size_t) symbol->bitmap_width * (symbol->bitmap_height - row - 1));
+            const unsigned char *pb = out_raster_row(rows, symbol->bitmap_height - row - 1);
             memset(rowbuf, 0, row_size);
             for (column = 0; column < symbol->bitmap_width; column++) {
                 rowbuf[column >> 3] |= map[pb[column]] >> (column & 7);
@@ -155,7 +155,7 @@ INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
             fm_write(rowbuf, 1, row_size, fmp);
         }
     }
-    free(rowbuf);
+    z_free(rowbuf);
 
     if (fm_error(fmp)) {
         ZEXT errtxtf(0, symbol, 603, "Incomplete write of BMP output (%1$d: %2$s)", fmp->err, strerror(fmp->err));
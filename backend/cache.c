@@ -0,0 +1,436 @@
+/*  cache.c - LRU cache of encoded symbols */
+/*
+    libzint - the open source barcode library
+    Copyright (C) 2025 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+#include <assert.h>
+#include "cache.h"
+#ifdef ZINT_USE_PTHREADS /* May be set by "common.h" */
+#include <pthread.h>
+#elif defined(_WIN32) && !defined(ZINT_NO_THREADS)
+#include <windows.h>
+#endif
+
+/* Mutexes guarding each shard, no-ops if no thread support */
+#ifdef ZINT_USE_PTHREADS
+#define CACHE_SHARDS    16
+typedef pthread_mutex_t cache_mutex_t;
+#define cache_mutex_init(m)     pthread_mutex_init(m, NULL)
+#define cache_mutex_destroy(m)  (void) pthread_mutex_destroy(m)
+#define cache_mutex_lock(m)     (void) pthread_mutex_lock(m)
+#define cache_mutex_unlock(m)   (void) pthread_mutex_unlock(m)
+#elif defined(_WIN32) && !defined(ZINT_NO_THREADS)
+#define CACHE_SHARDS    16
+typedef CRITICAL_SECTION cache_mutex_t;
+#define cache_mutex_init(m)     (InitializeCriticalSection(m), 0)
+#define cache_mutex_destroy(m)  DeleteCriticalSection(m)
+#define cache_mutex_lock(m)     EnterCriticalSection(m)
+#define cache_mutex_unlock(m)   LeaveCriticalSection(m)
+#else
+#define CACHE_SHARDS    1
+typedef int cache_mutex_t;
+#define cache_mutex_init(m)     (*(m) = 0)
+#define cache_mutex_destroy(m)  (void) (m)
+#define cache_mutex_lock(m)     (void) (m)
+#define cache_mutex_unlock(m)   (void) (m)
+#endif
+
+/* Cached result of an encode, followed in the same allocation by `row_height[rows]`, then `encoded_data` as
+   `rows` x `row_bytes`, then the key data */
+struct cache_entry {
+    struct cache_entry *next; /* Next in hash bucket chain */
+    struct cache_entry *lru_prev; /* More recently used */
+    struct cache_entry *lru_next; /* Less recently used */
+    unsigned int hash;
+    int key_length;
+    int error_number;
+    int symbology;
+    float height;
+    int whitespace_width;
+    int whitespace_height;
+    int border_width;
+    int output_options;
+    char primary[128];
+    int option_1;
+    int option_2;
+    int option_3;
+    int input_mode;
+    int eci;
+    unsigned char text[256];
+    int text_length;
+    int rows;
+    int width;
+    int row_bytes;
+    struct zint_estimate estimate;
+    char errtxt[100];
+};
+
+struct cache_shard {
+    cache_mutex_t mutex;
+    struct cache_entry **buckets;
+    unsigned int bucket_mask; /* Number of buckets less 1, buckets a power of 2 */
+    struct cache_entry *lru_head; /* Most recently used */
+    struct cache_entry *lru_tail; /* Least recently used, evicted first */
+    int count;
+    int capacity;
+};
+
+/* Allocated with plain `malloc()` etc. throughout as the cache outlives any allocator set by
+   `ZBarcode_SetAllocator()` */
+static struct cache_shard *cache_shards;
+static int cache_shard_count;
+
+#define CACHE_ROW_HEIGHTS(e)    ((float *) ((e) + 1))
+#define CACHE_ENCODED_DATA(e)   ((unsigned char *) (CACHE_ROW_HEIGHTS(e) + (e)->rows))
+#define CACHE_KEY_DATA(e)       (CACHE_ENCODED_DATA(e) + (e)->rows * (e)->row_bytes)
+
+/* Free all entries of shard, and its buckets */
+static void cache_shard_free(struct cache_shard *shard) {
+    struct cache_entry *entry, *next;
+
+    for (entry = shard->lru_head; entry; entry = next) {
+        next = entry->lru_next;
+        free(entry);
+    }
+    free(shard->buckets);
+    cache_mutex_destroy(&shard->mutex);
+}
+
+/* Set maximum number of entries, 0 to disable and free, returning 0 on success, ZINT_ERROR_MEMORY on failure.
+   Not thread-safe, i.e. must not be called while other threads are encoding */
+INTERNAL int cache_set_size(const int max_entries) {
+    int i;
+
+    assert(max_entries >= 0 && max_entries <= CACHE_MAX_ENTRIES);
+
+    for (i = 0; i < cache_shard_count; i++) {
+        cache_shard_free(cache_shards + i);
+    }
+    free(cache_shards);
+    cache_shards = NULL;
+    cache_shard_count = 0;
+
+    if (max_entries == 0) {
+        return 0;
+    }
+
+    cache_shard_count = max_entries < CACHE_SHARDS ? max_entries : CACHE_SHARDS;
+    if (!(cache_shards = (struct cache_shard *) calloc(cache_shard_count, sizeof(struct cache_shard)))) {
+        cache_shard_count = 0;
+        return ZINT_ERROR_MEMORY;
+    }
+    for (i = 0; i < cache_shard_count; i++) {
+        struct cache_shard *shard = cache_shards + i;
+        unsigned int bucket_count = 8;
+
+        /* Spread any remainder over the first shards */
+        shard->capacity = max_entries / cache_shard_count + (i < max_entries % cache_shard_count);
+        while (bucket_count < (unsigned int) shard->capacity) {
+            bucket_count <<= 1;
+        }
+        shard->bucket_mask = bucket_count - 1;
+        if (!(shard->buckets = (struct cache_entry **) calloc(bucket_count, sizeof(struct cache_entry *)))
+                || cache_mutex_init(&shard->mutex) != 0) {
+            free(shard->buckets);
+            cache_shard_count = i; /* Previous shards only */
+            (void) cache_set_size(0);
+            return ZINT_ERROR_MEMORY;
+        }
+    }
+
+    return 0;
+}
+
+/* Whether cache enabled */
+INTERNAL int cache_enabled(void) {
+    return cache_shard_count != 0;
+}
+
+/* Append `length` bytes of `src` to key data at `*p_d` */
+static void cache_key_add(unsigned char **p_d, const void *src, const int length) {
+    memcpy(*p_d, src, length);
+    *p_d += length;
+}
+
+/* Size of `symbol` fields serialized by `cache_key()`, excluding primary */
+#define CACHE_KEY_FIELDS_SIZE   (sizeof(int) * 15 + sizeof(float) * 5 + 32)
+
+/* Make key for encoding `segs` with the current settings of `symbol`, returning 1 on success, 0 if uncacheable or
+   allocation fails. On success `key->data` must be freed with `cache_key_free()` */
+INTERNAL int cache_key(const struct zint_symbol *symbol, const struct zint_seg segs[], const int seg_count,
+                    struct cache_key *key) {
+    int lengths[ZINT_MAX_SEG_COUNT];
+    int primary_len;
+    int total_len = 0;
+    int i;
+    unsigned int hash;
+    unsigned char *d;
+
+    /* Stacking (`rows` set) and debug printing are never cached, and nor are bad segments, left for
+       `ZBarcode_Encode_Segs()` to report */
+    if (symbol->rows != 0 || (symbol->debug & ZINT_DEBUG_PRINT) || segs == NULL || seg_count <= 0
+            || seg_count > ZINT_MAX_SEG_COUNT) {
+        return 0;
+    }
+    for (i = 0; i < seg_count; i++) {
+        if (segs[i].source == NULL) {
+            return 0;
+        }
+        lengths[i] = segs[i].length > 0 ? segs[i].length : (int) ustrlen(segs[i].source);
+        /* Allow for escape sequences */
+        if (lengths[i] > ZINT_MAX_DATA_LEN * 4 || (total_len += lengths[i]) > ZINT_MAX_DATA_LEN * 4) {
+            return 0;
+        }
+    }
+    for (primary_len = 0; primary_len < (int) sizeof(symbol->primary) && symbol->primary[primary_len];
+            primary_len++);
+
+    key->length = (int) CACHE_KEY_FIELDS_SIZE + (int) sizeof(int) + primary_len
+                    + (int) sizeof(int) * (1 + seg_count * 2) + total_len;
+    if (!(key->data = (unsigned char *) malloc(key->length))) {
+        return 0;
+    }
+
+    d = key->data;
+    cache_key_add(&d, &symbol->symbology, sizeof(int));
+    cache_key_add(&d, &symbol->height, sizeof(float));
+    cache_key_add(&d, &symbol->scale, sizeof(float));
+    cache_key_add(&d, &symbol->whitespace_width, sizeof(int));
+    cache_key_add(&d, &symbol->whitespace_height, sizeof(int));
+    cache_key_add(&d, &symbol->border_width, sizeof(int));
+    cache_key_add(&d, &symbol->output_options, sizeof(int));
+    cache_key_add(&d, &symbol->option_1, sizeof(int));
+    cache_key_add(&d, &symbol->option_2, sizeof(int));
+    cache_key_add(&d, &symbol->option_3, sizeof(int));
+    cache_key_add(&d, &symbol->show_hrt, sizeof(int));
+    cache_key_add(&d, &symbol->input_mode, sizeof(int));
+    cache_key_add(&d, &symbol->eci, sizeof(int));
+    cache_key_add(&d, &symbol->dot_size, sizeof(float));
+    cache_key_add(&d, &symbol->text_gap, sizeof(float));
+    cache_key_add(&d, &symbol->guard_descent, sizeof(float));
+    cache_key_add(&d, &symbol->structapp.index, sizeof(int));
+    cache_key_add(&d, &symbol->structapp.count, sizeof(int));
+    cache_key_add(&d, symbol->structapp.id, 32);
+    cache_key_add(&d, &symbol->warn_level, sizeof(int));
+    cache_key_add(&d, &symbol->debug, sizeof(int));
+    cache_key_add(&d, &primary_len, sizeof(int));
+    cache_key_add(&d, symbol->primary, primary_len);
+    cache_key_add(&d, &seg_count, sizeof(int));
+    for (i = 0; i < seg_count; i++) {
+        cache_key_add(&d, &segs[i].eci, sizeof(int));
+        cache_key_add(&d, lengths + i, sizeof(int));
+        cache_key_add(&d, segs[i].source, lengths[i]);
+    }
+    assert(d == key->data + key->length);
+
+    /* FNV-1a */
+    for (i = 0, hash = 2166136261u; i < key->length; i++) {
+        hash = (hash ^ key->data[i]) * 16777619u;
+    }
+    key->hash = hash;
+
+    return 1;
+}
+
+/* Free `key->data` */
+INTERNAL void cache_key_free(struct cache_key *key) {
+    free(key->data);
+    key->data = NULL;
+}
+
+/* Shard for `hash`, using high bits as low bits select bucket */
+static struct cache_shard *cache_shard(const unsigned int hash) {
+    return cache_shards + (hash >> 20) % cache_shard_count;
+}
+
+/* Find entry for `key` in `shard`, returning pointer to the link pointing to it (or to the NULL end of chain) */
+static struct cache_entry **cache_find(struct cache_shard *shard, const struct cache_key *key) {
+    struct cache_entry **p_entry = shard->buckets + (key->hash & shard->bucket_mask);
+
+    while (*p_entry && ((*p_entry)->hash != key->hash || (*p_entry)->key_length != key->length
+                        || memcmp(CACHE_KEY_DATA(*p_entry), key->data, key->length) != 0)) {
+        p_entry = &(*p_entry)->next;
+    }
+    return p_entry;
+}
+
+/* Remove `entry` from LRU list */
+static void cache_lru_unlink(struct cache_shard *shard, struct cache_entry *entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        shard->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        shard->lru_tail = entry->lru_prev;
+    }
+}
+
+/* Add `entry` to front (most recently used) of LRU list */
+static void cache_lru_push(struct cache_shard *shard, struct cache_entry *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+    if (shard->lru_head) {
+        shard->lru_head->lru_prev = entry;
+    } else {
+        shard->lru_tail = entry;
+    }
+    shard->lru_head = entry;
+}
+
+/* If `key` cached, copy its result into `symbol`, setting `p_error_number` and returning 1, else return 0 */
+INTERNAL int cache_get(struct zint_symbol *symbol, const struct cache_key *key, int *p_error_number) {
+    struct cache_shard *shard = cache_shard(key->hash);
+    struct cache_entry *entry;
+    const unsigned char *encoded_data;
+    int i;
+
+    cache_mutex_lock(&shard->mutex);
+
+    if (!(entry = *cache_find(shard, key))) {
+        cache_mutex_unlock(&shard->mutex);
+        return 0;
+    }
+    if (entry != shard->lru_head) {
+        cache_lru_unlink(shard, entry);
+        cache_lru_push(shard, entry);
+    }
+
+    symbol->symbology = entry->symbology;
+    symbol->height = entry->height;
+    symbol->whitespace_width = entry->whitespace_width;
+    symbol->whitespace_height = entry->whitespace_height;
+    symbol->border_width = entry->border_width;
+    symbol->output_options = entry->output_options;
+    memcpy(symbol->primary, entry->primary, sizeof(symbol->primary));
+    symbol->option_1 = entry->option_1;
+    symbol->option_2 = entry->option_2;
+    symbol->option_3 = entry->option_3;
+    symbol->input_mode = entry->input_mode;
+    symbol->eci = entry->eci;
+    memcpy(symbol->text, entry->text, sizeof(symbol->text));
+    symbol->text_length = entry->text_length;
+    symbol->rows = entry->rows;
+    symbol->width = entry->width;
+    symbol->estimate = entry->estimate;
+    memcpy(symbol->row_height, CACHE_ROW_HEIGHTS(entry), sizeof(float) * entry->rows);
+    for (i = 0, encoded_data = CACHE_ENCODED_DATA(entry); i < entry->rows; i++, encoded_data += entry->row_bytes) {
+        memcpy(symbol->encoded_data[i], encoded_data, entry->row_bytes);
+        memset(symbol->encoded_data[i] + entry->row_bytes, 0, sizeof(symbol->encoded_data[0]) - entry->row_bytes);
+    }
+    memcpy(symbol->errtxt, entry->errtxt, sizeof(symbol->errtxt));
+    *p_error_number = entry->error_number;
+
+    cache_mutex_unlock(&shard->mutex);
+
+    return 1;
+}
+
+/* Add result of encoding `symbol` with return `error_number` under `key`, evicting least recently used entry if
+   full */
+INTERNAL void cache_put(const struct zint_symbol *symbol, const struct cache_key *key, const int error_number) {
+    struct cache_shard *shard = cache_shard(key->hash);
+    struct cache_entry *entry, *evicted = NULL;
+    struct cache_entry **p_entry;
+    unsigned char *encoded_data;
+    int row_bytes;
+    int i;
+
+    if (symbol->rows <= 0 || symbol->rows > 200) {
+        return;
+    }
+    /* Ultracode uses a byte per module for colour */
+    row_bytes = symbol->symbology == BARCODE_ULTRA ? symbol->width : (symbol->width + 7) >> 3;
+    if (row_bytes > (int) sizeof(symbol->encoded_data[0])) {
+        row_bytes = (int) sizeof(symbol->encoded_data[0]);
+    }
+
+    if (!(entry = (struct cache_entry *) malloc(sizeof(struct cache_entry) + sizeof(float) * symbol->rows
+                                                    + row_bytes * symbol->rows + key->length))) {
+        return; /* Not an error, just don't cache */
+    }
+    entry->next = NULL;
+    entry->hash = key->hash;
+    entry->key_length = key->length;
+    entry->error_number = error_number;
+    entry->symbology = symbol->symbology;
+    entry->height = symbol->height;
+    entry->whitespace_width = symbol->whitespace_width;
+    entry->whitespace_height = symbol->whitespace_height;
+    entry->border_width = symbol->border_width;
+    entry->output_options = symbol->output_options;
+    memcpy(entry->primary, symbol->primary, sizeof(entry->primary));
+    entry->option_1 = symbol->option_1;
+    entry->option_2 = symbol->option_2;
+    entry->option_3 = symbol->option_3;
+    entry->input_mode = symbol->input_mode;
+    entry->eci = symbol->eci;
+    memcpy(entry->text, symbol->text, sizeof(entry->text));
+    entry->text_length = symbol->text_length;
+    entry->rows = symbol->rows;
+    entry->width = symbol->width;
+    entry->estimate = symbol->estimate;
+    entry->row_bytes = row_bytes;
+    memcpy(CACHE_ROW_HEIGHTS(entry), symbol->row_height, sizeof(float) * symbol->rows);
+    for (i = 0, encoded_data = CACHE_ENCODED_DATA(entry); i < symbol->rows; i++, encoded_data += row_bytes) {
+        memcpy(encoded_data, symbol->encoded_data[i], row_bytes);
+    }
+    memcpy(entry->errtxt, symbol->errtxt, sizeof(entry->errtxt));
+    memcpy(CACHE_KEY_DATA(entry), key->data, key->length);
+
+    cache_mutex_lock(&shard->mutex);
+
+    p_entry = cache_find(shard, key);
+    if (*p_entry) { /* Already added by another thread */
+        cache_mutex_unlock(&shard->mutex);
+        free(entry);
+        return;
+    }
+    *p_entry = entry;
+    cache_lru_push(shard, entry);
+
+    if (shard->count == shard->capacity) {
+        evicted = shard->lru_tail;
+        cache_lru_unlink(shard, evicted);
+        for (p_entry = shard->buckets + (evicted->hash & shard->bucket_mask); *p_entry != evicted;
+                p_entry = &(*p_entry)->next);
+        *p_entry = evicted->next;
+    } else {
+        shard->count++;
+    }
+
+    cache_mutex_unlock(&shard->mutex);
+
+    free(evicted);
+}
+
+/* vim: set ts=4 sw=4 et : */
@@ -0,0 +1,78 @@
+/*  cache.h - LRU cache of encoded symbols */
+/*
+    libzint - the open source barcode library
+    Copyright (C) 2025 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+#ifndef Z_CACHE_H
+#define Z_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "common.h"
+
+#define CACHE_MAX_ENTRIES   0x100000 /* 1M */
+
+/* Key of a `ZBarcode_Encode_Segs()` call, made by `cache_key()` */
+struct cache_key {
+    unsigned char *data; /* Serialized encodation-affecting symbol fields followed by the segments */
+    int length;         /* Length of `data` */
+    unsigned int hash;  /* Hash of `data` */
+};
+
+/* Set maximum number of entries, 0 to disable and free, returning 0 on success, ZINT_ERROR_MEMORY on failure.
+   Not thread-safe, i.e. must not be called while other threads are encoding */
+INTERNAL int cache_set_size(const int max_entries);
+
+/* Whether cache enabled */
+INTERNAL int cache_enabled(void);
+
+/* Make key for encoding `segs` with the current settings of `symbol`, returning 1 on success, 0 if uncacheable or
+   allocation fails. On success `key->data` must be freed with `cache_key_free()` */
+INTERNAL int cache_key(const struct zint_symbol *symbol, const struct zint_seg segs[], const int seg_count,
+                    struct cache_key *key);
+
+/* Free `key->data` */
+INTERNAL void cache_key_free(struct cache_key *key);
+
+/* If `key` cached, copy its result into `symbol`, setting `p_error_number` and returning 1, else return 0 */
+INTERNAL int cache_get(struct zint_symbol *symbol, const struct cache_key *key, int *p_error_number);
+
+/* Add result of encoding `symbol` with return `error_number` under `key`, evicting least recently used entry if
+   full */
+INTERNAL void cache_put(const struct zint_symbol *symbol, const struct cache_key *key, const int error_number);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+/* vim: set ts=4 sw=4 et : */
+#endif /* Z_CACHE_H */
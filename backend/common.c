@@ -33,8 +33,79 @@
 #include <assert.h>
 #include <stdarg.h>
 #include <stdio.h>
+#ifdef ZINT_STATS
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#endif
 #include "common.h"
 
+/* Allocation functions set by `ZBarcode_SetAllocator()`, NULL for defaults */
+static zint_malloc_func_t z_malloc_func;
+static zint_realloc_func_t z_realloc_func;
+static zint_free_func_t z_free_func;
+static void *z_alloc_opaque;
+
+/* Memory allocation via functions set by `ZBarcode_SetAllocator()` (default `malloc()` etc.) */
+INTERNAL void *z_malloc(const size_t size) {
+    return z_malloc_func ? z_malloc_func(z_alloc_opaque, size) : malloc(size);
+}
+
+/* As `z_malloc()` but zeroes memory, also checking `nmemb` * `size` for overflow */
+INTERNAL void *z_calloc(const size_t nmemb, const size_t size) {
+    void *ptr;
+
+    if (!z_malloc_func) {
+        return calloc(nmemb, size);
+    }
+    if (size && nmemb > (size_t) -1 / size) {
+        return NULL;
+    }
+    if ((ptr = z_malloc_func(z_alloc_opaque, nmemb * size))) {
+        memset(ptr, 0, nmemb * size);
+    }
+    return ptr;
+}
+
+/* As `realloc()`, `old_size` being the current size of `ptr` (used if no realloc function set) */
+INTERNAL void *z_realloc(void *ptr, const size_t old_size, const size_t size) {
+    void *new_ptr;
+
+    if (!z_malloc_func) {
+        return realloc(ptr, size);
+    }
+    if (z_realloc_func) {
+        return z_realloc_func(z_alloc_opaque, ptr, size);
+    }
+    if ((new_ptr = z_malloc_func(z_alloc_opaque, size)) && ptr) {
+        memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+        z_free_func(z_alloc_opaque, ptr);
+    }
+    return new_ptr;
+}
+
+/* Frees memory allocated by `z_malloc()` etc. Does nothing if `ptr` NULL */
+INTERNAL void z_free(void *ptr) {
+    if (ptr) {
+        if (z_free_func) {
+            z_free_func(z_alloc_opaque, ptr);
+        } else {
+            free(ptr);
+        }
+    }
+}
+
+/* Sets allocation functions (see `ZBarcode_SetAllocator()`) */
+INTERNAL void z_set_allocator(zint_malloc_func_t malloc_func, zint_realloc_func_t realloc_func,
+                zint_free_func_t free_func, void *opaque) {
+    z_malloc_func = malloc_func;
+    z_realloc_func = malloc_func ? realloc_func : NULL;
+    z_free_func = free_func;
+    z_alloc_opaque = malloc_func ? opaque : NULL;
+}
+
 /* Converts a character 0-9, A-F to its equivalent integer value */
 INTERNAL int ctoi(const char source) {
     if (z_isdigit(source))
@@ -207,6 +278,84 @@ INTERNAL void unset_module(struct zint_symbol *symbol, const int y_coord, const
 
 #endif /* Z_COMMON_INLINE */
 
+/* Packs row `y_coord` of (non-colour) module matrix into `(symbol->width + 63) / 64` 64-bit `words`, least
+   significant bit first */
+INTERNAL void module_row_words(const struct zint_symbol *symbol, const int y_coord, uint64_t *words) {
+    const unsigned char *row = symbol->encoded_data[y_coord];
+    const int width = symbol->width;
+    const int byte_cnt = (width + 7) >> 3;
+    const int word_cnt = (width + 63) >> 6;
+    int i, j;
+
+    for (i = 0; i < word_cnt; i++) {
+        const int end = byte_cnt - (i << 3) < 8 ? byte_cnt - (i << 3) : 8;
+        uint64_t word = 0;
+        for (j = end - 1; j >= 0; j--) {
+            word = (word << 8) | row[(i << 3) + j];
+        }
+        words[i] = word;
+    }
+    if (width & 0x3F) { /* Mask off any bits past `width` */
+        words[word_cnt - 1] &= ((uint64_t) 1 << (width & 0x3F)) - 1;
+    }
+}
+
+/* Count trailing zeroes of non-zero `x` */
+static int ctz_u64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    if (!(x & 0xFFFFFFFF)) { n += 32; x >>= 32; }
+    if (!(x & 0xFFFF)) { n += 16; x >>= 16; }
+    if (!(x & 0xFF)) { n += 8; x >>= 8; }
+    if (!(x & 0xF)) { n += 4; x >>= 4; }
+    if (!(x & 0x3)) { n += 2; x >>= 2; }
+    return n + (int) !(x & 0x1);
+#endif
+}
+
+/* Places start & length pairs of the runs of dark modules in row `y_coord` of (non-colour) module matrix in `runs`,
+   which must have room for `symbol->width + 1` entries, scanning 64 modules at a time. Returns number of runs */
+INTERNAL int module_row_runs(const struct zint_symbol *symbol, const int y_coord, int *runs) {
+    uint64_t words[(sizeof(symbol->encoded_data[0]) * 8 + 63) / 64];
+    const int word_cnt = (symbol->width + 63) >> 6;
+    int w = 0, count = 0;
+    uint64_t word;
+
+    if (word_cnt == 0) {
+        return 0;
+    }
+    module_row_words(symbol, y_coord, words);
+
+    word = words[0];
+    while (1) {
+        int start, end;
+        /* Next dark module */
+        while (!word) {
+            if (++w == word_cnt) {
+                return count >> 1;
+            }
+            word = words[w];
+        }
+        start = (w << 6) + ctz_u64(word);
+        /* Next light module (padding past `width` is light) */
+        word = ~words[w] & (~(uint64_t) 0 << (start & 0x3F));
+        while (!word) {
+            if (++w == word_cnt) {
+                runs[count++] = start;
+                runs[count++] = symbol->width - start;
+                return count >> 1;
+            }
+            word = ~words[w];
+        }
+        end = (w << 6) + ctz_u64(word);
+        runs[count++] = start;
+        runs[count++] = end - start;
+        word = words[w] & (~(uint64_t) 0 << (end & 0x3F));
+    }
+}
+
 /* Expands from a width pattern to a bit pattern */
 INTERNAL void expand(struct zint_symbol *symbol, const char data[], const int length) {
 
@@ -960,6 +1109,47 @@ INTERNAL void segs_cpy(const struct zint_symbol *symbol, const struct zint_seg s
     }
 }
 
+/* Sets `symbol->estimate` to the selected size. Returns 1 if only estimating (`ZINT_DEBUG_ESTIMATE` set), in which
+   case the encoder should feed back its options and return, else 0 */
+INTERNAL int estimate_set(struct zint_symbol *symbol, const int version, const int rows, const int width,
+                const int data_codewords, const int codewords) {
+    symbol->estimate.version = version;
+    symbol->estimate.rows = rows;
+    symbol->estimate.width = width;
+    symbol->estimate.data_codewords = data_codewords;
+    symbol->estimate.codewords = codewords;
+
+    return (symbol->debug & ZINT_DEBUG_ESTIMATE) ? 1 : 0;
+}
+
+#ifdef ZINT_STATS
+/* Monotonic clock in nanoseconds */
+INTERNAL uint64_t stats_now(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq; /* Benign race, always set to same value */
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t) (count.QuadPart / freq.QuadPart) * 1000000000
+            + (uint64_t) (count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/* Adds time elapsed since `begin` (from `stats_now()`) to `symbol->stats` stage `stage`, and bumps its call count */
+INTERNAL void stats_add(struct zint_symbol *symbol, const int stage, const uint64_t begin) {
+    symbol->stats.ns[stage] += stats_now() - begin;
+    symbol->stats.calls[stage]++;
+}
+#endif /* ZINT_STATS */
+
 /* Helper for ZINT_DEBUG_PRINT to put all but graphical ASCII in hex escapes. Output to `buf` if non-NULL, else
    stdout */
 INTERNAL char *debug_print_escape(const unsigned char *source, const int first_len, char *buf) {
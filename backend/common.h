@@ -33,6 +33,16 @@
 #ifndef Z_COMMON_H
 #define Z_COMMON_H
 
+/* Use POSIX threads (for `ZBarcode_Encode_Batch()` and locking the process-wide caches) if available, unless the
+   build says otherwise (CMake defines ZINT_USE_PTHREADS or ZINT_NO_THREADS) */
+#if !defined(ZINT_USE_PTHREADS) && !defined(ZINT_NO_THREADS) && !defined(_WIN32) \
+        && (defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__)))
+#include <unistd.h>
+#if defined(_POSIX_THREADS) && _POSIX_THREADS > 0
+#define ZINT_USE_PTHREADS
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -151,6 +161,18 @@ typedef unsigned __int64 uint64_t;
 /* Converts an integer value to its hexadecimal digit */
 #define xtoc(i) ((i) < 10 ? itoc(i) : ((i) - 10) + 'A')
 
+/* Memory allocation via functions set by `ZBarcode_SetAllocator()` (default `malloc()` etc.) */
+INTERNAL void *z_malloc(const size_t size);
+/* As `z_malloc()` but zeroes memory, also checking `nmemb` * `size` for overflow */
+INTERNAL void *z_calloc(const size_t nmemb, const size_t size);
+/* As `realloc()`, `old_size` being the current size of `ptr` (used if no realloc function set) */
+INTERNAL void *z_realloc(void *ptr, const size_t old_size, const size_t size);
+/* Frees memory allocated by `z_malloc()` etc. Does nothing if `ptr` NULL */
+INTERNAL void z_free(void *ptr);
+/* Sets allocation functions (see `ZBarcode_SetAllocator()`) */
+INTERNAL void z_set_allocator(zint_malloc_func_t malloc_func, zint_realloc_func_t realloc_func,
+                zint_free_func_t free_func, void *opaque);
+
 /* Converts a character 0-9, A-F to its equivalent integer value */
 INTERNAL int ctoi(const char source);
 
@@ -237,6 +259,14 @@ INTERNAL void unset_module(struct zint_symbol *symbol, const int y_coord, const
 
 #endif /* Z_COMMON_INLINE */
 
+/* Packs row `y_coord` of (non-colour) module matrix into `(symbol->width + 63) / 64` 64-bit `words`, least
+   significant bit first */
+INTERNAL void module_row_words(const struct zint_symbol *symbol, const int y_coord, uint64_t *words);
+
+/* Places start & length pairs of the runs of dark modules in row `y_coord` of (non-colour) module matrix in `runs`,
+   which must have room for `symbol->width + 1` entries, scanning 64 modules at a time. Returns number of runs */
+INTERNAL int module_row_runs(const struct zint_symbol *symbol, const int y_coord, int *runs);
+
 
 /* Expands from a width pattern to a bit pattern */
 INTERNAL void expand(struct zint_symbol *symbol, const char data[], const int length);
@@ -342,6 +372,29 @@ INTERNAL void segs_cpy(const struct zint_symbol *symbol, const struct zint_seg s
                 struct zint_seg local_segs[]);
 
 
+/* Internal `symbol->debug` flag set by `ZBarcode_Estimate()` to have encoders return once the size is selected */
+#define ZINT_DEBUG_ESTIMATE     0x40000000
+
+/* Sets `symbol->estimate` to the selected size. Returns 1 if only estimating (`ZINT_DEBUG_ESTIMATE` set), in which
+   case the encoder should feed back its options and return, else 0 */
+INTERNAL int estimate_set(struct zint_symbol *symbol, const int version, const int rows, const int width,
+                const int data_codewords, const int codewords);
+
+#ifdef ZINT_STATS
+/* Monotonic clock in nanoseconds */
+INTERNAL uint64_t stats_now(void);
+
+/* Adds time elapsed since `begin` (from `stats_now()`) to `symbol->stats` stage `stage`, and bumps its call count */
+INTERNAL void stats_add(struct zint_symbol *symbol, const int stage, const uint64_t begin);
+
+/* Wrap a stage in a block, timing it if built with ZINT_STATS. Must not be exited other than via `STATS_END()` */
+#define STATS_BEGIN(symbol, stage) { const uint64_t stats_begin_ = stats_now();
+#define STATS_END(symbol, stage) stats_add((symbol), (stage), stats_begin_); }
+#else
+#define STATS_BEGIN(symbol, stage) {
+#define STATS_END(symbol, stage) }
+#endif
+
 /* Helper for ZINT_DEBUG_PRINT to put all but graphical ASCII in hex escapes. Output to `buf` if non-NULL, else
    stdout */
 INTERNAL char *debug_print_escape(const unsigned char *source, const int first_len, char *buf);
@@ -982,7 +982,7 @@ static int dm_define_mode(struct zint_symbol *symbol, char modes[], const unsign
     int current_mode;
     int mode_end, mode_len;
 
-    struct dm_edge *edges = (struct dm_edge *) calloc((length + 1) * DM_NUM_MODES, sizeof(struct dm_edge));
+    struct dm_edge *edges = (struct dm_edge *) z_calloc((length + 1) * DM_NUM_MODES, sizeof(struct dm_edge));
     if (!edges) {
         return 0;
     }
@@ -1043,7 +1043,7 @@ static int dm_define_mode(struct zint_symbol *symbol, char modes[], const unsign
     }
     assert(mode_end == 0);
 
-    free(edges);
+    z_free(edges);
 
     return 1;
 }
@@ -1847,7 +1847,9 @@ static int dm_ecc200(struct zint_symbol *symbol, struct zint_seg segs[], const i
     const int debug_print = symbol->debug & ZINT_DEBUG_PRINT;
 
     /* `length` may be decremented by 2 if macro character is used */
+    STATS_BEGIN(symbol, ZINT_STATS_MODES);
     error_number = dm_encode_segs(symbol, segs, seg_count, binary, &binlen);
+    STATS_END(symbol, ZINT_STATS_MODES);
     if (error_number != 0) {
         return error_number;
     }
@@ -1882,6 +1884,10 @@ static int dm_ecc200(struct zint_symbol *symbol, struct zint_seg segs[], const i
     datablock = dm_matrixdatablock[symbolsize];
     rsblock = dm_matrixrsblock[symbolsize];
 
+    if (estimate_set(symbol, symbol->option_2, H, W, bytes, bytes + rsblock * ((bytes + 2) / datablock))) {
+        return error_number;
+    }
+
     taillength = bytes - binlen;
 
     if (taillength != 0) {
@@ -1897,7 +1903,9 @@ static int dm_ecc200(struct zint_symbol *symbol, struct zint_seg segs[], const i
     if (symbolsize == DMINTSYMBOL144 && !(symbol->option_3 & DM_ISO_144)) {
         skew = 1;
     }
+    STATS_BEGIN(symbol, ZINT_STATS_RS);
     dm_ecc(binary, bytes, datablock, rsblock, skew);
+    STATS_END(symbol, ZINT_STATS_RS);
     if (debug_print) {
         printf("ECC (%d): ", rsblock * (bytes / datablock));
         for (i = bytes; i < bytes + rsblock * (bytes / datablock); i++) printf("%d ", binary[i]);
@@ -1913,7 +1921,7 @@ static int dm_ecc200(struct zint_symbol *symbol, struct zint_seg segs[], const i
         const int NC = W - 2 * (W / FW);
         const int NR = H - 2 * (H / FH);
         int x, y, *places;
-        if (!(places = (int *) calloc((size_t) NC * (size_t) NR, sizeof(int)))) {
+        if (!(places = (int *) z_calloc((size_t) NC * (size_t) NR, sizeof(int)))) {
             return errtxt(ZINT_ERROR_MEMORY, symbol, 718, "Insufficient memory for placement array");
         }
         dm_placement(places, NR, NC);
@@ -1951,7 +1959,7 @@ static int dm_ecc200(struct zint_symbol *symbol, struct zint_seg segs[], const i
         for (y = 0; y < H; y++) {
             symbol->row_height[y] = 1;
         }
-        free(places);
+        z_free(places);
     }
 
     symbol->height = H;
@@ -1423,6 +1423,7 @@ INTERNAL int dotcode(struct zint_symbol *symbol, struct zint_seg segs[], const i
             printf("Applying mask %d (specified)\n", best_mask);
         }
     } else {
+        STATS_BEGIN(symbol, ZINT_STATS_MASK);
         /* Evaluate data mask options */
         for (i = 0; i < 4; i++) {
 
@@ -1494,6 +1495,7 @@ INTERNAL int dotcode(struct zint_symbol *symbol, struct zint_seg segs[], const i
         if (debug_print) {
             printf("Applying mask %d, high_score %d\n", best_mask, high_score);
         }
+        STATS_END(symbol, ZINT_STATS_MASK);
     }
 
     /* Apply best mask */
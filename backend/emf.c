@@ -635,9 +635,9 @@ INTERNAL int emf_plot(struct zint_symbol *symbol, int rotate_angle) {
             assert(string->length > 0);
             utfle_len = emf_utfle_length(string->text, string->length);
             text_bumped_lens[this_text] = emf_bump_up(utfle_len);
-            if (!(this_string[this_text] = (unsigned char *) malloc(text_bumped_lens[this_text]))) {
+            if (!(this_string[this_text] = (unsigned char *) z_malloc(text_bumped_lens[this_text]))) {
                 for (i = 0; i < this_text; i++) {
-                    free(this_string[i]);
+                    z_free(this_string[i]);
                 }
                 return errtxt(ZINT_ERROR_MEMORY, symbol, 641, "Insufficient memory for EMF string buffer");
             }
@@ -814,7 +814,7 @@ INTERNAL int emf_plot(struct zint_symbol *symbol, int rotate_angle) {
         }
         fm_write(&text[i], sizeof(emr_exttextoutw_t), 1, fmp);
         fm_write(this_string[i], text_bumped_lens[i], 1, fmp);
-        free(this_string[i]);
+        z_free(this_string[i]);
     }
 
     fm_write(&emr_eof, sizeof(emr_eof_t), 1, fmp);
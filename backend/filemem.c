@@ -80,7 +80,7 @@ static void fm_setpos(struct filemem *restrict const fmp, const size_t pos) {
 /* Helper to clear memory buffer and associates */
 static void fm_clear_mem(struct filemem *restrict const fmp) {
     if (fmp->mem) {
-        free(fmp->mem);
+        z_free(fmp->mem);
         fmp->mem = NULL;
     }
     fmp->memsize = fmp->mempos = fmp->memend = 0;
@@ -105,18 +105,27 @@ INTERNAL int fm_open(struct filemem *restrict const fmp, struct zint_symbol *sym
 #endif
 
     if (fmp->flags & BARCODE_MEMORY_FILE) {
-        if (!(fmp->mem = (unsigned char *) malloc(FM_PAGE_SIZE))) {
-            return fm_seterr(fmp, ENOMEM);
-        }
+        if (symbol->memfile && (symbol->output_options & BARCODE_RETAIN_BUFFERS)
+                && symbol->memfile_capacity >= FM_PAGE_SIZE) {
+            /* Take over previous buffer */
+            fmp->mem = symbol->memfile;
+            fmp->memsize = symbol->memfile_capacity;
+            symbol->memfile = NULL;
+        } else {
+            if (symbol->memfile) {
+                z_free(symbol->memfile);
+                symbol->memfile = NULL;
+            }
+            if (!(fmp->mem = (unsigned char *) z_malloc(FM_PAGE_SIZE))) {
+                symbol->memfile_size = symbol->memfile_capacity = 0;
+                return fm_seterr(fmp, ENOMEM);
+            }
 #ifdef ZINT_SANITIZEM /* Suppress clang -fsanitize=memory false positive */
-        memset(fmp->mem, 0, FM_PAGE_SIZE);
+            memset(fmp->mem, 0, FM_PAGE_SIZE);
 #endif
-        fmp->memsize = FM_PAGE_SIZE;
-        if (symbol->memfile) {
-            free(symbol->memfile);
-            symbol->memfile = NULL;
+            fmp->memsize = FM_PAGE_SIZE;
         }
-        symbol->memfile_size = 0;
+        symbol->memfile_size = symbol->memfile_capacity = 0;
         return 1;
     }
     if (fmp->flags & BARCODE_STDOUT) {
@@ -159,7 +168,8 @@ static int fm_mem_expand(struct filemem *restrict const fmp, const size_t size)
         return fm_seterr(fmp, EOVERFLOW);
     }
     /* Protect against very large files & (Linux) OOM killer - cf `raster_malloc()` in "raster.c" */
-    if (new_size > 0x40000000 /*1GB*/ || !(new_mem = (unsigned char *) realloc(fmp->mem, new_size))) {
+    if (new_size > 0x40000000 /*1GB*/
+            || !(new_mem = (unsigned char *) z_realloc(fmp->mem, fmp->memsize, new_size))) {
         fm_clear_mem(fmp);
         return fm_seterr(fmp, new_size > 0x40000000 ? EINVAL : ENOMEM);
     }
@@ -367,6 +377,7 @@ INTERNAL int fm_close(struct filemem *restrict const fmp, struct zint_symbol *sy
             return fm_seterr(fmp, EINVAL);
         }
         symbol->memfile = fmp->mem;
+        symbol->memfile_capacity = (int) fmp->memsize; /* `fm_mem_expand()` limits to 1GB */
         fmp->mem = NULL; /* Now belongs to `symbol` */
         fm_clear_mem(fmp);
         return 1;
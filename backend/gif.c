@@ -39,6 +39,17 @@
 /* Set LZW buffer paging size to this in expectation that compressed data will fit for typical scalings */
 #define GIF_LZW_PAGE_SIZE   0x100000 /* Megabyte */
 
+/* Maximum number of codes (12 bits) */
+#define GIF_MAX_CODES       4096
+
+/* String table hash size - power of 2 at least twice `GIF_MAX_CODES` to keep probe sequences short */
+#define GIF_HASH_BITS       13
+#define GIF_HASH_SIZE       (1 << GIF_HASH_BITS)
+/* Key of string `Prefix` code (12 bits) + `Pixel` (max 4 bits) */
+#define GIF_HASH_KEY(Prefix, Pixel) ((unsigned short) (((Prefix) << 4) | (Pixel)))
+/* Fibonacci hash of `Key` */
+#define GIF_HASH(Key)       ((unsigned short) ((((Key) * 40503U) & 0xFFFF) >> (16 - GIF_HASH_BITS)))
+
 struct gif_state {
     struct filemem *fmp;
     unsigned char *pOut;
@@ -52,9 +63,11 @@ struct gif_state {
     char fByteCountByteSet;
     char fOutPaged;
     unsigned char OutBitsFree;
-    unsigned short NodeAxon[4096];
-    unsigned short NodeNext[4096];
-    unsigned char NodePix[4096];
+    unsigned short HashKey[GIF_HASH_SIZE]; /* Open-addressed (linear probing) table of `GIF_HASH_KEY()`s */
+    unsigned short HashCode[GIF_HASH_SIZE]; /* Code for the string, 0 if slot empty */
+    unsigned short *RunCode; /* Codes of strings of a single repeated pixel, `GIF_MAX_CODES` per pixel by length */
+    unsigned short RunLen[16]; /* Longest repeated pixel string in table for each pixel */
+    unsigned char RunPixels; /* Number of pixel values (palette count) */
     unsigned char map[256];
 };
 
@@ -107,27 +120,37 @@ static void gif_AddCodeToBuffer(struct gif_state *pState, unsigned short CodeIn,
 }
 
 static void gif_FlushStringTable(struct gif_state *pState) {
-    unsigned short Pos;
-    for (Pos = 0; Pos < pState->ClearCode; Pos++) {
-        pState->NodeAxon[Pos] = 0;
+    unsigned char Pixel;
+    memset(pState->HashCode, 0, sizeof(pState->HashCode));
+    /* Single pixel strings are the root codes */
+    for (Pixel = 0; Pixel < pState->RunPixels; Pixel++) {
+        pState->RunLen[Pixel] = 1;
+        pState->RunCode[Pixel * GIF_MAX_CODES + 1] = Pixel;
     }
 }
 
-static unsigned short gif_FindPixelOutlet(struct gif_state *pState, unsigned short HeadNode, unsigned char Byte) {
-    unsigned short Outlet;
-
-    Outlet = pState->NodeAxon[HeadNode];
-    while (Outlet) {
-        if (pState->NodePix[Outlet] == Byte)
-            return Outlet;
-        Outlet = pState->NodeNext[Outlet];
+/* Return code of string `HeadNode` extended by `Byte`, or 0 if none, setting `*pSlot` to its hash table slot (or
+   to the empty slot to place it) */
+static unsigned short gif_FindPixelOutlet(const struct gif_state *pState, const unsigned short HeadNode,
+            const unsigned char Byte, unsigned short *pSlot) {
+    const unsigned short Key = GIF_HASH_KEY(HeadNode, Byte);
+    unsigned short Slot = GIF_HASH(Key);
+
+    while (pState->HashCode[Slot]) {
+        if (pState->HashKey[Slot] == Key) {
+            *pSlot = Slot;
+            return pState->HashCode[Slot];
+        }
+        Slot = (Slot + 1) & (GIF_HASH_SIZE - 1);
     }
+    *pSlot = Slot;
     return 0;
 }
 
 static int gif_NextCode(struct gif_state *pState, unsigned char *pPixelValueCur, unsigned char CodeBits) {
     unsigned short UpNode;
     unsigned short DownNode;
+    unsigned short Slot;
     /* Start with the root node for last pixel chain */
     UpNode = *pPixelValueCur;
     if (pState->pIn == pState->pInEnd) {
@@ -135,8 +158,34 @@ static int gif_NextCode(struct gif_state *pState, unsigned char *pPixelValueCur,
         return 0;
     }
     *pPixelValueCur = pState->map[*pState->pIn++];
+    /* Fast path for runs (long in scaled bilevel symbols) - strings of a repeated pixel are only ever extended by
+       that pixel, so if the table has one of length N it has all up to N, which can be matched by counting instead of
+       lookup (they're only ever reached this way, so aren't put in the hash table) */
+    if (*pPixelValueCur == UpNode) {
+        const unsigned char RunPixel = *pPixelValueCur;
+        unsigned short *const RunCode = pState->RunCode + RunPixel * GIF_MAX_CODES;
+        const unsigned short MaxLen = pState->RunLen[RunPixel];
+        unsigned short Len = 1;
+        while (Len < MaxLen) {
+            Len++;
+            if (pState->pIn == pState->pInEnd) {
+                gif_AddCodeToBuffer(pState, RunCode[Len], CodeBits);
+                return 0;
+            }
+            if ((*pPixelValueCur = pState->map[*pState->pIn++]) != RunPixel) {
+                break;
+            }
+        }
+        UpNode = RunCode[Len];
+        if (*pPixelValueCur == RunPixel) {
+            /* Longest in table, so submit it and extend */
+            gif_AddCodeToBuffer(pState, UpNode, CodeBits);
+            RunCode[++pState->RunLen[RunPixel]] = pState->FreeCode;
+            return 1;
+        }
+    }
     /* Follow the string table and the data stream to the end of the longest string that has a code */
-    while (0 != (DownNode = gif_FindPixelOutlet(pState, UpNode, *pPixelValueCur))) {
+    while (0 != (DownNode = gif_FindPixelOutlet(pState, UpNode, *pPixelValueCur, &Slot))) {
         UpNode = DownNode;
         if (pState->pIn == pState->pInEnd) {
             gif_AddCodeToBuffer(pState, UpNode, CodeBits);
@@ -147,26 +196,15 @@ static int gif_NextCode(struct gif_state *pState, unsigned char *pPixelValueCur,
     /* Submit 'UpNode' which is the code of the longest string */
     gif_AddCodeToBuffer(pState, UpNode, CodeBits);
     /* ... and extend the string by appending 'PixelValueCur' */
-    /* Create a successor node for 'PixelValueCur' whose code is 'freecode' */
-    pState->NodePix[pState->FreeCode] = *pPixelValueCur;
-    pState->NodeAxon[pState->FreeCode] = pState->NodeNext[pState->FreeCode] = 0;
-    /* ...and link it to the end of the chain emanating from fg_axon[UpNode]. */
-    DownNode = pState->NodeAxon[UpNode];
-    if (!DownNode) {
-        pState->NodeAxon[UpNode] = pState->FreeCode;
-    } else {
-        while (pState->NodeNext[DownNode]) {
-            DownNode = pState->NodeNext[DownNode];
-        }
-        pState->NodeNext[DownNode] = pState->FreeCode;
-    }
+    /* Create a successor node for 'PixelValueCur' whose code is 'freecode', in the empty slot found above */
+    pState->HashKey[Slot] = GIF_HASH_KEY(UpNode, *pPixelValueCur);
+    pState->HashCode[Slot] = pState->FreeCode;
     return 1;
 }
 
 static int gif_lzw(struct gif_state *pState, unsigned char paletteBitSize) {
     unsigned char PixelValueCur;
     unsigned char CodeBits;
-    unsigned short Pos;
 
     /* > Get first data byte */
     if (pState->pIn == pState->pInEnd)
@@ -187,9 +225,6 @@ static int gif_lzw(struct gif_state *pState, unsigned char paletteBitSize) {
     pState->OutPosCur = 0;
     pState->fByteCountByteSet = 0;
 
-    for (Pos = 0; Pos < pState->ClearCode; Pos++)
-        pState->NodePix[Pos] = (unsigned char) Pos;
-
     gif_FlushStringTable(pState);
 
     /* Write what the GIF specification calls the "code size". */
@@ -268,7 +303,7 @@ INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     if (State.fOutPaged) {
         State.OutLength = GIF_LZW_PAGE_SIZE;
     }
-    if (!(State.pOut = (unsigned char *) malloc(State.OutLength))) {
+    if (!(State.pOut = (unsigned char *) z_malloc(State.OutLength))) {
         return errtxt(ZINT_ERROR_MEMORY, symbol, 614, "Insufficient memory for GIF LZW buffer");
     }
 #ifdef ZINT_SANITIZEM /* Suppress clang -fsanitize=memory false positive */
@@ -281,7 +316,7 @@ INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     if (!fm_open(State.fmp, symbol, "wb")) {
         ZEXT errtxtf(0, symbol, 611, "Could not open GIF output file (%1$d: %2$s)", State.fmp->err,
                     strerror(State.fmp->err));
-        free(State.pOut);
+        z_free(State.pOut);
         return ZINT_ERROR_FILE_ACCESS;
     }
 
@@ -444,13 +479,21 @@ INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     fm_write(outbuf, 1, 10, State.fmp);
 
     /* Call lzw encoding */
+    State.RunPixels = (unsigned char) paletteCount;
+    if (!(State.RunCode = (unsigned short *) z_malloc(sizeof(unsigned short) * GIF_MAX_CODES * paletteCount))) {
+        z_free(State.pOut);
+        (void) fm_close(State.fmp, symbol);
+        return errtxt(ZINT_ERROR_MEMORY, symbol, 612, "Insufficient memory for GIF LZW run table");
+    }
     if (!gif_lzw(&State, paletteBitSize)) {
-        free(State.pOut);
+        z_free(State.RunCode);
+        z_free(State.pOut);
         (void) fm_close(State.fmp, symbol);
         return errtxt(ZINT_ERROR_MEMORY, symbol, 613, "Insufficient memory for GIF LZW buffer");
     }
+    z_free(State.RunCode);
     fm_write(State.pOut, 1, State.OutPosCur, State.fmp);
-    free(State.pOut);
+    z_free(State.pOut);
 
     /* GIF terminator */
     fm_putc(';', State.fmp);
@@ -1540,14 +1540,16 @@ INTERNAL int hanxin(struct zint_symbol *symbol, struct zint_seg segs[], const in
         }
     }
 
+    STATS_BEGIN(symbol, ZINT_STATS_MODES);
     hx_define_mode_segs(mode, ddata, local_segs, seg_count, debug_print);
+    STATS_END(symbol, ZINT_STATS_MODES);
 
     est_binlen = hx_calc_binlen_segs(mode, ddata, local_segs, seg_count);
     if (debug_print) {
         printf("Estimated binary length: %d\n", est_binlen);
     }
 
-    binary = (char *) malloc(est_binlen + 1);
+    binary = (char *) z_malloc(est_binlen + 1);
 
     if ((ecc_level <= 0) || (ecc_level >= 5)) {
         ecc_level = 1;
@@ -1571,7 +1573,7 @@ INTERNAL int hanxin(struct zint_symbol *symbol, struct zint_seg segs[], const in
     }
 
     if (version == 85) {
-        free(binary);
+        z_free(binary);
         return errtxtf(ZINT_ERROR_TOO_LONG, symbol, 541, "Input too long, requires %d codewords (maximum 3264)",
                         codewords);
     }
@@ -1585,7 +1587,7 @@ INTERNAL int hanxin(struct zint_symbol *symbol, struct zint_seg segs[], const in
     }
 
     if ((symbol->option_2 != 0) && (symbol->option_2 < version)) {
-        free(binary);
+        z_free(binary);
         if (ecc_level == 1) {
             return ZEXT errtxtf(ZINT_ERROR_TOO_LONG, symbol, 542,
                                 "Input too long for Version %1$d, requires %2$d codewords (maximum %3$d)",
@@ -1632,7 +1634,7 @@ INTERNAL int hanxin(struct zint_symbol *symbol, struct zint_seg segs[], const in
             datastream[i >> 3] |= 0x80 >> (i & 0x07);
         }
     }
-    free(binary);
+    z_free(binary);
 
     if (debug_print) {
         printf("Datastream (%d):", data_codewords);
@@ -1647,7 +1649,9 @@ INTERNAL int hanxin(struct zint_symbol *symbol, struct zint_seg segs[], const in
 
     hx_setup_grid(grid, size, version);
 
+    STATS_BEGIN(symbol, ZINT_STATS_RS);
     hx_add_ecc(fullstream, datastream, data_codewords, version, ecc_level);
+    STATS_END(symbol, ZINT_STATS_RS);
 
     if (debug_print) {
         printf("Fullstream (%d):", hx_total_codewords[version - 1]);
@@ -1675,7 +1679,9 @@ INTERNAL int hanxin(struct zint_symbol *symbol, struct zint_seg segs[], const in
         }
     }
 
+    STATS_BEGIN(symbol, ZINT_STATS_MASK);
     bitmask = hx_apply_bitmask(grid, size, version, ecc_level, user_mask, debug_print);
+    STATS_END(symbol, ZINT_STATS_MASK);
 
     /* Feedback options */
     symbol->option_1 = ecc_level;
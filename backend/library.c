@@ -36,6 +36,7 @@
 #include <math.h>
 #include <stdio.h>
 #include "common.h"
+#include "cache.h"
 #include "eci.h"
 #include "gs1.h"
 #include "output.h"
@@ -59,11 +60,7 @@ static void set_symbol_defaults(struct zint_symbol *symbol) {
     symbol->fgcolor = &symbol->fgcolour[0];
     memcpy(symbol->bgcolour, "ffffff", 7);
     symbol->bgcolor = &symbol->bgcolour[0];
-#ifdef ZINT_NO_PNG
-    memcpy(symbol->outfile, "out.gif", 8); /* Include terminating NUL */
-#else
-    memcpy(symbol->outfile, "out.png", 8);
-#endif
+    memcpy(symbol->outfile, "out.png", 8); /* Include terminating NUL */
     symbol->option_1 = -1;
     symbol->show_hrt = 1; /* Show human readable text */
     symbol->input_mode = DATA_MODE;
@@ -82,7 +79,7 @@ static void set_symbol_defaults(struct zint_symbol *symbol) {
 struct zint_symbol *ZBarcode_Create(void) {
     struct zint_symbol *symbol;
 
-    symbol = (struct zint_symbol *) calloc(1, sizeof(*symbol));
+    symbol = (struct zint_symbol *) z_calloc(1, sizeof(*symbol));
     if (!symbol) return NULL;
 
     set_symbol_defaults(symbol);
@@ -106,21 +103,28 @@ void ZBarcode_Clear(struct zint_symbol *symbol) {
     memset(symbol->row_height, 0, sizeof(symbol->row_height));
     memset(symbol->text, 0, sizeof(symbol->text));
     symbol->text_length = 0;
+    memset(&symbol->estimate, 0, sizeof(symbol->estimate));
     symbol->errtxt[0] = '\0';
-    if (symbol->bitmap != NULL) {
-        free(symbol->bitmap);
-        symbol->bitmap = NULL;
-    }
-    if (symbol->alphamap != NULL) {
-        free(symbol->alphamap);
-        symbol->alphamap = NULL;
+    /* Keep buffers if retaining */
+    if (!(symbol->output_options & BARCODE_RETAIN_BUFFERS)) {
+        if (symbol->bitmap != NULL) {
+            z_free(symbol->bitmap);
+            symbol->bitmap = NULL;
+        }
+        if (symbol->alphamap != NULL) {
+            z_free(symbol->alphamap);
+            symbol->alphamap = NULL;
+        }
+        if (symbol->memfile != NULL) {
+            z_free(symbol->memfile);
+            symbol->memfile = NULL;
+        }
+        symbol->bitmap_capacity = 0;
+        symbol->alphamap_capacity = 0;
+        symbol->memfile_capacity = 0;
     }
     symbol->bitmap_width = 0;
     symbol->bitmap_height = 0;
-    if (symbol->memfile != NULL) {
-        free(symbol->memfile);
-        symbol->memfile = NULL;
-    }
     symbol->memfile_size = 0;
 
     /* If there is a rendered version, ensure its memory is released */
@@ -132,11 +136,11 @@ void ZBarcode_Reset(struct zint_symbol *symbol) {
     if (!symbol) return;
 
     if (symbol->bitmap != NULL)
-        free(symbol->bitmap);
+        z_free(symbol->bitmap);
     if (symbol->alphamap != NULL)
-        free(symbol->alphamap);
+        z_free(symbol->alphamap);
     if (symbol->memfile != NULL)
-        free(symbol->memfile);
+        z_free(symbol->memfile);
 
     vector_free(symbol);
 
@@ -149,15 +153,15 @@ void ZBarcode_Delete(struct zint_symbol *symbol) {
     if (!symbol) return;
 
     if (symbol->bitmap != NULL)
-        free(symbol->bitmap);
+        z_free(symbol->bitmap);
     if (symbol->alphamap != NULL)
-        free(symbol->alphamap);
+        z_free(symbol->alphamap);
     if (symbol->memfile != NULL)
-        free(symbol->memfile);
+        z_free(symbol->memfile);
 
     vector_free(symbol);
 
-    free(symbol);
+    z_free(symbol);
 }
 
 /* Symbology handlers */
@@ -241,6 +245,7 @@ INTERNAL int dxfilmedge(struct zint_symbol *symbol, unsigned char source[], int
 /* Output handlers */
 /* Plot to BMP/GIF/PCX/PNG/TIF */
 INTERNAL int plot_raster(struct zint_symbol *symbol, int rotate_angle, int file_type);
+INTERNAL int plot_raster_into(struct zint_symbol *symbol, int rotate_angle, const struct out_raster_dest *dest);
 /* Plot to EMF/EPS/SVG */
 INTERNAL int plot_vector(struct zint_symbol *symbol, int rotate_angle, int file_type);
 
@@ -666,8 +671,10 @@ static int reduced_charset(struct zint_symbol *symbol, struct zint_seg segs[], c
         preprocessed = preprocessed_buf;
         for (i = 0; i < seg_count; i++) {
             if (convertible[i]) {
+                STATS_BEGIN(symbol, ZINT_STATS_ECI);
                 error_number = utf8_to_eci(local_segs[i].eci, local_segs[i].source, preprocessed,
                                             &local_segs[i].length);
+                STATS_END(symbol, ZINT_STATS_ECI);
                 if (error_number != 0) {
                     if (local_segs[i].eci) {
                         return errtxtf(error_number, symbol, 244, "Invalid character in input for ECI '%d'",
@@ -764,141 +771,143 @@ static int esc_base(struct zint_symbol *symbol, const unsigned char *input_strin
     return val;
 }
 
-/* Helper to parse escape sequences. If `escaped_string` NULL, calculates length only */
+/* Helper to parse escape sequences, de-escaping `input_string` of length `*p_length` in a single pass into
+   `escaped_string` (if non-NULL) of size `escaped_size`, setting `*p_length` to the de-escaped length. As the
+   de-escaped length never exceeds the input length, `*p_length` + 1 is always sufficient for `escaped_size`, but if
+   less then any excess is counted but not written (and the result not NUL-terminated) */
 static int escape_char_process(struct zint_symbol *symbol, const unsigned char *input_string, int *p_length,
-            unsigned char *escaped_string) {
+            unsigned char *escaped_string, const int escaped_size) {
                                /* NUL   EOT   BEL   BS    HT    LF    VT    FF    CR    ESC   GS    RS   \ */
     static const char escs[] = {  '0',  'E',  'a',  'b',  't',  'n',  'v',  'f',  'r',  'e',  'G',  'R', '\\', '\0' };
     static const char vals[] = { 0x00, 0x04, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x1B, 0x1D, 0x1E, 0x5C };
     const int length = *p_length;
     int in_posn = 0, out_posn = 0;
     unsigned char ch;
+    unsigned char buf[4]; /* De-escaped bytes of a single escape sequence */
+    int buf_len;
     int val;
     int i;
     unsigned int unicode;
     const int extra_escape_mode = (symbol->input_mode & EXTRA_ESCAPE_MODE) && symbol->symbology == BARCODE_CODE128;
 
-    do {
-        if (input_string[in_posn] == '\\') {
-            if (in_posn + 1 >= length) {
-                return errtxt(ZINT_ERROR_INVALID_DATA, symbol, 236, "Incomplete escape character in input");
+    while (in_posn < length) {
+        /* Copy run up to next backslash as-is */
+        const unsigned char *bs = (const unsigned char *) memchr(input_string + in_posn, '\\', length - in_posn);
+        const int run = bs ? (int) (bs - input_string) - in_posn : length - in_posn;
+        if (run) {
+            if (escaped_string && out_posn < escaped_size) {
+                memcpy(escaped_string + out_posn, input_string + in_posn,
+                        run < escaped_size - out_posn ? run : escaped_size - out_posn);
             }
-            ch = input_string[in_posn + 1];
-            /* NOTE: if add escape character, must also update regex in "frontend_qt/datawindow.php" */
-            switch (ch) {
-                case '0':
-                case 'E':
-                case 'a':
-                case 'b':
-                case 't':
-                case 'n':
-                case 'v':
-                case 'f':
-                case 'r':
-                case 'e':
-                case 'G':
-                case 'R':
-                case '\\':
-                    if (escaped_string) escaped_string[out_posn] = vals[posn(escs, ch)];
-                    in_posn += 2;
-                    break;
-                case '^': /* CODE128 specific */
-                    if (!extra_escape_mode) {
-                        return errtxt(ZINT_ERROR_INVALID_DATA, symbol, 798,
-                                        "Escape '\\^' only valid for Code 128 in extra escape mode");
-                    }
-                    /* Pass thru unaltered */
-                    if (escaped_string) {
-                        escaped_string[out_posn++] = '\\';
-                        escaped_string[out_posn] = '^';
-                    } else {
-                        out_posn++;
-                    }
-                    in_posn += 2;
-                    if (in_posn < length) { /* Note allowing '\\^' on its own at end */
-                        if (escaped_string) {
-                            escaped_string[++out_posn] = input_string[in_posn++];
-                        } else {
-                            ++out_posn;
-                            in_posn++;
-                        }
-                    }
-                    break;
-                case 'd':
-                case 'o':
-                case 'x':
-                    if ((val = esc_base(symbol, input_string, length, in_posn + 2, ch)) == -1) {
-                        return ZINT_ERROR_INVALID_DATA;
-                    }
-                    if (escaped_string) escaped_string[out_posn] = val;
-                    in_posn += 4 + (ch != 'x');
-                    break;
-                case 'u':
-                case 'U':
-                    if (in_posn + 6 > length || (ch == 'U' && in_posn + 8 > length)) {
-                        return errtxtf(ZINT_ERROR_INVALID_DATA, symbol, 209,
-                                        "Incomplete '\\%c' escape sequence in input", ch);
-                    }
-                    unicode = 0;
-                    for (i = 0; i < 6; i++) {
-                        if ((val = ctoi(input_string[in_posn + i + 2])) == -1) {
-                            return errtxtf(ZINT_ERROR_INVALID_DATA, symbol, 211,
-                                    "Invalid character for '\\%c' escape sequence in input (hexadecimal only)",
-                                    ch);
-                        }
-                        unicode = (unicode << 4) | val;
-                        if (i == 3 && ch == 'u') {
-                            break;
-                        }
-                    }
-                    /* Exclude reversed BOM and surrogates and out-of-range */
-                    if (unicode == 0xfffe || (unicode >= 0xd800 && unicode < 0xe000) || unicode > 0x10ffff) {
-                        return errtxtf(ZINT_ERROR_INVALID_DATA, symbol, 246,
-                                        "Value of escape sequence '%.*s' in input out of range",
-                                        ch == 'u' ? 6 : 8, input_string + in_posn);
+            in_posn += run;
+            out_posn += run;
+            if (!bs) {
+                break;
+            }
+        }
+        if (in_posn + 1 >= length) {
+            return errtxt(ZINT_ERROR_INVALID_DATA, symbol, 236, "Incomplete escape character in input");
+        }
+        ch = input_string[in_posn + 1];
+        buf_len = 1;
+        /* NOTE: if add escape character, must also update regex in "frontend_qt/datawindow.php" */
+        switch (ch) {
+            case '0':
+            case 'E':
+            case 'a':
+            case 'b':
+            case 't':
+            case 'n':
+            case 'v':
+            case 'f':
+            case 'r':
+            case 'e':
+            case 'G':
+            case 'R':
+            case '\\':
+                buf[0] = vals[posn(escs, ch)];
+                in_posn += 2;
+                break;
+            case '^': /* CODE128 specific */
+                if (!extra_escape_mode) {
+                    return errtxt(ZINT_ERROR_INVALID_DATA, symbol, 798,
+                                    "Escape '\\^' only valid for Code 128 in extra escape mode");
+                }
+                /* Pass thru unaltered */
+                buf[0] = '\\';
+                buf[1] = '^';
+                buf_len = 2;
+                in_posn += 2;
+                if (in_posn < length) { /* Note allowing '\\^' on its own at end */
+                    buf[buf_len++] = input_string[in_posn++];
+                }
+                break;
+            case 'd':
+            case 'o':
+            case 'x':
+                if ((val = esc_base(symbol, input_string, length, in_posn + 2, ch)) == -1) {
+                    return ZINT_ERROR_INVALID_DATA;
+                }
+                buf[0] = (unsigned char) val;
+                in_posn += 4 + (ch != 'x');
+                break;
+            case 'u':
+            case 'U':
+                if (in_posn + 6 > length || (ch == 'U' && in_posn + 8 > length)) {
+                    return errtxtf(ZINT_ERROR_INVALID_DATA, symbol, 209,
+                                    "Incomplete '\\%c' escape sequence in input", ch);
+                }
+                unicode = 0;
+                for (i = 0; i < 6; i++) {
+                    if ((val = ctoi(input_string[in_posn + i + 2])) == -1) {
+                        return errtxtf(ZINT_ERROR_INVALID_DATA, symbol, 211,
+                                "Invalid character for '\\%c' escape sequence in input (hexadecimal only)",
+                                ch);
                     }
-                    if (unicode < 0x80) {
-                        if (escaped_string) escaped_string[out_posn] = (unsigned char) unicode;
-                    } else if (unicode < 0x800) {
-                        if (escaped_string) {
-                            escaped_string[out_posn++] = (unsigned char) (0xC0 | (unicode >> 6));
-                            escaped_string[out_posn] = (unsigned char) (0x80 | (unicode & 0x3F));
-                        } else {
-                            out_posn++;
-                        }
-                    } else if (unicode < 0x10000) {
-                        if (escaped_string) {
-                            escaped_string[out_posn++] = (unsigned char) (0xE0 | (unicode >> 12));
-                            escaped_string[out_posn++] = (unsigned char) (0x80 | ((unicode >> 6) & 0x3F));
-                            escaped_string[out_posn] = (unsigned char) (0x80 | (unicode & 0x3F));
-                        } else {
-                            out_posn += 2;
-                        }
-                    } else {
-                        if (escaped_string) {
-                            escaped_string[out_posn++] = (unsigned char) (0xF0 | (unicode >> 18));
-                            escaped_string[out_posn++] = (unsigned char) (0x80 | ((unicode >> 12) & 0x3F));
-                            escaped_string[out_posn++] = (unsigned char) (0x80 | ((unicode >> 6) & 0x3F));
-                            escaped_string[out_posn] = (unsigned char) (0x80 | (unicode & 0x3F));
-                        } else {
-                            out_posn += 3;
-                        }
+                    unicode = (unicode << 4) | val;
+                    if (i == 3 && ch == 'u') {
+                        break;
                     }
-                    in_posn += 6 + (ch == 'U') * 2;
-                    break;
-                default:
-                    return errtxtf(ZINT_ERROR_INVALID_DATA, symbol, 234,
-                                    "Unrecognised escape character '\\%c' in input", ch);
-                    break;
-            }
-        } else {
-            if (escaped_string) escaped_string[out_posn] = input_string[in_posn];
-            in_posn++;
+                }
+                /* Exclude reversed BOM and surrogates and out-of-range */
+                if (unicode == 0xfffe || (unicode >= 0xd800 && unicode < 0xe000) || unicode > 0x10ffff) {
+                    return errtxtf(ZINT_ERROR_INVALID_DATA, symbol, 246,
+                                    "Value of escape sequence '%.*s' in input out of range",
+                                    ch == 'u' ? 6 : 8, input_string + in_posn);
+                }
+                if (unicode < 0x80) {
+                    buf[0] = (unsigned char) unicode;
+                } else if (unicode < 0x800) {
+                    buf[0] = (unsigned char) (0xC0 | (unicode >> 6));
+                    buf[1] = (unsigned char) (0x80 | (unicode & 0x3F));
+                    buf_len = 2;
+                } else if (unicode < 0x10000) {
+                    buf[0] = (unsigned char) (0xE0 | (unicode >> 12));
+                    buf[1] = (unsigned char) (0x80 | ((unicode >> 6) & 0x3F));
+                    buf[2] = (unsigned char) (0x80 | (unicode & 0x3F));
+                    buf_len = 3;
+                } else {
+                    buf[0] = (unsigned char) (0xF0 | (unicode >> 18));
+                    buf[1] = (unsigned char) (0x80 | ((unicode >> 12) & 0x3F));
+                    buf[2] = (unsigned char) (0x80 | ((unicode >> 6) & 0x3F));
+                    buf[3] = (unsigned char) (0x80 | (unicode & 0x3F));
+                    buf_len = 4;
+                }
+                in_posn += 6 + (ch == 'U') * 2;
+                break;
+            default:
+                return errtxtf(ZINT_ERROR_INVALID_DATA, symbol, 234,
+                                "Unrecognised escape character '\\%c' in input", ch);
+                break;
+        }
+        if (escaped_string && out_posn < escaped_size) {
+            memcpy(escaped_string + out_posn, buf,
+                    buf_len < escaped_size - out_posn ? buf_len : escaped_size - out_posn);
         }
-        out_posn++;
-    } while (in_posn < length);
+        out_posn += buf_len;
+    }
 
-    if (escaped_string) {
+    if (escaped_string && out_posn < escaped_size) {
         escaped_string[out_posn] = '\0';
     }
     *p_length = out_posn;
@@ -909,7 +918,7 @@ static int escape_char_process(struct zint_symbol *symbol, const unsigned char *
 #ifdef ZINT_TEST /* Wrapper for direct testing (also used by `testUtilZXingCPPCmp()` in "tests/testcommon.c") */
 INTERNAL int escape_char_process_test(struct zint_symbol *symbol, const unsigned char *input_string, int *p_length,
                 unsigned char *escaped_string) {
-    return escape_char_process(symbol, input_string, p_length, escaped_string);
+    return escape_char_process(symbol, input_string, p_length, escaped_string, *p_length + 1);
 }
 #endif
 
@@ -992,18 +1001,101 @@ int ZBarcode_Encode(struct zint_symbol *symbol, const unsigned char *source, int
     return ZBarcode_Encode_Segs(symbol, segs, 1);
 }
 
-/* Encode a barcode with multiple ECI segments. */
-int ZBarcode_Encode_Segs(struct zint_symbol *symbol, const struct zint_seg segs[], const int seg_count) {
+/* Settings of a symbol validated by `ZBarcode_Prepare()`, restored before each `ZBarcode_Encode_Segs_Prepared()` as
+   encoding may change them */
+struct zint_prepared {
+    struct zint_symbol *symbol;
+    int warn_number;    /* Any warning from validation */
+    char errtxt[100];   /* Its message */
+    int symbology;
+    float height;
+    int whitespace_width;
+    int whitespace_height;
+    int border_width;
+    int output_options;
+    char primary[128];
+    int option_1;
+    int option_2;
+    int option_3;
+    int input_mode;
+    int eci;
+};
+
+/* Check `input_mode` and `symbology`, resetting/mapping if invalid, returning warning or error */
+static int check_mode_symbology(struct zint_symbol *symbol) {
+    int warn_number = 0;
+
+    if ((symbol->input_mode & 0x07) > 2) {
+        symbol->input_mode = DATA_MODE; /* Reset completely */
+        warn_number = error_tag(ZINT_WARN_INVALID_OPTION, symbol, 212, "Invalid input mode - reset to DATA_MODE");
+        if (warn_number >= ZINT_ERROR) {
+            return warn_number;
+        }
+    }
+
+    /* Check the symbology field */
+    if (!ZBarcode_ValidID(symbol->symbology)) {
+        warn_number = map_invalid_symbology(symbol);
+    }
+
+    return warn_number;
+}
+
+/* Check other symbol fields, returning error if any out of range */
+static int check_other_fields(struct zint_symbol *symbol) {
+    if ((symbol->scale < 0.01f) || (symbol->scale > 200.0f)) {
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 227, "Scale out of range (0.01 to 200)");
+    }
+    if ((symbol->dot_size < 0.01f) || (symbol->dot_size > 20.0f)) {
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 221, "Dot size out of range (0.01 to 20)");
+    }
+
+    if ((symbol->height < 0.0f) || (symbol->height > 2000.0f)) { /* Allow for 44 row CODABLOCKF at 45X each */
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 765, "Height out of range (0 to 2000)");
+    }
+    if ((symbol->guard_descent < 0.0f) || (symbol->guard_descent > 50.0f)) {
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 769, "Guard bar descent out of range (0 to 50)");
+    }
+    if ((symbol->text_gap < -5.0f) || (symbol->text_gap > 10.0f)) {
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 219, "Text gap out of range (-5 to 10)");
+    }
+    if ((symbol->whitespace_width < 0) || (symbol->whitespace_width > 100)) {
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 766, "Whitespace width out of range (0 to 100)");
+    }
+    if ((symbol->whitespace_height < 0) || (symbol->whitespace_height > 100)) {
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 767, "Whitespace height out of range (0 to 100)");
+    }
+    if ((symbol->border_width < 0) || (symbol->border_width > 100)) {
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 768, "Border width out of range (0 to 100)");
+    }
+
+    if (symbol->rows >= 200) { /* Check for stacking too many symbols */
+        return error_tag(ZINT_ERROR_TOO_LONG, symbol, 770, "Too many stacked symbols");
+    }
+    if (symbol->rows < 0) { /* Silently defend against out-of-bounds access */
+        symbol->rows = 0;
+    }
+
+    if ((symbol->input_mode & 0x07) == GS1_MODE && !gs1_compliant(symbol->symbology)) {
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 220, "Selected symbology does not support GS1 mode");
+    }
+
+    return 0;
+}
+
+/* Encode a barcode with multiple ECI segments (uncached), skipping option checks if `prepared` */
+static int encode_segs(struct zint_symbol *symbol, const struct zint_seg segs[], const int seg_count,
+            const struct zint_prepared *prepared) {
     int error_number, warn_number = 0;
     int total_len = 0;
     int have_zero_eci = 0;
     int escape_mode;
     int i;
-    unsigned char *local_source;
+    unsigned char *local_source = NULL;
     struct zint_seg *local_segs;
-    unsigned char *local_sources;
-
-    if (!symbol) return ZINT_ERROR_INVALID_DATA;
+    unsigned char *local_sources = NULL;
+    int *escaped_lens = NULL;
+    int escaped_size = 0;
 
     if (segs == NULL) {
         return error_tag(ZINT_ERROR_INVALID_DATA, symbol, 200, "Input segments NULL");
@@ -1013,20 +1105,10 @@ int ZBarcode_Encode_Segs(struct zint_symbol *symbol, const struct zint_seg segs[
         return error_tag(ZINT_ERROR_INVALID_DATA, symbol, 771, "Too many input segments (maximum 256)");
     }
 
-    if ((symbol->input_mode & 0x07) > 2) {
-        symbol->input_mode = DATA_MODE; /* Reset completely */
-        warn_number = error_tag(ZINT_WARN_INVALID_OPTION, symbol, 212, "Invalid input mode - reset to DATA_MODE");
-        if (warn_number >= ZINT_ERROR) {
-            return warn_number;
-        }
-    }
-
-    /* Check the symbology field */
-    if (!ZBarcode_ValidID(symbol->symbology)) {
-        warn_number = map_invalid_symbology(symbol);
-        if (warn_number >= ZINT_ERROR) {
-            return warn_number;
-        }
+    if (prepared) {
+        warn_number = prepared->warn_number;
+    } else if ((warn_number = check_mode_symbology(symbol)) >= ZINT_ERROR) {
+        return warn_number;
     }
 
     escape_mode = (symbol->input_mode & ESCAPE_MODE)
@@ -1034,6 +1116,22 @@ int ZBarcode_Encode_Segs(struct zint_symbol *symbol, const struct zint_seg segs[
 
     local_segs = (struct zint_seg *) z_alloca(sizeof(struct zint_seg) * (seg_count > 0 ? seg_count : 1));
 
+    if (escape_mode && seg_count > 0) {
+        /* De-escaping never lengthens, so (capped) input length suffices to de-escape in a single pass below */
+        for (i = 0; i < seg_count && escaped_size <= ZINT_MAX_DATA_LEN; i++) {
+            if (segs[i].source) {
+                escaped_size += segs[i].length > 0 ? segs[i].length : (int) ustrlen(segs[i].source);
+            }
+        }
+        if (escaped_size > ZINT_MAX_DATA_LEN) {
+            escaped_size = ZINT_MAX_DATA_LEN; /* Anything more will fail length checks */
+        }
+        escaped_size += seg_count; /* Allow for terminating NULs */
+        local_sources = (unsigned char *) z_alloca(escaped_size);
+        escaped_lens = (int *) z_alloca(sizeof(int) * seg_count);
+        local_source = local_sources;
+    }
+
     /* Check segment lengths */
     for (i = 0; i < seg_count; i++) {
         local_segs[i] = segs[i];
@@ -1059,17 +1157,26 @@ int ZBarcode_Encode_Segs(struct zint_symbol *symbol, const struct zint_seg segs[
             }
             return error_tag(ZINT_ERROR_INVALID_DATA, symbol, -1, NULL);
         }
-        /* Calculate de-escaped length for check against ZINT_MAX_DATA_LEN */
+        /* De-escape, checking length against ZINT_MAX_DATA_LEN */
         if (escape_mode) {
             int escaped_len = local_segs[i].length;
-            error_number = escape_char_process(symbol, local_segs[i].source, &escaped_len, NULL /*escaped_string*/);
+            const int offset = (int) (local_source - local_sources);
+            error_number = escape_char_process(symbol, local_segs[i].source, &escaped_len, local_source,
+                                                escaped_size - offset);
             if (error_number != 0) { /* Only returns errors, not warnings */
                 return error_tag(error_number, symbol, -1, NULL);
             }
             if (escaped_len > ZINT_MAX_DATA_LEN) {
                 return error_tag(ZINT_ERROR_TOO_LONG, symbol, 797, "Input too long");
             }
+            escaped_lens[i] = escaped_len;
             total_len += escaped_len;
+            /* If overflows `escaped_size` then `total_len` > ZINT_MAX_DATA_LEN, caught below */
+            if (escaped_len + 1 < escaped_size - offset) {
+                local_source += escaped_len + 1;
+            } else {
+                local_source = local_sources + escaped_size;
+            }
         } else {
             if (local_segs[i].length > ZINT_MAX_DATA_LEN) {
                 return error_tag(ZINT_ERROR_TOO_LONG, symbol, 777, "Input too long");
@@ -1140,42 +1247,8 @@ int ZBarcode_Encode_Segs(struct zint_symbol *symbol, const struct zint_seg segs[
         }
     }
 
-    /* Check other symbol fields */
-    if ((symbol->scale < 0.01f) || (symbol->scale > 200.0f)) {
-        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 227, "Scale out of range (0.01 to 200)");
-    }
-    if ((symbol->dot_size < 0.01f) || (symbol->dot_size > 20.0f)) {
-        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 221, "Dot size out of range (0.01 to 20)");
-    }
-
-    if ((symbol->height < 0.0f) || (symbol->height > 2000.0f)) { /* Allow for 44 row CODABLOCKF at 45X each */
-        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 765, "Height out of range (0 to 2000)");
-    }
-    if ((symbol->guard_descent < 0.0f) || (symbol->guard_descent > 50.0f)) {
-        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 769, "Guard bar descent out of range (0 to 50)");
-    }
-    if ((symbol->text_gap < -5.0f) || (symbol->text_gap > 10.0f)) {
-        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 219, "Text gap out of range (-5 to 10)");
-    }
-    if ((symbol->whitespace_width < 0) || (symbol->whitespace_width > 100)) {
-        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 766, "Whitespace width out of range (0 to 100)");
-    }
-    if ((symbol->whitespace_height < 0) || (symbol->whitespace_height > 100)) {
-        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 767, "Whitespace height out of range (0 to 100)");
-    }
-    if ((symbol->border_width < 0) || (symbol->border_width > 100)) {
-        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 768, "Border width out of range (0 to 100)");
-    }
-
-    if (symbol->rows >= 200) { /* Check for stacking too many symbols */
-        return error_tag(ZINT_ERROR_TOO_LONG, symbol, 770, "Too many stacked symbols");
-    }
-    if (symbol->rows < 0) { /* Silently defend against out-of-bounds access */
-        symbol->rows = 0;
-    }
-
-    if ((symbol->input_mode & 0x07) == GS1_MODE && !gs1_compliant(symbol->symbology)) {
-        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 220, "Selected symbology does not support GS1 mode");
+    if (!prepared && (error_number = check_other_fields(symbol)) != 0) {
+        return error_number;
     }
     if (seg_count > 1) {
         /* Note: GS1_MODE not currently supported when using multiple segments */
@@ -1184,19 +1257,23 @@ int ZBarcode_Encode_Segs(struct zint_symbol *symbol, const struct zint_seg segs[
         }
     }
 
-    local_sources = (unsigned char *) z_alloca(total_len + seg_count);
+    if (escape_mode) {
+        /* Already de-escaped */
+        for (i = 0, local_source = local_sources; i < seg_count; i++) {
+            local_segs[i].source = local_source;
+            local_segs[i].length = escaped_lens[i];
+            local_source += local_segs[i].length + 1;
+        }
+    } else {
+        local_sources = (unsigned char *) z_alloca(total_len + seg_count);
 
-    /* Copy input, de-escaping if required */
-    for (i = 0, local_source = local_sources; i < seg_count; i++) {
-        local_segs[i].source = local_source;
-        if (escape_mode) {
-            /* Checked already */
-            (void) escape_char_process(symbol, segs[i].source, &local_segs[i].length, local_segs[i].source);
-        } else {
+        /* Copy input */
+        for (i = 0, local_source = local_sources; i < seg_count; i++) {
+            local_segs[i].source = local_source;
             memcpy(local_segs[i].source, segs[i].source, local_segs[i].length);
             local_segs[i].source[local_segs[i].length] = '\0';
+            local_source += local_segs[i].length + 1;
         }
-        local_source += local_segs[i].length + 1;
     }
 
     if (escape_mode && symbol->primary[0] && strchr(symbol->primary, '\\') != NULL) {
@@ -1206,7 +1283,8 @@ int ZBarcode_Encode_Segs(struct zint_symbol *symbol, const struct zint_seg segs[
             return error_tag(ZINT_ERROR_INVALID_DATA, symbol, 799, "Invalid primary string");
         }
         memcpy(primary, symbol->primary, primary_len);
-        error_number = escape_char_process(symbol, primary, &primary_len, (unsigned char *) symbol->primary);
+        error_number = escape_char_process(symbol, primary, &primary_len, (unsigned char *) symbol->primary,
+                                            (int) sizeof(symbol->primary));
         if (error_number != 0) { /* Only returns errors, not warnings */
             return error_tag(error_number, symbol, -1, NULL);
         }
@@ -1279,6 +1357,170 @@ int ZBarcode_Encode_Segs(struct zint_symbol *symbol, const struct zint_seg segs[
     return error_number;
 }
 
+/* Encode via the cache if enabled, skipping option checks if `prepared` */
+static int encode_segs_cached(struct zint_symbol *symbol, const struct zint_seg segs[], const int seg_count,
+            const struct zint_prepared *prepared) {
+    struct cache_key key;
+    int error_number;
+
+    STATS_BEGIN(symbol, ZINT_STATS_ENCODE);
+    if (!cache_enabled() || !cache_key(symbol, segs, seg_count, &key)) {
+        error_number = encode_segs(symbol, segs, seg_count, prepared);
+    } else {
+        if (!cache_get(symbol, &key, &error_number)) {
+            error_number = encode_segs(symbol, segs, seg_count, prepared);
+            if (error_number < ZINT_ERROR) { /* Only cache successes (including warnings) */
+                cache_put(symbol, &key, error_number);
+            }
+        }
+        cache_key_free(&key);
+    }
+    STATS_END(symbol, ZINT_STATS_ENCODE);
+
+    return error_number;
+}
+
+/* Encode a barcode with multiple ECI segments. */
+int ZBarcode_Encode_Segs(struct zint_symbol *symbol, const struct zint_seg segs[], const int seg_count) {
+    if (!symbol) return ZINT_ERROR_INVALID_DATA;
+
+    return encode_segs_cached(symbol, segs, seg_count, NULL /*prepared*/);
+}
+
+/* Validate the settings of `symbol` once for use with `ZBarcode_Encode_Segs_Prepared()` */
+int ZBarcode_Prepare(struct zint_symbol *symbol, struct zint_prepared **p_prepared) {
+    struct zint_prepared *prepared;
+    int warn_number, error_number;
+
+    if (!symbol) return ZINT_ERROR_INVALID_DATA;
+    if (!p_prepared) {
+        return error_tag(ZINT_ERROR_INVALID_DATA, symbol, 213, "Prepared handle pointer NULL");
+    }
+    *p_prepared = NULL;
+
+    if ((warn_number = check_mode_symbology(symbol)) >= ZINT_ERROR) {
+        return warn_number;
+    }
+    if ((error_number = check_other_fields(symbol)) != 0) {
+        return error_number;
+    }
+    if (symbol->eci && !supports_eci(symbol->symbology)) {
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 217, "Symbology does not support ECI switching");
+    }
+    if (out_check_colour_options(symbol) != 0) {
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, -1, NULL);
+    }
+
+    if (!(prepared = (struct zint_prepared *) z_malloc(sizeof(struct zint_prepared)))) {
+        return error_tag(ZINT_ERROR_MEMORY, symbol, 214, "Insufficient memory for prepared handle");
+    }
+    prepared->symbol = symbol;
+    prepared->warn_number = warn_number;
+    memcpy(prepared->errtxt, symbol->errtxt, sizeof(prepared->errtxt));
+    prepared->symbology = symbol->symbology;
+    prepared->height = symbol->height;
+    prepared->whitespace_width = symbol->whitespace_width;
+    prepared->whitespace_height = symbol->whitespace_height;
+    prepared->border_width = symbol->border_width;
+    prepared->output_options = symbol->output_options;
+    memcpy(prepared->primary, symbol->primary, sizeof(prepared->primary));
+    prepared->option_1 = symbol->option_1;
+    prepared->option_2 = symbol->option_2;
+    prepared->option_3 = symbol->option_3;
+    prepared->input_mode = symbol->input_mode;
+    prepared->eci = symbol->eci;
+
+    *p_prepared = prepared;
+
+    return warn_number;
+}
+
+/* Encode a barcode with multiple ECI segments using the symbol and settings validated by `ZBarcode_Prepare()` */
+int ZBarcode_Encode_Segs_Prepared(struct zint_prepared *prepared, const struct zint_seg segs[],
+            const int seg_count) {
+    struct zint_symbol *symbol;
+
+    if (!prepared) return ZINT_ERROR_INVALID_DATA;
+
+    symbol = prepared->symbol;
+    ZBarcode_Clear(symbol);
+
+    /* Restore settings that a previous encode may have changed */
+    symbol->symbology = prepared->symbology;
+    symbol->height = prepared->height;
+    symbol->whitespace_width = prepared->whitespace_width;
+    symbol->whitespace_height = prepared->whitespace_height;
+    symbol->border_width = prepared->border_width;
+    symbol->output_options = prepared->output_options;
+    memcpy(symbol->primary, prepared->primary, sizeof(symbol->primary));
+    symbol->option_1 = prepared->option_1;
+    symbol->option_2 = prepared->option_2;
+    symbol->option_3 = prepared->option_3;
+    symbol->input_mode = prepared->input_mode;
+    symbol->eci = prepared->eci;
+    if (prepared->warn_number) {
+        memcpy(symbol->errtxt, prepared->errtxt, sizeof(symbol->errtxt));
+    }
+
+    return encode_segs_cached(symbol, segs, seg_count, prepared);
+}
+
+/* Encode a barcode using the symbol and settings validated by `ZBarcode_Prepare()`. If `length` is 0 or negative,
+   `source` must be NUL-terminated */
+int ZBarcode_Encode_Prepared(struct zint_prepared *prepared, const unsigned char *source, int length) {
+    struct zint_seg segs[1];
+
+    if (!prepared) return ZINT_ERROR_INVALID_DATA;
+
+    segs[0].eci = prepared->eci;
+    segs[0].source = (unsigned char *) source;
+    segs[0].length = length;
+
+    return ZBarcode_Encode_Segs_Prepared(prepared, segs, 1);
+}
+
+/* Free a handle returned by `ZBarcode_Prepare()` (does not free its symbol) */
+void ZBarcode_Prepared_Free(struct zint_prepared *prepared) {
+    z_free(prepared);
+}
+
+/* Predict the size of the symbol encoding `source` would produce, stopping short of a full encode if the symbology
+   supports it (see `estimate_set()`) */
+int ZBarcode_Estimate(struct zint_symbol *symbol, const unsigned char *source, int length,
+            struct zint_estimate *estimate) {
+    struct zint_seg segs[1];
+    int error_number;
+
+    if (!symbol) return ZINT_ERROR_INVALID_DATA;
+    if (!estimate) {
+        return error_tag(ZINT_ERROR_INVALID_DATA, symbol, 216, "Estimate pointer NULL");
+    }
+    memset(estimate, 0, sizeof(*estimate));
+    ZBarcode_Clear(symbol); /* Stacked rows would skew a full encode's result */
+
+    segs[0].eci = symbol->eci;
+    segs[0].source = (unsigned char *) source;
+    segs[0].length = length;
+
+    /* Bypass the cache, which only holds full encodes */
+    symbol->debug |= ZINT_DEBUG_ESTIMATE;
+    error_number = encode_segs(symbol, segs, 1, NULL /*prepared*/);
+    symbol->debug &= ~ZINT_DEBUG_ESTIMATE;
+
+    if (error_number < ZINT_ERROR) {
+        if (symbol->estimate.rows == 0) {
+            /* Symbology doesn't support estimation so fully encoded - use result */
+            symbol->estimate.version = symbol->option_2;
+            symbol->estimate.rows = symbol->rows;
+            symbol->estimate.width = symbol->width;
+        }
+        *estimate = symbol->estimate;
+    }
+
+    return error_number;
+}
+
+
 /* Helper for output routines to check `rotate_angle` and dottiness */
 static int check_output_args(struct zint_symbol *symbol, int rotate_angle) {
 
@@ -1342,11 +1584,13 @@ int ZBarcode_Print(struct zint_symbol *symbol, int rotate_angle) {
         int i = filetype_idx(symbol->outfile + len - 3);
         if (i >= 0) {
             if (filetypes[i].filetype) {
+                STATS_BEGIN(symbol, ZINT_STATS_PLOT);
                 if (filetypes[i].is_raster) {
                     error_number = plot_raster(symbol, rotate_angle, filetypes[i].filetype);
                 } else {
                     error_number = plot_vector(symbol, rotate_angle, filetypes[i].filetype);
                 }
+                STATS_END(symbol, ZINT_STATS_PLOT);
             } else {
                 error_number = dump_plot(symbol);
             }
@@ -1368,7 +1612,57 @@ int ZBarcode_Buffer(struct zint_symbol *symbol, int rotate_angle) {
         return error_number; /* Already tagged */
     }
 
+    STATS_BEGIN(symbol, ZINT_STATS_PLOT);
     error_number = plot_raster(symbol, rotate_angle, OUT_BUFFER);
+    STATS_END(symbol, ZINT_STATS_PLOT);
+    return error_tag(error_number, symbol, -1, NULL);
+}
+
+/* Output a previously encoded symbol as raster directly into caller-supplied buffer `dst` */
+int ZBarcode_Buffer_Into(struct zint_symbol *symbol, int rotate_angle, unsigned char *dst, int dst_width,
+            int dst_height, int dst_stride, int dst_format, int x, int y) {
+    static const int bits_per_pixel[5] = { 0, 8, 24, 32, 1 }; /* Indexed by ZINT_PIXEL_XXX */
+    struct out_raster_dest dest;
+    int min_stride;
+    int error_number;
+
+    if ((error_number = check_output_args(symbol, rotate_angle))) { /* >= ZINT_ERROR only */
+        return error_number; /* Already tagged */
+    }
+    if (!dst) {
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, 264, "Destination buffer NULL");
+    }
+    if (dst_format < ZINT_PIXEL_GREY8 || dst_format > ZINT_PIXEL_1BPP) {
+        errtxtf(0, symbol, 265, "Destination format '%d' out of range (1 to 4)", dst_format);
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, -1, NULL);
+    }
+    if (dst_width <= 0 || dst_width > 0x100000 || dst_height <= 0 || dst_height > 0x100000) {
+        ZEXT errtxtf(0, symbol, 266, "Destination size %1$dx%2$d out of range (1 to 1048576)", dst_width,
+                    dst_height);
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, -1, NULL);
+    }
+    /* Bound offsets so clipping arithmetic in `buffer_plot_dest()` can't overflow */
+    if (x < -0x100000 || x > 0x100000 || y < -0x100000 || y > 0x100000) {
+        ZEXT errtxtf(0, symbol, 268, "Destination offset %1$d,%2$d out of range (-1048576 to 1048576)", x, y);
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, -1, NULL);
+    }
+    min_stride = (dst_width * bits_per_pixel[dst_format] + 7) / 8;
+    if (dst_stride < min_stride) {
+        ZEXT errtxtf(0, symbol, 267, "Destination stride '%1$d' too small (minimum %2$d)", dst_stride, min_stride);
+        return error_tag(ZINT_ERROR_INVALID_OPTION, symbol, -1, NULL);
+    }
+
+    dest.buf = dst;
+    dest.width = dst_width;
+    dest.height = dst_height;
+    dest.stride = dst_stride;
+    dest.format = dst_format;
+    dest.x = x;
+    dest.y = y;
+
+    STATS_BEGIN(symbol, ZINT_STATS_PLOT);
+    error_number = plot_raster_into(symbol, rotate_angle, &dest);
+    STATS_END(symbol, ZINT_STATS_PLOT);
     return error_tag(error_number, symbol, -1, NULL);
 }
 
@@ -1380,7 +1674,9 @@ int ZBarcode_Buffer_Vector(struct zint_symbol *symbol, int rotate_angle) {
         return error_number; /* Already tagged */
     }
 
+    STATS_BEGIN(symbol, ZINT_STATS_PLOT);
     error_number = plot_vector(symbol, rotate_angle, OUT_BUFFER);
+    STATS_END(symbol, ZINT_STATS_PLOT);
     return error_tag(error_number, symbol, -1, NULL);
 }
 
@@ -1531,7 +1827,7 @@ int ZBarcode_Encode_File(struct zint_symbol *symbol, const char *filename) {
     }
 
     /* Allocate memory */
-    buffer = (unsigned char *) malloc((size_t) fileLen);
+    buffer = (unsigned char *) z_malloc((size_t) fileLen);
     if (!buffer) {
         if (file_opened) {
             (void) fclose(file);
@@ -1545,7 +1841,7 @@ int ZBarcode_Encode_File(struct zint_symbol *symbol, const char *filename) {
         n = fread(buffer + nRead, 1, fileLen - nRead, file);
         if (ferror(file)) {
             ZEXT errtxtf(0, symbol, 241, "Input file read error (%1$d: %2$s)", errno, strerror(errno));
-            free(buffer);
+            z_free(buffer);
             if (file_opened) {
                 (void) fclose(file);
             }
@@ -1557,12 +1853,12 @@ int ZBarcode_Encode_File(struct zint_symbol *symbol, const char *filename) {
     if (file_opened) {
         if (fclose(file) != 0) {
             ZEXT errtxtf(0, symbol, 794, "Failure on closing input file (%1$d: %2$s)", errno, strerror(errno));
-            free(buffer);
+            z_free(buffer);
             return error_tag(ZINT_ERROR_INVALID_DATA, symbol, -1, NULL);
         }
     }
     ret = ZBarcode_Encode(symbol, buffer, (int) nRead);
-    free(buffer);
+    z_free(buffer);
     return ret;
 }
 
@@ -1611,6 +1907,162 @@ int ZBarcode_Encode_File_and_Buffer_Vector(struct zint_symbol *symbol, const cha
     return error_number ? error_number : warn_number;
 }
 
+/* Per-thread state for `ZBarcode_Encode_Batch()` */
+struct batch_worker {
+    struct zint_batch *items;
+    int item_count;
+    int action;
+    int rotate_angle;
+    int start;          /* Index of first item to process */
+    int step;           /* Stride between items, i.e. number of workers */
+};
+
+/* Process every `step`th item of batch starting at `start` */
+static void batch_worker_run(void *arg) {
+    const struct batch_worker *worker = (const struct batch_worker *) arg;
+    int i;
+
+    for (i = worker->start; i < worker->item_count; i += worker->step) {
+        struct zint_batch *item = worker->items + i;
+        struct zint_seg segs[1];
+        const struct zint_seg *p_segs = item->segs;
+        int seg_count = item->seg_count;
+
+        if (!item->symbol) {
+            item->ret = ZINT_ERROR_INVALID_OPTION;
+            continue;
+        }
+        if (!p_segs) {
+            segs[0].eci = item->symbol->eci;
+            segs[0].source = (unsigned char *) item->source;
+            segs[0].length = item->length;
+            p_segs = segs;
+            seg_count = 1;
+        }
+        switch (worker->action) {
+            case ZINT_BATCH_BUFFER:
+                item->ret = ZBarcode_Encode_Segs_and_Buffer(item->symbol, p_segs, seg_count, worker->rotate_angle);
+                break;
+            case ZINT_BATCH_BUFFER_VECTOR:
+                item->ret = ZBarcode_Encode_Segs_and_Buffer_Vector(item->symbol, p_segs, seg_count,
+                                                                    worker->rotate_angle);
+                break;
+            case ZINT_BATCH_PRINT:
+                item->ret = ZBarcode_Encode_Segs_and_Print(item->symbol, p_segs, seg_count, worker->rotate_angle);
+                break;
+            default: /* ZINT_BATCH_ENCODE */
+                item->ret = ZBarcode_Encode_Segs(item->symbol, p_segs, seg_count);
+                break;
+        }
+    }
+}
+
+/* Encode (and output according to `action`) `item_count` batch `items`, using up to `num_threads` threads */
+int ZBarcode_Encode_Batch(struct zint_batch items[], const int item_count, const int action, int rotate_angle,
+            const int num_threads) {
+    struct batch_worker *workers;
+    int worker_count;
+    int i;
+    int ret = 0;
+
+    if (!items || item_count <= 0 || action < ZINT_BATCH_ENCODE || action > ZINT_BATCH_PRINT) {
+        return ZINT_ERROR_INVALID_OPTION;
+    }
+
+    worker_count = out_thread_count(num_threads, item_count);
+    workers = (struct batch_worker *) z_alloca(sizeof(struct batch_worker) * worker_count);
+
+    for (i = 0; i < worker_count; i++) {
+        workers[i].items = items;
+        workers[i].item_count = item_count;
+        workers[i].action = action;
+        workers[i].rotate_angle = rotate_angle;
+        workers[i].start = i;
+        workers[i].step = worker_count;
+    }
+
+    out_run_threads(batch_worker_run, workers, sizeof(struct batch_worker), worker_count);
+
+    for (i = 0; i < item_count; i++) {
+        if (items[i].ret > ret) {
+            ret = items[i].ret;
+        }
+    }
+
+    return ret;
+}
+
+/* Return module at `row`, `column` of a previously encoded symbol (colour 1-8 for Ultracode), or -1 if out of
+   range */
+int ZBarcode_Module(const struct zint_symbol *symbol, int row, int column) {
+    if (!symbol || row < 0 || row >= symbol->rows || column < 0 || column >= symbol->width) {
+        return -1;
+    }
+    if (symbol->symbology == BARCODE_ULTRA) {
+        return module_colour_is_set(symbol, row, column);
+    }
+    return module_is_set(symbol, row, column);
+}
+
+/* Return a compact copy of the module matrix of a previously encoded symbol, or NULL if none or malloc failure */
+struct zint_modules *ZBarcode_Modules(const struct zint_symbol *symbol) {
+    struct zint_modules *modules;
+    const size_t header_size = (sizeof(struct zint_modules) + 7) & ~((size_t) 7); /* Keep `bits` 8-byte aligned */
+    size_t bits_size, colours_size;
+    int stride, r;
+
+    if (!symbol || symbol->rows <= 0 || symbol->width <= 0) {
+        return NULL;
+    }
+    stride = (symbol->width + 63) >> 6;
+    bits_size = sizeof(zint_uint64) * stride * symbol->rows;
+    colours_size = symbol->symbology == BARCODE_ULTRA ? (size_t) symbol->width * symbol->rows : 0;
+
+    /* Allocate header, bits and colours (if any) in one go */
+    if (!(modules = (struct zint_modules *) z_malloc(header_size + bits_size + colours_size))) {
+        return NULL;
+    }
+    modules->rows = symbol->rows;
+    modules->width = symbol->width;
+    modules->stride = stride;
+    modules->bits = (zint_uint64 *) ((unsigned char *) modules + header_size);
+    modules->colours = colours_size ? (unsigned char *) (modules->bits + stride * symbol->rows) : NULL;
+
+    for (r = 0; r < symbol->rows; r++) {
+        zint_uint64 *words = modules->bits + stride * r;
+        if (modules->colours) {
+            unsigned char *colours = modules->colours + symbol->width * r;
+            int i;
+            memset(words, 0, sizeof(zint_uint64) * stride);
+            for (i = 0; i < symbol->width; i++) {
+                if ((colours[i] = module_colour_is_set(symbol, r, i))) {
+                    words[i >> 6] |= (zint_uint64) 1 << (i & 0x3F);
+                }
+            }
+        } else {
+            module_row_words(symbol, r, words);
+        }
+    }
+
+    return modules;
+}
+
+/* Return module at `row`, `column` of `modules` (colour 1-8 for Ultracode), or -1 if out of range */
+int ZBarcode_Modules_Get(const struct zint_modules *modules, int row, int column) {
+    if (!modules || row < 0 || row >= modules->rows || column < 0 || column >= modules->width) {
+        return -1;
+    }
+    if (modules->colours) {
+        return modules->colours[modules->width * row + column];
+    }
+    return (int) ((modules->bits[modules->stride * row + (column >> 6)] >> (column & 0x3F)) & 1);
+}
+
+/* Free a compact module matrix returned by `ZBarcode_Modules()` */
+void ZBarcode_Modules_Free(struct zint_modules *modules) {
+    z_free(modules); /* Allocated in one go */
+}
+
 /* Checks whether a symbology is supported */
 int ZBarcode_ValidID(int symbol_id) {
 
@@ -2131,15 +2583,76 @@ int ZBarcode_Dest_Len_ECI(int eci, const unsigned char *source, int length, int
     return 0;
 }
 
-/* Whether Zint built without PNG support */
-int ZBarcode_NoPng(void) {
-#ifdef ZINT_NO_PNG
-    return 1;
-#else
+/* Process escape sequences in `source` of length `length` as for ESCAPE_MODE (and EXTRA_ESCAPE_MODE if set in
+   `symbol->input_mode` and `symbol->symbology` is BARCODE_CODE128), placing the result in `dest`, which must be
+   at least `length` + 1 bytes long, and its length in `p_dest_length`. If `length` is 0 or negative, `source` must
+   be NUL-terminated. Returns 0 on success, else ZINT_ERROR_INVALID_DATA (with `symbol->errtxt` set if `symbol`
+   non-NULL) */
+int ZBarcode_Unescape(struct zint_symbol *symbol, const unsigned char *source, int length, unsigned char dest[],
+            int *p_dest_length) {
+    int error_number;
+
+    if (!symbol) return ZINT_ERROR_INVALID_DATA;
+    if (!source || !dest || !p_dest_length) {
+        return error_tag(ZINT_ERROR_INVALID_DATA, symbol, 215, "Unescape source, destination or length NULL");
+    }
+    if (length <= 0) {
+        length = (int) ustrlen(source);
+    }
+
+    if ((error_number = escape_char_process(symbol, source, &length, dest, length + 1)) != 0) {
+        return error_tag(error_number, symbol, -1, NULL);
+    }
+    *p_dest_length = length;
+
     return 0;
+}
+
+/* Set the memory allocation functions used by libzint. Returns 0 on success, else ZINT_ERROR_INVALID_OPTION */
+int ZBarcode_SetAllocator(zint_malloc_func_t malloc_func, zint_realloc_func_t realloc_func,
+            zint_free_func_t free_func, void *opaque) {
+    if (!malloc_func != !free_func) {
+        return ZINT_ERROR_INVALID_OPTION;
+    }
+    z_set_allocator(malloc_func, realloc_func, free_func, opaque);
+
+    return 0;
+}
+
+/* Set the maximum number of entries in the encode cache, 0 (the default) to disable and free it. Returns 0 on
+   success, ZINT_ERROR_INVALID_OPTION if `max_entries` out of range, or ZINT_ERROR_MEMORY */
+int ZBarcode_SetEncodeCache(const int max_entries) {
+    if (max_entries < 0 || max_entries > CACHE_MAX_ENTRIES) {
+        return ZINT_ERROR_INVALID_OPTION;
+    }
+    return cache_set_size(max_entries);
+}
+
+/* Copy the per-stage timing statistics in `symbol->stats` to `stats`. Returns 0 on success, or
+   ZINT_ERROR_INVALID_OPTION (`stats` zeroed) if not built with ZINT_STATS */
+int ZBarcode_GetStats(const struct zint_symbol *symbol, struct zint_stats *stats) {
+    if (!stats) {
+        return ZINT_ERROR_INVALID_OPTION;
+    }
+#ifdef ZINT_STATS
+    if (!symbol) {
+        memset(stats, 0, sizeof(*stats));
+        return ZINT_ERROR_INVALID_OPTION;
+    }
+    memcpy(stats, &symbol->stats, sizeof(*stats));
+    return 0;
+#else
+    (void)symbol;
+    memset(stats, 0, sizeof(*stats));
+    return ZINT_ERROR_INVALID_OPTION;
 #endif
 }
 
+/* Whether Zint built without PNG support - always 0 as PNG falls back to built-in encoder if no libpng */
+int ZBarcode_NoPng(void) {
+    return 0;
+}
+
 /* Return the version of Zint linked to */
 int ZBarcode_Version(void) {
 #if ZINT_VERSION_BUILD
@@ -40,6 +40,10 @@
 #include <sys/stat.h> /* mkdir(2) */
 #endif
 #include "common.h"
+#ifdef ZINT_USE_PTHREADS /* May be set by "common.h" */
+#include <pthread.h>
+#include <unistd.h> /* sysconf(3) */
+#endif
 #include "output.h"
 
 #define OUT_SSET_F  (IS_NUM_F | IS_UHX_F | IS_LHX_F) /* SSET "0123456789ABCDEFabcdef" */
@@ -885,6 +889,210 @@ INTERNAL float out_large_bar_height(struct zint_symbol *symbol, const int si, in
     return large_bar_height;
 }
 
+/* Source row/column of scaled row `y`/column `x` */
+#define OUT_SRC_ROW(rows, y) ((rows)->row_map ? (rows)->row_map[y] : (y))
+#define OUT_SRC_COL(rows, x) ((rows)->col_map ? (rows)->col_map[x] : (x))
+
+/* Set up `rows` to view `pixelbuf` scaled by `scaler` (0 for none) then rotated by `rotate_angle`.
+   Returns 0 if memory allocation fails */
+INTERNAL int out_raster_rows_init(struct out_raster_rows *rows, const unsigned char *pixelbuf, const int src_width,
+                const int src_height, const float scaler, const int rotate_angle) {
+    int i, x;
+
+    assert(rotate_angle == 0 || rotate_angle == 90 || rotate_angle == 180 || rotate_angle == 270);
+
+    rows->pixelbuf = pixelbuf;
+    rows->src_width = src_width;
+    rows->src_height = src_height;
+    rows->scaler = scaler;
+    rows->rotate_angle = rotate_angle;
+    if (scaler) {
+        rows->scaled_width = (int) stripf(src_width * scaler);
+        rows->scaled_height = (int) stripf(src_height * scaler);
+    } else {
+        rows->scaled_width = src_width;
+        rows->scaled_height = src_height;
+    }
+    if (rotate_angle == 90 || rotate_angle == 270) {
+        rows->width = rows->scaled_height;
+        rows->height = rows->scaled_width;
+    } else {
+        rows->width = rows->scaled_width;
+        rows->height = rows->scaled_height;
+    }
+    rows->band_buf = rows->band = NULL;
+    rows->band_start = 0;
+    rows->band_count = 0;
+    rows->row_map = rows->col_map = rows->col_start = NULL;
+
+    if (scaler || rotate_angle) {
+        if (!(rows->band_buf = (unsigned char *) z_malloc((size_t) rows->width * OUT_RASTER_BAND * 2))) {
+            return 0;
+        }
+    }
+    if (scaler) {
+        /* Nearest neighbour maps, worked out once per image */
+        if (!(rows->row_map = (int *) z_malloc(sizeof(int) * (rows->scaled_height + rows->scaled_width
+                                                                + src_width + 1)))) {
+            out_raster_rows_free(rows);
+            return 0;
+        }
+        rows->col_map = rows->row_map + rows->scaled_height;
+        rows->col_start = rows->col_map + rows->scaled_width;
+        for (i = 0; i < rows->scaled_height; i++) {
+            const int y = (int) stripf(i / scaler);
+            rows->row_map[i] = y < src_height ? y : src_height - 1;
+        }
+        for (i = 0, x = 0; i < rows->scaled_width; i++) {
+            const int col = (int) stripf(i / scaler);
+            rows->col_map[i] = col < src_width ? col : src_width - 1;
+            while (x <= rows->col_map[i]) {
+                rows->col_start[x++] = i;
+            }
+        }
+        while (x <= src_width) {
+            rows->col_start[x++] = rows->scaled_width;
+        }
+    }
+    return 1;
+}
+
+/* Fill scaled row `dst` from source row `src`, setting spans of output columns with same source pixel value at a
+   time using `col_start`, reversed if `reverse` */
+static void out_raster_scale_row(const struct out_raster_rows *rows, const unsigned char *src, unsigned char *dst,
+                const int reverse) {
+    const int *const col_start = rows->col_start;
+    const int src_width = rows->src_width;
+    const int width = rows->scaled_width;
+    int x = 0, x_end;
+
+    while (x < src_width) {
+        const unsigned char val = src[x];
+        for (x_end = x + 1; x_end < src_width && src[x_end] == val; x_end++);
+        if (col_start[x_end] > col_start[x]) {
+            memset(dst + (reverse ? width - col_start[x_end] : col_start[x]), val, col_start[x_end] - col_start[x]);
+        }
+        x = x_end;
+    }
+}
+
+/* Fill `count` output rows of `rows` starting at `row` into `dst`, each `dst_stride` bytes apart. 90 and 270 degree
+   rotations are done a tile of `OUT_RASTER_BAND` rows at a time, reading each source row sequentially once per tile
+   rather than walking source columns */
+static void out_raster_fill(const struct out_raster_rows *rows, int row, const int count, unsigned char *dst,
+                const size_t dst_stride) {
+    const unsigned char *const pixelbuf = rows->pixelbuf;
+    const size_t src_width = rows->src_width;
+    const int width = rows->width;
+    const int start = row;
+    const int end = row + count;
+    int column, k;
+
+    if (rows->rotate_angle == 0 || rows->rotate_angle == 180) {
+        const int reverse = rows->rotate_angle == 180;
+        for (; row < end; row++, dst += dst_stride) {
+            const int y = reverse ? rows->height - row - 1 : row;
+            const unsigned char *const src = pixelbuf + src_width * OUT_SRC_ROW(rows, y);
+            if (row > start && OUT_SRC_ROW(rows, y) == OUT_SRC_ROW(rows, reverse ? y + 1 : y - 1)) {
+                memcpy(dst, dst - dst_stride, width); /* Same source row as previous */
+            } else if (rows->col_start) {
+                out_raster_scale_row(rows, src, dst, reverse);
+            } else if (reverse) {
+                for (column = 0; column < width; column++) {
+                    dst[column] = src[width - column - 1];
+                }
+            } else {
+                memcpy(dst, src, width);
+            }
+        }
+    } else {
+        int src_x[OUT_RASTER_BAND];
+        for (; row < end; row += OUT_RASTER_BAND, dst += dst_stride * OUT_RASTER_BAND) {
+            const int tile_rows = end - row < OUT_RASTER_BAND ? end - row : OUT_RASTER_BAND;
+            /* Output rows are source columns */
+            for (k = 0; k < tile_rows; k++) {
+                src_x[k] = OUT_SRC_COL(rows, rows->rotate_angle == 90 ? row + k : rows->height - (row + k) - 1);
+            }
+            /* Output columns are source rows, bottom up if 90 degrees clockwise, top down if 270 */
+            for (column = 0; column < width; column++) {
+                const unsigned char *const src = pixelbuf + src_width * OUT_SRC_ROW(rows,
+                                                    rows->rotate_angle == 90 ? width - column - 1 : column);
+                unsigned char *d = dst + column;
+                for (k = 0; k < tile_rows; k++, d += dst_stride) {
+                    *d = src[src_x[k]];
+                }
+            }
+        }
+    }
+}
+
+/* Return output row `row` of `rows`, produced a band at a time. The row returned by the previous call remains
+   valid */
+INTERNAL const unsigned char *out_raster_row(struct out_raster_rows *rows, const int row) {
+    const size_t width = rows->width;
+    int start;
+
+    assert(row >= 0 && row < rows->height);
+
+    if (!rows->band_buf) {
+        return rows->pixelbuf + (size_t) rows->src_width * row;
+    }
+    if (row < rows->band_start || row >= rows->band_start + rows->band_count) {
+        if (rows->band_count && row == rows->band_start - 1) {
+            /* Going backwards (BMP), so end band at `row` */
+            start = row - OUT_RASTER_BAND + 1 > 0 ? row - OUT_RASTER_BAND + 1 : 0;
+        } else {
+            start = row;
+        }
+        /* Alternate halves so that previous band (and so previous row) stays valid */
+        rows->band = rows->band == rows->band_buf ? rows->band_buf + width * OUT_RASTER_BAND : rows->band_buf;
+        rows->band_start = start;
+        rows->band_count = rows->height - start < OUT_RASTER_BAND ? rows->height - start : OUT_RASTER_BAND;
+        out_raster_fill(rows, start, rows->band_count, rows->band, width);
+    }
+
+    return rows->band + width * (row - rows->band_start);
+}
+
+/* Arguments for `out_raster_copy_band()` */
+struct out_raster_copy {
+    const struct out_raster_rows *rows;
+    unsigned char *dst;
+};
+
+/* Fill rows `start` to `end` - 1 of `out_raster_rows_copy()` destination */
+static void out_raster_copy_band(void *arg, const int start, const int end) {
+    const struct out_raster_copy *copy = (const struct out_raster_copy *) arg;
+    const size_t width = copy->rows->width;
+
+    out_raster_fill(copy->rows, start, end - start, copy->dst + width * start, width);
+}
+
+/* Copy all the output rows of `rows` to `dst` (`rows->width` x `rows->height`), split into `band_count` bands done
+   concurrently if threads available */
+INTERNAL void out_raster_rows_copy(const struct out_raster_rows *rows, unsigned char *dst, const int band_count) {
+    if (!rows->band_buf) {
+        memcpy(dst, rows->pixelbuf, (size_t) rows->width * rows->height);
+    } else {
+        struct out_raster_copy copy;
+        copy.rows = rows;
+        copy.dst = dst;
+        out_run_bands(out_raster_copy_band, &copy, rows->height, band_count);
+    }
+}
+
+/* Free any memory allocated by `out_raster_rows_init()` */
+INTERNAL void out_raster_rows_free(struct out_raster_rows *rows) {
+    if (rows->band_buf) {
+        z_free(rows->band_buf);
+        rows->band_buf = NULL;
+    }
+    if (rows->row_map) {
+        z_free(rows->row_map);
+        rows->row_map = rows->col_map = rows->col_start = NULL;
+    }
+}
+
 #ifdef _WIN32
 /* Convert UTF-8 to Windows wide chars. Ticket #288, props Marcel */
 #define utf8_to_wide(u, w, r) \
@@ -1003,4 +1211,143 @@ INTERNAL FILE *out_fopen(const char filename[256], const char *mode) {
     return outfile;
 }
 
+#if defined(ZINT_USE_PTHREADS) || (defined(_WIN32) && !defined(ZINT_NO_THREADS))
+#define OUT_HAVE_THREADS
+#endif
+
+/* Return number of threads to use given `requested` (0 or negative for number of processors), bounded by `max` */
+INTERNAL int out_thread_count(const int requested, const int max) {
+    int count = requested;
+
+#ifdef OUT_HAVE_THREADS
+    if (count <= 0) {
+#  ifdef _WIN32
+        SYSTEM_INFO sysinfo;
+        GetSystemInfo(&sysinfo);
+        count = (int) sysinfo.dwNumberOfProcessors;
+#  elif defined(_SC_NPROCESSORS_ONLN)
+        const long nprocs = sysconf(_SC_NPROCESSORS_ONLN);
+        count = nprocs > 0 && nprocs <= OUT_MAX_THREADS ? (int) nprocs : 1;
+#  else
+        count = 1;
+#  endif
+    }
+    if (count > OUT_MAX_THREADS) {
+        count = OUT_MAX_THREADS;
+    }
+#else
+    count = 1; /* No threads */
+#endif
+    if (count > max) {
+        count = max;
+    }
+
+    return count < 1 ? 1 : count;
+}
+
+#ifdef OUT_HAVE_THREADS
+/* Thread start argument */
+struct out_thread {
+    void (*func)(void *arg);
+    void *arg;
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+};
+
+#ifdef _WIN32
+static DWORD WINAPI out_thread_start(LPVOID arg) {
+#else
+static void *out_thread_start(void *arg) {
+#endif
+    struct out_thread *thread = (struct out_thread *) arg;
+    thread->func(thread->arg);
+    return 0;
+}
+#endif /* OUT_HAVE_THREADS */
+
+/* Call `func` with each of the `count` arguments in `args` (each `arg_size` bytes long), concurrently if threads
+   available, returning when all calls done. The first call is made on the calling thread, as are any for which a
+   thread can't be created (so `func` is always called `count` times) */
+INTERNAL void out_run_threads(void (*func)(void *arg), void *args, const size_t arg_size, const int count) {
+    unsigned char *arg = (unsigned char *) args;
+    int i;
+#ifdef OUT_HAVE_THREADS
+    struct out_thread *threads;
+    int started = 0;
+
+    if (count > 1 && (threads = (struct out_thread *) z_malloc(sizeof(struct out_thread) * (count - 1)))) {
+        for (i = 0; i < count - 1; i++) {
+            threads[i].func = func;
+            threads[i].arg = arg + arg_size * (i + 1);
+#ifdef _WIN32
+            if (!(threads[i].handle = CreateThread(NULL, 0, out_thread_start, &threads[i], 0, NULL))) {
+                break;
+            }
+#else
+            if (pthread_create(&threads[i].handle, NULL, out_thread_start, &threads[i]) != 0) {
+                break;
+            }
+#endif
+        }
+        started = i;
+        func(arg);
+        for (i = started; i < count - 1; i++) { /* Run any that failed to start on this thread */
+            func(arg + arg_size * (i + 1));
+        }
+        for (i = 0; i < started; i++) {
+#ifdef _WIN32
+            WaitForSingleObject(threads[i].handle, INFINITE);
+            CloseHandle(threads[i].handle);
+#else
+            (void) pthread_join(threads[i].handle, NULL);
+#endif
+        }
+        z_free(threads);
+        return;
+    }
+#endif /* OUT_HAVE_THREADS */
+
+    for (i = 0; i < count; i++) {
+        func(arg + arg_size * i);
+    }
+}
+
+/* Band argument for `out_run_bands()` */
+struct out_band {
+    void (*func)(void *arg, const int start, const int end);
+    void *arg;
+    int start;
+    int end;
+};
+
+static void out_band_run(void *arg) {
+    const struct out_band *band = (const struct out_band *) arg;
+    band->func(band->arg, band->start, band->end);
+}
+
+/* Call `func` for each of `count` contiguous bands of rows `start` to `end` - 1 covering rows 0 to `height` - 1,
+   concurrently if threads available. Bands must not write to each other's rows */
+INTERNAL void out_run_bands(void (*func)(void *arg, const int start, const int end), void *arg, const int height,
+                const int count) {
+    struct out_band *bands;
+    int i;
+
+    if (count <= 1 || height <= 1) {
+        func(arg, 0, height);
+        return;
+    }
+    bands = (struct out_band *) z_alloca(sizeof(struct out_band) * count);
+    for (i = 0; i < count; i++) {
+        bands[i].func = func;
+        bands[i].arg = arg;
+        bands[i].start = (int) (((size_t) height * i) / count); /* Sizes differ by at most 1 */
+        bands[i].end = (int) (((size_t) height * (i + 1)) / count);
+    }
+
+    out_run_threads(out_band_run, bands, sizeof(struct out_band), count);
+}
+
 /* vim: set ts=4 sw=4 et : */
@@ -39,6 +39,58 @@ extern "C" {
 
 #include <stdio.h> /* For FILE */
 
+/* Caller-supplied raster destination (`ZBarcode_Buffer_Into()`), validated by caller */
+struct out_raster_dest {
+    unsigned char *buf; /* Destination pixels */
+    int width;          /* Width in pixels */
+    int height;         /* Height in pixels */
+    int stride;         /* Bytes per row */
+    int format;         /* ZINT_PIXEL_XXX */
+    int x;              /* Offset of symbol's left edge in pixels, may be negative (clipped) */
+    int y;              /* Offset of symbol's top edge in pixels, may be negative (clipped) */
+};
+
+/* Number of rows `out_raster_row()` produces at a time, also the tile height used when rotating */
+#define OUT_RASTER_BAND 64
+
+/* Row-at-a-time view of a raster image, scaled and/or rotated on demand by `out_raster_row()` so that file output
+   needn't materialise the final image (the source image must still be whole) */
+struct out_raster_rows {
+    const unsigned char *pixelbuf; /* Source pixels, `src_width` x `src_height` */
+    int src_width;                 /* Source width in pixels */
+    int src_height;                /* Source height in pixels */
+    float scaler;                  /* Scale applied to source, or 0 if none */
+    int rotate_angle;              /* Rotation applied after scaling (0, 90, 180 or 270) */
+    int scaled_width;              /* Width after scaling (before rotation) */
+    int scaled_height;             /* Height after scaling (before rotation) */
+    int width;                     /* Width of output rows */
+    int height;                    /* Number of output rows */
+    unsigned char *band_buf;       /* Two halves of `OUT_RASTER_BAND` rows used alternately, NULL if output is
+                                      `pixelbuf` as is */
+    unsigned char *band;           /* Half of `band_buf` holding current band */
+    int band_start;                /* First row in band */
+    int band_count;                /* Number of rows in band, 0 if none */
+    int *row_map;                  /* Source row of each scaled row, NULL if not scaled */
+    int *col_map;                  /* Source column of each scaled column, NULL if not scaled */
+    int *col_start;                /* First scaled column of each source column (plus end), NULL if not scaled */
+};
+
+/* Set up `rows` to view `pixelbuf` scaled by `scaler` (0 for none) then rotated by `rotate_angle`.
+   Returns 0 if memory allocation fails */
+INTERNAL int out_raster_rows_init(struct out_raster_rows *rows, const unsigned char *pixelbuf, const int src_width,
+                const int src_height, const float scaler, const int rotate_angle);
+
+/* Return output row `row` of `rows`, produced a band at a time. The row returned by the previous call remains
+   valid */
+INTERNAL const unsigned char *out_raster_row(struct out_raster_rows *rows, const int row);
+
+/* Copy all the output rows of `rows` to `dst` (`rows->width` x `rows->height`), split into `band_count` bands done
+   concurrently if threads available */
+INTERNAL void out_raster_rows_copy(const struct out_raster_rows *rows, unsigned char *dst, const int band_count);
+
+/* Free any memory allocated by `out_raster_rows_init()` */
+INTERNAL void out_raster_rows_free(struct out_raster_rows *rows);
+
 /* Check colour options are good (`symbol->fgcolour`, `symbol->bgcolour`) */
 INTERNAL int out_check_colour_options(struct zint_symbol *symbol);
 
@@ -78,6 +130,22 @@ INTERNAL FILE *out_fopen(const char filename[256], const char *mode);
 INTERNAL FILE *out_win_fopen(const char *filename, const char *mode);
 #endif
 
+/* Maximum number of threads used by `out_run_threads()` */
+#define OUT_MAX_THREADS 256
+
+/* Return number of threads to use given `requested` (0 or negative for number of processors), bounded by `max`.
+   Always 1 if built without threads support */
+INTERNAL int out_thread_count(const int requested, const int max);
+
+/* Call `func` with each of the `count` arguments in `args` (each `arg_size` bytes long), concurrently if threads
+   available, returning when all calls done */
+INTERNAL void out_run_threads(void (*func)(void *arg), void *args, const size_t arg_size, const int count);
+
+/* Call `func` for each of `count` contiguous bands of rows `start` to `end` - 1 covering rows 0 to `height` - 1,
+   concurrently if threads available. Bands must not write to each other's rows */
+INTERNAL void out_run_bands(void (*func)(void *arg, const int start, const int end), void *arg, const int height,
+                const int count);
+
 /* Little-endian output */
 #define out_le_u16(b, n) do { \
         unsigned char *bp = (unsigned char *) &(b); \
@@ -39,7 +39,7 @@
 #include "pcx.h"        /* PCX header structure */
 
 /* ZSoft PCX File Format Technical Reference Manual http://bespin.org/~qz/pc-gpe/pcx.txt */
-INTERNAL int pcx_pixel_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf) {
+INTERNAL int pcx_pixel_plot(struct zint_symbol *symbol, struct out_raster_rows *rows) {
     unsigned char fgred, fggrn, fgblu, fgalpha, bgred, bggrn, bgblu, bgalpha;
     int row, column, i, colour;
     int run_count;
@@ -92,7 +92,8 @@ INTERNAL int pcx_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
 
     fm_write(&header, sizeof(pcx_header_t), 1, fmp);
 
-    for (row = 0, pb = pixelbuf; row < symbol->bitmap_height; row++, pb += symbol->bitmap_width) {
+    for (row = 0; row < symbol->bitmap_height; row++) {
+        pb = out_raster_row(rows, row);
         for (colour = 0; colour < header.number_of_planes; colour++) {
             for (column = 0; column < symbol->bitmap_width; column++) {
                 const unsigned char ch = pb[column];
@@ -916,7 +916,7 @@ static int pdf_define_mode(short liste[3][PDF_MAX_LEN], int *p_indexliste, const
     struct pdf_edge *edge;
     int mode_start, mode_len;
 
-    struct pdf_edge *edges = (struct pdf_edge *) calloc((length + 1) * PDF_NUM_MODES, sizeof(struct pdf_edge));
+    struct pdf_edge *edges = (struct pdf_edge *) z_calloc((length + 1) * PDF_NUM_MODES, sizeof(struct pdf_edge));
     if (!edges) {
         return 0;
     }
@@ -985,7 +985,7 @@ static int pdf_define_mode(short liste[3][PDF_MAX_LEN], int *p_indexliste, const
         fputc('\n', stdout);
     }
 
-    free(edges);
+    z_free(edges);
 
     return 1;
 }
@@ -1317,6 +1317,11 @@ static int pdf_enc(struct zint_symbol *symbol, struct zint_seg segs[], const int
     symbol->option_2 = cols;
     symbol->option_3 = rows; /* Same as `symbol->rows` */
 
+    if (estimate_set(symbol, cols, rows, symbol->symbology != BARCODE_PDF417COMP ? 17 * (cols + 4) + 1
+                        : 17 * (cols + 2) + 1, rows * cols - ecc_cws, rows * cols)) {
+        return error_number;
+    }
+
     /* 781 - Padding calculation */
     padding = rows * cols - longueur;
 
@@ -1673,6 +1678,13 @@ INTERNAL int micropdf417(struct zint_symbol *symbol, struct zint_seg segs[], con
         fputc('\n', stdout);
     }
 
+    /* Width is left & right RAPs and stop, plus centre RAP if 3 or 4 columns */
+    if (estimate_set(symbol, symbol->option_2, symbol->rows, 21 + 17 * symbol->option_2
+                        + (symbol->option_2 >= 3) * 10, longueur, longueur + k)) {
+        symbol->rows = 0;
+        return error_number;
+    }
+
     /* We add the padding */
     while (i > 0) {
         chainemc[mclength++] = 900;
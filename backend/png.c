@@ -30,105 +30,40 @@
  */
 /* SPDX-License-Identifier: BSD-3-Clause */
 
-#ifndef ZINT_NO_PNG
-
 #include <errno.h>
 #include <math.h>
 #include <stdio.h>
+#ifndef ZINT_NO_PNG
 #include <png.h>
 #include <zlib.h>
 #include <setjmp.h>
+#endif /* ZINT_NO_PNG */
 #include "common.h"
 #include "filemem.h"
 #include "output.h"
 
 /* Note using "wpng_" prefix not "png_" (except for `png_pixel_plot()`) to avoid clashing with libpng */
 
-/* Note if change this need to change "backend/tests/test_png.c" definition also */
-struct wpng_error_type {
-    struct zint_symbol *symbol;
-    jmp_buf jmpbuf;
+/* Palette entry (same layout as libpng's `png_color`) */
+struct wpng_colour {
+    unsigned char red;
+    unsigned char green;
+    unsigned char blue;
 };
 
-static void wpng_error_handler(png_structp png_ptr, png_const_charp msg) {
-    struct wpng_error_type *wpng_error_ptr;
-
-    wpng_error_ptr = (struct wpng_error_type *) png_get_error_ptr(png_ptr);
-    if (wpng_error_ptr == NULL) {
-        /* we are completely hosed now */
-        fprintf(stderr, "Error 636: libpng error: %s\n", msg ? msg : "<NULL>");
-        fprintf(stderr, "Error 637: jmpbuf not recoverable, terminating\n");
-        fflush(stderr);
-        return; /* libpng will call abort() */
-    }
-    errtxtf(0, wpng_error_ptr->symbol, 635, "libpng error: %s", msg ? msg : "<NULL>");
-    longjmp(wpng_error_ptr->jmpbuf, 1);
-}
-
-#ifdef ZINT_TEST /* Wrapper for direct testing */
-INTERNAL void wpng_error_handler_test(png_structp png_ptr, png_const_charp msg) {
-    wpng_error_handler(png_ptr, msg);
-}
-#endif
-
-/* libpng write callback */
-static void wpng_write(png_structp png_ptr, png_bytep ptr, size_t size) {
-    struct filemem *fmp = (struct filemem *) png_get_io_ptr(png_ptr);
-    (void) fm_write(ptr, 1, size, fmp);
-}
-
-/* libpng flush callback */
-static void wpng_flush(png_structp png_ptr) {
-    struct filemem *fmp = (struct filemem *) png_get_io_ptr(png_ptr);
-    (void) fm_flush(fmp);
-}
-
-/* Guestimate best compression strategy */
-static int wpng_guess_compression_strategy(struct zint_symbol *symbol, const unsigned char *pixelbuf) {
-    (void)pixelbuf;
-
-    /* TODO: Do properly */
-
-    /* It seems the best choice for typical barcode pngs is one of Z_DEFAULT_STRATEGY and Z_FILTERED */
-
-    /* Some guesses */
-    if (symbol->symbology == BARCODE_MAXICODE) {
-        return Z_DEFAULT_STRATEGY;
-    }
-    if (symbol->symbology == BARCODE_AZTEC && symbol->bitmap_width <= 30) {
-        return Z_DEFAULT_STRATEGY;
-    }
-
-    /* Z_FILTERED seems to work better for slightly more barcodes+data so default to that */
-    return Z_FILTERED;
-}
-
-INTERNAL int png_pixel_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf) {
-    struct wpng_error_type wpng_error;
-    struct filemem fm;
-    struct filemem *const fmp = &fm;
-    png_structp png_ptr;
-    png_infop info_ptr;
-    int i;
-    int row, column;
-    png_color bg, fg;
+/* Set `palette`, `trans_alpha` (leading palette entries with alpha, `*p_num_trans` of them) and `map` from pixel
+   colour chars to palette indexes, returning number of palette entries */
+static int wpng_palette(const struct zint_symbol *symbol, unsigned char map[128], struct wpng_colour palette[32],
+            unsigned char trans_alpha[32], int *p_num_trans) {
+    struct wpng_colour bg, fg;
     unsigned char bg_alpha, fg_alpha;
-    unsigned char map[128];
-    png_color palette[32];
     int num_palette;
-    unsigned char trans_alpha[32];
-    int num_trans; /* Note initialize below to avoid gcc -Wclobbered warning due to `longjmp()` */
-    int bit_depth;
-    int compression_strategy;
-    const unsigned char *pb;
-    unsigned char *outdata = (unsigned char *) z_alloca(symbol->bitmap_width);
-
-    wpng_error.symbol = symbol;
+    int num_trans = 0;
+    int i;
 
     (void) out_colour_get_rgb(symbol->fgcolour, &fg.red, &fg.green, &fg.blue, &fg_alpha);
     (void) out_colour_get_rgb(symbol->bgcolour, &bg.red, &bg.green, &bg.blue, &bg_alpha);
 
-    num_trans = 0;
     if (symbol->symbology == BARCODE_ULTRA) {
         static const unsigned char ultra_chars[8] = { 'W', 'C', 'B', 'M', 'R', 'Y', 'G', 'K' };
         for (i = 0; i < 8; i++) {
@@ -171,7 +106,7 @@ INTERNAL int png_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
                     palette[num_palette++] = bg;
                 } else {
                     /* Alpha and no foreground alpha - add to front & move white to end */
-                    png_color white = palette[0]; /* Take copy */
+                    struct wpng_colour white = palette[0]; /* Take copy */
                     map['0'] = 0;
                     palette[0] = bg;
                     map['W'] = num_palette;
@@ -204,36 +139,767 @@ INTERNAL int png_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
         num_palette = 2;
     }
 
-    if (num_palette <= 2) {
-        bit_depth = 1;
+    *p_num_trans = num_trans;
+    return num_palette;
+}
+
+/* Smallest bit depth that can index `num_palette` entries */
+static int wpng_bit_depth(const int num_palette) {
+    return num_palette <= 2 ? 1 : num_palette <= 4 ? 2 : num_palette <= 16 ? 4 : 8;
+}
+
+/* Size in bytes of a row of `width` pixels at `bit_depth`, excluding filter type byte */
+#define WPNG_ROW_BYTES(width, bit_depth) (((size_t) (width) * (bit_depth) + 7) / 8)
+
+/* Pack row `pb` of `width` pixels into `outdata` at `bit_depth` (1, 2, 4 or 8) using palette indexes `map` */
+static void wpng_pack_row(const unsigned char map[128], const int bit_depth, const unsigned char *pb,
+            const int width, unsigned char *outdata) {
+    const unsigned char *const pe = pb + width;
+
+    if (bit_depth == 8) {
+        while (pb < pe) {
+            *outdata++ = map[*pb++];
+        }
     } else {
-        bit_depth = 4;
+        while (pb < pe) {
+            unsigned char byte = 0;
+            int shift;
+            for (shift = 8 - bit_depth; shift >= 0 && pb < pe; shift -= bit_depth) {
+                byte |= map[*pb++] << shift;
+            }
+            *outdata++ = byte;
+        }
     }
+}
 
-    /* Open output file in binary mode */
-    if (!fm_open(fmp, symbol, "wb")) {
-        return ZEXT errtxtf(ZINT_ERROR_FILE_ACCESS, symbol, 632, "Could not open PNG output file (%1$d: %2$s)",
-                            fmp->err, strerror(fmp->err));
+/* Built-in encoder, used if no libpng or if `ZINT_PNG_NATIVE` set. Rows are written unfiltered and compressed by a
+   deflate specialised for barcodes, which only looks for repeats of the previous byte (distance 1) and of the
+   previous row (distance one row), these catching the long runs and repeated rows that make up most images */
+
+#define WPNG_IDAT_SIZE      0x8000  /* Size of IDAT chunks written (apart from last) */
+#define WPNG_BLOCK_SYMS     0x4000  /* Literals and matches per deflate block (apart from last) */
+#define WPNG_LITLEN_CODES   286     /* Literal/length alphabet, excluding unused 286 and 287 */
+#define WPNG_FIXED_CODES    288     /* Fixed code literal/length alphabet, including unused 286 and 287 */
+#define WPNG_DIST_CODES     30      /* Distance alphabet */
+#define WPNG_CL_CODES       19      /* Code length alphabet */
+#define WPNG_MIN_MATCH      3
+#define WPNG_MAX_MATCH      258
+#define WPNG_MAX_DIST       32768
+
+/* Deflate state */
+struct wpng_deflate {
+    struct filemem *fmp;
+    unsigned long bitbuf;                       /* Pending output bits, first out in LSB */
+    int bitcnt;                                 /* Number of bits in `bitbuf` */
+    unsigned long adler;                        /* Adler-32 of data so far */
+    int idat_len;                               /* Bytes in `idat` */
+    int sym_cnt;                                /* Symbols in `litlens` & `dists` */
+    unsigned short litlens[WPNG_BLOCK_SYMS];    /* Literal byte, or 256 + match length */
+    unsigned short dists[WPNG_BLOCK_SYMS];      /* Match distance, or 0 if literal */
+    unsigned char idat[WPNG_IDAT_SIZE];         /* Compressed data pending output */
+};
+
+/* Bases and extra bits of length codes 257-285, and of distance codes 0-29 (RFC 1951 3.2.5) */
+static const unsigned short wpng_len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const unsigned char wpng_len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short wpng_dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+    6145, 8193, 12289, 16385, 24577
+};
+static const unsigned char wpng_dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/* Return index of the last of the `cnt` ascending `bases` that is <= `value` */
+static int wpng_base_index(const unsigned short *bases, const int cnt, const int value) {
+    int i = cnt - 1;
+    while (bases[i] > value) {
+        i--;
+    }
+    return i;
+}
+
+/* Return CRC-32 (as used by PNG) `crc` updated with `len` bytes of `data`, a nibble at a time */
+static unsigned long wpng_crc32(unsigned long crc, const unsigned char *data, size_t len) {
+    static const unsigned long nibbles[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    crc = ~crc & 0xFFFFFFFF;
+    while (len--) {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ nibbles[crc & 0x0F];
+        crc = (crc >> 4) ^ nibbles[crc & 0x0F];
+    }
+    return ~crc & 0xFFFFFFFF;
+}
+
+/* Return Adler-32 (as used by zlib) `adler` updated with `len` bytes of `data` */
+static unsigned long wpng_adler32(const unsigned long adler, const unsigned char *data, size_t len) {
+    unsigned long a = adler & 0xFFFF, b = adler >> 16;
+
+    while (len) {
+        size_t n = len < 5552 ? len : 5552; /* Max before `b` can overflow 32 bits */
+        len -= n;
+        while (n--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+/* Big-endian output */
+static void wpng_be_u32(unsigned char *b, const unsigned long n) {
+    b[0] = (unsigned char) ((n >> 24) & 0xFF);
+    b[1] = (unsigned char) ((n >> 16) & 0xFF);
+    b[2] = (unsigned char) ((n >> 8) & 0xFF);
+    b[3] = (unsigned char) (n & 0xFF);
+}
+
+/* Write PNG chunk `type` with `len` bytes of `data` */
+static void wpng_chunk(struct filemem *fmp, const char type[4], const unsigned char *data, const size_t len) {
+    unsigned char buf[8];
+    unsigned long crc;
+
+    wpng_be_u32(buf, (unsigned long) len);
+    memcpy(buf + 4, type, 4);
+    crc = wpng_crc32(0, buf + 4, 4);
+    (void) fm_write(buf, 1, 8, fmp);
+    if (len) {
+        crc = wpng_crc32(crc, data, len);
+        (void) fm_write(data, 1, len, fmp);
+    }
+    wpng_be_u32(buf, crc);
+    (void) fm_write(buf, 1, 4, fmp);
+}
+
+/* Add compressed `byte`, writing an IDAT chunk if full */
+static void wpng_put_byte(struct wpng_deflate *d, const unsigned char byte) {
+    d->idat[d->idat_len++] = byte;
+    if (d->idat_len == WPNG_IDAT_SIZE) {
+        wpng_chunk(d->fmp, "IDAT", d->idat, WPNG_IDAT_SIZE);
+        d->idat_len = 0;
+    }
+}
+
+/* Add the `cnt` (<= 16) low bits of `bits`, LSB first */
+static void wpng_put_bits(struct wpng_deflate *d, const unsigned int bits, const int cnt) {
+    d->bitbuf |= (unsigned long) bits << d->bitcnt;
+    d->bitcnt += cnt;
+    while (d->bitcnt >= 8) {
+        wpng_put_byte(d, (unsigned char) (d->bitbuf & 0xFF));
+        d->bitbuf >>= 8;
+        d->bitcnt -= 8;
+    }
+}
+
+/* Set code `lengths` of a Huffman code no longer than `max_bits` for the `cnt` symbols with frequencies `freqs`.
+   At least two symbols are given codes (unused ones if necessary) so that the code is always complete */
+static void wpng_huff_lengths(const unsigned int *freqs, const int cnt, const int max_bits, unsigned char *lengths) {
+    unsigned int sym_weights[WPNG_LITLEN_CODES];
+    unsigned int weights[WPNG_LITLEN_CODES * 2]; /* Leaves sorted by weight, followed by internal nodes */
+    short syms[WPNG_LITLEN_CODES];
+    short parents[WPNG_LITLEN_CODES * 2];
+    short depths[WPNG_LITLEN_CODES * 2];
+    int used = 0, max_depth, m;
+    int i, j;
+
+    for (i = 0; i < cnt; i++) {
+        if ((sym_weights[i] = freqs[i])) {
+            used++;
+        }
     }
+    for (i = 0; used < 2; i++) {
+        if (!sym_weights[i]) {
+            sym_weights[i] = 1;
+            used++;
+        }
+    }
+
+    do {
+        int leaf, node, next;
+
+        /* Insertion sort leaves by weight */
+        for (i = 0, m = 0; i < cnt; i++) {
+            if (sym_weights[i]) {
+                for (j = m; j > 0 && weights[j - 1] > sym_weights[i]; j--) {
+                    weights[j] = weights[j - 1];
+                    syms[j] = syms[j - 1];
+                }
+                weights[j] = sym_weights[i];
+                syms[j] = i;
+                m++;
+            }
+        }
+
+        /* Combine the two lightest of leaves and internal nodes, which are created in order of weight so are also
+           sorted */
+        for (leaf = 0, node = next = m; next < 2 * m - 1; next++) {
+            weights[next] = 0;
+            for (j = 0; j < 2; j++) {
+                const int pick = leaf < m && (node == next || weights[leaf] <= weights[node]) ? leaf++ : node++;
+                parents[pick] = next;
+                weights[next] += weights[pick];
+            }
+        }
+
+        /* Parents come after their children so work back from root */
+        depths[2 * m - 2] = 0;
+        for (i = 2 * m - 3; i >= 0; i--) {
+            depths[i] = depths[parents[i]] + 1;
+        }
+        for (i = 0, max_depth = 0; i < m; i++) {
+            if (depths[i] > max_depth) {
+                max_depth = depths[i];
+            }
+        }
+
+        /* If too long, flatten the weights and try again */
+        if (max_depth > max_bits) {
+            for (i = 0; i < cnt; i++) {
+                sym_weights[i] = (sym_weights[i] + 1) >> 1; /* Stays non-zero if non-zero */
+            }
+        }
+    } while (max_depth > max_bits);
+
+    memset(lengths, 0, cnt);
+    for (i = 0; i < m; i++) {
+        lengths[syms[i]] = (unsigned char) depths[i];
+    }
+}
+
+/* Set canonical Huffman `codes` (bit-reversed for LSB first output) from code `lengths` (RFC 1951 3.2.2) */
+static void wpng_huff_codes(const unsigned char *lengths, const int cnt, unsigned short *codes) {
+    unsigned short bl_count[16] = {0};
+    unsigned int next_code[16];
+    unsigned int code = 0;
+    int i, bits;
+
+    for (i = 0; i < cnt; i++) {
+        bl_count[lengths[i]]++;
+    }
+    bl_count[0] = 0;
+    for (bits = 1; bits < 16; bits++) {
+        code = (code + bl_count[bits - 1]) << 1;
+        next_code[bits] = code;
+    }
+    for (i = 0; i < cnt; i++) {
+        if (lengths[i]) {
+            unsigned int c = next_code[lengths[i]]++;
+            unsigned int reversed = 0;
+            for (bits = 0; bits < lengths[i]; bits++, c >>= 1) {
+                reversed = (reversed << 1) | (c & 1);
+            }
+            codes[i] = (unsigned short) reversed;
+        }
+    }
+}
+
+/* Run-length encode the `cnt` code `lengths` using the code length alphabet (16 repeat previous 3-6 times, 17 repeat
+   zero 3-10 times, 18 repeat zero 11-138 times), setting `rle` (symbol | extra bits value << 8) and adding to
+   `cl_freqs`. Returns number of `rle` entries */
+static int wpng_rle_lengths(const unsigned char *lengths, const int cnt, unsigned short *rle,
+            unsigned int cl_freqs[WPNG_CL_CODES]) {
+    int rle_cnt = 0;
+    int i = 0;
+
+    while (i < cnt) {
+        const int len = lengths[i];
+        int run = 1;
+        while (i + run < cnt && lengths[i + run] == len) {
+            run++;
+        }
+        i += run;
+        if (len == 0) {
+            while (run >= 11) {
+                const int r = run < 138 ? run : 138;
+                rle[rle_cnt++] = (unsigned short) (18 | ((r - 11) << 8));
+                cl_freqs[18]++;
+                run -= r;
+            }
+            if (run >= 3) {
+                rle[rle_cnt++] = (unsigned short) (17 | ((run - 3) << 8));
+                cl_freqs[17]++;
+                run = 0;
+            }
+        } else {
+            rle[rle_cnt++] = (unsigned short) len;
+            cl_freqs[len]++;
+            run--;
+            while (run >= 3) {
+                const int r = run < 6 ? run : 6;
+                rle[rle_cnt++] = (unsigned short) (16 | ((r - 3) << 8));
+                cl_freqs[16]++;
+                run -= r;
+            }
+        }
+        while (run--) {
+            rle[rle_cnt++] = (unsigned short) len;
+            cl_freqs[len]++;
+        }
+    }
+    return rle_cnt;
+}
+
+/* Output the pending literals and matches as a deflate block, using dynamic or fixed Huffman codes, whichever is
+   smaller */
+static void wpng_flush_block(struct wpng_deflate *d, const int final) {
+    static const unsigned char cl_order[WPNG_CL_CODES] = {
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+    };
+    static const unsigned char cl_extra[3] = { 2, 3, 7 }; /* Extra bits of code length symbols 16-18 */
+    unsigned int freqs[WPNG_LITLEN_CODES + WPNG_DIST_CODES] = {0}; /* Literal/lengths followed by distances */
+    unsigned int cl_freqs[WPNG_CL_CODES] = {0};
+    unsigned char lengths[WPNG_FIXED_CODES];
+    unsigned char dist_lengths[WPNG_DIST_CODES];
+    unsigned char dyn_lengths[WPNG_LITLEN_CODES + WPNG_DIST_CODES];
+    unsigned char cl_lengths[WPNG_CL_CODES];
+    unsigned short codes[WPNG_FIXED_CODES];
+    unsigned short dist_codes[WPNG_DIST_CODES];
+    unsigned short cl_codes[WPNG_CL_CODES];
+    unsigned short rle[WPNG_LITLEN_CODES + WPNG_DIST_CODES];
+    unsigned int *const dist_freqs = freqs + WPNG_LITLEN_CODES;
+    unsigned long dyn_bits, fixed_bits = 0;
+    int hlit = WPNG_LITLEN_CODES, hdist = WPNG_DIST_CODES, hclen = WPNG_CL_CODES;
+    int rle_cnt = 0, dynamic;
+    int i;
+
+    for (i = 0; i < d->sym_cnt; i++) {
+        if (d->dists[i]) {
+            freqs[257 + wpng_base_index(wpng_len_base, 29, d->litlens[i] - 256)]++;
+            dist_freqs[wpng_base_index(wpng_dist_base, 30, d->dists[i])]++;
+        } else {
+            freqs[d->litlens[i]]++;
+        }
+    }
+    freqs[256] = 1; /* End-of-block */
+
+    /* Fixed codes (RFC 1951 3.2.6) - must be defined over all 288 symbols for the codes to be correct */
+    for (i = 0; i < WPNG_FIXED_CODES; i++) {
+        lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+    }
+    for (i = 0; i < WPNG_LITLEN_CODES; i++) {
+        fixed_bits += freqs[i] * lengths[i];
+    }
+    for (i = 0; i < WPNG_DIST_CODES; i++) {
+        dist_lengths[i] = 5;
+        fixed_bits += dist_freqs[i] * 5;
+    }
+
+    /* Dynamic codes */
+    wpng_huff_lengths(freqs, WPNG_LITLEN_CODES, 15, dyn_lengths);
+    wpng_huff_lengths(dist_freqs, WPNG_DIST_CODES, 15, dyn_lengths + WPNG_LITLEN_CODES);
+    while (hlit > 257 && dyn_lengths[hlit - 1] == 0) {
+        hlit--;
+    }
+    while (hdist > 1 && dyn_lengths[WPNG_LITLEN_CODES + hdist - 1] == 0) {
+        hdist--;
+    }
+    /* Distance lengths follow on directly from literal/length lengths */
+    memmove(dyn_lengths + hlit, dyn_lengths + WPNG_LITLEN_CODES, hdist);
+    rle_cnt = wpng_rle_lengths(dyn_lengths, hlit + hdist, rle, cl_freqs);
+    wpng_huff_lengths(cl_freqs, WPNG_CL_CODES, 7, cl_lengths);
+    while (hclen > 4 && cl_lengths[cl_order[hclen - 1]] == 0) {
+        hclen--;
+    }
+    dyn_bits = 5 + 5 + 4 + 3 * hclen;
+    for (i = 0; i < WPNG_CL_CODES; i++) {
+        dyn_bits += cl_freqs[i] * (cl_lengths[i] + (i >= 16 ? cl_extra[i - 16] : 0));
+    }
+    for (i = 0; i < hlit; i++) {
+        dyn_bits += freqs[i] * dyn_lengths[i];
+    }
+    for (i = 0; i < hdist; i++) {
+        dyn_bits += dist_freqs[i] * dyn_lengths[hlit + i];
+    }
+
+    dynamic = dyn_bits < fixed_bits;
+    wpng_put_bits(d, final, 1);
+    wpng_put_bits(d, dynamic ? 2 : 1, 2);
+    if (dynamic) {
+        memset(lengths, 0, sizeof(lengths));
+        memset(dist_lengths, 0, sizeof(dist_lengths));
+        memcpy(lengths, dyn_lengths, hlit);
+        memcpy(dist_lengths, dyn_lengths + hlit, hdist);
+
+        wpng_huff_codes(cl_lengths, WPNG_CL_CODES, cl_codes);
+        wpng_put_bits(d, hlit - 257, 5);
+        wpng_put_bits(d, hdist - 1, 5);
+        wpng_put_bits(d, hclen - 4, 4);
+        for (i = 0; i < hclen; i++) {
+            wpng_put_bits(d, cl_lengths[cl_order[i]], 3);
+        }
+        for (i = 0; i < rle_cnt; i++) {
+            const int sym = rle[i] & 0xFF;
+            wpng_put_bits(d, cl_codes[sym], cl_lengths[sym]);
+            if (sym >= 16) {
+                wpng_put_bits(d, rle[i] >> 8, cl_extra[sym - 16]);
+            }
+        }
+    }
+    wpng_huff_codes(lengths, WPNG_FIXED_CODES, codes); /* Unused 286 and 287 zero if dynamic */
+    wpng_huff_codes(dist_lengths, WPNG_DIST_CODES, dist_codes);
+
+    for (i = 0; i < d->sym_cnt; i++) {
+        if (d->dists[i]) {
+            const int len = d->litlens[i] - 256;
+            const int len_idx = wpng_base_index(wpng_len_base, 29, len);
+            const int dist_idx = wpng_base_index(wpng_dist_base, 30, d->dists[i]);
+            wpng_put_bits(d, codes[257 + len_idx], lengths[257 + len_idx]);
+            if (wpng_len_extra[len_idx]) {
+                wpng_put_bits(d, len - wpng_len_base[len_idx], wpng_len_extra[len_idx]);
+            }
+            wpng_put_bits(d, dist_codes[dist_idx], dist_lengths[dist_idx]);
+            if (wpng_dist_extra[dist_idx]) {
+                wpng_put_bits(d, d->dists[i] - wpng_dist_base[dist_idx], wpng_dist_extra[dist_idx]);
+            }
+        } else {
+            wpng_put_bits(d, codes[d->litlens[i]], lengths[d->litlens[i]]);
+        }
+    }
+    wpng_put_bits(d, codes[256], lengths[256]);
+
+    d->sym_cnt = 0;
+}
+
+/* Add literal `byte` or match (`dist` non-zero) of `len` bytes, flushing block if full */
+static void wpng_add_sym(struct wpng_deflate *d, const int byte_or_len, const int dist) {
+    d->litlens[d->sym_cnt] = (unsigned short) (dist ? 256 + byte_or_len : byte_or_len);
+    d->dists[d->sym_cnt] = (unsigned short) dist;
+    if (++d->sym_cnt == WPNG_BLOCK_SYMS) {
+        wpng_flush_block(d, 0 /*final*/);
+    }
+}
+
+/* Compress `row_size` bytes of row `cur`, matching against runs of the previous byte and against `prev` row (NULL if
+   none). Matches stop at the end of the row */
+static void wpng_deflate_row(struct wpng_deflate *d, const unsigned char *cur, const unsigned char *prev,
+            const int row_size) {
+    const int use_prev = prev && row_size <= WPNG_MAX_DIST;
+    int i = 0;
+
+    d->adler = wpng_adler32(d->adler, cur, row_size);
+
+    while (i < row_size) {
+        const int max_len = row_size - i < WPNG_MAX_MATCH ? row_size - i : WPNG_MAX_MATCH;
+        int prev_len = 0, run_len = 0;
+
+        if (use_prev) {
+            while (prev_len < max_len && cur[i + prev_len] == prev[i + prev_len]) {
+                prev_len++;
+            }
+        }
+        if (prev_len < max_len && (i || prev)) {
+            const unsigned char byte = i ? cur[i - 1] : prev[row_size - 1];
+            while (run_len < max_len && cur[i + run_len] == byte) {
+                run_len++;
+            }
+        }
+        if (prev_len >= WPNG_MIN_MATCH && prev_len >= run_len) {
+            wpng_add_sym(d, prev_len, row_size);
+            i += prev_len;
+        } else if (run_len >= WPNG_MIN_MATCH) {
+            wpng_add_sym(d, run_len, 1);
+            i += run_len;
+        } else {
+            wpng_add_sym(d, cur[i], 0);
+            i++;
+        }
+    }
+}
+
+/* Write PNG to `fmp` using built-in encoder */
+static int wpng_native_plot(struct zint_symbol *symbol, struct out_raster_rows *rows, struct filemem *const fmp) {
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    unsigned char map[128];
+    struct wpng_colour palette[32];
+    unsigned char trans_alpha[32];
+    int num_palette, num_trans;
+    int bit_depth;
+    size_t row_size;
+    unsigned char buf[32 * 3];
+    struct wpng_deflate *d;
+    unsigned char *row_bufs;
+    unsigned char *prev = NULL;
+    const unsigned char *pb, *prev_pb = NULL;
+    int row, i;
+
+    num_palette = wpng_palette(symbol, map, palette, trans_alpha, &num_trans);
+    bit_depth = wpng_bit_depth(num_palette);
+    row_size = 1 + WPNG_ROW_BYTES(symbol->bitmap_width, bit_depth); /* Including filter type byte */
+
+    if (!(d = (struct wpng_deflate *) z_malloc(sizeof(struct wpng_deflate)))) {
+        return errtxt(ZINT_ERROR_MEMORY, symbol, 668, "Insufficient memory for PNG deflate buffer");
+    }
+    if (!(row_bufs = (unsigned char *) z_malloc(row_size * 2))) {
+        z_free(d);
+        return errtxt(ZINT_ERROR_MEMORY, symbol, 669, "Insufficient memory for PNG row buffer");
+    }
+
+    (void) fm_write(signature, 1, sizeof(signature), fmp);
+
+    wpng_be_u32(buf, symbol->bitmap_width);
+    wpng_be_u32(buf + 4, symbol->bitmap_height);
+    buf[8] = (unsigned char) bit_depth;
+    buf[9] = 3; /* Colour type palette */
+    buf[10] = buf[11] = buf[12] = 0; /* Compression deflate, filter method adaptive, no interlace */
+    wpng_chunk(fmp, "IHDR", buf, 13);
+
+    if (symbol->dpmm) {
+        const unsigned long resolution = (unsigned long) roundf(stripf(symbol->dpmm * 1000.0f)); /* pixels/metre */
+        wpng_be_u32(buf, resolution);
+        wpng_be_u32(buf + 4, resolution);
+        buf[8] = 1; /* Unit metre */
+        wpng_chunk(fmp, "pHYs", buf, 9);
+    }
+
+    for (i = 0; i < num_palette; i++) {
+        buf[i * 3] = palette[i].red;
+        buf[i * 3 + 1] = palette[i].green;
+        buf[i * 3 + 2] = palette[i].blue;
+    }
+    wpng_chunk(fmp, "PLTE", buf, num_palette * 3);
+    if (num_trans) {
+        wpng_chunk(fmp, "tRNS", trans_alpha, num_trans);
+    }
+
+    d->fmp = fmp;
+    d->bitbuf = 0;
+    d->bitcnt = 0;
+    d->adler = 1;
+    d->idat_len = 0;
+    d->sym_cnt = 0;
+
+    /* zlib header: deflate with 32K window, fastest (RFC 1950 2.2) */
+    wpng_put_byte(d, 0x78);
+    wpng_put_byte(d, 0x01);
+
+    for (row = 0; row < symbol->bitmap_height; row++, prev_pb = pb) {
+        unsigned char *cur = row_bufs + (row & 1) * row_size;
+        pb = out_raster_row(rows, row);
+        if (row && memcmp(pb, prev_pb, symbol->bitmap_width) == 0) {
+            memcpy(cur, prev, row_size);
+        } else {
+            cur[0] = 0; /* Filter type None */
+            wpng_pack_row(map, bit_depth, pb, symbol->bitmap_width, cur + 1);
+        }
+        wpng_deflate_row(d, cur, prev, (int) row_size);
+        prev = cur;
+    }
+    wpng_flush_block(d, 1 /*final*/);
+    wpng_put_bits(d, 0, (8 - d->bitcnt) & 7); /* Byte align */
+    for (i = 24; i >= 0; i -= 8) {
+        wpng_put_byte(d, (unsigned char) ((d->adler >> i) & 0xFF));
+    }
+    if (d->idat_len) {
+        wpng_chunk(fmp, "IDAT", d->idat, d->idat_len);
+    }
+    wpng_chunk(fmp, "IEND", NULL, 0);
+
+    z_free(row_bufs);
+    z_free(d);
+
+    return 0;
+}
+
+#ifndef ZINT_NO_PNG
+
+/* Note if change this need to change "backend/tests/test_png.c" definition also */
+struct wpng_error_type {
+    struct zint_symbol *symbol;
+    jmp_buf jmpbuf;
+};
+
+static void wpng_error_handler(png_structp png_ptr, png_const_charp msg) {
+    struct wpng_error_type *wpng_error_ptr;
+
+    wpng_error_ptr = (struct wpng_error_type *) png_get_error_ptr(png_ptr);
+    if (wpng_error_ptr == NULL) {
+        /* we are completely hosed now */
+        fprintf(stderr, "Error 636: libpng error: %s\n", msg ? msg : "<NULL>");
+        fprintf(stderr, "Error 637: jmpbuf not recoverable, terminating\n");
+        fflush(stderr);
+        return; /* libpng will call abort() */
+    }
+    errtxtf(0, wpng_error_ptr->symbol, 635, "libpng error: %s", msg ? msg : "<NULL>");
+    longjmp(wpng_error_ptr->jmpbuf, 1);
+}
+
+#ifdef ZINT_TEST /* Wrapper for direct testing */
+INTERNAL void wpng_error_handler_test(png_structp png_ptr, png_const_charp msg) {
+    wpng_error_handler(png_ptr, msg);
+}
+#endif
+
+/* libpng write callback */
+static void wpng_write(png_structp png_ptr, png_bytep ptr, size_t size) {
+    struct filemem *fmp = (struct filemem *) png_get_io_ptr(png_ptr);
+    (void) fm_write(ptr, 1, size, fmp);
+}
+
+/* libpng flush callback */
+static void wpng_flush(png_structp png_ptr) {
+    struct filemem *fmp = (struct filemem *) png_get_io_ptr(png_ptr);
+    (void) fm_flush(fmp);
+}
+
+#ifdef PNG_USER_MEM_SUPPORTED
+/* libpng allocation callbacks, routing its allocations (including those of zlib) via `ZBarcode_SetAllocator()` */
+static png_voidp wpng_malloc(png_structp png_ptr, png_alloc_size_t size) {
+    (void) png_ptr;
+    return z_malloc(size);
+}
+
+static void wpng_free(png_structp png_ptr, png_voidp ptr) {
+    (void) png_ptr;
+    z_free(ptr);
+}
+#endif
+
+/* zlib allocation callbacks, as above */
+static voidpf wpng_zalloc(voidpf opaque, uInt items, uInt size) {
+    (void) opaque;
+    return z_calloc(items, size);
+}
+
+static void wpng_zfree(voidpf opaque, voidpf ptr) {
+    (void) opaque;
+    z_free(ptr);
+}
+
+/* Guestimate best compression strategy */
+static int wpng_guess_compression_strategy(const struct zint_symbol *symbol) {
+    /* It seems the best choice for typical barcode pngs is one of Z_DEFAULT_STRATEGY and Z_FILTERED */
+
+    /* Some guesses */
+    if (symbol->symbology == BARCODE_MAXICODE) {
+        return Z_DEFAULT_STRATEGY;
+    }
+    if (symbol->symbology == BARCODE_AZTEC && symbol->bitmap_width <= 30) {
+        return Z_DEFAULT_STRATEGY;
+    }
+
+    /* Z_FILTERED seems to work better for slightly more barcodes+data so default to that */
+    return Z_FILTERED;
+}
+
+/* Maximum number of rows deflated by `wpng_sample_compression_strategy()` */
+#define WPNG_SAMPLE_ROWS 64
+
+/* Choose compression strategy for `level` by deflating a sample of evenly spaced rows with each candidate strategy,
+   returning the one giving the smallest output (ties going to the earlier candidate). Falls back to
+   `wpng_guess_compression_strategy()` if memory allocation fails */
+static int wpng_sample_compression_strategy(struct zint_symbol *symbol, struct out_raster_rows *rows,
+            const unsigned char map[128], const int bit_depth, const int level) {
+    static const int strategies[] = { Z_FILTERED, Z_DEFAULT_STRATEGY, Z_RLE };
+    const int sample_cnt = rows->height < WPNG_SAMPLE_ROWS ? rows->height : WPNG_SAMPLE_ROWS;
+    /* Unfiltered PNG rows, i.e. filter type byte 0 followed by packed pixels */
+    const size_t row_size = 1 + WPNG_ROW_BYTES(rows->width, bit_depth);
+    const size_t sample_size = row_size * sample_cnt;
+    unsigned char *sample, *sp;
+    unsigned char buf[4096];
+    int best_strategy = -1;
+    uLong best_size = 0;
+    int i;
+
+    if (!(sample = (unsigned char *) z_malloc(sample_size))) {
+        return wpng_guess_compression_strategy(symbol);
+    }
+    for (i = 0, sp = sample; i < sample_cnt; i++, sp += row_size) {
+        sp[0] = 0; /* Filter type None */
+        wpng_pack_row(map, bit_depth, out_raster_row(rows, (int) (((size_t) rows->height * i) / sample_cnt)),
+                        rows->width, sp + 1);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(strategies); i++) {
+        z_stream strm;
+        int ret;
+
+        memset(&strm, 0, sizeof(strm));
+        strm.zalloc = wpng_zalloc;
+        strm.zfree = wpng_zfree;
+        if (deflateInit2(&strm, level, Z_DEFLATED, 15 /*windowBits*/, 8 /*memLevel*/, strategies[i]) != Z_OK) {
+            continue;
+        }
+        strm.next_in = sample;
+        strm.avail_in = (uInt) sample_size;
+        /* Only the size matters so keep overwriting `buf` */
+        do {
+            strm.next_out = buf;
+            strm.avail_out = (uInt) sizeof(buf);
+            ret = deflate(&strm, Z_FINISH);
+        } while (ret == Z_OK);
+        if (ret == Z_STREAM_END && (best_strategy == -1 || strm.total_out < best_size)) {
+            best_strategy = strategies[i];
+            best_size = strm.total_out;
+        }
+        (void) deflateEnd(&strm);
+    }
+    z_free(sample);
+
+    return best_strategy == -1 ? wpng_guess_compression_strategy(symbol) : best_strategy;
+}
+
+/* Write PNG to `fmp` using libpng */
+static int wpng_libpng_plot(struct zint_symbol *symbol, struct out_raster_rows *rows, struct filemem *const fmp) {
+    struct wpng_error_type wpng_error;
+    png_structp png_ptr;
+    png_infop info_ptr;
+    int i;
+    int row;
+    unsigned char map[128];
+    struct wpng_colour colours[32];
+    png_color palette[32];
+    int num_palette;
+    unsigned char trans_alpha[32];
+    int num_trans;
+    int bit_depth;
+    int compression_level, compression_strategy;
+    const int profile = symbol->png_options & ZINT_PNG_PROFILE_MASK;
+    const int filter = symbol->png_options & ZINT_PNG_FILTER_MASK;
+    const int strategy = symbol->png_options & ZINT_PNG_STRATEGY_MASK;
+    const unsigned char *pb = NULL, *prev_pb = NULL;
+    unsigned char *outdata;
+
+    wpng_error.symbol = symbol;
+
+    num_palette = wpng_palette(symbol, map, colours, trans_alpha, &num_trans);
+    for (i = 0; i < num_palette; i++) {
+        palette[i].red = colours[i].red;
+        palette[i].green = colours[i].green;
+        palette[i].blue = colours[i].blue;
+    }
+    bit_depth = wpng_bit_depth(num_palette);
+    outdata = (unsigned char *) z_alloca(WPNG_ROW_BYTES(symbol->bitmap_width, bit_depth));
 
     /* Set up error handling routine as proc() above */
+#ifdef PNG_USER_MEM_SUPPORTED
+    png_ptr = png_create_write_struct_2(PNG_LIBPNG_VER_STRING, &wpng_error, wpng_error_handler, NULL,
+                NULL /*mem_ptr*/, wpng_malloc, wpng_free);
+#else
     png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, &wpng_error, wpng_error_handler, NULL);
+#endif
     if (!png_ptr) {
-        (void) fm_close(fmp, symbol);
         return errtxt(ZINT_ERROR_MEMORY, symbol, 633, "Insufficient memory for PNG write structure buffer");
     }
 
     info_ptr = png_create_info_struct(png_ptr);
     if (!info_ptr) {
         png_destroy_write_struct(&png_ptr, NULL);
-        (void) fm_close(fmp, symbol);
         return errtxt(ZINT_ERROR_MEMORY, symbol, 634, "Insufficient memory for PNG info structure buffer");
     }
 
     /* catch jumping here */
     if (setjmp(wpng_error.jmpbuf)) {
         png_destroy_write_struct(&png_ptr, &info_ptr);
-        (void) fm_close(fmp, symbol);
         return ZINT_ERROR_MEMORY;
     }
 
@@ -241,14 +907,32 @@ INTERNAL int png_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
     png_set_write_fn(png_ptr, fmp, wpng_write, wpng_flush);
 
     /* set compression */
-    png_set_compression_level(png_ptr, 9);
+    compression_level = profile == ZINT_PNG_FASTEST ? 1 : profile == ZINT_PNG_BALANCED ? 6 : 9;
+    png_set_compression_level(png_ptr, compression_level);
 
     /* Compression strategy can make a difference */
-    compression_strategy = wpng_guess_compression_strategy(symbol, pixelbuf);
+    if (strategy) {
+        static const int strategies[] = { Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE, Z_FIXED };
+        compression_strategy = strategies[(strategy >> 8) - 1];
+    } else if (profile == ZINT_PNG_FASTEST) {
+        /* Not worth sampling, and Z_RLE can't match repeated rows (only the previous byte) */
+        compression_strategy = Z_DEFAULT_STRATEGY;
+    } else if (profile) {
+        compression_strategy = wpng_sample_compression_strategy(symbol, rows, map, bit_depth, compression_level);
+    } else {
+        compression_strategy = wpng_guess_compression_strategy(symbol);
+    }
     if (compression_strategy != Z_DEFAULT_STRATEGY) {
         png_set_compression_strategy(png_ptr, compression_strategy);
     }
 
+    if (filter) {
+        static const int filters[] = {
+            PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP, PNG_FILTER_AVG, PNG_FILTER_PAETH, PNG_ALL_FILTERS
+        };
+        png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, filters[(filter >> 4) - 1]);
+    }
+
     if (symbol->dpmm) {
         int resolution = (int) roundf(stripf(symbol->dpmm * 1000.0f)); /* pixels per metre */
         png_set_pHYs(png_ptr, info_ptr, resolution, resolution, PNG_RESOLUTION_METER);
@@ -268,41 +952,13 @@ INTERNAL int png_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
     png_write_info(png_ptr, info_ptr);
 
     /* Pixel Plotting */
-    pb = pixelbuf;
-    if (bit_depth == 1) {
-        for (row = 0; row < symbol->bitmap_height; row++) {
-            if (row && memcmp(pb, pb - symbol->bitmap_width, symbol->bitmap_width) == 0) {
-                pb += symbol->bitmap_width;
-            } else {
-                unsigned char *image_data = outdata;
-                for (column = 0; column < symbol->bitmap_width; column += 8, image_data++) {
-                    unsigned char byte = 0;
-                    for (i = 0; i < 8 && column + i < symbol->bitmap_width; i++, pb++) {
-                        byte |= map[*pb] << (7 - i);
-                    }
-                    *image_data = byte;
-                }
-            }
-            /* write row contents to file */
-            png_write_row(png_ptr, outdata);
-        }
-    } else { /* Bit depth 4 */
-        for (row = 0; row < symbol->bitmap_height; row++) {
-            if (row && memcmp(pb, pb - symbol->bitmap_width, symbol->bitmap_width) == 0) {
-                pb += symbol->bitmap_width;
-            } else {
-                unsigned char *image_data = outdata;
-                for (column = 0; column < symbol->bitmap_width; column += 2, image_data++) {
-                    unsigned char byte = map[*pb++] << 4;
-                    if (column + 1 < symbol->bitmap_width) {
-                        byte |= map[*pb++];
-                    }
-                    *image_data = byte;
-                }
-            }
-            /* write row contents to file */
-            png_write_row(png_ptr, outdata);
+    for (row = 0; row < symbol->bitmap_height; row++, prev_pb = pb) {
+        pb = out_raster_row(rows, row);
+        if (!row || memcmp(pb, prev_pb, symbol->bitmap_width) != 0) {
+            wpng_pack_row(map, bit_depth, pb, symbol->bitmap_width, outdata);
         }
+        /* write row contents to file */
+        png_write_row(png_ptr, outdata);
     }
 
     /* End the file */
@@ -311,6 +967,43 @@ INTERNAL int png_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
     /* make sure we have disengaged */
     png_destroy_write_struct(&png_ptr, &info_ptr);
 
+    return 0;
+}
+#endif /* ZINT_NO_PNG */
+
+INTERNAL int png_pixel_plot(struct zint_symbol *symbol, struct out_raster_rows *rows) {
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
+    int error_number;
+
+    if ((symbol->png_options & ZINT_PNG_PROFILE_MASK) > ZINT_PNG_FASTEST
+            || (symbol->png_options & ZINT_PNG_FILTER_MASK) > ZINT_PNG_FILTER_ALL
+            || (symbol->png_options & ZINT_PNG_STRATEGY_MASK) > ZINT_PNG_STRATEGY_FIXED
+            || (symbol->png_options & ~(ZINT_PNG_PROFILE_MASK | ZINT_PNG_FILTER_MASK | ZINT_PNG_STRATEGY_MASK
+                                        | ZINT_PNG_NATIVE))) {
+        return errtxtf(ZINT_ERROR_INVALID_OPTION, symbol, 639, "Invalid PNG options '%d'", symbol->png_options);
+    }
+
+    /* Open output file in binary mode */
+    if (!fm_open(fmp, symbol, "wb")) {
+        return ZEXT errtxtf(ZINT_ERROR_FILE_ACCESS, symbol, 632, "Could not open PNG output file (%1$d: %2$s)",
+                            fmp->err, strerror(fmp->err));
+    }
+
+#ifdef ZINT_NO_PNG
+    error_number = wpng_native_plot(symbol, rows, fmp);
+#else
+    if (symbol->png_options & ZINT_PNG_NATIVE) {
+        error_number = wpng_native_plot(symbol, rows, fmp);
+    } else {
+        error_number = wpng_libpng_plot(symbol, rows, fmp);
+    }
+#endif
+    if (error_number) {
+        (void) fm_close(fmp, symbol);
+        return error_number;
+    }
+
     if (fm_error(fmp)) {
         ZEXT errtxtf(0, symbol, 638, "Incomplete write of PNG output (%1$d: %2$s)", fmp->err, strerror(fmp->err));
         (void) fm_close(fmp, symbol);
@@ -324,10 +1017,5 @@ INTERNAL int png_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
 
     return 0;
 }
+
 /* vim: set ts=4 sw=4 et : */
-#else
-#if defined(__clang__)
-/* Suppresses clang-tidy-18 "clang-diagnostic-empty-translation-unit" */
-typedef int wpng_make_clang_tidy_compilers_happy;
-#endif
-#endif /* ZINT_NO_PNG */
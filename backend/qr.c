@@ -1633,89 +1633,22 @@ static int qr_prep_data(struct zint_symbol *symbol, struct zint_seg segs[], cons
     return warn_number;
 }
 
-INTERNAL int qrcode(struct zint_symbol *symbol, struct zint_seg segs[], const int seg_count) {
-    int warn_number;
-    int i, j, est_binlen, prev_est_binlen;
-    int ecc_level, autosize, version, max_cw, target_codewords, blocks, size;
-    int bitmask;
-    int user_mask;
+/* Work out the optimal encodation `mode` and the version and ECC level, placing them in `p_version`,
+   `p_ecc_level` and `p_est_binlen` (the number of data bits), and set `symbol->estimate`. Returns 0 on success, else
+   ZINT_ERROR_TOO_LONG. Kept separate so that `qrcode()` can return on ZINT_DEBUG_ESTIMATE before any of the symbol
+   buffers are allocated */
+static int qr_select_version(struct zint_symbol *symbol, char mode[], char prev_mode[], const unsigned int ddata[],
+            const struct zint_seg local_segs[], const int seg_count, const struct zint_structapp *p_structapp,
+            const int gs1, const int eci_length_segs, const int debug_print, int *p_version, int *p_ecc_level,
+            int *p_est_binlen) {
+    int i, est_binlen, prev_est_binlen;
+    int ecc_level, autosize, version, max_cw;
     int canShrink;
-    int size_squared;
-    const struct zint_structapp *p_structapp = NULL;
-    const int gs1 = ((symbol->input_mode & 0x07) == GS1_MODE);
-    const int fast_encode = symbol->input_mode & FAST_MODE;
-    const int debug_print = symbol->debug & ZINT_DEBUG_PRINT;
-    const int eci_length_segs = get_eci_length_segs(segs, seg_count);
-    struct zint_seg *local_segs = (struct zint_seg *) z_alloca(sizeof(struct zint_seg) * seg_count);
-    unsigned int *ddata = (unsigned int *) z_alloca(sizeof(unsigned int) * eci_length_segs);
-    char *mode = (char *) z_alloca(eci_length_segs);
-    char *prev_mode = (char *) z_alloca(eci_length_segs);
-    unsigned char *datastream;
-    unsigned char *fullstream;
-    unsigned char *grid;
-
-    user_mask = (symbol->option_3 >> 8) & 0x0F; /* User mask is pattern + 1, so >= 1 and <= 8 */
-    if (user_mask > 8) {
-        user_mask = 0; /* Ignore */
-    }
-
-    segs_cpy(symbol, segs, seg_count, local_segs); /* Shallow copy (needed to set default ECIs & protect lengths) */
-
-    warn_number = qr_prep_data(symbol, local_segs, seg_count, ddata);
-    if (warn_number >= ZINT_ERROR) {
-        return warn_number;
-    }
-
-    if (symbol->structapp.count) {
-        if (symbol->structapp.count < 2 || symbol->structapp.count > 16) {
-            return errtxtf(ZINT_ERROR_INVALID_OPTION, symbol, 750,
-                            "Structured Append count '%d' out of range (2 to 16)", symbol->structapp.count);
-        }
-        if (symbol->structapp.index < 1 || symbol->structapp.index > symbol->structapp.count) {
-            return ZEXT errtxtf(ZINT_ERROR_INVALID_OPTION, symbol, 751,
-                                "Structured Append index '%1$d' out of range (1 to count %2$d)",
-                                symbol->structapp.index, symbol->structapp.count);
-        }
-        if (symbol->structapp.id[0]) {
-            int id, id_len;
-
-            for (id_len = 1; id_len < 4 && symbol->structapp.id[id_len]; id_len++);
-
-            if (id_len > 3) { /* Max value 255 */
-                return errtxtf(ZINT_ERROR_INVALID_OPTION, symbol, 752,
-                                "Structured Append ID length %d too long (3 digit maximum)", id_len);
-            }
-
-            id = to_int((const unsigned char *) symbol->structapp.id, id_len);
-            if (id == -1) {
-                return errtxt(ZINT_ERROR_INVALID_OPTION, symbol, 753, "Invalid Structured Append ID (digits only)");
-            }
-            if (id > 255) {
-                return errtxtf(ZINT_ERROR_INVALID_OPTION, symbol, 754,
-                                "Structured Append ID value '%d' out of range (0 to 255)", id);
-            }
-        }
-        p_structapp = &symbol->structapp;
-    }
-
-    /* GS1 General Specifications 22.0 section 5.7.3 says Structured Append and ECIs not supported
-       for GS1 QR Code so check and return ZINT_WARN_NONCOMPLIANT if either true */
-    if (gs1 && warn_number == 0) {
-        for (i = 0; i < seg_count; i++) {
-            if (local_segs[i].eci) {
-                warn_number = errtxt(ZINT_WARN_NONCOMPLIANT, symbol, 755,
-                                        "Using ECI in GS1 mode not supported by GS1 standards");
-                break;
-            }
-        }
-        if (warn_number == 0 && p_structapp) {
-            warn_number = errtxt(ZINT_WARN_NONCOMPLIANT, symbol, 756,
-                                    "Using Structured Append in GS1 mode not supported by GS1 standards");
-        }
-    }
 
+    STATS_BEGIN(symbol, ZINT_STATS_MODES);
     est_binlen = qr_calc_binlen_segs(40, mode, ddata, local_segs, seg_count, p_structapp, 0 /*mode_preset*/, gs1,
                     debug_print);
+    STATS_END(symbol, ZINT_STATS_MODES);
 
     if ((symbol->option_1 >= 1) && (symbol->option_1 <= 4)) {
         ecc_level = symbol->option_1 - 1;
@@ -1815,6 +1748,106 @@ INTERNAL int qrcode(struct zint_symbol *symbol, struct zint_seg segs[], const in
         }
     }
 
+
+    (void) estimate_set(symbol, version, qr_sizes[version - 1], qr_sizes[version - 1],
+                        qr_data_codewords[ecc_level][version - 1], qr_total_codewords[version - 1]);
+
+    *p_version = version;
+    *p_ecc_level = ecc_level;
+    *p_est_binlen = est_binlen;
+
+    return 0;
+}
+
+INTERNAL int qrcode(struct zint_symbol *symbol, struct zint_seg segs[], const int seg_count) {
+    int warn_number, error_number;
+    int i, j;
+    int est_binlen = 0, ecc_level = 0, version = 0; /* Set by `qr_select_version()` (initialized to avoid warnings) */
+    int target_codewords, blocks, size;
+    int bitmask;
+    int user_mask;
+    int size_squared;
+    const struct zint_structapp *p_structapp = NULL;
+    const int gs1 = ((symbol->input_mode & 0x07) == GS1_MODE);
+    const int fast_encode = symbol->input_mode & FAST_MODE;
+    const int debug_print = symbol->debug & ZINT_DEBUG_PRINT;
+    const int eci_length_segs = get_eci_length_segs(segs, seg_count);
+    struct zint_seg *local_segs = (struct zint_seg *) z_alloca(sizeof(struct zint_seg) * seg_count);
+    unsigned int *ddata = (unsigned int *) z_alloca(sizeof(unsigned int) * eci_length_segs);
+    char *mode = (char *) z_alloca(eci_length_segs);
+    char *prev_mode = (char *) z_alloca(eci_length_segs);
+    unsigned char *datastream;
+    unsigned char *fullstream;
+    unsigned char *grid;
+
+    user_mask = (symbol->option_3 >> 8) & 0x0F; /* User mask is pattern + 1, so >= 1 and <= 8 */
+    if (user_mask > 8) {
+        user_mask = 0; /* Ignore */
+    }
+
+    segs_cpy(symbol, segs, seg_count, local_segs); /* Shallow copy (needed to set default ECIs & protect lengths) */
+
+    STATS_BEGIN(symbol, ZINT_STATS_ECI);
+    warn_number = qr_prep_data(symbol, local_segs, seg_count, ddata);
+    STATS_END(symbol, ZINT_STATS_ECI);
+    if (warn_number >= ZINT_ERROR) {
+        return warn_number;
+    }
+
+    if (symbol->structapp.count) {
+        if (symbol->structapp.count < 2 || symbol->structapp.count > 16) {
+            return errtxtf(ZINT_ERROR_INVALID_OPTION, symbol, 750,
+                            "Structured Append count '%d' out of range (2 to 16)", symbol->structapp.count);
+        }
+        if (symbol->structapp.index < 1 || symbol->structapp.index > symbol->structapp.count) {
+            return ZEXT errtxtf(ZINT_ERROR_INVALID_OPTION, symbol, 751,
+                                "Structured Append index '%1$d' out of range (1 to count %2$d)",
+                                symbol->structapp.index, symbol->structapp.count);
+        }
+        if (symbol->structapp.id[0]) {
+            int id, id_len;
+
+            for (id_len = 1; id_len < 4 && symbol->structapp.id[id_len]; id_len++);
+
+            if (id_len > 3) { /* Max value 255 */
+                return errtxtf(ZINT_ERROR_INVALID_OPTION, symbol, 752,
+                                "Structured Append ID length %d too long (3 digit maximum)", id_len);
+            }
+
+            id = to_int((const unsigned char *) symbol->structapp.id, id_len);
+            if (id == -1) {
+                return errtxt(ZINT_ERROR_INVALID_OPTION, symbol, 753, "Invalid Structured Append ID (digits only)");
+            }
+            if (id > 255) {
+                return errtxtf(ZINT_ERROR_INVALID_OPTION, symbol, 754,
+                                "Structured Append ID value '%d' out of range (0 to 255)", id);
+            }
+        }
+        p_structapp = &symbol->structapp;
+    }
+
+    /* GS1 General Specifications 22.0 section 5.7.3 says Structured Append and ECIs not supported
+       for GS1 QR Code so check and return ZINT_WARN_NONCOMPLIANT if either true */
+    if (gs1 && warn_number == 0) {
+        for (i = 0; i < seg_count; i++) {
+            if (local_segs[i].eci) {
+                warn_number = errtxt(ZINT_WARN_NONCOMPLIANT, symbol, 755,
+                                        "Using ECI in GS1 mode not supported by GS1 standards");
+                break;
+            }
+        }
+        if (warn_number == 0 && p_structapp) {
+            warn_number = errtxt(ZINT_WARN_NONCOMPLIANT, symbol, 756,
+                                    "Using Structured Append in GS1 mode not supported by GS1 standards");
+        }
+    }
+
+    error_number = qr_select_version(symbol, mode, prev_mode, ddata, local_segs, seg_count, p_structapp, gs1,
+                    eci_length_segs, debug_print, &version, &ecc_level, &est_binlen);
+    if (error_number) {
+        return error_number;
+    }
+
     target_codewords = qr_data_codewords[ecc_level][version - 1];
     blocks = qr_blocks[ecc_level][version - 1];
 
@@ -1826,6 +1859,13 @@ INTERNAL int qrcode(struct zint_symbol *symbol, struct zint_seg segs[], const in
         printf("Number of ECC blocks: %d\n", blocks);
     }
 
+    if (symbol->debug & ZINT_DEBUG_ESTIMATE) {
+        /* Feedback options (apart from mask) */
+        symbol->option_1 = ecc_level + 1;
+        symbol->option_2 = version;
+        return warn_number;
+    }
+
     datastream = (unsigned char *) z_alloca(target_codewords + 1);
     fullstream = (unsigned char *) z_alloca(qr_total_codewords[version - 1] + 1);
 
@@ -1834,7 +1874,9 @@ INTERNAL int qrcode(struct zint_symbol *symbol, struct zint_seg segs[], const in
 #ifdef ZINT_TEST
     if (symbol->debug & ZINT_DEBUG_TEST) debug_test_codeword_dump(symbol, datastream, target_codewords);
 #endif
+    STATS_BEGIN(symbol, ZINT_STATS_RS);
     qr_add_ecc(fullstream, datastream, version, target_codewords, blocks, debug_print);
+    STATS_END(symbol, ZINT_STATS_RS);
 
     size = qr_sizes[version - 1];
     size_squared = size * size;
@@ -1849,7 +1891,9 @@ INTERNAL int qrcode(struct zint_symbol *symbol, struct zint_seg segs[], const in
         qr_add_version_info(grid, size, version);
     }
 
+    STATS_BEGIN(symbol, ZINT_STATS_MASK);
     bitmask = qr_apply_bitmask(grid, size, ecc_level, user_mask, fast_encode, debug_print);
+    STATS_END(symbol, ZINT_STATS_MASK);
 
     /* Feedback options */
     symbol->option_1 = ecc_level + 1;
@@ -39,6 +39,11 @@
 #endif /* _MSC_VER */
 
 #include "common.h"
+#ifdef ZINT_USE_PTHREADS /* May be set by "common.h" */
+#include <pthread.h>
+#elif defined(_WIN32) && !defined(ZINT_NO_THREADS)
+#include <windows.h>
+#endif
 #include "output.h"
 #include "zfiletypes.h"
 
@@ -52,14 +57,13 @@
 #define ZFONT_HALIGN_LEFT   1
 #define ZFONT_HALIGN_RIGHT  2
 #define ZFONT_UPCEAN_TEXT   4   /* Helper flag to indicate dealing with EAN/UPC */
+#define ZFONT_NO_CACHE      8   /* Don't use glyph cache (test use only) */
 
-#ifndef ZINT_NO_PNG
-INTERNAL int png_pixel_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf);
-#endif /* ZINT_NO_PNG */
-INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf);
-INTERNAL int pcx_pixel_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf);
+INTERNAL int png_pixel_plot(struct zint_symbol *symbol, struct out_raster_rows *rows);
+INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, struct out_raster_rows *rows);
+INTERNAL int pcx_pixel_plot(struct zint_symbol *symbol, struct out_raster_rows *rows);
 INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf);
-INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf);
+INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, struct out_raster_rows *rows);
 
 static const char ultra_colour[] = "0CBMRYGKW";
 
@@ -71,7 +75,92 @@ static void *raster_malloc(size_t size, size_t prev_size) {
     if (size + prev_size < size /*Overflow check*/ || size + prev_size > 0x40000000 /*1GB*/) {
         return NULL;
     }
-    return malloc(size);
+    return z_malloc(size);
+}
+
+/* Make `*p_buf` at least `size` bytes, re-using it if BARCODE_RETAIN_BUFFERS and its `*p_capacity` big enough, else
+   freeing it (if any) and allocating anew. Returns 1 on success, 0 on failure */
+static int raster_buffer(const struct zint_symbol *symbol, unsigned char **p_buf, int *p_capacity, const size_t size,
+            const size_t prev_size) {
+    if (*p_buf) {
+        if ((symbol->output_options & BARCODE_RETAIN_BUFFERS) && (size_t) *p_capacity >= size) {
+            return 1;
+        }
+        z_free(*p_buf);
+        *p_buf = NULL;
+    }
+    *p_capacity = 0;
+    if (!(*p_buf = (unsigned char *) raster_malloc(size, prev_size))) {
+        return 0;
+    }
+    *p_capacity = (int) size; /* `raster_malloc()` limits to 1GB */
+    return 1;
+}
+
+/* Minimum number of pixels per band when rendering with `symbol->raster_threads` */
+#define RASTER_BAND_MIN_PIXELS  0x40000
+
+/* Return number of bands (done concurrently) to split image of `height` rows (or symbol rows) and `size` pixels
+   into, as allowed by `symbol->raster_threads` */
+static int raster_band_count(const struct zint_symbol *symbol, const int height, const size_t size) {
+    const size_t max_bands = size / RASTER_BAND_MIN_PIXELS;
+
+    if (symbol->raster_threads == 0 || symbol->raster_threads == 1 || max_bands < 2) {
+        return 1;
+    }
+    return out_thread_count(symbol->raster_threads < 0 ? 0 : symbol->raster_threads,
+                            max_bands < (size_t) height ? (int) max_bands : height);
+}
+
+/* Arguments for the `buffer_plot_XXX_band()` functions */
+struct buffer_band {
+    struct zint_symbol *symbol;
+    const unsigned char *pixelbuf;
+    const void *palette;        /* Per-pixel-value colours */
+    const unsigned char *alpha; /* Background and foreground alpha if alphamap wanted, else NULL */
+};
+
+/* Convert rows `start` to `end` - 1 of `buffer_plot()` */
+static void buffer_plot_band(void *arg, const int start, const int end) {
+    const struct buffer_band *band = (const struct buffer_band *) arg;
+    struct zint_symbol *symbol = band->symbol;
+    const unsigned char *const pixelbuf = band->pixelbuf;
+    const unsigned char (*map)[3] = (const unsigned char (*)[3]) band->palette;
+    const unsigned char *const alpha = band->alpha;
+    const size_t bm_bitmap_width = (size_t) symbol->bitmap_width * 3;
+    int row;
+
+    if (alpha) {
+        for (row = start; row < end; row++) {
+            size_t p = (size_t) symbol->bitmap_width * row;
+            const unsigned char *pb = pixelbuf + p;
+            unsigned char *bitmap = symbol->bitmap + p * 3;
+            if (row > start && memcmp(pb, pb - symbol->bitmap_width, symbol->bitmap_width) == 0) {
+                memcpy(bitmap, bitmap - bm_bitmap_width, bm_bitmap_width);
+                memcpy(symbol->alphamap + p, symbol->alphamap + p - symbol->bitmap_width, symbol->bitmap_width);
+            } else {
+                const size_t pe = p + symbol->bitmap_width;
+                for (; p < pe; p++, bitmap += 3) {
+                    memcpy(bitmap, map[pixelbuf[p]], 3);
+                    symbol->alphamap[p] = alpha[pixelbuf[p] == DEFAULT_PAPER];
+                }
+            }
+        }
+    } else {
+        for (row = start; row < end; row++) {
+            const size_t r = (size_t) symbol->bitmap_width * row;
+            const unsigned char *pb = pixelbuf + r;
+            unsigned char *bitmap = symbol->bitmap + r * 3;
+            if (row > start && memcmp(pb, pb - symbol->bitmap_width, symbol->bitmap_width) == 0) {
+                memcpy(bitmap, bitmap - bm_bitmap_width, bm_bitmap_width);
+            } else {
+                const unsigned char *const pbe = pb + symbol->bitmap_width;
+                for (; pb < pbe; pb++, bitmap += 3) {
+                    memcpy(bitmap, map[*pb], 3);
+                }
+            }
+        }
+    }
 }
 
 static int buffer_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf) {
@@ -88,10 +177,9 @@ static int buffer_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf
         {0}, {0}, {0}, { 0xff, 0, 0 } /*Red*/, {0}, {0}, {0}, {0}, /* O-V */
         { 0xff, 0xff, 0xff } /*White*/, {0}, { 0xff, 0xff, 0 } /*Yellow*/, {0} /* W-Z */
     };
-    int row;
     int plot_alpha = 0;
-    const size_t bm_bitmap_width = (size_t) symbol->bitmap_width * 3;
-    const size_t bm_bitmap_size = bm_bitmap_width * symbol->bitmap_height;
+    const size_t bm_bitmap_size = (size_t) symbol->bitmap_width * 3 * symbol->bitmap_height;
+    struct buffer_band band;
 
     if (out_colour_get_rgb(symbol->fgcolour, &map[DEFAULT_INK][0], &map[DEFAULT_INK][1], &map[DEFAULT_INK][2],
             &alpha[0])) {
@@ -102,17 +190,15 @@ static int buffer_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf
         plot_alpha = 1;
     }
 
-    /* Free any previous bitmap */
-    if (symbol->bitmap != NULL) {
-        free(symbol->bitmap);
-        symbol->bitmap = NULL;
-    }
-    if (symbol->alphamap != NULL) {
-        free(symbol->alphamap);
+    /* Free any previous alphamap if not needed (NULL indicates no alpha) */
+    if (!plot_alpha && symbol->alphamap != NULL) {
+        z_free(symbol->alphamap);
         symbol->alphamap = NULL;
+        symbol->alphamap_capacity = 0;
     }
 
-    if (!(symbol->bitmap = (unsigned char *) raster_malloc(bm_bitmap_size, 0 /*prev_size*/))) {
+    /* Re-use any previous bitmap if retaining and big enough */
+    if (!raster_buffer(symbol, &symbol->bitmap, &symbol->bitmap_capacity, bm_bitmap_size, 0 /*prev_size*/)) {
         return errtxt(ZINT_ERROR_MEMORY, symbol, 661, "Insufficient memory for bitmap buffer");
     }
 #ifdef ZINT_SANITIZEM /* Suppress clang -fsanitize=memory false positive */
@@ -121,158 +207,370 @@ static int buffer_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf
 
     if (plot_alpha) {
         const size_t alpha_size = (size_t) symbol->bitmap_width * symbol->bitmap_height;
-        if (!(symbol->alphamap = (unsigned char *) raster_malloc(alpha_size, bm_bitmap_size))) {
+        if (!raster_buffer(symbol, &symbol->alphamap, &symbol->alphamap_capacity, alpha_size, bm_bitmap_size)) {
             return errtxt(ZINT_ERROR_MEMORY, symbol, 662, "Insufficient memory for alphamap buffer");
         }
-        for (row = 0; row < symbol->bitmap_height; row++) {
-            size_t p = (size_t) symbol->bitmap_width * row;
-            const unsigned char *pb = pixelbuf + p;
-            unsigned char *bitmap = symbol->bitmap + p * 3;
-            if (row && memcmp(pb, pb - symbol->bitmap_width, symbol->bitmap_width) == 0) {
-                memcpy(bitmap, bitmap - bm_bitmap_width, bm_bitmap_width);
-                memcpy(symbol->alphamap + p, symbol->alphamap + p - symbol->bitmap_width, symbol->bitmap_width);
-            } else {
-                const size_t pe = p + symbol->bitmap_width;
-                for (; p < pe; p++, bitmap += 3) {
-                    memcpy(bitmap, map[pixelbuf[p]], 3);
-                    symbol->alphamap[p] = alpha[pixelbuf[p] == DEFAULT_PAPER];
-                }
+    }
+
+    band.symbol = symbol;
+    band.pixelbuf = pixelbuf;
+    band.palette = map;
+    band.alpha = plot_alpha ? alpha : NULL;
+    out_run_bands(buffer_plot_band, &band, symbol->bitmap_height, raster_band_count(symbol, symbol->bitmap_height,
+                    (size_t) symbol->bitmap_width * symbol->bitmap_height));
+
+    return 0;
+}
+
+/* Convert rows `start` to `end` - 1 of `buffer_plot_rgba()` */
+static void buffer_plot_rgba_band(void *arg, const int start, const int end) {
+    const struct buffer_band *band = (const struct buffer_band *) arg;
+    struct zint_symbol *symbol = band->symbol;
+    const unsigned char (*palette)[4] = (const unsigned char (*)[4]) band->palette;
+    const size_t bm_bitmap_width = (size_t) symbol->bitmap_width * 4;
+    int row;
+
+    for (row = start; row < end; row++) {
+        const size_t r = (size_t) symbol->bitmap_width * row;
+        const unsigned char *pb = band->pixelbuf + r;
+        unsigned char *bitmap = symbol->bitmap + r * 4;
+        if (row > start && memcmp(pb, pb - symbol->bitmap_width, symbol->bitmap_width) == 0) {
+            memcpy(bitmap, bitmap - bm_bitmap_width, bm_bitmap_width);
+        } else {
+            const unsigned char *const pbe = pb + symbol->bitmap_width;
+            for (; pb < pbe; pb++, bitmap += 4) {
+                memcpy(bitmap, palette[*pb], 4);
             }
         }
-    } else {
-        for (row = 0; row < symbol->bitmap_height; row++) {
-            const size_t r = (size_t) symbol->bitmap_width * row;
-            const unsigned char *pb = pixelbuf + r;
-            unsigned char *bitmap = symbol->bitmap + r * 3;
-            if (row && memcmp(pb, pb - symbol->bitmap_width, symbol->bitmap_width) == 0) {
-                memcpy(bitmap, bitmap - bm_bitmap_width, bm_bitmap_width);
-            } else {
-                const unsigned char *const pbe = pb + symbol->bitmap_width;
-                for (; pb < pbe; pb++, bitmap += 3) {
-                    memcpy(bitmap, map[*pb], 3);
-                }
+    }
+}
+
+/* Place pixelbuffer into symbol as interleaved RGBA (OUT_BUFFER_RGBA), premultiplied if OUT_BUFFER_PREMULTIPLIED */
+static int buffer_plot_rgba(struct zint_symbol *symbol, const unsigned char *pixelbuf) {
+    /* RGBA palette indexed by pixelbuf values ('0', '1' and Ultracode colour chars), expanded by 4-byte copies */
+    unsigned char palette[91][4];
+    unsigned char fg_alpha = 0xFF, bg_alpha = 0xFF;
+    const size_t bm_bitmap_width = (size_t) symbol->bitmap_width * 4;
+    struct buffer_band band;
+    int i;
+
+    memset(palette, 0, sizeof(palette));
+    (void) out_colour_get_rgb(symbol->fgcolour, &palette[DEFAULT_INK][0], &palette[DEFAULT_INK][1],
+                                &palette[DEFAULT_INK][2], &fg_alpha);
+    (void) out_colour_get_rgb(symbol->bgcolour, &palette[DEFAULT_PAPER][0], &palette[DEFAULT_PAPER][1],
+                                &palette[DEFAULT_PAPER][2], &bg_alpha);
+    for (i = 1; i < 9; i++) { /* Ultracode colours */
+        const unsigned char ch = (unsigned char) ultra_colour[i];
+        (void) out_colour_char_to_rgb(ch, &palette[ch][0], &palette[ch][1], &palette[ch][2]);
+    }
+    /* As with `alphamap`, everything but paper takes the foreground alpha */
+    for (i = 0; i < 91; i++) {
+        palette[i][3] = i == DEFAULT_PAPER ? bg_alpha : fg_alpha;
+        if ((symbol->output_options & OUT_BUFFER_PREMULTIPLIED) && palette[i][3] != 0xFF) {
+            int j;
+            for (j = 0; j < 3; j++) {
+                palette[i][j] = (unsigned char) ((palette[i][j] * palette[i][3] + 0x7F) / 0xFF);
             }
         }
     }
 
+    /* No separate alpha */
+    if (symbol->alphamap != NULL) {
+        z_free(symbol->alphamap);
+        symbol->alphamap = NULL;
+        symbol->alphamap_capacity = 0;
+    }
+
+    if (!raster_buffer(symbol, &symbol->bitmap, &symbol->bitmap_capacity, bm_bitmap_width * symbol->bitmap_height,
+            0 /*prev_size*/)) {
+        return errtxt(ZINT_ERROR_MEMORY, symbol, 661, "Insufficient memory for bitmap buffer");
+    }
+
+    band.symbol = symbol;
+    band.pixelbuf = pixelbuf;
+    band.palette = palette;
+    band.alpha = NULL;
+    out_run_bands(buffer_plot_rgba_band, &band, symbol->bitmap_height, raster_band_count(symbol,
+                    symbol->bitmap_height, (size_t) symbol->bitmap_width * symbol->bitmap_height));
+
     return 0;
 }
 
-static int save_raster_image_to_file(struct zint_symbol *symbol, const int image_height, const int image_width,
-            unsigned char *pixelbuf, int rotate_angle, const int file_type) {
-    int error_number;
-    int row, column;
+/* Convert rows `start` to `end` - 1 of `buffer_plot_1bpp()` */
+static void buffer_plot_1bpp_band(void *arg, const int start, const int end) {
+    const struct buffer_band *band = (const struct buffer_band *) arg;
+    struct zint_symbol *symbol = band->symbol;
+    const int width = symbol->bitmap_width;
+    const int stride = symbol->bitmap_stride ? symbol->bitmap_stride : (width + 7) / 8;
+    const int last_bits = width & 7;
+    int row;
+
+    for (row = start; row < end; row++) {
+        const unsigned char *pb = band->pixelbuf + (size_t) width * row;
+        unsigned char *bitmap = symbol->bitmap + (size_t) stride * row;
+        if (row > start && memcmp(pb, pb - width, width) == 0) {
+            memcpy(bitmap, bitmap - stride, stride);
+        } else {
+            const unsigned char *const pbe = pb + (width - last_bits);
+            unsigned char *const bitmap_end = bitmap + stride;
+            for (; pb < pbe; pb += 8) {
+                *bitmap++ = (unsigned char) (((pb[0] != DEFAULT_PAPER && pb[0] != 'W') << 7)
+                                | ((pb[1] != DEFAULT_PAPER && pb[1] != 'W') << 6)
+                                | ((pb[2] != DEFAULT_PAPER && pb[2] != 'W') << 5)
+                                | ((pb[3] != DEFAULT_PAPER && pb[3] != 'W') << 4)
+                                | ((pb[4] != DEFAULT_PAPER && pb[4] != 'W') << 3)
+                                | ((pb[5] != DEFAULT_PAPER && pb[5] != 'W') << 2)
+                                | ((pb[6] != DEFAULT_PAPER && pb[6] != 'W') << 1)
+                                | (pb[7] != DEFAULT_PAPER && pb[7] != 'W'));
+            }
+            if (last_bits) {
+                unsigned char byte = 0;
+                int i;
+                for (i = 0; i < last_bits; i++) {
+                    byte = (unsigned char) (byte | ((pb[i] != DEFAULT_PAPER && pb[i] != 'W') << (7 - i)));
+                }
+                *bitmap++ = byte;
+            }
+            if (bitmap < bitmap_end) {
+                memset(bitmap, 0, bitmap_end - bitmap);
+            }
+        }
+    }
+}
 
-    unsigned char *rotated_pixbuf = pixelbuf;
+/* Place pixelbuffer into symbol packed 1 bit per pixel (OUT_BUFFER_1BPP), MSB first, with ink (anything other than
+   paper or Ultracode white) 1, and rows padded with zero bits to `symbol->bitmap_stride` bytes (if set) */
+static int buffer_plot_1bpp(struct zint_symbol *symbol, const unsigned char *pixelbuf) {
+    const int width = symbol->bitmap_width;
+    const int min_stride = (width + 7) / 8;
+    const int stride = symbol->bitmap_stride ? symbol->bitmap_stride : min_stride;
+    struct buffer_band band;
 
-    /* Suppress clang-analyzer-core.UndefinedBinaryOperatorResult warning */
-    assert(rotate_angle == 0 || rotate_angle == 90 || rotate_angle == 180 || rotate_angle == 270);
-    switch (rotate_angle) {
-        case 0:
-        case 180:
-            symbol->bitmap_width = image_width;
-            symbol->bitmap_height = image_height;
-            break;
-        case 90:
-        case 270:
-            symbol->bitmap_width = image_height;
-            symbol->bitmap_height = image_width;
-            break;
+    if (stride < min_stride) {
+        return ZEXT errtxtf(ZINT_ERROR_INVALID_OPTION, symbol, 666,
+                            "Bitmap stride '%1$d' too small (minimum %2$d for width %3$d)", stride, min_stride,
+                            width);
     }
 
-    if (rotate_angle) {
-        size_t image_size = (size_t) image_width * image_height;
-        if (!(rotated_pixbuf = (unsigned char *) raster_malloc((size_t) image_size, 0 /*prev_size*/))) {
-            return errtxt(ZINT_ERROR_MEMORY, symbol, 650, "Insufficient memory for pixel buffer");
-        }
-#ifdef ZINT_SANITIZEM /* Suppress clang -fsanitize=memory false positive */
-        memset(rotated_pixbuf, DEFAULT_PAPER, image_size);
-#endif
+    /* No alpha */
+    if (symbol->alphamap != NULL) {
+        z_free(symbol->alphamap);
+        symbol->alphamap = NULL;
+        symbol->alphamap_capacity = 0;
     }
 
-    /* Rotate image before plotting */
-    switch (rotate_angle) {
-        case 0: /* Plot the right way up */
-            /* Nothing to do */
-            break;
-        case 90: /* Plot 90 degrees clockwise */
-            for (row = 0; row < image_width; row++) {
-                const size_t h_offset = (size_t) image_height * row;
-                for (column = 0; column < image_height; column++) {
-                    const size_t w_offset = (size_t) image_width * (image_height - column - 1);
-                    rotated_pixbuf[h_offset + column] = *(pixelbuf + w_offset + row);
+    if (!raster_buffer(symbol, &symbol->bitmap, &symbol->bitmap_capacity,
+            (size_t) stride * symbol->bitmap_height, 0 /*prev_size*/)) {
+        return errtxt(ZINT_ERROR_MEMORY, symbol, 661, "Insufficient memory for bitmap buffer");
+    }
+
+    band.symbol = symbol;
+    band.pixelbuf = pixelbuf;
+    band.palette = NULL;
+    band.alpha = NULL;
+    out_run_bands(buffer_plot_1bpp_band, &band, symbol->bitmap_height, raster_band_count(symbol,
+                    symbol->bitmap_height, (size_t) width * symbol->bitmap_height));
+
+    return 0;
+}
+
+/* Composite pixelbuffer into caller-supplied `dest` at its offset, clipping to its bounds, converting to its format
+   and blending by the colours' alpha (fully transparent pixels leaving `dest` untouched) */
+static int buffer_plot_dest(struct zint_symbol *symbol, const unsigned char *pixelbuf,
+            const struct out_raster_dest *dest) {
+    /* Per-pixel-value lookups, indexed by pixelbuf values ('0', '1' and Ultracode colour chars) */
+    unsigned char rgb[91][3];
+    unsigned char grey[91];
+    unsigned char alpha[91];
+    unsigned char ink[91];
+    unsigned char fg_alpha = 0xFF, bg_alpha = 0xFF;
+    const int width = symbol->bitmap_width;
+    const int x_begin = dest->x < 0 ? -dest->x : 0;
+    const int y_begin = dest->y < 0 ? -dest->y : 0;
+    const int x_end = dest->x + width > dest->width ? dest->width - dest->x : width;
+    const int y_end = dest->y + symbol->bitmap_height > dest->height ? dest->height - dest->y
+                        : symbol->bitmap_height;
+    int opaque;
+    int i, row, column;
+
+    if (x_begin >= x_end || y_begin >= y_end) { /* Wholly outside `dest` */
+        return 0;
+    }
+
+    memset(rgb, 0, sizeof(rgb));
+    memset(alpha, 0, sizeof(alpha));
+    memset(ink, 0, sizeof(ink));
+    (void) out_colour_get_rgb(symbol->fgcolour, &rgb[DEFAULT_INK][0], &rgb[DEFAULT_INK][1], &rgb[DEFAULT_INK][2],
+                                &fg_alpha);
+    (void) out_colour_get_rgb(symbol->bgcolour, &rgb[DEFAULT_PAPER][0], &rgb[DEFAULT_PAPER][1],
+                                &rgb[DEFAULT_PAPER][2], &bg_alpha);
+    alpha[DEFAULT_INK] = fg_alpha;
+    alpha[DEFAULT_PAPER] = bg_alpha;
+    ink[DEFAULT_INK] = 1;
+    for (i = 1; i < 9; i++) { /* Ultracode colours, using foreground alpha as `buffer_plot()` */
+        const unsigned char ch = (unsigned char) ultra_colour[i];
+        (void) out_colour_char_to_rgb(ch, &rgb[ch][0], &rgb[ch][1], &rgb[ch][2]);
+        alpha[ch] = fg_alpha;
+        ink[ch] = ch != 'W';
+    }
+    for (i = 0; i < 91; i++) {
+        /* ITU-R BT.601 luma */
+        grey[i] = (unsigned char) ((rgb[i][0] * 299 + rgb[i][1] * 587 + rgb[i][2] * 114 + 500) / 1000);
+    }
+    opaque = fg_alpha == 0xFF && bg_alpha == 0xFF;
+
+    for (row = y_begin; row < y_end; row++) {
+        const unsigned char *pb = pixelbuf + (size_t) width * row;
+        unsigned char *d = dest->buf + (size_t) dest->stride * (dest->y + row);
+
+        if (dest->format == ZINT_PIXEL_1BPP) {
+            for (column = x_begin; column < x_end; column++) {
+                const unsigned char p = pb[column];
+                if (alpha[p] >= 0x80) {
+                    const int dx = dest->x + column;
+                    if (ink[p]) {
+                        d[dx >> 3] |= (unsigned char) (0x80 >> (dx & 7));
+                    } else {
+                        d[dx >> 3] &= (unsigned char) ~(0x80 >> (dx & 7));
+                    }
                 }
             }
-            break;
-        case 180: /* Plot upside down */
-            for (row = 0; row < image_height; row++) {
-                const size_t w_offset = (size_t) image_width * row;
-                const size_t wh_offset = (size_t) image_width * (image_height - row - 1);
-                for (column = 0; column < image_width; column++) {
-                    rotated_pixbuf[w_offset + column] = *(pixelbuf + wh_offset + (image_width - column - 1));
-                }
+            continue;
+        }
+        {
+            const int bpp = dest->format == ZINT_PIXEL_GREY8 ? 1 : dest->format == ZINT_PIXEL_RGB24 ? 3 : 4;
+            const size_t row_bytes = (size_t) bpp * (x_end - x_begin);
+
+            d += (size_t) bpp * (dest->x + x_begin);
+            /* Opaque row same as previous can be copied */
+            if (opaque && row > y_begin && memcmp(pb, pb - width, width) == 0) {
+                memcpy(d, d - dest->stride, row_bytes);
+                continue;
             }
-            break;
-        case 270: /* Plot 90 degrees anti-clockwise */
-            for (row = 0; row < image_width; row++) {
-                const size_t h_offset = (size_t) image_height * row;
-                for (column = 0; column < image_height; column++) {
-                    const size_t w_offset = (size_t) image_width * column;
-                    rotated_pixbuf[h_offset + column] = *(pixelbuf + w_offset + (image_width - row - 1));
+            for (column = x_begin; column < x_end; column++, d += bpp) {
+                const unsigned char p = pb[column];
+                const unsigned int a = alpha[p];
+                if (a == 0xFF) {
+                    if (bpp == 1) {
+                        *d = grey[p];
+                    } else {
+                        memcpy(d, rgb[p], 3);
+                        if (bpp == 4) {
+                            d[3] = 0xFF;
+                        }
+                    }
+                } else if (a) {
+                    const unsigned int na = 0xFF - a;
+                    if (bpp == 1) {
+                        *d = (unsigned char) ((grey[p] * a + *d * na + 0x7F) / 0xFF);
+                    } else if (bpp == 3) {
+                        for (i = 0; i < 3; i++) {
+                            d[i] = (unsigned char) ((rgb[p][i] * a + d[i] * na + 0x7F) / 0xFF);
+                        }
+                    } else { /* Porter-Duff "over" for unpremultiplied RGBA */
+                        const unsigned int da = (d[3] * na + 0x7F) / 0xFF;
+                        const unsigned int out_a = a + da;
+                        for (i = 0; i < 3; i++) {
+                            d[i] = (unsigned char) ((rgb[p][i] * a + d[i] * da + out_a / 2) / out_a);
+                        }
+                        d[3] = (unsigned char) out_a;
+                    }
                 }
             }
-            break;
+        }
+    }
+
+    return 0;
+}
+
+/* Output `pixelbuf` (`image_width` x `image_height`), scaled by `scaler` (0 if none) and rotated by `rotate_angle`.
+   File formats that write row by row (PNG, BMP, PCX and TIF) are fed rows on demand, so the final image is only
+   materialised for buffer and GIF output. Note `pixelbuf` itself is whole, plotted at the integer or half-integer
+   scale, so memory use is still proportional to image size, just without the scaled and rotated copies. Takes
+   ownership of `pixelbuf` */
+static int save_raster_image_to_file(struct zint_symbol *symbol, const int image_height, const int image_width,
+            unsigned char *pixelbuf, const float scaler, const int rotate_angle, const int file_type,
+            const struct out_raster_dest *dest) {
+    int error_number;
+    struct out_raster_rows rows;
+    unsigned char *out_pixbuf = pixelbuf;
+
+    /* Suppress clang-analyzer-core.UndefinedBinaryOperatorResult warning */
+    assert(rotate_angle == 0 || rotate_angle == 90 || rotate_angle == 180 || rotate_angle == 270);
+
+    if (!out_raster_rows_init(&rows, pixelbuf, image_width, image_height, scaler, rotate_angle)) {
+        z_free(pixelbuf);
+        return errtxt(ZINT_ERROR_MEMORY, symbol, 659, "Insufficient memory for row buffer");
     }
+    symbol->bitmap_width = rows.width;
+    symbol->bitmap_height = rows.height;
 
+    /* Only buffer and GIF output need the final image in memory */
+    if (rows.band_buf && (file_type == OUT_BUFFER || file_type == OUT_BUFFER_DEST || file_type == OUT_GIF_FILE)) {
+        const size_t out_size = (size_t) rows.width * rows.height;
+        if (!(out_pixbuf = (unsigned char *) raster_malloc(out_size, (size_t) image_width * image_height))) {
+            out_raster_rows_free(&rows);
+            z_free(pixelbuf);
+            return errtxt(ZINT_ERROR_MEMORY, symbol, 650, "Insufficient memory for pixel buffer");
+        }
+        STATS_BEGIN(symbol, ZINT_STATS_ROTATE);
+        out_raster_rows_copy(&rows, out_pixbuf, raster_band_count(symbol, rows.height, out_size));
+        STATS_END(symbol, ZINT_STATS_ROTATE);
+        out_raster_rows_free(&rows);
+        z_free(pixelbuf);
+        /* Now plain view of final image */
+        (void) out_raster_rows_init(&rows, out_pixbuf, symbol->bitmap_width, symbol->bitmap_height, 0.0f, 0);
+    }
+
+    STATS_BEGIN(symbol, ZINT_STATS_OUTPUT);
     switch (file_type) {
         case OUT_BUFFER:
             if (symbol->output_options & OUT_BUFFER_INTERMEDIATE) {
                 if (symbol->bitmap != NULL) {
-                    free(symbol->bitmap);
+                    z_free(symbol->bitmap);
                     symbol->bitmap = NULL;
                 }
                 if (symbol->alphamap != NULL) {
-                    free(symbol->alphamap);
+                    z_free(symbol->alphamap);
                     symbol->alphamap = NULL;
+                    symbol->alphamap_capacity = 0;
                 }
-                symbol->bitmap = rotated_pixbuf;
-                rotate_angle = 0; /* Suppress freeing buffer if rotated */
+                symbol->bitmap = out_pixbuf;
+                symbol->bitmap_capacity = symbol->bitmap_width * symbol->bitmap_height;
+                out_pixbuf = NULL; /* Now owned by `symbol` */
                 error_number = 0;
+            } else if (symbol->output_options & OUT_BUFFER_1BPP) {
+                error_number = buffer_plot_1bpp(symbol, out_pixbuf);
+            } else if (symbol->output_options & OUT_BUFFER_RGBA) {
+                error_number = buffer_plot_rgba(symbol, out_pixbuf);
             } else {
-                error_number = buffer_plot(symbol, rotated_pixbuf);
+                error_number = buffer_plot(symbol, out_pixbuf);
             }
             break;
+        case OUT_BUFFER_DEST:
+            error_number = buffer_plot_dest(symbol, out_pixbuf, dest);
+            break;
         case OUT_PNG_FILE:
-#ifndef ZINT_NO_PNG
-            error_number = png_pixel_plot(symbol, rotated_pixbuf);
-#else
-            error_number = ZINT_ERROR_INVALID_OPTION;
-#endif
+            error_number = png_pixel_plot(symbol, &rows);
             break;
-#if defined(__GNUC__) && !defined(__clang__) && defined(NDEBUG) && defined(ZINT_NO_PNG)
-/* Suppress gcc warning ‘<unknown>’ may be used uninitialized - only when Release and ZINT_NO_PNG */
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
-#endif
         case OUT_PCX_FILE:
-            error_number = pcx_pixel_plot(symbol, rotated_pixbuf);
+            error_number = pcx_pixel_plot(symbol, &rows);
             break;
         case OUT_GIF_FILE:
-            error_number = gif_pixel_plot(symbol, rotated_pixbuf);
+            error_number = gif_pixel_plot(symbol, out_pixbuf);
             break;
         case OUT_TIF_FILE:
-            error_number = tif_pixel_plot(symbol, rotated_pixbuf);
+            error_number = tif_pixel_plot(symbol, &rows);
             break;
         default:
-            error_number = bmp_pixel_plot(symbol, rotated_pixbuf);
+            error_number = bmp_pixel_plot(symbol, &rows);
             break;
-#if defined(__GNUC__) && !defined(__clang__) && defined(NDEBUG) && defined(ZINT_NO_PNG)
-#pragma GCC diagnostic pop
-#endif
     }
+    STATS_END(symbol, ZINT_STATS_OUTPUT);
 
-    if (rotate_angle) {
-        free(rotated_pixbuf);
+    out_raster_rows_free(&rows);
+    if (out_pixbuf) {
+        z_free(out_pixbuf);
     }
     return error_number;
 }
@@ -321,14 +619,189 @@ static void draw_bar(unsigned char *pixelbuf, const int xpos, const int xlen, co
     }
 }
 
-/* Put a letter into a position */
+/* Lock for the process-wide glyph and stamp caches below */
+#ifdef ZINT_USE_PTHREADS
+static pthread_mutex_t raster_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define raster_cache_lock()     (void) pthread_mutex_lock(&raster_cache_mutex)
+#define raster_cache_unlock()   (void) pthread_mutex_unlock(&raster_cache_mutex)
+#elif defined(_WIN32) && !defined(ZINT_NO_THREADS)
+static SRWLOCK raster_cache_mutex = SRWLOCK_INIT;
+#define raster_cache_lock()     AcquireSRWLockExclusive(&raster_cache_mutex)
+#define raster_cache_unlock()   ReleaseSRWLockExclusive(&raster_cache_mutex)
+#else
+#define raster_cache_lock()     (void) 0
+#define raster_cache_unlock()   (void) 0
+#endif
+
+/* Glyph cache: the scaled rendering of each font at each `si` is worked out once per process as runs of ink per
+   pixel row, so that letters lying wholly within the image can be drawn with a few `memset()`s */
+#define GLYPH_FONT_NORMAL       0
+#define GLYPH_FONT_BOLD         1
+#define GLYPH_FONT_SMALL        2
+#define GLYPH_FONT_UPCEAN       3
+#define GLYPH_FONT_UPCEAN_SMALL 4
+
+#define GLYPH_MAX_SETS  32  /* Maximum number of (font, `si`) combinations cached, after which letters drawn as is */
+#define GLYPH_MAX_RUNS  8   /* Maximum number of ink runs per pixel row (fonts have at most 5) */
+
+/* A pixel row of a scaled glyph */
+struct glyph_row {
+    unsigned short len;                         /* Pixels spanned, as copied for odd `si` */
+    unsigned char run_cnt;                      /* Number of ink runs */
+    unsigned short runs[GLYPH_MAX_RUNS * 2];    /* Start and length of each ink run */
+};
+
+/* All the glyphs of a font scaled by `si`, with a `glyph_row` per font row of each glyph */
+struct glyph_set {
+    int font;                   /* GLYPH_FONT_XXX */
+    int si;
+    int glyph_cnt;
+    int max_len;                /* Maximum `len` of any row */
+    struct glyph_row *rows;     /* `glyph_cnt` x font height */
+};
+
+static struct glyph_set glyph_sets[GLYPH_MAX_SETS];
+static int glyph_set_cnt;
+
+/* Render the font rows of `font_table` (`glyph_cnt` glyphs `max_x` x `max_y`) scaled by `si` into `set`, using
+   exactly the same algorithm as `draw_letter()`. Returns 0 if memory allocation fails or runs don't fit */
+static int glyph_set_build(struct glyph_set *set, const raster_font_item *font_table, const int glyph_cnt,
+            const int max_x, const int max_y, const int bold, const int si) {
+    const int half_si = si / 2, odd_si = si & 1;
+    const int line_len = max_x * half_si + max_x / 2 + 1;
+    const unsigned glyph_mask = ((unsigned) 1) << (max_x - 1);
+    unsigned char *line;
+    int i;
+
+    if (line_len > 0xFFFF) {
+        return 0;
+    }
+    /* Plain `malloc()` as the cache outlives any allocator set by `ZBarcode_SetAllocator()` */
+    if (!(set->rows = (struct glyph_row *) malloc(sizeof(struct glyph_row) * glyph_cnt * max_y))) {
+        return 0;
+    }
+    line = (unsigned char *) z_alloca(line_len);
+    set->glyph_cnt = glyph_cnt;
+    set->max_len = 0;
+
+    for (i = 0; i < glyph_cnt * max_y; i++) {
+        struct glyph_row *const row = set->rows + i;
+        const unsigned set_bits = font_table[i];
+        int x, x_si, pos = 0, extra_dot = 0;
+
+        memset(line, 0, line_len);
+        for (x = 0; x < max_x; x++) {
+            const unsigned bit = set_bits & (glyph_mask >> x);
+            for (x_si = 0; x_si < half_si; x_si++) {
+                if (bit) {
+                    line[pos] = 1;
+                    extra_dot = bold;
+                } else if (extra_dot) {
+                    line[pos] = 1;
+                    extra_dot = 0;
+                }
+                pos++;
+            }
+            if (odd_si && (x & 1)) {
+                line[pos++] = bit ? 1 : 0;
+            }
+        }
+        if (extra_dot) {
+            line[pos++] = 1;
+        }
+        row->len = (unsigned short) pos;
+        if (pos > set->max_len) {
+            set->max_len = pos;
+        }
+
+        row->run_cnt = 0;
+        for (x = 0; x < pos; x++) {
+            if (line[x]) {
+                const int start = x;
+                while (x + 1 < pos && line[x + 1]) {
+                    x++;
+                }
+                if (row->run_cnt == GLYPH_MAX_RUNS) {
+                    free(set->rows);
+                    set->rows = NULL;
+                    return 0;
+                }
+                row->runs[row->run_cnt * 2] = (unsigned short) start;
+                row->runs[row->run_cnt * 2 + 1] = (unsigned short) (x - start + 1);
+                row->run_cnt++;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/* Font tables and dimensions of each GLYPH_FONT_XXX */
+static const struct {
+    const raster_font_item *font_table;
+    int glyph_cnt;
+    int max_x;
+    int max_y;
+    int bold;
+} glyph_fonts[] = {
+    { ascii_font, ARRAY_SIZE(ascii_font) / NORMAL_FONT_HEIGHT, NORMAL_FONT_WIDTH, NORMAL_FONT_HEIGHT, 0 },
+    { ascii_font, ARRAY_SIZE(ascii_font) / NORMAL_FONT_HEIGHT, NORMAL_FONT_WIDTH + 1, NORMAL_FONT_HEIGHT, 1 },
+    { small_font, ARRAY_SIZE(small_font) / SMALL_FONT_HEIGHT, SMALL_FONT_WIDTH, SMALL_FONT_HEIGHT, 0 },
+    { upcean_font, ARRAY_SIZE(upcean_font) / UPCEAN_FONT_HEIGHT, UPCEAN_FONT_WIDTH, UPCEAN_FONT_HEIGHT, 0 },
+    { upcean_small_font, ARRAY_SIZE(upcean_small_font) / UPCEAN_SMALL_FONT_HEIGHT, UPCEAN_SMALL_FONT_WIDTH,
+        UPCEAN_SMALL_FONT_HEIGHT, 0 },
+};
+
+/* The GLYPH_FONT_XXX used by `draw_letter()` for `textflags` */
+static int glyph_font(const int textflags) {
+    if (textflags & ZFONT_UPCEAN_TEXT) { /* Needs to be before SMALL_TEXT check */
+        return textflags & SMALL_TEXT ? GLYPH_FONT_UPCEAN_SMALL : GLYPH_FONT_UPCEAN;
+    }
+    if (textflags & SMALL_TEXT) {
+        return GLYPH_FONT_SMALL;
+    }
+    return textflags & BOLD_TEXT ? GLYPH_FONT_BOLD : GLYPH_FONT_NORMAL;
+}
+
+/* Return the cached glyphs of `font` scaled by `si`, building them if not already, or NULL if the cache is full or
+   building fails. Sets once built are never changed or freed, so the result may be used without locking. Called
+   once per string by `draw_string()` */
+static const struct glyph_set *glyph_set_get(const int font, const int si) {
+    const struct glyph_set *ret = NULL;
+    int i;
+
+    raster_cache_lock();
+    for (i = 0; i < glyph_set_cnt; i++) {
+        if (glyph_sets[i].font == font && glyph_sets[i].si == si) {
+            ret = glyph_sets + i;
+            break;
+        }
+    }
+    if (!ret && glyph_set_cnt < GLYPH_MAX_SETS) {
+        struct glyph_set *const set = glyph_sets + glyph_set_cnt;
+        set->font = font;
+        set->si = si;
+        if (glyph_set_build(set, glyph_fonts[font].font_table, glyph_fonts[font].glyph_cnt, glyph_fonts[font].max_x,
+                glyph_fonts[font].max_y, glyph_fonts[font].bold, si)) {
+            glyph_set_cnt++;
+            ret = set;
+        }
+    }
+    raster_cache_unlock();
+
+    return ret;
+}
+
+/* Put a letter into a position, using `glyphs` (if non-NULL) if it lies wholly within the image */
 static void draw_letter(unsigned char *pixelbuf, const unsigned char letter, int xposn, const int yposn,
-            const int textflags, const int image_width, const int image_height, const int si) {
+            const int textflags, const int image_width, const int image_height, const int si,
+            const struct glyph_set *glyphs) {
     int glyph_no;
     int x, y;
     int max_x, max_y;
     const raster_font_item *font_table;
     int bold = 0;
+    int glyph_cnt;
     unsigned glyph_mask;
     int font_y;
     int half_si;
@@ -363,10 +836,12 @@ static void draw_letter(unsigned char *pixelbuf, const unsigned char letter, int
             font_table = upcean_small_font;
             max_x = UPCEAN_SMALL_FONT_WIDTH;
             max_y = UPCEAN_SMALL_FONT_HEIGHT;
+            glyph_cnt = ARRAY_SIZE(upcean_small_font) / UPCEAN_SMALL_FONT_HEIGHT;
         } else {
             font_table = upcean_font;
             max_x = UPCEAN_FONT_WIDTH;
             max_y = UPCEAN_FONT_HEIGHT;
+            glyph_cnt = ARRAY_SIZE(upcean_font) / UPCEAN_FONT_HEIGHT;
         }
         glyph_no = letter - '0';
     } else if (textflags & SMALL_TEXT) { /* small font 5x9 */
@@ -374,16 +849,42 @@ static void draw_letter(unsigned char *pixelbuf, const unsigned char letter, int
         max_x = SMALL_FONT_WIDTH;
         max_y = SMALL_FONT_HEIGHT;
         font_table = small_font;
+        glyph_cnt = ARRAY_SIZE(small_font) / SMALL_FONT_HEIGHT;
     } else if (textflags & BOLD_TEXT) { /* bold font -> regular font + 1 */
         max_x = NORMAL_FONT_WIDTH + 1;
         max_y = NORMAL_FONT_HEIGHT;
         font_table = ascii_font;
         bold = 1;
+        glyph_cnt = ARRAY_SIZE(ascii_font) / NORMAL_FONT_HEIGHT;
     } else { /* regular font 7x14 */
         max_x = NORMAL_FONT_WIDTH;
         max_y = NORMAL_FONT_HEIGHT;
         font_table = ascii_font;
+        glyph_cnt = ARRAY_SIZE(ascii_font) / NORMAL_FONT_HEIGHT;
+    }
+
+    /* If letter wholly within image use cached glyph */
+    if (glyphs && xposn >= 0 && glyph_no >= 0 && glyph_no < glyph_cnt
+            && yposn + max_y * half_si + (odd_si ? max_y / 2 : 0) <= image_height
+            && xposn + glyphs->max_len <= image_width) {
+        const struct glyph_row *row = glyphs->rows + glyph_no * max_y;
+        linePtr = pixelbuf + ((size_t) yposn * image_width) + xposn;
+        for (y = 0; y < max_y; y++, row++) {
+            int y_si;
+            for (y_si = 0; y_si < half_si; y_si++) {
+                for (x = 0; x < row->run_cnt; x++) {
+                    memset(linePtr + row->runs[x * 2], DEFAULT_INK, row->runs[x * 2 + 1]);
+                }
+                linePtr += image_width;
+            }
+            if (odd_si && (y & 1)) {
+                memcpy(linePtr, linePtr - image_width, row->len);
+                linePtr += image_width;
+            }
+        }
+        return;
     }
+
     glyph_mask = ((unsigned) 1) << (max_x - 1);
     font_y = glyph_no * max_y;
 
@@ -441,6 +942,7 @@ static void draw_string(unsigned char *pixelbuf, const unsigned char input_strin
     int i, string_left_hand, letter_width, letter_gap;
     const int half_si = si / 2, odd_si = si & 1;
     int x_incr;
+    const struct glyph_set *glyphs = NULL;
 
     if (textflags & ZFONT_UPCEAN_TEXT) { /* Needs to be before SMALL_TEXT check */
         /* No bold for UPCEAN */
@@ -473,30 +975,16 @@ static void draw_string(unsigned char *pixelbuf, const unsigned char input_strin
     if (odd_si) {
         string_left_hand -= (letter_width * length - letter_gap) / 4;
     }
+    if (half_si && length && !(textflags & ZFONT_NO_CACHE)) {
+        glyphs = glyph_set_get(glyph_font(textflags), si);
+    }
     for (i = 0; i < length; i++) {
         x_incr = i * letter_width * half_si;
         if (odd_si) {
             x_incr += i * letter_width / 2;
         }
         draw_letter(pixelbuf, input_string[i], string_left_hand + x_incr, yposn, textflags, image_width, image_height,
-                    si);
-    }
-}
-
-/* Draw disc using x² + y² <= r² */
-static void draw_circle(unsigned char *pixelbuf, const int image_width, const int image_height,
-            const int x0, const int y0, const float radius, const char fill) {
-    int x, y;
-    const int radius_i = (int) radius;
-    const int radius_squared = radius_i * radius_i;
-
-    for (y = -radius_i; y <= radius_i; y++) {
-        const int y_squared = y * y;
-        for (x = -radius_i; x <= radius_i; x++) {
-            if ((x * x) + y_squared <= radius_squared) {
-                draw_pt(pixelbuf, image_width, image_height, x0 + x, y0 + y, fill);
-            }
-        }
+                    si, glyphs);
     }
 }
 
@@ -514,7 +1002,7 @@ static void draw_mp_circle_lines(unsigned char *pixelbuf, const int image_width,
     }
 }
 
-/* Draw disc using Midpoint Circle Algorithm. Using this for MaxiCode rather than `draw_circle()` because it gives a
+/* Draw disc using Midpoint Circle Algorithm. Using this for MaxiCode rather than a disc stamp because it gives a
  * flatter circumference with no single pixel peaks, similar to Figures J3 and J6 in ISO/IEC 16023:2000.
  * Taken from https://rosettacode.org/wiki/Bitmap/Midpoint_circle_algorithm#C
  * "Content is available under GNU Free Documentation License 1.2 unless otherwise noted."
@@ -571,21 +1059,6 @@ static void draw_bullseye(unsigned char *pixelbuf, const int image_width, const
     draw_mp_circle(pixelbuf, image_width, image_height, x, y, r1, DEFAULT_PAPER);
 }
 
-/* Put a hexagon into the pixel buffer */
-static void draw_hexagon(unsigned char *pixelbuf, const int image_width, const int image_height,
-            const unsigned char *scaled_hexagon, const int hex_width, const int hex_height,
-            const int xposn, const int yposn) {
-    int i, j;
-
-    for (i = 0; i < hex_height; i++) {
-        for (j = 0; j < hex_width; j++) {
-            if (scaled_hexagon[(i * hex_width) + j] == DEFAULT_INK) {
-                draw_pt(pixelbuf, image_width, image_height, xposn + j, yposn + i, DEFAULT_INK);
-            }
-        }
-    }
-}
-
 /* Bresenham's line algorithm https://en.wikipedia.org/wiki/Bresenham's_line_algorithm
  * Creative Commons Attribution-ShareAlike License
  * https://en.wikipedia.org/wiki/Wikipedia:Text_of_Creative_Commons_Attribution-ShareAlike_3.0_Unported_License */
@@ -680,6 +1153,186 @@ static void plot_hexagon(unsigned char *scaled_hexagon, const int hex_width, con
     }
 }
 
+/* Stamp cache: the dots of dotty mode and the hexagons of MaxiCode are made once per process for each size as a span
+   of ink per pixel row (both shapes being convex), and plotted with a `memset()` per row */
+#define STAMP_DISC      0   /* Disc using x² + y² <= r² */
+#define STAMP_HEXAGON   1   /* MaxiCode hexagon */
+
+#define STAMP_MAX_CACHED    32  /* Maximum number of stamps cached, after which stamps made per render */
+
+struct stamp {
+    int kind;       /* STAMP_XXX */
+    int key[6];     /* Dimensions stamp made from (disc radius, or `plot_hexagon()` args) */
+    int y_start;    /* Row of first span relative to plot position */
+    int height;     /* Number of spans */
+    int *spans;     /* `height` pairs of start column relative to plot position and length (0 if none) */
+};
+
+static struct stamp stamps[STAMP_MAX_CACHED];
+static int stamp_cnt;
+
+/* Make disc stamp centred on plot position, giving same pixels as plotting each x² + y² <= r². Returns 0 if memory
+   allocation fails */
+static int stamp_disc_make(struct stamp *stamp, const int radius) {
+    int y, x = radius;
+    int *span;
+
+    stamp->y_start = -radius;
+    stamp->height = radius * 2 + 1;
+    if (!(stamp->spans = (int *) malloc(sizeof(int) * 2 * stamp->height))) {
+        return 0;
+    }
+    /* Going from the middle row out, the half-width can only shrink */
+    for (y = 0; y <= radius; y++) {
+        while (x * x + y * y > radius * radius) {
+            x--;
+        }
+        span = stamp->spans + (radius + y) * 2;
+        span[0] = -x;
+        span[1] = x * 2 + 1;
+        span = stamp->spans + (radius - y) * 2;
+        span[0] = -x;
+        span[1] = x * 2 + 1;
+    }
+    return 1;
+}
+
+/* Make hexagon stamp using `plot_hexagon()`, with plot position top left. Returns 0 if memory allocation fails */
+static int stamp_hexagon_make(struct stamp *stamp, const int hex_width, const int hex_height, const int hx_start,
+            const int hy_start, const int hx_end, const int hy_end) {
+    const size_t hex_size = (size_t) hex_width * hex_height;
+    unsigned char *scaled_hexagon;
+    int y;
+
+    if (!(scaled_hexagon = (unsigned char *) z_malloc(hex_size))) {
+        return 0;
+    }
+    if (!(stamp->spans = (int *) malloc(sizeof(int) * 2 * hex_height))) {
+        z_free(scaled_hexagon);
+        return 0;
+    }
+    memset(scaled_hexagon, DEFAULT_PAPER, hex_size);
+
+    plot_hexagon(scaled_hexagon, hex_width, hex_height, hx_start, hy_start, hx_end, hy_end);
+
+    stamp->y_start = 0;
+    stamp->height = hex_height;
+    for (y = 0; y < hex_height; y++) {
+        const unsigned char *const line = scaled_hexagon + (size_t) y * hex_width;
+        int *const span = stamp->spans + y * 2;
+        int first = 0, last = hex_width - 1;
+        while (first < hex_width && line[first] != DEFAULT_INK) {
+            first++;
+        }
+        while (last > first && line[last] != DEFAULT_INK) {
+            last--;
+        }
+        span[0] = first;
+        span[1] = first < hex_width ? last - first + 1 : 0;
+        assert(span[1] == 0 || !memchr(line + first, DEFAULT_PAPER, span[1])); /* Convex */
+    }
+
+    z_free(scaled_hexagon);
+    return 1;
+}
+
+/* Make stamp of `kind` with dimensions `key` (`key[0]` radius if disc) into `stamp`. Its spans are allocated with
+   plain `malloc()` as cached stamps outlive any allocator set by `ZBarcode_SetAllocator()`. Returns 0 if memory
+   allocation fails */
+static int stamp_make(struct stamp *stamp, const int kind, const int key[6]) {
+    stamp->kind = kind;
+    memcpy(stamp->key, key, sizeof(stamp->key));
+    if (kind == STAMP_DISC) {
+        return stamp_disc_make(stamp, key[0]);
+    }
+    return stamp_hexagon_make(stamp, key[0], key[1], key[2], key[3], key[4], key[5]);
+}
+
+/* Return the cached stamp of `kind` with dimensions `key`, making it if not already. If the cache is full the
+   stamp is made into `local`, whose `spans` must then be `free()`d by caller. Returns NULL if memory allocation
+   fails. Called once per render */
+static const struct stamp *stamp_get(const int kind, const int key[6], struct stamp *local) {
+    const struct stamp *ret = NULL;
+    int i;
+
+    local->spans = NULL;
+
+    raster_cache_lock();
+    for (i = 0; i < stamp_cnt; i++) {
+        if (stamps[i].kind == kind && memcmp(stamps[i].key, key, sizeof(stamps[i].key)) == 0) {
+            ret = stamps + i;
+            break;
+        }
+    }
+    if (!ret && stamp_cnt < STAMP_MAX_CACHED && stamp_make(stamps + stamp_cnt, kind, key)) {
+        ret = stamps + stamp_cnt++;
+    }
+    raster_cache_unlock();
+
+    if (!ret && stamp_make(local, kind, key)) {
+        ret = local;
+    }
+    return ret;
+}
+
+/* Plot `stamp` in ink at `xposn`, `yposn`, clipped to the pixel buffer rows `y_begin` to `y_end` - 1 */
+static void draw_stamp(unsigned char *pixelbuf, const int image_width, const int y_begin, const int y_end,
+            const struct stamp *stamp, const int xposn, const int yposn) {
+    const int *span = stamp->spans;
+    int i, y = yposn + stamp->y_start;
+
+    for (i = 0; i < stamp->height; i++, y++, span += 2) {
+        int x = xposn + span[0], len = span[1];
+        if (len == 0 || y < y_begin || y >= y_end) {
+            continue;
+        }
+        if (x < 0) {
+            len += x;
+            x = 0;
+        }
+        if (x + len > image_width) {
+            len = image_width - x;
+        }
+        if (len > 0) {
+            memset(pixelbuf + (size_t) y * image_width + x, DEFAULT_INK, len);
+        }
+    }
+}
+
+/* Arguments for `draw_stamps_band()` */
+struct stamp_band {
+    const struct zint_symbol *symbol;
+    unsigned char *pixelbuf;
+    int image_width;
+    const struct stamp *stamp;
+    const int *row_y;       /* Plot position of each row */
+    const int *column_x;    /* Plot position of each column */
+    int odd_row_offset;     /* If non-zero, odd rows shifted right by this and a module shorter (MaxiCode) */
+};
+
+/* Plot the stamp of each set module, clipped to pixel rows `start` to `end` - 1 */
+static void draw_stamps_band(void *arg, const int start, const int end) {
+    const struct stamp_band *band = (const struct stamp_band *) arg;
+    const struct zint_symbol *symbol = band->symbol;
+    const struct stamp *stamp = band->stamp;
+    int row, column;
+
+    for (row = 0; row < symbol->rows; row++) {
+        const int odd_row = band->odd_row_offset ? row & 1 : 0;
+        const int x_offset = odd_row ? band->odd_row_offset : 0;
+        const int yposn = band->row_y[row];
+        if (yposn + stamp->y_start >= end || yposn + stamp->y_start + stamp->height <= start) {
+            continue;
+        }
+        for (column = 0; column < symbol->width - odd_row; column++) {
+            if (module_is_set(symbol, row, column)) {
+                draw_stamp(band->pixelbuf, band->image_width, start, end, stamp, band->column_x[column] + x_offset,
+                            yposn);
+            }
+        }
+    }
+}
+
 /* Draw binding or box */
 static void draw_bind_box(const struct zint_symbol *symbol, unsigned char *pixelbuf,
             const int xoffset_si, const int yoffset_si, const int symbol_height_si, const int dot_overspill_si,
@@ -733,7 +1386,8 @@ static void draw_bind_box(const struct zint_symbol *symbol, unsigned char *pixel
 }
 
 /* Plot a MaxiCode symbol with hexagons and bullseye */
-static int plot_raster_maxicode(struct zint_symbol *symbol, const int rotate_angle, const int file_type) {
+static int plot_raster_maxicode(struct zint_symbol *symbol, const int rotate_angle, const int file_type,
+            const struct out_raster_dest *dest) {
     int row, column;
     int image_height, image_width;
     size_t image_size;
@@ -741,9 +1395,12 @@ static int plot_raster_maxicode(struct zint_symbol *symbol, const int rotate_ang
     int error_number;
     float xoffset, yoffset, roffset, boffset;
     float scaler = symbol->scale;
-    unsigned char *scaled_hexagon;
+    const struct stamp *hexagon;
+    struct stamp local_hexagon;
+    struct stamp_band band;
+    int *row_y, *column_x;
+    int hex_key[6];
     int hex_width, hex_height;
-    size_t hex_size;
     int hx_start, hy_start, hx_end, hy_end;
     int hex_image_width, hex_image_height;
     int yposn_offset;
@@ -790,27 +1447,34 @@ static int plot_raster_maxicode(struct zint_symbol *symbol, const int rotate_ang
     }
     memset(pixelbuf, DEFAULT_PAPER, image_size);
 
-    hex_size = (size_t) hex_width * hex_height;
-    if (!(scaled_hexagon = (unsigned char *) raster_malloc(hex_size, image_size))) {
-        free(pixelbuf);
+    hex_key[0] = hex_width;
+    hex_key[1] = hex_height;
+    hex_key[2] = hx_start;
+    hex_key[3] = hy_start;
+    hex_key[4] = hx_end;
+    hex_key[5] = hy_end;
+    if (!(hexagon = stamp_get(STAMP_HEXAGON, hex_key, &local_hexagon))) {
+        z_free(pixelbuf);
         return errtxt(ZINT_ERROR_MEMORY, symbol, 656, "Insufficient memory for pixel buffer");
     }
-    memset(scaled_hexagon, DEFAULT_PAPER, hex_size);
-
-    plot_hexagon(scaled_hexagon, hex_width, hex_height, hx_start, hy_start, hx_end, hy_end);
 
+    /* Odd rows reduced (and shifted right by half a hexagon), even rows full */
+    row_y = (int *) z_alloca(sizeof(int) * symbol->rows);
+    column_x = (int *) z_alloca(sizeof(int) * symbol->width);
     for (row = 0; row < symbol->rows; row++) {
-        const int odd_row = row & 1; /* Odd (reduced) row, even (full) row */
-        const int yposn = row * yposn_offset + yoffset_si - hy_start;
-        const int xposn_offset = (odd_row ? hex_width / 2 : 0) + xoffset_si - hx_start;
-        for (column = 0; column < symbol->width - odd_row; column++) {
-            const int xposn = column * hex_width + xposn_offset;
-            if (module_is_set(symbol, row, column)) {
-                draw_hexagon(pixelbuf, image_width, image_height, scaled_hexagon, hex_width, hex_height, xposn,
-                            yposn);
-            }
-        }
+        row_y[row] = row * yposn_offset + yoffset_si - hy_start;
     }
+    for (column = 0; column < symbol->width; column++) {
+        column_x[column] = column * hex_width + xoffset_si - hx_start;
+    }
+    band.symbol = symbol;
+    band.pixelbuf = pixelbuf;
+    band.image_width = image_width;
+    band.stamp = hexagon;
+    band.row_y = row_y;
+    band.column_x = column_x;
+    band.odd_row_offset = hex_width / 2;
+    out_run_bands(draw_stamps_band, &band, image_height, raster_band_count(symbol, image_height, image_size));
 
     draw_bullseye(pixelbuf, image_width, image_height, hex_width, hex_height, hx_start, hx_end, hex_image_height,
                 xoffset_si, yoffset_si);
@@ -818,11 +1482,9 @@ static int plot_raster_maxicode(struct zint_symbol *symbol, const int rotate_ang
     draw_bind_box(symbol, pixelbuf, xoffset_si, yoffset_si, hex_image_height, 0 /*dot_overspill_si*/,
                 0 /*upceanflag*/, 0 /*textoffset_si*/, image_width, image_height, (int) scaler);
 
-    error_number = save_raster_image_to_file(symbol, image_height, image_width, pixelbuf, rotate_angle, file_type);
-    free(scaled_hexagon);
-    if (rotate_angle || file_type != OUT_BUFFER || !(symbol->output_options & OUT_BUFFER_INTERMEDIATE)) {
-        free(pixelbuf);
-    }
+    error_number = save_raster_image_to_file(symbol, image_height, image_width, pixelbuf, 0.0f /*scaler*/,
+                                            rotate_angle, file_type, dest);
+    free(local_hexagon.spans);
     if (error_number == 0) {
         /* Check whether size is compliant */
         const float min_ratio = 0.92993629f; /* 24.82 / 26.69 */
@@ -835,17 +1497,22 @@ static int plot_raster_maxicode(struct zint_symbol *symbol, const int rotate_ang
     return error_number;
 }
 
-static int plot_raster_dotty(struct zint_symbol *symbol, const int rotate_angle, const int file_type) {
+static int plot_raster_dotty(struct zint_symbol *symbol, const int rotate_angle, const int file_type,
+            const struct out_raster_dest *dest) {
     float scaler = 2 * symbol->scale;
     unsigned char *scaled_pixelbuf;
     int r, i;
     int scale_width, scale_height;
     size_t scale_size;
-    int error_number = 0;
     float xoffset, yoffset, roffset, boffset;
     float dot_offset_s;
     float dot_radius_s;
     int dot_radius_si;
+    const struct stamp *dot;
+    struct stamp local_dot;
+    struct stamp_band band;
+    int *row_y, *column_x;
+    int dot_key[6] = {0};
     int dot_overspill_si;
     int xoffset_si, yoffset_si, roffset_si, boffset_si;
     int symbol_height_si;
@@ -883,28 +1550,37 @@ static int plot_raster_dotty(struct zint_symbol *symbol, const int rotate_angle,
     }
     memset(scaled_pixelbuf, DEFAULT_PAPER, scale_size);
 
+    dot_key[0] = dot_radius_si;
+    if (!(dot = stamp_get(STAMP_DISC, dot_key, &local_dot))) {
+        z_free(scaled_pixelbuf);
+        return errtxt(ZINT_ERROR_MEMORY, symbol, 667, "Insufficient memory for pixel buffer");
+    }
+
     /* Plot the body of the symbol to the pixel buffer */
+    row_y = (int *) z_alloca(sizeof(int) * symbol->rows);
+    column_x = (int *) z_alloca(sizeof(int) * symbol->width);
     for (r = 0; r < symbol->rows; r++) {
-        int row_si = (int) (r * scaler + yoffset_si + dot_offset_s);
-        for (i = 0; i < symbol->width; i++) {
-            if (module_is_set(symbol, r, i)) {
-                draw_circle(scaled_pixelbuf, scale_width, scale_height,
-                            (int) (i * scaler + xoffset_si + dot_offset_s),
-                            row_si, dot_radius_si, DEFAULT_INK);
-            }
-        }
+        row_y[r] = (int) (r * scaler + yoffset_si + dot_offset_s);
+    }
+    for (i = 0; i < symbol->width; i++) {
+        column_x[i] = (int) (i * scaler + xoffset_si + dot_offset_s);
     }
+    band.symbol = symbol;
+    band.pixelbuf = scaled_pixelbuf;
+    band.image_width = scale_width;
+    band.stamp = dot;
+    band.row_y = row_y;
+    band.column_x = column_x;
+    band.odd_row_offset = 0;
+    out_run_bands(draw_stamps_band, &band, scale_height, raster_band_count(symbol, scale_height, scale_size));
 
     draw_bind_box(symbol, scaled_pixelbuf, xoffset_si, yoffset_si, symbol_height_si, dot_overspill_si,
                 0 /*upceanflag*/, 0 /*textoffset_si*/, scale_width, scale_height, (int) scaler);
 
-    error_number = save_raster_image_to_file(symbol, scale_height, scale_width, scaled_pixelbuf, rotate_angle,
-                                            file_type);
-    if (rotate_angle || file_type != OUT_BUFFER || !(symbol->output_options & OUT_BUFFER_INTERMEDIATE)) {
-        free(scaled_pixelbuf);
-    }
+    free(local_dot.spans);
 
-    return error_number;
+    return save_raster_image_to_file(symbol, scale_height, scale_width, scaled_pixelbuf, 0.0f /*scaler*/,
+                                    rotate_angle, file_type, dest);
 }
 
 /* Convert UTF-8 to ISO/IEC 8859-1 for `draw_string()` human readable text */
@@ -946,7 +1622,40 @@ static void to_iso8859_1(const unsigned char source[], unsigned char preprocesse
     preprocessed[j] = '\0';
 }
 
-static int plot_raster_default(struct zint_symbol *symbol, const int rotate_angle, const int file_type) {
+/* Arguments for `draw_bars_band()` */
+struct bars_band {
+    const struct zint_symbol *symbol;
+    unsigned char *pixelbuf;
+    int image_width;
+    int image_height;
+    const int *row_y;       /* Vertical pixel position of each row */
+    const int *row_height;  /* Pixel height of each row */
+    int si;
+    int xoffset_si;
+    int roffset_si;
+};
+
+/* Draw symbol rows `start` to `end` - 1 from their runs of dark modules */
+static void draw_bars_band(void *arg, const int start, const int end) {
+    const struct bars_band *band = (const struct bars_band *) arg;
+    const struct zint_symbol *symbol = band->symbol;
+    const int si = band->si;
+    int *runs = (int *) z_alloca(sizeof(int) * (symbol->width + 1));
+    int r, i, run_cnt;
+
+    for (r = start; r < end; r++) {
+        run_cnt = module_row_runs(symbol, r, runs);
+        for (i = 0; i < run_cnt; i++) {
+            draw_bar_line(band->pixelbuf, runs[i << 1] * si + band->xoffset_si, runs[(i << 1) + 1] * si,
+                        band->row_y[r], band->image_width, DEFAULT_INK);
+        }
+        copy_bar_line(band->pixelbuf, band->xoffset_si, band->image_width - band->xoffset_si - band->roffset_si,
+                    band->row_y[r], band->row_height[r], band->image_width, band->image_height);
+    }
+}
+
+static int plot_raster_default(struct zint_symbol *symbol, const int rotate_angle, const int file_type,
+            const struct out_raster_dest *dest) {
     int error_number, warn_number = 0;
     int main_width;
     int comp_xoffset = 0;
@@ -1028,6 +1737,11 @@ static int plot_raster_default(struct zint_symbol *symbol, const int rotate_angl
         font_height = textflags & SMALL_TEXT ? (SMALL_FONT_HEIGHT + 1) / 2 : (NORMAL_FONT_HEIGHT + 1) / 2;
         guard_descent = 0.0f;
     }
+#ifdef ZINT_TEST
+    if (symbol->debug & ZINT_DEBUG_TEST) {
+        textflags |= ZFONT_NO_CACHE;
+    }
+#endif
 
     if (hide_text) {
         textoffset = guard_descent;
@@ -1116,6 +1830,10 @@ static int plot_raster_default(struct zint_symbol *symbol, const int rotate_angl
         }
 
     } else {
+        struct bars_band band;
+        int *row_y = (int *) z_alloca(sizeof(int) * symbol->rows);
+        int *row_height = (int *) z_alloca(sizeof(int) * symbol->rows);
+
         if (upceanflag && !hide_text) { /* EAN-2, EAN-5 (standalone add-ons) */
             yposn_si += (int) ceilf((font_height + symbol->text_gap) * si);
         }
@@ -1124,21 +1842,22 @@ static int plot_raster_default(struct zint_symbol *symbol, const int rotate_angl
             if (upceanflag && !hide_text) { /* EAN-2, EAN-5 (standalone add-ons) */
                 row_height_si += textoffset * si - (yposn_si - yoffset_si);
             }
-
-            for (i = 0; i < symbol->width; i += block_width) {
-                const int fill = module_is_set(symbol, r, i);
-                for (block_width = 1; (i + block_width < symbol->width)
-                                        && module_is_set(symbol, r, i + block_width) == fill; block_width++);
-                if (fill) {
-                    /* a bar */
-                    draw_bar_line(pixelbuf, i * si + xoffset_si, block_width * si, yposn_si, image_width,
-                                DEFAULT_INK);
-                }
-            }
-            copy_bar_line(pixelbuf, xoffset_si, image_width - xoffset_si - roffset_si, yposn_si, row_height_si,
-                        image_width, image_height);
+            row_y[r] = yposn_si;
+            row_height[r] = row_height_si;
             yposn_si += row_height_si;
         }
+
+        /* Rows occupy separate pixel rows so can be drawn in bands */
+        band.symbol = symbol;
+        band.pixelbuf = pixelbuf;
+        band.image_width = image_width;
+        band.image_height = image_height;
+        band.row_y = row_y;
+        band.row_height = row_height;
+        band.si = si;
+        band.xoffset_si = xoffset_si;
+        band.roffset_si = roffset_si;
+        out_run_bands(draw_bars_band, &band, symbol->rows, raster_band_count(symbol, symbol->rows, image_size));
     }
 
     if (guard_descent && upceanflag >= 6) { /* UPC-E, EAN-8, UPC-A, EAN-13 */
@@ -1369,59 +2088,17 @@ static int plot_raster_default(struct zint_symbol *symbol, const int rotate_angl
     draw_bind_box(symbol, pixelbuf, xoffset_si, yoffset_si, symbol_height_si, 0 /*dot_overspill_si*/,
                 upceanflag, (int) (textoffset * si), image_width, image_height, si);
 
-    if (!half_int_scaling) {
-        size_t prev_image_row;
-        unsigned char *scaled_pixelbuf;
-        const int scale_width = (int) stripf(image_width * scaler);
-        const int scale_height = (int) stripf(image_height * scaler);
-
-        /* Apply scale options by creating another pixel buffer */
-        if (!(scaled_pixelbuf = (unsigned char *) raster_malloc((size_t) scale_width * scale_height, image_size))) {
-            free(pixelbuf);
-            return errtxt(ZINT_ERROR_MEMORY, symbol, 659, "Insufficient memory for scaled pixel buffer");
-        }
-        memset(scaled_pixelbuf, DEFAULT_PAPER, (size_t) scale_width * scale_height);
-
-        /* Interpolate */
-        for (r = 0; r < scale_height; r++) {
-            size_t scaled_row = (size_t) scale_width * r;
-            size_t image_row = (size_t) stripf(r / scaler) * image_width;
-            if (r && (image_row == prev_image_row
-                    || memcmp(pixelbuf + image_row, pixelbuf + prev_image_row, image_width) == 0)) {
-                memcpy(scaled_pixelbuf + scaled_row, scaled_pixelbuf + scaled_row - scale_width, scale_width);
-            } else {
-                for (i = 0; i < scale_width; i++) {
-                    *(scaled_pixelbuf + scaled_row + i) = *(pixelbuf + image_row + (int) stripf(i / scaler));
-                }
-            }
-            prev_image_row = image_row;
-        }
-
-        error_number = save_raster_image_to_file(symbol, scale_height, scale_width, scaled_pixelbuf, rotate_angle,
-                                                file_type);
-        if (rotate_angle || file_type != OUT_BUFFER || !(symbol->output_options & OUT_BUFFER_INTERMEDIATE)) {
-            free(scaled_pixelbuf);
-        }
-        free(pixelbuf);
-    } else {
-        error_number = save_raster_image_to_file(symbol, image_height, image_width, pixelbuf, rotate_angle,
-                                                file_type);
-        if (rotate_angle || file_type != OUT_BUFFER || !(symbol->output_options & OUT_BUFFER_INTERMEDIATE)) {
-            free(pixelbuf);
-        }
-    }
+    /* Apply any fractional scaling on output rather than by creating another pixel buffer */
+    error_number = save_raster_image_to_file(symbol, image_height, image_width, pixelbuf,
+                                            half_int_scaling ? 0.0f : scaler, rotate_angle, file_type, dest);
     return error_number ? error_number : warn_number;
 }
 
-INTERNAL int plot_raster(struct zint_symbol *symbol, int rotate_angle, int file_type) {
+/* Plot to `file_type`, or to caller-supplied `dest` if `file_type` OUT_BUFFER_DEST */
+static int plot_raster_dest(struct zint_symbol *symbol, const int rotate_angle, const int file_type,
+            const struct out_raster_dest *dest) {
     int error;
 
-#ifdef ZINT_NO_PNG
-    if (file_type == OUT_PNG_FILE) {
-        return errtxt(ZINT_ERROR_INVALID_OPTION, symbol, 660, "PNG format disabled at compile time");
-    }
-#endif /* ZINT_NO_PNG */
-
     error = out_check_colour_options(symbol);
     if (error != 0) {
         return error;
@@ -1431,14 +2108,23 @@ INTERNAL int plot_raster(struct zint_symbol *symbol, int rotate_angle, int file_
     }
 
     if (symbol->symbology == BARCODE_MAXICODE) {
-        error = plot_raster_maxicode(symbol, rotate_angle, file_type);
+        error = plot_raster_maxicode(symbol, rotate_angle, file_type, dest);
     } else if (symbol->output_options & BARCODE_DOTTY_MODE) {
-        error = plot_raster_dotty(symbol, rotate_angle, file_type);
+        error = plot_raster_dotty(symbol, rotate_angle, file_type, dest);
     } else {
-        error = plot_raster_default(symbol, rotate_angle, file_type);
+        error = plot_raster_default(symbol, rotate_angle, file_type, dest);
     }
 
     return error;
 }
 
+INTERNAL int plot_raster(struct zint_symbol *symbol, int rotate_angle, int file_type) {
+    return plot_raster_dest(symbol, rotate_angle, file_type, NULL /*dest*/);
+}
+
+/* Plot directly into caller-supplied buffer `dest` (`ZBarcode_Buffer_Into()`) */
+INTERNAL int plot_raster_into(struct zint_symbol *symbol, int rotate_angle, const struct out_raster_dest *dest) {
+    return plot_raster_dest(symbol, rotate_angle, OUT_BUFFER_DEST, dest);
+}
+
 /* vim: set ts=4 sw=4 et : */
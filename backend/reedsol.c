@@ -254,11 +254,11 @@ INTERNAL int rs_uint_init_gf(rs_uint_t *rs_uint, const unsigned int prime_poly,
     rs_uint->logt = NULL;
     rs_uint->alog = NULL;
 
-    if (!(logt = (unsigned int *) calloc(b, sizeof(unsigned int)))) {
+    if (!(logt = (unsigned int *) z_calloc(b, sizeof(unsigned int)))) {
         return 0;
     }
-    if (!(alog = (unsigned int *) calloc(b * 2, sizeof(unsigned int)))) {
-        free(logt);
+    if (!(alog = (unsigned int *) z_calloc(b * 2, sizeof(unsigned int)))) {
+        z_free(logt);
         return 0;
     }
 
@@ -364,11 +364,11 @@ INTERNAL void rs_uint_encode(const rs_uint_t *rs_uint, const int datalen, const
 
 INTERNAL void rs_uint_free(rs_uint_t *rs_uint) {
     if (rs_uint->logt) {
-        free(rs_uint->logt);
+        z_free(rs_uint->logt);
         rs_uint->logt = NULL;
     }
     if (rs_uint->alog) {
-        free(rs_uint->alog);
+        z_free(rs_uint->alog);
         rs_uint->alog = NULL;
     }
 }
@@ -30,9 +30,10 @@
 /* SPDX-License-Identifier: BSD-3-Clause */
 
 #include "testcommon.h"
+#include "../output.h"
 #include <sys/stat.h>
 
-INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf);
+INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, struct out_raster_rows *rows);
 
 static void test_pixel_plot(const testCtx *const p_ctx) {
     int debug = p_ctx->debug;
@@ -60,6 +61,7 @@ static void test_pixel_plot(const testCtx *const p_ctx) {
     const int data_size = ARRAY_SIZE(data);
     int i, ret;
     struct zint_symbol *symbol;
+    struct out_raster_rows rows;
 
     const char *bmp = "out.bmp";
 
@@ -99,7 +101,8 @@ static void test_pixel_plot(const testCtx *const p_ctx) {
 
         symbol->bitmap = (unsigned char *) data_buf;
 
-        ret = bmp_pixel_plot(symbol, TCU(data_buf));
+        (void) out_raster_rows_init(&rows, TCU(data_buf), symbol->bitmap_width, symbol->bitmap_height, 0.0f, 0);
+        ret = bmp_pixel_plot(symbol, &rows);
         assert_equal(ret, data[i].ret, "i:%d bmp_pixel_plot ret %d != %d (%s)\n", i, ret, data[i].ret, symbol->errtxt);
 
         if (ret < ZINT_ERROR) {
@@ -252,6 +255,7 @@ static void test_outfile(const testCtx *const p_ctx) {
     int skip_readonly_test = 0;
     struct zint_symbol symbol = {0};
     unsigned char data[] = { "1" };
+    struct out_raster_rows rows;
 
     (void)p_ctx;
 
@@ -260,6 +264,7 @@ static void test_outfile(const testCtx *const p_ctx) {
     symbol.symbology = BARCODE_CODE128;
     symbol.bitmap = data;
     symbol.bitmap_width = symbol.bitmap_height = 1;
+    (void) out_raster_rows_init(&rows, data, 1, 1, 0.0f, 0);
 
     strcpy(symbol.outfile, "test_bmp_out.bmp");
 #ifndef _WIN32
@@ -271,7 +276,7 @@ static void test_outfile(const testCtx *const p_ctx) {
         (void) testUtilRmROFile(symbol.outfile); /* In case lying around from previous fail */
         assert_nonzero(testUtilCreateROFile(symbol.outfile), "bmp_pixel_plot testUtilCreateROFile(%s) fail (%d: %s)\n", symbol.outfile, errno, strerror(errno));
 
-        ret = bmp_pixel_plot(&symbol, data);
+        ret = bmp_pixel_plot(&symbol, &rows);
         assert_equal(ret, ZINT_ERROR_FILE_ACCESS, "bmp_pixel_plot ret %d != ZINT_ERROR_FILE_ACCESS (%d) (%s)\n", ret, ZINT_ERROR_FILE_ACCESS, symbol.errtxt);
         assert_zero(testUtilRmROFile(symbol.outfile), "bmp_pixel_plot testUtilRmROFile(%s) != 0 (%d: %s)\n", symbol.outfile, errno, strerror(errno));
         assert_zero(strncmp(symbol.errtxt, expected_errtxt, sizeof(expected_errtxt) - 1), "strncmp(%s, %s) != 0\n", symbol.errtxt, expected_errtxt);
@@ -279,7 +284,7 @@ static void test_outfile(const testCtx *const p_ctx) {
 
     symbol.output_options |= BARCODE_STDOUT;
 
-    ret = bmp_pixel_plot(&symbol, data);
+    ret = bmp_pixel_plot(&symbol, &rows);
     printf(" - ignore (BMP to stdout)\n"); fflush(stdout);
     assert_zero(ret, "bmp_pixel_plot ret %d != 0 (%s)\n", ret, symbol.errtxt);
 
@@ -1061,6 +1061,73 @@ static void test_set_height(const testCtx *const p_ctx) {
 
 INTERNAL void debug_test_codeword_dump_int(struct zint_symbol *symbol, const int *codewords, const int length);
 
+static void test_module_row_runs(const testCtx *const p_ctx) {
+
+    struct item {
+        const char *pattern;
+        int width;
+        int ret;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { "0", 1, 0 },
+        /*  1*/ { "1", 1, 1 },
+        /*  2*/ { "10", 5, 3 },
+        /*  3*/ { "01", 64, 32 },
+        /*  4*/ { "1", 64, 1 },
+        /*  5*/ { "1", 65, 1 },
+        /*  6*/ { "0", 130, 0 },
+        /*  7*/ { "1", 1152, 1 },
+        /*  8*/ { "1100", 130, 33 },
+        /*  9*/ { "000000000011111111111111111111111111111111111111111111111111111111111111111111100", 400, 5 },
+        /* 10*/ { "1111111101010000", 1152, 216 }, /* PDF417 start */
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, j, k, ret;
+    struct zint_symbol symbol = {0};
+    int runs[1152 + 1];
+    char buf[1152 + 1];
+
+    testStart("test_module_row_runs");
+
+    for (i = 0; i < data_size; i++) {
+
+        if (testContinue(p_ctx, i)) continue;
+
+        memset(symbol.encoded_data[0], 0, sizeof(symbol.encoded_data[0]));
+        symbol.width = data[i].width;
+        testUtilStrCpyRepeat(buf, data[i].pattern, data[i].width);
+        for (j = 0; j < data[i].width; j++) {
+            if (buf[j] == '1') {
+                set_module(&symbol, 0, j);
+            }
+        }
+
+        ret = module_row_runs(&symbol, 0, runs);
+        assert_equal(ret, data[i].ret, "i:%d ret %d != %d\n", i, ret, data[i].ret);
+
+        /* Check runs cover the dark modules exactly */
+        for (j = 0, k = 0; k < ret; k++) {
+            assert_nonzero(runs[k << 1] >= j, "i:%d run %d start %d < %d\n", i, k, runs[k << 1], j);
+            assert_nonzero(runs[(k << 1) + 1] > 0, "i:%d run %d length %d <= 0\n", i, k, runs[(k << 1) + 1]);
+            for (; j < runs[k << 1]; j++) {
+                assert_equal(buf[j], '0', "i:%d run %d module %d '%c' != '0'\n", i, k, j, buf[j]);
+            }
+            for (; j < runs[k << 1] + runs[(k << 1) + 1]; j++) {
+                assert_equal(buf[j], '1', "i:%d run %d module %d '%c' != '1'\n", i, k, j, buf[j]);
+            }
+            if (j < data[i].width) {
+                assert_equal(buf[j], '0', "i:%d run %d end module %d '%c' != '0'\n", i, k, j, buf[j]);
+            }
+        }
+        for (; j < data[i].width; j++) {
+            assert_equal(buf[j], '0', "i:%d trailing module %d '%c' != '0'\n", i, j, buf[j]);
+        }
+    }
+
+    testFinish();
+}
+
 static void test_debug_test_codeword_dump_int(const testCtx *const p_ctx) {
     int debug = p_ctx->debug;
 
@@ -1115,6 +1182,7 @@ int main(int argc, char *argv[]) {
         { "test_hrt_printf_nochk", test_hrt_printf_nochk },
         { "test_hrt_conv_gs1_brackets_nochk", test_hrt_conv_gs1_brackets_nochk },
         { "test_set_height", test_set_height },
+        { "test_module_row_runs", test_module_row_runs },
         { "test_debug_test_codeword_dump_int", test_debug_test_codeword_dump_int },
     };
 
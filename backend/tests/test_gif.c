@@ -364,6 +364,258 @@ static void test_large_scale(const testCtx *const p_ctx) {
     testFinish();
 }
 
+/* Decode GIF `buf` of `size` bytes, checking it's `width` x `height`, placing the palette indexes in `pixels`.
+   Also sets `*p_clears` to the number of table resets (Clear codes after the first), `*p_collisions` to the number
+   of hash collisions when adding strings to the encoder's table (as GIF_HASH() in "gif.c", with single pixel runs
+   not hashed) and `*p_max_run` to the longest single pixel run emitted as one code. Returns 0 on success */
+static int test_gif_decode(const unsigned char *buf, const int size, const int width, const int height,
+            unsigned char *pixels, int *p_clears, int *p_collisions, int *p_max_run) {
+    unsigned short prefix[4096];
+    unsigned char suffix[4096];
+    unsigned char first[4096];
+    unsigned short length[4096];
+    short run_pixel[4096]; /* Pixel if string is a single pixel repeated, else -1 */
+    unsigned char hash_used[8192];
+    unsigned char *lzw;
+    int lzw_len = 0, lzw_pos = 0;
+    int pos, min_code_size, clear_code, code_size, next_code, prev = -1;
+    unsigned int bits = 0;
+    int bits_cnt = 0;
+    const int total = width * height;
+    int out = 0;
+    int i;
+
+    *p_clears = -1; /* Don't count the initial Clear code */
+    *p_collisions = 0;
+    *p_max_run = 0;
+
+    if (size < 13 || memcmp(buf, "GIF8", 4) != 0) return 1;
+    if ((buf[6] | (buf[7] << 8)) != width || (buf[8] | (buf[9] << 8)) != height) return 2;
+    pos = 13;
+    if (buf[10] & 0x80) {
+        pos += 3 * (2 << (buf[10] & 0x07)); /* Global Color Table */
+    }
+    while (pos < size && buf[pos] == '!') { /* Extensions */
+        pos += 2;
+        while (pos < size && buf[pos]) {
+            pos += buf[pos] + 1;
+        }
+        pos++;
+    }
+    if (pos + 11 > size || buf[pos] != ',') return 3;
+    if ((buf[pos + 5] | (buf[pos + 6] << 8)) != width || (buf[pos + 7] | (buf[pos + 8] << 8)) != height) return 4;
+    pos += 10;
+    min_code_size = buf[pos++];
+    if (min_code_size < 2 || min_code_size > 8) return 5;
+
+    /* Concatenate sub-blocks */
+    if (!(lzw = (unsigned char *) malloc(size))) return 6;
+    while (pos < size && buf[pos]) {
+        if (pos + 1 + buf[pos] > size) {
+            free(lzw);
+            return 7;
+        }
+        memcpy(lzw + lzw_len, buf + pos + 1, buf[pos]);
+        lzw_len += buf[pos];
+        pos += buf[pos] + 1;
+    }
+    if (pos + 2 != size || buf[pos + 1] != ';') {
+        free(lzw);
+        return 8;
+    }
+
+    clear_code = 1 << min_code_size;
+    code_size = min_code_size + 1;
+    next_code = clear_code + 2;
+    for (i = 0; i < clear_code; i++) {
+        prefix[i] = 0;
+        suffix[i] = first[i] = (unsigned char) i;
+        length[i] = 1;
+        run_pixel[i] = (short) i;
+    }
+    memset(hash_used, 0, sizeof(hash_used));
+
+    for (;;) {
+        int code;
+        while (bits_cnt < code_size) {
+            if (lzw_pos == lzw_len) {
+                free(lzw);
+                return 9; /* No End Of Information code */
+            }
+            bits |= (unsigned int) lzw[lzw_pos++] << bits_cnt;
+            bits_cnt += 8;
+        }
+        code = (int) (bits & ((1U << code_size) - 1));
+        bits >>= code_size;
+        bits_cnt -= code_size;
+
+        if (code == clear_code) {
+            code_size = min_code_size + 1;
+            next_code = clear_code + 2;
+            prev = -1;
+            memset(hash_used, 0, sizeof(hash_used));
+            (*p_clears)++;
+            continue;
+        }
+        if (code == clear_code + 1) {
+            break;
+        }
+        if (code > next_code || (prev == -1 && code >= clear_code)) {
+            free(lzw);
+            return 10;
+        }
+        if (prev != -1 && next_code < 4096) {
+            const unsigned char pixel = code == next_code ? first[prev] : first[code];
+            prefix[next_code] = (unsigned short) prev;
+            suffix[next_code] = pixel;
+            first[next_code] = first[prev];
+            length[next_code] = (unsigned short) (length[prev] + 1);
+            run_pixel[next_code] = (short) (run_pixel[prev] == pixel ? pixel : -1);
+            if (run_pixel[next_code] == -1) {
+                /* Simulate adding to encoder's open-addressed hash table */
+                const unsigned int key = ((unsigned int) prev << 4) | pixel;
+                unsigned int slot = ((key * 40503U) & 0xFFFF) >> 3;
+                if (hash_used[slot]) {
+                    (*p_collisions)++;
+                    do {
+                        slot = (slot + 1) & 0x1FFF;
+                    } while (hash_used[slot]);
+                }
+                hash_used[slot] = 1;
+            }
+            next_code++;
+            if (next_code == (1 << code_size) && code_size < 12) {
+                code_size++;
+            }
+        } else if (code == next_code) {
+            free(lzw);
+            return 11;
+        }
+        if (out + length[code] > total) {
+            free(lzw);
+            return 12;
+        }
+        if (run_pixel[code] != -1 && length[code] > *p_max_run) {
+            *p_max_run = length[code];
+        }
+        for (i = length[code] - 1, pos = code; i >= 0; i--, pos = prefix[pos]) {
+            pixels[out + i] = suffix[pos];
+        }
+        out += length[code];
+        prev = code;
+    }
+    free(lzw);
+
+    return out == total ? 0 : 13;
+}
+
+static void test_lzw_roundtrip(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int width;
+        int height;
+        int max_run; /* If non-zero, fill with runs of random pixel of random length 1 to `max_run`, else noise */
+
+        int min_clears;
+        int min_collisions;
+        int min_max_run;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, 1000, 1000, 0, 20, 10000, 10 }, /* High-entropy bilevel */
+        /*  1*/ { BARCODE_ULTRA, 700, 700, 0, 30, 10000, 3 }, /* High-entropy 8 colours */
+        /*  2*/ { BARCODE_CODE128, 3000, 3000, 9000000, 1, 0, 4000 }, /* Single run, table fills on run codes alone */
+        /*  3*/ { BARCODE_CODE128, 2000, 2000, 2000, 1, 100, 1000 }, /* Long runs */
+        /*  4*/ { BARCODE_ULTRA, 1000, 1000, 500, 1, 100, 250 }, /* Long runs 8 colours */
+        /*  5*/ { BARCODE_CODE128, 800, 600, 4, 5, 5000, 20 }, /* Short runs */
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, j, ret;
+    struct zint_symbol *symbol = NULL;
+
+    static const char ultra_chars[8] = { 'W', 'C', 'B', 'M', 'R', 'Y', 'G', 'K' };
+
+    testStart("test_lzw_roundtrip");
+
+    for (i = 0; i < data_size; i++) {
+        const int size = data[i].width * data[i].height;
+        const int colours = data[i].symbology == BARCODE_ULTRA ? 8 : 2;
+        unsigned int seed = 12345 + i;
+        unsigned char *pixelbuf, *expected, *decoded;
+        int clears, collisions, max_run;
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        symbol->symbology = data[i].symbology;
+        symbol->bitmap_width = data[i].width;
+        symbol->bitmap_height = data[i].height;
+        symbol->output_options |= BARCODE_MEMORY_FILE;
+        symbol->debug |= debug;
+
+        pixelbuf = (unsigned char *) malloc(size);
+        expected = (unsigned char *) malloc(size);
+        decoded = (unsigned char *) malloc(size);
+        assert_nonnull(pixelbuf, "i:%d malloc pixelbuf NULL\n", i);
+        assert_nonnull(expected, "i:%d malloc expected NULL\n", i);
+        assert_nonnull(decoded, "i:%d malloc decoded NULL\n", i);
+
+        for (j = 0; j < size;) {
+            int len = 1, k, pixel;
+            seed = seed * 1103515245 + 12345;
+            pixel = (int) ((seed >> 16) % colours);
+            if (data[i].max_run) {
+                seed = seed * 1103515245 + 12345;
+                len = 1 + (int) ((seed >> 8) % data[i].max_run);
+                if (len > size - j) {
+                    len = size - j;
+                }
+            }
+            for (k = 0; k < len; k++, j++) {
+                expected[j] = (unsigned char) pixel;
+                pixelbuf[j] = colours == 8 ? ultra_chars[pixel] : (unsigned char) ('0' + pixel);
+            }
+        }
+
+        ret = gif_pixel_plot(symbol, pixelbuf);
+        assert_zero(ret, "i:%d gif_pixel_plot ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+        assert_nonnull(symbol->memfile, "i:%d memfile NULL\n", i);
+
+        ret = test_gif_decode(symbol->memfile, symbol->memfile_size, data[i].width, data[i].height, decoded,
+                                &clears, &collisions, &max_run);
+        assert_zero(ret, "i:%d test_gif_decode ret %d != 0\n", i, ret);
+
+        if (debug & ZINT_DEBUG_TEST_PRINT) {
+            printf("i:%d size %d, memfile_size %d, clears %d, collisions %d, max_run %d\n",
+                    i, size, symbol->memfile_size, clears, collisions, max_run);
+        }
+
+        j = 0;
+        while (j < size && decoded[j] == expected[j]) {
+            j++;
+        }
+        assert_equal(j, size, "i:%d decoded[%d] %d != expected %d\n", i, j, j < size ? decoded[j] : -1,
+                    j < size ? expected[j] : -1);
+
+        assert_nonzero(clears >= data[i].min_clears, "i:%d clears %d < %d\n", i, clears, data[i].min_clears);
+        assert_nonzero(collisions >= data[i].min_collisions, "i:%d collisions %d < %d\n",
+                    i, collisions, data[i].min_collisions);
+        assert_nonzero(max_run >= data[i].min_max_run, "i:%d max_run %d < %d\n", i, max_run, data[i].min_max_run);
+
+        free(decoded);
+        free(expected);
+        free(pixelbuf);
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
 static void test_too_big(const testCtx *const p_ctx) {
     int debug = p_ctx->debug;
 
@@ -400,6 +652,7 @@ int main(int argc, char *argv[]) {
         { "test_print", test_print },
         { "test_outfile", test_outfile },
         { "test_large_scale", test_large_scale },
+        { "test_lzw_roundtrip", test_lzw_roundtrip },
         { "test_too_big", test_too_big },
     };
 
@@ -846,6 +846,83 @@ static void test_escape_char_process_test(const testCtx *const p_ctx) {
     testFinish();
 }
 
+static void test_unescape(const testCtx *const p_ctx) {
+
+    struct item {
+        int symbology;
+        int input_mode;
+        const char *data;
+        int length;
+        int ret;
+        const char *expected;
+        int expected_len;
+        const char *expected_errtxt;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, -1, "BLANK", -1, 0, "BLANK", 5, "" },
+        /*  1*/ { BARCODE_CODE128, -1, "", -1, 0, "", 0, "" },
+        /*  2*/ { BARCODE_QRCODE, -1, "A\\0\\E\\a\\b\\t\\n\\v\\f\\r\\e\\G\\R\\x81\\\\\\o201\\d255B", -1, 0, "A\000\004\a\b\t\n\v\f\r\033\035\036\201\\\201\377B", 18, "" },
+        /*  3*/ { BARCODE_QRCODE, -1, "\\u007F\\u0080\\u011E\\u13C9\\U010283", -1, 0, "\177\302\200\304\236\341\217\211\360\220\212\203", 12, "" },
+        /*  4*/ { BARCODE_QRCODE, -1, "ABC\\x41DEF", 9, 0, "ABCADE", 6, "" }, /* Length respected */
+        /*  5*/ { BARCODE_CODE128, EXTRA_ESCAPE_MODE, "\\^A\\^^\\^B", -1, 0, "\\^A\\^^\\^B", 9, "" },
+        /*  6*/ { BARCODE_CODE128, -1, "\\^A", -1, ZINT_ERROR_INVALID_DATA, "", 0, "Error 798: Escape '\\^' only valid for Code 128 in extra escape mode" },
+        /*  7*/ { BARCODE_QRCODE, EXTRA_ESCAPE_MODE, "\\^A", -1, ZINT_ERROR_INVALID_DATA, "", 0, "Error 798: Escape '\\^' only valid for Code 128 in extra escape mode" },
+        /*  8*/ { BARCODE_QRCODE, -1, "AB\\\\", -1, 0, "AB\\", 3, "" },
+        /*  9*/ { BARCODE_QRCODE, -1, "AB\\\\\\", -1, ZINT_ERROR_INVALID_DATA, "", 0, "Error 236: Incomplete escape character in input" },
+        /* 10*/ { BARCODE_QRCODE, -1, "\\q", -1, ZINT_ERROR_INVALID_DATA, "", 0, "Error 234: Unrecognised escape character '\\q' in input" },
+        /* 11*/ { BARCODE_QRCODE, -1, "\\x4", -1, ZINT_ERROR_INVALID_DATA, "", 0, "Error 232: Incomplete '\\x' escape sequence in input" },
+        /* 12*/ { BARCODE_QRCODE, -1, "\\uD800", -1, ZINT_ERROR_INVALID_DATA, "", 0, "Error 246: Value of escape sequence '\\uD800' in input out of range" },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    int dest_len;
+    unsigned char dest[1024];
+
+    testStart("test_unescape");
+
+    ret = ZBarcode_Unescape(NULL, TCU("A"), 1, dest, &dest_len);
+    assert_equal(ret, ZINT_ERROR_INVALID_DATA, "ZBarcode_Unescape(NULL) ret %d != ZINT_ERROR_INVALID_DATA\n", ret);
+
+    for (i = 0; i < data_size; i++) {
+
+        struct zint_symbol s_symbol = {0};
+        struct zint_symbol *symbol = &s_symbol;
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol->symbology = data[i].symbology;
+        if (data[i].input_mode != -1) {
+            symbol->input_mode = data[i].input_mode;
+        }
+        length = data[i].length == -1 ? (int) strlen(data[i].data) : data[i].length;
+
+        if (i == 0) {
+            ret = ZBarcode_Unescape(symbol, TCU(data[i].data), length, NULL, &dest_len);
+            assert_equal(ret, ZINT_ERROR_INVALID_DATA, "i:%d ZBarcode_Unescape(NULL dest) ret %d != ZINT_ERROR_INVALID_DATA\n", i, ret);
+            assert_zero(strcmp(symbol->errtxt, "Error 215: Unescape source, destination or length NULL"), "i:%d errtxt %s\n", i, symbol->errtxt);
+            symbol->errtxt[0] = '\0';
+        }
+
+        /* Exactly `length` + 1 with sentinel following */
+        memset(dest, 0xDD, sizeof(dest));
+        dest_len = -1;
+        ret = ZBarcode_Unescape(symbol, TCU(data[i].data), length, dest, &dest_len);
+        assert_equal(ret, data[i].ret, "i:%d ZBarcode_Unescape ret %d != %d (%s)\n", i, ret, data[i].ret, symbol->errtxt);
+        assert_zero(strcmp(symbol->errtxt, data[i].expected_errtxt), "i:%d errtxt %s != %s\n", i, symbol->errtxt, data[i].expected_errtxt);
+        if (ret == 0) {
+            assert_equal(dest_len, data[i].expected_len, "i:%d dest_len %d != %d\n", i, dest_len, data[i].expected_len);
+            assert_zero(memcmp(dest, data[i].expected, dest_len), "i:%d memcmp() != 0\n", i);
+            assert_zero(dest[dest_len], "i:%d dest[%d] not NUL-terminated (0x%X)\n", i, dest_len, dest[dest_len]);
+        } else {
+            assert_equal(dest_len, -1, "i:%d dest_len %d != -1\n", i, dest_len);
+        }
+        assert_equal(dest[length + 1], 0xDD, "i:%d dest[%d] 0x%X != 0xDD\n", i, length + 1, dest[length + 1]);
+    }
+
+    testFinish();
+}
+
 static void test_cap(const testCtx *const p_ctx) {
 
     struct item {
@@ -1979,6 +2056,119 @@ static void test_reset(const testCtx *const p_ctx) {
     testFinish();
 }
 
+static void test_retain_buffers(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        const char *fgcolour;
+        const char *data;
+        int use_memfile;
+        int expected_realloc; /* Whether expect buffer to have been reallocated */
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_QRCODE, "", "12345678901234567890", 0, 1 },
+        /*  1*/ { BARCODE_QRCODE, "", "1234", 0, 0 }, /* Smaller so re-used */
+        /*  2*/ { BARCODE_DATAMATRIX, "", "1234", 0, 0 },
+        /*  3*/ { BARCODE_QRCODE, "", "12345678901234567890", 0, 0 }, /* Same size as first */
+        /*  4*/ { BARCODE_QRCODE, "", "123456789012345678901234567890123456789012345678901234567890", 0, 1 }, /* Bigger */
+        /*  5*/ { BARCODE_QRCODE, "00000080", "1234", 0, 0 }, /* Alphamap allocated */
+        /*  6*/ { BARCODE_QRCODE, "00000080", "1234", 0, 0 }, /* Alphamap re-used */
+        /*  7*/ { BARCODE_QRCODE, "", "1234", 1, 1 },
+        /*  8*/ { BARCODE_QRCODE, "", "1234", 1, 0 }, /* Memfile re-used */
+        /*  9*/ { BARCODE_QRCODE, "", "12345678901234567890", 1, 0 },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol = NULL;
+    unsigned char *prev_buf = NULL;
+    unsigned char *prev_alphamap = NULL;
+    int prev_capacity = 0;
+
+    testStartSymbol("test_retain_buffers", &symbol);
+
+    symbol = ZBarcode_Create();
+    assert_nonnull(symbol, "Symbol not created\n");
+
+    for (i = 0; i < data_size; i++) {
+        unsigned char *buf;
+        int capacity;
+
+        if (testContinue(p_ctx, i)) continue;
+
+        ZBarcode_Clear(symbol);
+        if (data[i].use_memfile) {
+            assert_zero(symbol->memfile_size, "i:%d memfile_size %d != 0\n", i, symbol->memfile_size);
+        } else {
+            assert_zero(symbol->bitmap_width, "i:%d bitmap_width %d != 0\n", i, symbol->bitmap_width);
+            assert_zero(symbol->bitmap_height, "i:%d bitmap_height %d != 0\n", i, symbol->bitmap_height);
+        }
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, 0 /*option_1*/, 0, 0,
+                                    BARCODE_RETAIN_BUFFERS | (data[i].use_memfile ? BARCODE_MEMORY_FILE : 0),
+                                    data[i].data, -1, debug);
+        strcpy(symbol->fgcolour, data[i].fgcolour[0] ? data[i].fgcolour : "000000");
+        strcpy(symbol->outfile, "mem.bmp");
+
+        if (data[i].use_memfile) {
+            ret = ZBarcode_Encode_and_Print(symbol, TCU(data[i].data), length, 0);
+            assert_zero(ret, "i:%d ZBarcode_Encode_and_Print ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+            buf = symbol->memfile;
+            capacity = symbol->memfile_capacity;
+            assert_nonzero(symbol->memfile_size <= capacity, "i:%d memfile_size %d > capacity %d\n",
+                        i, symbol->memfile_size, capacity);
+        } else {
+            ret = ZBarcode_Encode_and_Buffer(symbol, TCU(data[i].data), length, 0);
+            assert_zero(ret, "i:%d ZBarcode_Encode_and_Buffer ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+            buf = symbol->bitmap;
+            capacity = symbol->bitmap_capacity;
+            assert_nonzero(symbol->bitmap_width * symbol->bitmap_height * 3 <= capacity,
+                        "i:%d bitmap size %d > capacity %d\n",
+                        i, symbol->bitmap_width * symbol->bitmap_height * 3, capacity);
+            if (data[i].fgcolour[0]) {
+                assert_nonnull(symbol->alphamap, "i:%d alphamap NULL\n", i);
+                assert_nonzero(symbol->bitmap_width * symbol->bitmap_height <= symbol->alphamap_capacity,
+                            "i:%d alphamap size %d > capacity %d\n",
+                            i, symbol->bitmap_width * symbol->bitmap_height, symbol->alphamap_capacity);
+                if (prev_alphamap) {
+                    assert_equal(symbol->alphamap == prev_alphamap, 1, "i:%d alphamap reallocated\n", i);
+                }
+                prev_alphamap = symbol->alphamap;
+            } else {
+                assert_null(symbol->alphamap, "i:%d alphamap not NULL\n", i);
+                assert_zero(symbol->alphamap_capacity, "i:%d alphamap_capacity %d != 0\n",
+                            i, symbol->alphamap_capacity);
+            }
+        }
+        assert_nonnull(buf, "i:%d buf NULL\n", i);
+        if (!data[i].expected_realloc) {
+            assert_equal(buf == prev_buf, 1, "i:%d buffer reallocated\n", i);
+            assert_equal(capacity, prev_capacity, "i:%d capacity %d != prev_capacity %d\n",
+                        i, capacity, prev_capacity);
+        } else {
+            assert_nonzero(capacity > prev_capacity || data[i].use_memfile,
+                        "i:%d capacity %d <= prev_capacity %d\n", i, capacity, prev_capacity);
+        }
+        prev_buf = buf;
+        prev_capacity = capacity;
+    }
+
+    /* Without retain, `ZBarcode_Clear()` frees buffers */
+    symbol->output_options &= ~BARCODE_RETAIN_BUFFERS;
+    ZBarcode_Clear(symbol);
+    assert_null(symbol->bitmap, "bitmap not NULL\n");
+    assert_null(symbol->alphamap, "alphamap not NULL\n");
+    assert_null(symbol->memfile, "memfile not NULL\n");
+    assert_zero(symbol->bitmap_capacity, "bitmap_capacity %d != 0\n", symbol->bitmap_capacity);
+    assert_zero(symbol->alphamap_capacity, "alphamap_capacity %d != 0\n", symbol->alphamap_capacity);
+    assert_zero(symbol->memfile_capacity, "memfile_capacity %d != 0\n", symbol->memfile_capacity);
+
+    ZBarcode_Delete(symbol);
+
+    testFinish();
+}
+
 static void test_scale_from_xdimdp(const testCtx *const p_ctx) {
 
     struct item {
@@ -2287,6 +2477,832 @@ static void test_utf8_to_eci(const testCtx *const p_ctx) {
     testFinish();
 }
 
+static void test_prepare(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int input_mode;
+        int option_1;
+        int option_2;
+        float scale;
+        const char *fgcolour;
+        int ret_prepare;
+        const char *expected_errtxt;
+        const char *data[3];
+        int ret[3];
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_QRCODE, -1, -1, -1, 0.0f, "", ZINT_ERROR_INVALID_OPTION, "Error 227: Scale out of range (0.01 to 200)", { "" }, { 0 } },
+        /*  1*/ { BARCODE_QRCODE, -1, -1, -1, -1, "GGGGGG", ZINT_ERROR_INVALID_OPTION, "Error 881: Malformed foreground RGB colour 'GGGGGG' (hexadecimal only)", { "" }, { 0 } },
+        /*  2*/ { BARCODE_QRCODE, 3, -1, -1, -1, "", ZINT_WARN_INVALID_OPTION, "Warning 212: Invalid input mode - reset to DATA_MODE", { "1234", "12345678901234567890123456789012345678901234567890", "A" }, { ZINT_WARN_INVALID_OPTION, ZINT_WARN_INVALID_OPTION, ZINT_WARN_INVALID_OPTION } },
+        /*  3*/ { BARCODE_QRCODE, -1, -1, -1, -1, "", 0, "", { "1234", "12345678901234567890123456789012345678901234567890", "A" }, { 0, 0, 0 } }, /* Version (`option_2`) restored */
+        /*  4*/ { BARCODE_CODE16K, -1, -1, -1, -1, "", 0, "", { "1234", "1234567890ABCDEFGHIJKLMNOPQRSTUVWXYZ", "1" }, { 0, 0, 0 } }, /* Rows (`option_1`) restored */
+        /*  5*/ { BARCODE_DATAMATRIX, GS1_MODE, -1, -1, -1, "", 0, "", { "[01]12345678901231", "[01]12345678901234", "A" }, { 0, ZINT_WARN_NONCOMPLIANT, ZINT_ERROR_INVALID_DATA } },
+        /*  6*/ { BARCODE_CODE128, GS1_MODE, -1, -1, -1, "", ZINT_ERROR_INVALID_OPTION, "Error 220: Selected symbology does not support GS1 mode", { "" }, { 0 } },
+        /*  7*/ { 200, -1, -1, -1, -1, "", ZINT_WARN_INVALID_OPTION, "Warning 206: Symbology out of range", { "1234", "", "" }, { ZINT_WARN_INVALID_OPTION } },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, j, r, c, length, ret;
+    struct zint_symbol *symbol = NULL;
+    struct zint_symbol *expected = NULL;
+    struct zint_prepared *prepared;
+
+    testStartSymbol("test_prepare", &symbol);
+
+    ret = ZBarcode_Prepare(NULL, &prepared);
+    assert_equal(ret, ZINT_ERROR_INVALID_DATA, "ZBarcode_Prepare(NULL) ret %d != ZINT_ERROR_INVALID_DATA\n", ret);
+    ret = ZBarcode_Encode_Prepared(NULL, TCU("1234"), 4);
+    assert_equal(ret, ZINT_ERROR_INVALID_DATA, "ZBarcode_Encode_Prepared(NULL) ret %d != ZINT_ERROR_INVALID_DATA\n",
+                ret);
+    ZBarcode_Prepared_Free(NULL); /* Does nothing */
+
+    for (i = 0; i < data_size; i++) {
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        (void) testUtilSetSymbol(symbol, data[i].symbology, data[i].input_mode, -1 /*eci*/,
+                                    data[i].option_1, data[i].option_2, -1, -1 /*output_options*/,
+                                    "", -1, debug);
+        if (data[i].scale != -1) {
+            symbol->scale = data[i].scale;
+        }
+        if (data[i].fgcolour[0]) {
+            strcpy(symbol->fgcolour, data[i].fgcolour);
+        }
+
+        if (i == 0) {
+            ret = ZBarcode_Prepare(symbol, NULL);
+            assert_equal(ret, ZINT_ERROR_INVALID_DATA, "i:%d ZBarcode_Prepare(NULL) ret %d != ZINT_ERROR_INVALID_DATA\n",
+                        i, ret);
+            assert_zero(strcmp(symbol->errtxt, "Error 213: Prepared handle pointer NULL"),
+                        "i:%d errtxt %s != Error 213: Prepared handle pointer NULL\n", i, symbol->errtxt);
+        }
+
+        ret = ZBarcode_Prepare(symbol, &prepared);
+        assert_equal(ret, data[i].ret_prepare, "i:%d ZBarcode_Prepare ret %d != %d (%s)\n",
+                    i, ret, data[i].ret_prepare, symbol->errtxt);
+        assert_zero(strcmp(symbol->errtxt, data[i].expected_errtxt), "i:%d errtxt %s != %s\n",
+                    i, symbol->errtxt, data[i].expected_errtxt);
+        if (ret >= ZINT_ERROR) {
+            assert_null(prepared, "i:%d prepared not NULL\n", i);
+            ZBarcode_Delete(symbol);
+            continue;
+        }
+        assert_nonnull(prepared, "i:%d prepared NULL\n", i);
+
+        for (j = 0; j < ARRAY_SIZE(data[i].data) && data[i].data[j][0]; j++) {
+            ret = ZBarcode_Encode_Prepared(prepared, TCU(data[i].data[j]), -1);
+            assert_equal(ret, data[i].ret[j], "i:%d j:%d ZBarcode_Encode_Prepared ret %d != %d (%s)\n",
+                        i, j, ret, data[i].ret[j], symbol->errtxt);
+
+            /* Compare with unprepared encode */
+            expected = ZBarcode_Create();
+            assert_nonnull(expected, "Symbol not created\n");
+            length = testUtilSetSymbol(expected, data[i].symbology, data[i].input_mode, -1 /*eci*/,
+                                        data[i].option_1, data[i].option_2, -1, -1 /*output_options*/,
+                                        data[i].data[j], -1, debug);
+            ret = ZBarcode_Encode(expected, TCU(data[i].data[j]), length);
+            assert_equal(ret, data[i].ret[j], "i:%d j:%d ZBarcode_Encode ret %d != %d (%s)\n",
+                        i, j, ret, data[i].ret[j], expected->errtxt);
+            assert_zero(strcmp(symbol->errtxt, expected->errtxt), "i:%d j:%d errtxt %s != %s\n",
+                        i, j, symbol->errtxt, expected->errtxt);
+            assert_equal(symbol->rows, expected->rows, "i:%d j:%d rows %d != %d\n",
+                        i, j, symbol->rows, expected->rows);
+            assert_equal(symbol->width, expected->width, "i:%d j:%d width %d != %d\n",
+                        i, j, symbol->width, expected->width);
+            for (r = 0; r < symbol->rows; r++) {
+                for (c = 0; c < symbol->width; c++) {
+                    assert_equal(module_is_set(symbol, r, c), module_is_set(expected, r, c),
+                                "i:%d j:%d module (%d, %d) %d != %d\n",
+                                i, j, r, c, module_is_set(symbol, r, c), module_is_set(expected, r, c));
+                }
+            }
+            ZBarcode_Delete(expected);
+        }
+
+        ZBarcode_Prepared_Free(prepared);
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+static void test_encode_cache(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int input_mode;
+        int option_1;
+        int option_2;
+        const char *data;
+        int ret;
+        const char *expected_errtxt;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_QRCODE, -1, -1, -1, "1234567890ABCDEFGHIJ", 0, "" },
+        /*  1*/ { BARCODE_QRCODE, -1, 4, -1, "1234567890ABCDEFGHIJ", 0, "" }, /* Differs by option_1 */
+        /*  2*/ { BARCODE_QRCODE, -1, -1, 5, "1234567890ABCDEFGHIJ", 0, "" }, /* Differs by option_2 */
+        /*  3*/ { BARCODE_MICROQR, -1, -1, -1, "1234567890ABCDEFGHIJ", 0, "" }, /* Differs by symbology */
+        /*  4*/ { BARCODE_DATAMATRIX, GS1_MODE, -1, -1, "[01]12345678901231", 0, "" },
+        /*  5*/ { BARCODE_DATAMATRIX, GS1_MODE, -1, -1, "[01]12345678901234", ZINT_WARN_NONCOMPLIANT, "Warning 261: AI (01) position 14: Bad checksum '4', expected '1'" },
+        /*  6*/ { BARCODE_DATAMATRIX, GS1_MODE | ESCAPE_MODE, -1, -1, "[01]12345678901231", 0, "" }, /* Differs by input_mode */
+        /*  7*/ { BARCODE_EANX, -1, -1, -1, "123456789012A", ZINT_ERROR_INVALID_DATA, "Error 284: Invalid character at position 13 in input (digits and \"+\" only)" },
+        /*  8*/ { BARCODE_ULTRA, -1, -1, -1, "1234567890ABCDEFGHIJ", 0, "" },
+        /*  9*/ { BARCODE_CODE16K, -1, -1, -1, "1234567890ABCDEFGHIJ", 0, "" }, /* Sets `output_options`, `border_width` */
+        /* 10*/ { BARCODE_PDF417, -1, -1, -1, "1234567890ABCDEFGHIJ", 0, "" },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    struct zint_symbol *expected[ARRAY_SIZE(data)];
+    struct zint_symbol *symbols[ARRAY_SIZE(data)];
+    struct zint_batch items[ARRAY_SIZE(data)];
+    struct zint_symbol *symbol;
+    int i, j, r, pass, length, ret;
+
+    testStart("test_encode_cache");
+
+    ret = ZBarcode_SetEncodeCache(-1);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_SetEncodeCache(-1) ret %d != ZINT_ERROR_INVALID_OPTION\n",
+                ret);
+    ret = ZBarcode_SetEncodeCache(0x100001);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION,
+                "ZBarcode_SetEncodeCache(0x100001) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+
+    /* Uncached results */
+    for (i = 0; i < data_size; i++) {
+        expected[i] = ZBarcode_Create();
+        assert_nonnull(expected[i], "i:%d Symbol not created\n", i);
+        length = testUtilSetSymbol(expected[i], data[i].symbology, data[i].input_mode, -1 /*eci*/,
+                                    data[i].option_1, data[i].option_2, -1, -1 /*output_options*/,
+                                    data[i].data, -1, debug);
+        ret = ZBarcode_Encode(expected[i], TCU(data[i].data), length);
+        assert_equal(ret, data[i].ret, "i:%d ZBarcode_Encode ret %d != %d (%s)\n",
+                    i, ret, data[i].ret, expected[i]->errtxt);
+        assert_zero(strcmp(expected[i]->errtxt, data[i].expected_errtxt), "i:%d errtxt %s != %s\n",
+                    i, expected[i]->errtxt, data[i].expected_errtxt);
+    }
+
+    /* Small so that entries evicted */
+    ret = ZBarcode_SetEncodeCache(4);
+    assert_zero(ret, "ZBarcode_SetEncodeCache(4) ret %d != 0\n", ret);
+
+    /* 3 passes, 3rd via batch */
+    for (pass = 0; pass < 3; pass++) {
+        for (i = 0; i < data_size; i++) {
+            symbols[i] = ZBarcode_Create();
+            assert_nonnull(symbols[i], "pass:%d i:%d Symbol not created\n", pass, i);
+            length = testUtilSetSymbol(symbols[i], data[i].symbology, data[i].input_mode, -1 /*eci*/,
+                                        data[i].option_1, data[i].option_2, -1, -1 /*output_options*/,
+                                        data[i].data, -1, debug);
+            if (pass < 2) {
+                ret = ZBarcode_Encode(symbols[i], TCU(data[i].data), length);
+                assert_equal(ret, data[i].ret, "pass:%d i:%d ZBarcode_Encode ret %d != %d (%s)\n",
+                            pass, i, ret, data[i].ret, symbols[i]->errtxt);
+            } else {
+                memset(items + i, 0, sizeof(items[i]));
+                items[i].symbol = symbols[i];
+                items[i].source = TCU(data[i].data);
+                items[i].length = length;
+            }
+        }
+        if (pass == 2) {
+            (void) ZBarcode_Encode_Batch(items, data_size, ZINT_BATCH_ENCODE, 0, 3 /*num_threads*/);
+        }
+        for (i = 0; i < data_size; i++) {
+            symbol = symbols[i];
+            if (pass == 2) {
+                assert_equal(items[i].ret, data[i].ret, "pass:%d i:%d items[i].ret %d != %d (%s)\n",
+                            pass, i, items[i].ret, data[i].ret, symbol->errtxt);
+            }
+            assert_zero(strcmp(symbol->errtxt, expected[i]->errtxt), "pass:%d i:%d errtxt %s != %s\n",
+                        pass, i, symbol->errtxt, expected[i]->errtxt);
+            assert_equal(symbol->rows, expected[i]->rows, "pass:%d i:%d rows %d != %d\n",
+                        pass, i, symbol->rows, expected[i]->rows);
+            assert_equal(symbol->width, expected[i]->width, "pass:%d i:%d width %d != %d\n",
+                        pass, i, symbol->width, expected[i]->width);
+            assert_equal(symbol->option_1, expected[i]->option_1, "pass:%d i:%d option_1 %d != %d\n",
+                        pass, i, symbol->option_1, expected[i]->option_1);
+            assert_equal(symbol->option_2, expected[i]->option_2, "pass:%d i:%d option_2 %d != %d\n",
+                        pass, i, symbol->option_2, expected[i]->option_2);
+            assert_equal(symbol->output_options, expected[i]->output_options,
+                        "pass:%d i:%d output_options 0x%X != 0x%X\n",
+                        pass, i, symbol->output_options, expected[i]->output_options);
+            assert_equal(symbol->border_width, expected[i]->border_width, "pass:%d i:%d border_width %d != %d\n",
+                        pass, i, symbol->border_width, expected[i]->border_width);
+            assert_equal(symbol->height, expected[i]->height, "pass:%d i:%d height %g != %g\n",
+                        pass, i, symbol->height, expected[i]->height);
+            assert_equal(symbol->text_length, expected[i]->text_length, "pass:%d i:%d text_length %d != %d\n",
+                        pass, i, symbol->text_length, expected[i]->text_length);
+            assert_zero(memcmp(symbol->text, expected[i]->text, symbol->text_length),
+                        "pass:%d i:%d text %s != %s\n", pass, i, symbol->text, expected[i]->text);
+            for (r = 0; r < symbol->rows; r++) {
+                assert_equal(symbol->row_height[r], expected[i]->row_height[r],
+                            "pass:%d i:%d row_height[%d] %g != %g\n",
+                            pass, i, r, symbol->row_height[r], expected[i]->row_height[r]);
+                for (j = 0; j < symbol->width; j++) {
+                    const int module = data[i].symbology == BARCODE_ULTRA ? module_colour_is_set(symbol, r, j)
+                                        : module_is_set(symbol, r, j);
+                    const int expected_module = data[i].symbology == BARCODE_ULTRA
+                                        ? module_colour_is_set(expected[i], r, j) : module_is_set(expected[i], r, j);
+                    assert_equal(module, expected_module, "pass:%d i:%d module (%d, %d) %d != %d\n",
+                                pass, i, r, j, module, expected_module);
+                }
+            }
+            ZBarcode_Delete(symbol);
+        }
+    }
+
+    ret = ZBarcode_SetEncodeCache(0);
+    assert_zero(ret, "ZBarcode_SetEncodeCache(0) ret %d != 0\n", ret);
+
+    for (i = 0; i < data_size; i++) {
+        ZBarcode_Delete(expected[i]);
+    }
+
+    testFinish();
+}
+
+static void test_encode_batch(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int input_mode;
+        const char *data;
+        int ret;
+        const char *expected_errtxt;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, -1, "1234", 0, "" },
+        /*  1*/ { BARCODE_QRCODE, -1, "1234567890ABCDEFGHIJ", 0, "" },
+        /*  2*/ { BARCODE_EANX, -1, "123456789012A", ZINT_ERROR_INVALID_DATA, "Error 284: Invalid character at position 13 in input (digits and \"+\" only)" },
+        /*  3*/ { BARCODE_DATAMATRIX, -1, "[01]12345678901231", 0, "" },
+        /*  4*/ { BARCODE_DATAMATRIX, GS1_MODE, "[01]12345678901234", ZINT_WARN_NONCOMPLIANT, "Warning 261: AI (01) position 14: Bad checksum '4', expected '1'" },
+        /*  5*/ { BARCODE_MAXICODE, -1, "ABCDEFGHIJKLMNOPQRSTUVWXYZ", 0, "" },
+        /*  6*/ { BARCODE_AZTEC, -1, "1234567890", 0, "" },
+        /*  7*/ { BARCODE_PDF417, -1, "ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890", 0, "" },
+        /*  8*/ { BARCODE_CODE39, -1, "AB_C", ZINT_ERROR_INVALID_DATA, "Error 324: Invalid character at position 3 in input (alphanumerics, space and \"-.$/+%\" only)" },
+        /*  9*/ { BARCODE_DOTCODE, -1, "1234567890", 0, "" },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    static const int actions[] = {
+        ZINT_BATCH_ENCODE, ZINT_BATCH_BUFFER, ZINT_BATCH_BUFFER_VECTOR
+    };
+    static const int threads[] = { 1, 3, 0 };
+    struct zint_batch items[ARRAY_SIZE(data)];
+    struct zint_seg segs[ARRAY_SIZE(data)];
+    struct zint_symbol *symbols[ARRAY_SIZE(data)];
+    struct zint_symbol *symbol;
+    int i, a, t, ret;
+    int expected_ret;
+
+    testStart("test_encode_batch");
+
+    /* Bad args */
+    memset(items, 0, sizeof(items));
+    ret = ZBarcode_Encode_Batch(NULL, 1, ZINT_BATCH_ENCODE, 0, 0);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_Encode_Batch(NULL) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+    ret = ZBarcode_Encode_Batch(items, 0, ZINT_BATCH_ENCODE, 0, 0);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_Encode_Batch(0) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+    ret = ZBarcode_Encode_Batch(items, 1, -1, 0, 0);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_Encode_Batch(action -1) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+    ret = ZBarcode_Encode_Batch(items, 1, ZINT_BATCH_PRINT + 1, 0, 0);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_Encode_Batch(action %d) ret %d != ZINT_ERROR_INVALID_OPTION\n", ZINT_BATCH_PRINT + 1, ret);
+    ret = ZBarcode_Encode_Batch(items, 1, ZINT_BATCH_ENCODE, 0, 0); /* NULL symbol */
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_Encode_Batch(NULL symbol) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+    assert_equal(items[0].ret, ZINT_ERROR_INVALID_OPTION, "items[0].ret %d != ZINT_ERROR_INVALID_OPTION\n", items[0].ret);
+
+    expected_ret = 0;
+    for (i = 0; i < data_size; i++) {
+        if (data[i].ret > expected_ret) {
+            expected_ret = data[i].ret;
+        }
+    }
+
+    for (a = 0; a < ARRAY_SIZE(actions); a++) {
+        for (t = 0; t < ARRAY_SIZE(threads); t++) {
+
+            if (testContinue(p_ctx, a * ARRAY_SIZE(threads) + t)) continue;
+
+            memset(items, 0, sizeof(items));
+            for (i = 0; i < data_size; i++) {
+                symbols[i] = ZBarcode_Create();
+                assert_nonnull(symbols[i], "a:%d t:%d i:%d Symbol not created\n", a, t, i);
+
+                (void) testUtilSetSymbol(symbols[i], data[i].symbology, data[i].input_mode, -1 /*eci*/,
+                                        -1 /*option_1*/, -1, -1, -1 /*output_options*/, data[i].data, -1, debug);
+                items[i].symbol = symbols[i];
+                if (i & 1) { /* Use segs for odd items */
+                    segs[i].source = TU(data[i].data);
+                    segs[i].length = -1;
+                    segs[i].eci = 0;
+                    items[i].segs = segs + i;
+                    items[i].seg_count = 1;
+                } else {
+                    items[i].source = TCU(data[i].data);
+                    items[i].length = -1;
+                }
+            }
+
+            ret = ZBarcode_Encode_Batch(items, data_size, actions[a], 0, threads[t]);
+            assert_equal(ret, expected_ret, "a:%d t:%d ZBarcode_Encode_Batch ret %d != %d\n",
+                        a, t, ret, expected_ret);
+
+            for (i = 0; i < data_size; i++) {
+                assert_equal(items[i].ret, data[i].ret, "a:%d t:%d i:%d items[i].ret %d != %d (%s)\n",
+                            a, t, i, items[i].ret, data[i].ret, symbols[i]->errtxt);
+                assert_zero(strcmp(symbols[i]->errtxt, data[i].expected_errtxt),
+                            "a:%d t:%d i:%d strcmp(%s, %s) != 0\n",
+                            a, t, i, symbols[i]->errtxt, data[i].expected_errtxt);
+
+                /* Compare against single encode */
+                symbol = ZBarcode_Create();
+                assert_nonnull(symbol, "a:%d t:%d i:%d Symbol not created\n", a, t, i);
+
+                (void) testUtilSetSymbol(symbol, data[i].symbology, data[i].input_mode, -1 /*eci*/,
+                                        -1 /*option_1*/, -1, -1, -1 /*output_options*/, data[i].data, -1, debug);
+                if (actions[a] == ZINT_BATCH_BUFFER) {
+                    ret = ZBarcode_Encode_and_Buffer(symbol, TCU(data[i].data), -1, 0);
+                } else if (actions[a] == ZINT_BATCH_BUFFER_VECTOR) {
+                    ret = ZBarcode_Encode_and_Buffer_Vector(symbol, TCU(data[i].data), -1, 0);
+                } else {
+                    ret = ZBarcode_Encode(symbol, TCU(data[i].data), -1);
+                }
+                assert_equal(ret, data[i].ret, "a:%d t:%d i:%d single ret %d != %d (%s)\n",
+                            a, t, i, ret, data[i].ret, symbol->errtxt);
+
+                if (ret < ZINT_ERROR) {
+                    assert_zero(testUtilSymbolCmp(symbols[i], symbol), "a:%d t:%d i:%d testUtilSymbolCmp != 0\n",
+                                a, t, i);
+                    if (actions[a] == ZINT_BATCH_BUFFER) {
+                        assert_nonnull(symbols[i]->bitmap, "a:%d t:%d i:%d bitmap NULL\n", a, t, i);
+                        assert_equal(symbols[i]->bitmap_width, symbol->bitmap_width,
+                                    "a:%d t:%d i:%d bitmap_width %d != %d\n",
+                                    a, t, i, symbols[i]->bitmap_width, symbol->bitmap_width);
+                        assert_equal(symbols[i]->bitmap_height, symbol->bitmap_height,
+                                    "a:%d t:%d i:%d bitmap_height %d != %d\n",
+                                    a, t, i, symbols[i]->bitmap_height, symbol->bitmap_height);
+                        assert_zero(memcmp(symbols[i]->bitmap, symbol->bitmap,
+                                        (size_t) symbol->bitmap_width * symbol->bitmap_height * 3),
+                                    "a:%d t:%d i:%d memcmp(bitmap) != 0\n", a, t, i);
+                    } else if (actions[a] == ZINT_BATCH_BUFFER_VECTOR) {
+                        assert_nonnull(symbols[i]->vector, "a:%d t:%d i:%d vector NULL\n", a, t, i);
+                        assert_zero(testUtilVectorCmp(symbols[i]->vector, symbol->vector),
+                                    "a:%d t:%d i:%d testUtilVectorCmp != 0\n", a, t, i);
+                    } else {
+                        assert_null(symbols[i]->bitmap, "a:%d t:%d i:%d bitmap not NULL\n", a, t, i);
+                        assert_null(symbols[i]->vector, "a:%d t:%d i:%d vector not NULL\n", a, t, i);
+                    }
+                }
+
+                ZBarcode_Delete(symbol);
+                ZBarcode_Delete(symbols[i]);
+            }
+        }
+    }
+
+    testFinish();
+}
+
+static void test_estimate(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int input_mode;
+        int option_1;
+        int option_2;
+        const char *data;
+        int ret;
+        int expected_version;
+        int expected_rows;
+        int expected_width;
+        int expected_data_codewords;
+        int expected_codewords;
+        const char *expected_errtxt;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_QRCODE, -1, -1, -1, "1234567890ABCDEFGHIJ", 0, 1, 21, 21, 16, 26, "" },
+        /*  1*/ { BARCODE_QRCODE, -1, 4, -1, "https://www.example.com/some/path?query=12345&other=abcdefghijklmnopqrstuvwxyz", 0, 8, 49, 49, 86, 242, "" },
+        /*  2*/ { BARCODE_QRCODE, -1, -1, 10, "1234567890ABCDEFGHIJ", 0, 10, 57, 57, 122, 346, "" },
+        /*  3*/ { BARCODE_QRCODE, -1, -1, 1, "1234567890ABCDEFGHIJKLMNOPQRSTUVWXYZ", ZINT_ERROR_TOO_LONG, 0, 0, 0, 0, 0, "Error 569: Input too long for Version 1-L, requires 26 codewords (maximum 19)" },
+        /*  4*/ { BARCODE_HIBC_QR, -1, -1, -1, "1234567890ABCDEFGHIJ", 0, 1, 21, 21, 19, 26, "" },
+        /*  5*/ { BARCODE_DATAMATRIX, -1, -1, -1, "1234567890ABCDEFGHIJ", 0, 27, 12, 26, 16, 30, "" },
+        /*  6*/ { BARCODE_DATAMATRIX, -1, -1, 24, "1234567890ABCDEFGHIJ", 0, 24, 144, 144, 1558, 2178, "" },
+        /*  7*/ { BARCODE_DATAMATRIX, GS1_MODE, -1, -1, "[01]12345678901231", 0, 26, 8, 32, 10, 21, "" },
+        /*  8*/ { BARCODE_PDF417, -1, -1, -1, "1234567890ABCDEFGHIJ", 0, 3, 7, 120, 13, 21, "" },
+        /*  9*/ { BARCODE_PDF417COMP, -1, -1, -1, "1234567890ABCDEFGHIJ", 0, 3, 7, 86, 13, 21, "" },
+        /* 10*/ { BARCODE_MICROPDF417, -1, -1, -1, "1234567890", 0, 3, 6, 82, 6, 18, "" },
+        /* 11*/ { BARCODE_MICROPDF417, -1, -1, 3, "1234567890ABCDEFGHIJ", 0, 3, 10, 82, 14, 30, "" },
+        /* 12*/ { BARCODE_MICROPDF417, -1, -1, 4, "1234567890ABCDEFGHIJ", 0, 4, 6, 99, 12, 24, "" },
+        /* 13*/ { BARCODE_CODE128, -1, -1, -1, "1234567890ABCDEFGHIJ", 0, 0, 1, 211, 0, 0, "" }, /* Full encode */
+        /* 14*/ { BARCODE_DOTCODE, -1, -1, -1, "1234567890ABCDEFGHIJ", 0, 28, 19, 28, 0, 0, "" }, /* Full encode */
+        /* 15*/ { BARCODE_EANX, -1, -1, -1, "123456789012A", ZINT_ERROR_INVALID_DATA, 0, 0, 0, 0, 0, "Error 284: Invalid character at position 13 in input (digits and \"+\" only)" },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol;
+    struct zint_estimate estimate;
+
+    testStart("test_estimate");
+
+    ret = ZBarcode_Estimate(NULL, TCU("1"), 1, &estimate);
+    assert_equal(ret, ZINT_ERROR_INVALID_DATA, "ZBarcode_Estimate(NULL) ret %d != ZINT_ERROR_INVALID_DATA\n", ret);
+
+    for (i = 0; i < data_size; i++) {
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, data[i].input_mode, -1 /*eci*/,
+                                    data[i].option_1, data[i].option_2, -1, -1 /*output_options*/,
+                                    data[i].data, -1, debug);
+
+        if (i == 0) {
+            ret = ZBarcode_Estimate(symbol, TCU(data[i].data), length, NULL);
+            assert_equal(ret, ZINT_ERROR_INVALID_DATA, "i:%d ZBarcode_Estimate(NULL) ret %d != %d\n",
+                        i, ret, ZINT_ERROR_INVALID_DATA);
+            assert_zero(strcmp(symbol->errtxt, "Error 216: Estimate pointer NULL"), "i:%d errtxt %s\n",
+                        i, symbol->errtxt);
+        }
+
+        memset(&estimate, 0xFF, sizeof(estimate));
+        ret = ZBarcode_Estimate(symbol, TCU(data[i].data), length, &estimate);
+        assert_equal(ret, data[i].ret, "i:%d ZBarcode_Estimate ret %d != %d (%s)\n",
+                    i, ret, data[i].ret, symbol->errtxt);
+        assert_zero(strcmp(symbol->errtxt, data[i].expected_errtxt), "i:%d errtxt %s != %s\n",
+                    i, symbol->errtxt, data[i].expected_errtxt);
+        assert_equal(estimate.version, data[i].expected_version, "i:%d version %d != %d\n",
+                    i, estimate.version, data[i].expected_version);
+        assert_equal(estimate.rows, data[i].expected_rows, "i:%d rows %d != %d\n",
+                    i, estimate.rows, data[i].expected_rows);
+        assert_equal(estimate.width, data[i].expected_width, "i:%d width %d != %d\n",
+                    i, estimate.width, data[i].expected_width);
+        assert_equal(estimate.data_codewords, data[i].expected_data_codewords, "i:%d data_codewords %d != %d\n",
+                    i, estimate.data_codewords, data[i].expected_data_codewords);
+        assert_equal(estimate.codewords, data[i].expected_codewords, "i:%d codewords %d != %d\n",
+                    i, estimate.codewords, data[i].expected_codewords);
+        if (estimate.codewords) {
+            assert_zero(symbol->rows, "i:%d symbol->rows %d != 0\n", i, symbol->rows);
+        }
+
+        /* Full encode agrees */
+        ZBarcode_Reset(symbol);
+        length = testUtilSetSymbol(symbol, data[i].symbology, data[i].input_mode, -1 /*eci*/,
+                                    data[i].option_1, data[i].option_2, -1, -1 /*output_options*/,
+                                    data[i].data, -1, debug);
+        ret = ZBarcode_Encode(symbol, TCU(data[i].data), length);
+        assert_equal(ret, data[i].ret, "i:%d ZBarcode_Encode ret %d != %d (%s)\n",
+                    i, ret, data[i].ret, symbol->errtxt);
+        if (ret < ZINT_ERROR) {
+            assert_equal(symbol->rows, estimate.rows, "i:%d rows %d != estimate %d\n",
+                        i, symbol->rows, estimate.rows);
+            assert_equal(symbol->width, estimate.width, "i:%d width %d != estimate %d\n",
+                        i, symbol->width, estimate.width);
+            assert_equal(symbol->option_2, estimate.version, "i:%d option_2 %d != estimate %d\n",
+                        i, symbol->option_2, estimate.version);
+            if (estimate.codewords) {
+                assert_zero(memcmp(&symbol->estimate, &estimate, sizeof(estimate)),
+                            "i:%d symbol->estimate != estimate\n", i);
+            }
+        }
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+static void test_stats(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct zint_symbol *symbol;
+    struct zint_stats stats;
+    int i, length, ret;
+    const char *data = "1234567890ABCDEFGHIJ";
+
+    (void)debug;
+
+    testStart("test_stats");
+
+    ret = ZBarcode_GetStats(NULL, NULL);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION,
+                "ZBarcode_GetStats(NULL, NULL) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+
+    symbol = ZBarcode_Create();
+    assert_nonnull(symbol, "Symbol not created\n");
+
+    length = testUtilSetSymbol(symbol, BARCODE_QRCODE, -1 /*input_mode*/, -1 /*eci*/, -1, -1, -1,
+                                -1 /*output_options*/, data, -1, debug);
+    ret = ZBarcode_Encode(symbol, TCU(data), length);
+    assert_zero(ret, "ZBarcode_Encode ret %d != 0 (%s)\n", ret, symbol->errtxt);
+    ret = ZBarcode_Buffer(symbol, 90);
+    assert_zero(ret, "ZBarcode_Buffer ret %d != 0 (%s)\n", ret, symbol->errtxt);
+
+    memset(&stats, 0xFF, sizeof(stats));
+    ret = ZBarcode_GetStats(symbol, &stats);
+    if (ret == 0) { /* Built with ZINT_STATS */
+        assert_equal((int) stats.calls[ZINT_STATS_ENCODE], 1, "calls[ZINT_STATS_ENCODE] %d != 1\n",
+                    (int) stats.calls[ZINT_STATS_ENCODE]);
+        assert_equal((int) stats.calls[ZINT_STATS_ECI], 1, "calls[ZINT_STATS_ECI] %d != 1\n",
+                    (int) stats.calls[ZINT_STATS_ECI]);
+        assert_equal((int) stats.calls[ZINT_STATS_MODES], 1, "calls[ZINT_STATS_MODES] %d != 1\n",
+                    (int) stats.calls[ZINT_STATS_MODES]);
+        assert_equal((int) stats.calls[ZINT_STATS_RS], 1, "calls[ZINT_STATS_RS] %d != 1\n",
+                    (int) stats.calls[ZINT_STATS_RS]);
+        assert_equal((int) stats.calls[ZINT_STATS_MASK], 1, "calls[ZINT_STATS_MASK] %d != 1\n",
+                    (int) stats.calls[ZINT_STATS_MASK]);
+        assert_equal((int) stats.calls[ZINT_STATS_PLOT], 1, "calls[ZINT_STATS_PLOT] %d != 1\n",
+                    (int) stats.calls[ZINT_STATS_PLOT]);
+        assert_equal((int) stats.calls[ZINT_STATS_ROTATE], 1, "calls[ZINT_STATS_ROTATE] %d != 1\n",
+                    (int) stats.calls[ZINT_STATS_ROTATE]);
+        assert_equal((int) stats.calls[ZINT_STATS_OUTPUT], 1, "calls[ZINT_STATS_OUTPUT] %d != 1\n",
+                    (int) stats.calls[ZINT_STATS_OUTPUT]);
+        assert_nonzero(stats.ns[ZINT_STATS_ENCODE] >= stats.ns[ZINT_STATS_RS],
+                    "ns[ZINT_STATS_ENCODE] < ns[ZINT_STATS_RS]\n");
+        assert_nonzero(stats.ns[ZINT_STATS_PLOT] >= stats.ns[ZINT_STATS_OUTPUT],
+                    "ns[ZINT_STATS_PLOT] < ns[ZINT_STATS_OUTPUT]\n");
+
+        /* Accumulates */
+        ret = ZBarcode_Encode(symbol, TCU(data), length);
+        assert_zero(ret, "ZBarcode_Encode ret %d != 0 (%s)\n", ret, symbol->errtxt);
+        ret = ZBarcode_GetStats(symbol, &stats);
+        assert_zero(ret, "ZBarcode_GetStats ret %d != 0\n", ret);
+        assert_equal((int) stats.calls[ZINT_STATS_ENCODE], 2, "calls[ZINT_STATS_ENCODE] %d != 2\n",
+                    (int) stats.calls[ZINT_STATS_ENCODE]);
+        assert_equal((int) stats.calls[ZINT_STATS_PLOT], 1, "calls[ZINT_STATS_PLOT] %d != 1\n",
+                    (int) stats.calls[ZINT_STATS_PLOT]);
+    } else {
+        assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_GetStats ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+        for (i = 0; i < ZINT_STATS_STAGES; i++) {
+            assert_zero((int) stats.calls[i], "i:%d calls %d != 0\n", i, (int) stats.calls[i]);
+            assert_zero((int) stats.ns[i], "i:%d ns %d != 0\n", i, (int) stats.ns[i]);
+        }
+    }
+
+    /* Reset zeroes */
+    ZBarcode_Reset(symbol);
+    for (i = 0; i < ZINT_STATS_STAGES; i++) {
+        assert_zero((int) symbol->stats.calls[i], "i:%d reset calls %d != 0\n", i, (int) symbol->stats.calls[i]);
+        assert_zero((int) symbol->stats.ns[i], "i:%d reset ns %d != 0\n", i, (int) symbol->stats.ns[i]);
+    }
+
+    ZBarcode_Delete(symbol);
+
+    testFinish();
+}
+
+static void test_modules(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        const char *data;
+        int expected_rows;
+        int expected_width;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, "1234", 1, 57 },
+        /*  1*/ { BARCODE_EANX, "123456789012", 1, 95 },
+        /*  2*/ { BARCODE_QRCODE, "1234", 21, 21 },
+        /*  3*/ { BARCODE_DBAR_EXPSTK, "[01]12345678901231[10]ABCDEF", 9, 102 },
+        /*  4*/ { BARCODE_PDF417, "ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890", 9, 120 },
+        /*  5*/ { BARCODE_ULTRA, "1234", 13, 15 },
+        /*  6*/ { BARCODE_CODE128, "ABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUV", 1, 1135 },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol = NULL;
+    struct zint_modules *modules;
+
+    testStartSymbol("test_modules", &symbol);
+
+    assert_equal(ZBarcode_Module(NULL, 0, 0), -1, "ZBarcode_Module(NULL) != -1\n");
+    assert_null(ZBarcode_Modules(NULL), "ZBarcode_Modules(NULL) != NULL\n");
+    assert_equal(ZBarcode_Modules_Get(NULL, 0, 0), -1, "ZBarcode_Modules_Get(NULL) != -1\n");
+    ZBarcode_Modules_Free(NULL); /* Ok */
+
+    for (i = 0; i < data_size; i++) {
+        int r, c;
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        assert_null(ZBarcode_Modules(symbol), "i:%d ZBarcode_Modules(unencoded) != NULL\n", i);
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/, -1, -1,
+                                    -1 /*output_options*/, data[i].data, -1, debug);
+
+        ret = ZBarcode_Encode(symbol, TCU(data[i].data), length);
+        assert_zero(ret, "i:%d ZBarcode_Encode ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+
+        assert_equal(symbol->rows, data[i].expected_rows, "i:%d symbol->rows %d != %d\n",
+                    i, symbol->rows, data[i].expected_rows);
+        assert_equal(symbol->width, data[i].expected_width, "i:%d symbol->width %d != %d\n",
+                    i, symbol->width, data[i].expected_width);
+
+        modules = ZBarcode_Modules(symbol);
+        assert_nonnull(modules, "i:%d ZBarcode_Modules NULL\n", i);
+        assert_equal(modules->rows, symbol->rows, "i:%d modules->rows %d != %d\n", i, modules->rows, symbol->rows);
+        assert_equal(modules->width, symbol->width, "i:%d modules->width %d != %d\n",
+                    i, modules->width, symbol->width);
+        assert_equal(modules->stride, (symbol->width + 63) / 64, "i:%d modules->stride %d != %d\n",
+                    i, modules->stride, (symbol->width + 63) / 64);
+        if (data[i].symbology == BARCODE_ULTRA) {
+            assert_nonnull(modules->colours, "i:%d modules->colours NULL\n", i);
+        } else {
+            assert_null(modules->colours, "i:%d modules->colours not NULL\n", i);
+        }
+
+        for (r = 0; r < symbol->rows; r++) {
+            for (c = 0; c < symbol->width; c++) {
+                const int expected = data[i].symbology == BARCODE_ULTRA ? module_colour_is_set(symbol, r, c)
+                                        : module_is_set(symbol, r, c);
+                ret = ZBarcode_Module(symbol, r, c);
+                assert_equal(ret, expected, "i:%d ZBarcode_Module(%d, %d) %d != %d\n", i, r, c, ret, expected);
+                ret = ZBarcode_Modules_Get(modules, r, c);
+                assert_equal(ret, expected, "i:%d ZBarcode_Modules_Get(%d, %d) %d != %d\n", i, r, c, ret, expected);
+                ret = (int) ((modules->bits[modules->stride * r + c / 64] >> (c % 64)) & 1);
+                assert_equal(ret, expected != 0, "i:%d bits(%d, %d) %d != %d\n", i, r, c, ret, expected != 0);
+            }
+            for (c = symbol->width; c < modules->stride * 64; c++) {
+                ret = (int) ((modules->bits[modules->stride * r + c / 64] >> (c % 64)) & 1);
+                assert_zero(ret, "i:%d bits(%d, %d) %d != 0\n", i, r, c, ret);
+            }
+        }
+        assert_equal(ZBarcode_Module(symbol, -1, 0), -1, "i:%d ZBarcode_Module(-1, 0) != -1\n", i);
+        assert_equal(ZBarcode_Module(symbol, 0, -1), -1, "i:%d ZBarcode_Module(0, -1) != -1\n", i);
+        assert_equal(ZBarcode_Module(symbol, symbol->rows, 0), -1, "i:%d ZBarcode_Module(rows, 0) != -1\n", i);
+        assert_equal(ZBarcode_Module(symbol, 0, symbol->width), -1, "i:%d ZBarcode_Module(0, width) != -1\n", i);
+        assert_equal(ZBarcode_Modules_Get(modules, symbol->rows, 0), -1,
+                    "i:%d ZBarcode_Modules_Get(rows, 0) != -1\n", i);
+        assert_equal(ZBarcode_Modules_Get(modules, 0, symbol->width), -1,
+                    "i:%d ZBarcode_Modules_Get(0, width) != -1\n", i);
+
+        ZBarcode_Modules_Free(modules);
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+struct test_alloc_counts {
+    int mallocs;
+    int reallocs;
+    int frees;
+    int fail_after; /* Fail `malloc()` after this many, -1 for never */
+};
+
+static void *test_alloc_malloc(void *opaque, size_t size) {
+    struct test_alloc_counts *counts = (struct test_alloc_counts *) opaque;
+    if (counts->fail_after != -1 && counts->mallocs >= counts->fail_after) {
+        return NULL;
+    }
+    counts->mallocs++;
+    return malloc(size);
+}
+
+static void *test_alloc_realloc(void *opaque, void *ptr, size_t size) {
+    struct test_alloc_counts *counts = (struct test_alloc_counts *) opaque;
+    counts->reallocs++;
+    return realloc(ptr, size);
+}
+
+static void test_alloc_free(void *opaque, void *ptr) {
+    struct test_alloc_counts *counts = (struct test_alloc_counts *) opaque;
+    counts->frees++;
+    free(ptr);
+}
+
+static void test_set_allocator(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int output_options;
+        const char *outfile;
+        float scale;
+        int encode_cache;
+        int use_realloc;
+        int fail_after;
+        const char *data;
+        int ret;
+        const char *expected_errtxt;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, -1, NULL, 0, 0, 1, -1, "1234", 0, "" },
+        /*  1*/ { BARCODE_DATAMATRIX, -1, NULL, 0, 0, 1, -1, "1234", 0, "" },
+        /*  2*/ { BARCODE_HANXIN, -1, NULL, 0, 0, 0, -1, "1234", 0, "" },
+        /*  3*/ { BARCODE_PDF417, BARCODE_MEMORY_FILE, "mem.gif", 0, 0, 1, -1, "1234", 0, "" },
+        /*  4*/ { BARCODE_QRCODE, BARCODE_MEMORY_FILE, "mem.gif", 0, 0, 0, -1, "1234", 0, "" },
+        /*  5*/ { BARCODE_CODE128, -1, NULL, 0, 0, 1, 1, "1234", ZINT_ERROR_MEMORY, "Error 658: Insufficient memory for pixel buffer" },
+        /*  6*/ { BARCODE_PDF417, BARCODE_MEMORY_FILE, "mem.png", 0, 0, 1, -1, "1234", 0, "" }, /* libpng & zlib if available */
+        /*  7*/ { BARCODE_QRCODE, BARCODE_MEMORY_FILE, "mem.png", 0, 0, 0, -1, "1234", 0, "" },
+        /*  8*/ { BARCODE_DATAMATRIX, BARCODE_MEMORY_FILE, "mem.tif", 0, 0, 1, -1, "1234", 0, "" }, /* LZW & G4 */
+        /*  9*/ { BARCODE_MAXICODE, BARCODE_MEMORY_FILE, "mem.tif", 0, 0, 0, -1, "1234", 0, "" },
+        /* 10*/ { BARCODE_CODE128, BOLD_TEXT, NULL, 9.5f, 0, 1, -1, "1234", 0, "" }, /* Builds new (process-wide) glyph set */
+        /* 11*/ { BARCODE_DATAMATRIX, -1, NULL, 0, 1, 1, -1, "1234", 0, "" }, /* Process-wide encode cache */
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol = NULL;
+    struct test_alloc_counts counts;
+
+    testStartSymbol("test_set_allocator", &symbol);
+
+    ret = ZBarcode_SetAllocator(test_alloc_malloc, NULL, NULL, NULL);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_SetAllocator(NULL free) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+    ret = ZBarcode_SetAllocator(NULL, NULL, test_alloc_free, NULL);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_SetAllocator(NULL malloc) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+
+    for (i = 0; i < data_size; i++) {
+        if (testContinue(p_ctx, i)) continue;
+
+        memset(&counts, 0, sizeof(counts));
+        counts.fail_after = -1;
+        ret = ZBarcode_SetAllocator(test_alloc_malloc, data[i].use_realloc ? test_alloc_realloc : NULL,
+                                    test_alloc_free, &counts);
+        assert_zero(ret, "i:%d ZBarcode_SetAllocator ret %d != 0\n", i, ret);
+
+        if (data[i].encode_cache) {
+            ret = ZBarcode_SetEncodeCache(100);
+            assert_zero(ret, "i:%d ZBarcode_SetEncodeCache ret %d != 0\n", i, ret);
+            assert_zero(counts.mallocs, "i:%d ZBarcode_SetEncodeCache mallocs %d != 0\n", i, counts.mallocs);
+        }
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "i:%d Symbol not created\n", i);
+        assert_equal(counts.mallocs, 1, "i:%d mallocs %d != 1\n", i, counts.mallocs);
+
+        counts.fail_after = data[i].fail_after;
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/, -1, -1,
+                                    data[i].output_options, data[i].data, -1, debug);
+        if (data[i].scale) {
+            symbol->scale = data[i].scale;
+        }
+        if (data[i].outfile) {
+            strcpy(symbol->outfile, data[i].outfile);
+            ret = ZBarcode_Encode_and_Print(symbol, TCU(data[i].data), length, 0);
+        } else {
+            ret = ZBarcode_Encode_and_Buffer(symbol, TCU(data[i].data), length, 0);
+        }
+        assert_equal(ret, data[i].ret, "i:%d ret %d != %d (%s)\n", i, ret, data[i].ret, symbol->errtxt);
+        assert_zero(strcmp(symbol->errtxt, data[i].expected_errtxt), "i:%d strcmp(%s, %s) != 0\n",
+                    i, symbol->errtxt, data[i].expected_errtxt);
+
+        if (ret < ZINT_ERROR) {
+            assert_nonzero(counts.mallocs > 1, "i:%d mallocs %d <= 1\n", i, counts.mallocs);
+            if (data[i].outfile) {
+                assert_nonnull(symbol->memfile, "i:%d memfile NULL\n", i);
+            } else {
+                assert_nonnull(symbol->bitmap, "i:%d bitmap NULL\n", i);
+            }
+            ret = ZBarcode_Buffer_Vector(symbol, 0);
+            assert_zero(ret, "i:%d ZBarcode_Buffer_Vector ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+        }
+
+        ZBarcode_Delete(symbol);
+
+        if (debug & ZINT_DEBUG_TEST_PRINT) {
+            printf("i:%d mallocs %d, reallocs %d, frees %d\n", i, counts.mallocs, counts.reallocs, counts.frees);
+        }
+        assert_equal(counts.frees, counts.mallocs, "i:%d frees %d != mallocs %d\n", i, counts.frees, counts.mallocs);
+        if (!data[i].use_realloc) {
+            assert_zero(counts.reallocs, "i:%d reallocs %d != 0\n", i, counts.reallocs);
+        }
+        if (data[i].encode_cache) {
+            (void) ZBarcode_SetEncodeCache(0);
+        }
+    }
+
+    ret = ZBarcode_SetAllocator(NULL, NULL, NULL, NULL); /* Restore defaults */
+    assert_zero(ret, "ZBarcode_SetAllocator(NULL) ret %d != 0\n", ret);
+
+    memset(&counts, 0, sizeof(counts));
+    symbol = ZBarcode_Create();
+    assert_nonnull(symbol, "Symbol not created\n");
+    ZBarcode_Delete(symbol);
+    assert_zero(counts.mallocs, "default mallocs %d != 0\n", counts.mallocs);
+
+    testFinish();
+}
+
 int main(int argc, char *argv[]) {
 
     testFunction funcs[] = { /* name, func */
@@ -2297,6 +3313,7 @@ int main(int argc, char *argv[]) {
         { "test_input_mode", test_input_mode },
         { "test_escape_char_process", test_escape_char_process },
         { "test_escape_char_process_test", test_escape_char_process_test },
+        { "test_unescape", test_unescape },
         { "test_cap", test_cap },
         { "test_cap_compliant_height", test_cap_compliant_height },
         { "test_encode_file_empty", test_encode_file_empty },
@@ -2313,9 +3330,17 @@ int main(int argc, char *argv[]) {
         { "test_zero_outfile", test_zero_outfile },
         { "test_clear", test_clear },
         { "test_reset", test_reset },
+        { "test_retain_buffers", test_retain_buffers },
         { "test_scale_from_xdimdp", test_scale_from_xdimdp },
         { "test_xdimdp_from_scale", test_xdimdp_from_scale },
         { "test_utf8_to_eci", test_utf8_to_eci },
+        { "test_encode_batch", test_encode_batch },
+        { "test_prepare", test_prepare },
+        { "test_encode_cache", test_encode_cache },
+        { "test_estimate", test_estimate },
+        { "test_stats", test_stats },
+        { "test_modules", test_modules },
+        { "test_set_allocator", test_set_allocator },
     };
 
     testRun(argc, argv, funcs, ARRAY_SIZE(funcs));
@@ -414,6 +414,118 @@ static void test_fopen(const testCtx *const p_ctx) {
     testFinish();
 }
 
+static void test_raster_rows(const testCtx *const p_ctx) {
+    struct item {
+        int src_width;
+        int src_height;
+        float scaler;
+        int rotate_angle;
+        int runs;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { 1, 1, 0.0f, 0, 0 },
+        /*  1*/ { 7, 5, 0.0f, 90, 0 },
+        /*  2*/ { 7, 5, 0.0f, 180, 0 },
+        /*  3*/ { 7, 5, 0.0f, 270, 0 },
+        /*  4*/ { 150, 131, 0.0f, 90, 0 }, /* More than 2 bands */
+        /*  5*/ { 150, 131, 0.0f, 270, 0 },
+        /*  6*/ { 131, 150, 1.7f, 0, 0 },
+        /*  7*/ { 131, 150, 1.7f, 90, 0 },
+        /*  8*/ { 131, 150, 0.6f, 180, 0 },
+        /*  9*/ { 131, 150, 2.3f, 270, 0 },
+        /* 10*/ { 131, 150, 1.7f, 0, 1 }, /* Runs of same value */
+        /* 11*/ { 131, 150, 2.3f, 180, 1 },
+        /* 12*/ { 131, 150, 0.6f, 0, 1 }, /* Skips source columns */
+        /* 13*/ { 131, 150, 0.6f, 180, 1 },
+        /* 14*/ { 131, 150, 0.6f, 90, 1 },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, ret, row, column, pass;
+    unsigned char *pixelbuf, *expected, *copied;
+    const unsigned char *prev;
+    struct out_raster_rows rows;
+
+    testStart("test_raster_rows");
+
+    for (i = 0; i < data_size; i++) {
+        const size_t src_size = (size_t) data[i].src_width * data[i].src_height;
+        int sw, sh;
+
+        if (testContinue(p_ctx, i)) continue;
+
+        pixelbuf = (unsigned char *) malloc(src_size);
+        assert_nonnull(pixelbuf, "i:%d malloc pixelbuf fail\n", i);
+        for (row = 0; row < data[i].src_height; row++) {
+            for (column = 0; column < data[i].src_width; column++) {
+                pixelbuf[row * data[i].src_width + column] = data[i].runs ? "01"[(row / 3 + column / 5) & 1]
+                                                            : (unsigned char) (row * 7 + column * 13);
+            }
+        }
+
+        ret = out_raster_rows_init(&rows, pixelbuf, data[i].src_width, data[i].src_height, data[i].scaler,
+                                    data[i].rotate_angle);
+        assert_equal(ret, 1, "i:%d out_raster_rows_init ret %d != 1\n", i, ret);
+
+        /* Straightforward scale then rotate to compare against */
+        sw = data[i].scaler ? (int) stripf(data[i].src_width * data[i].scaler) : data[i].src_width;
+        sh = data[i].scaler ? (int) stripf(data[i].src_height * data[i].scaler) : data[i].src_height;
+        if (data[i].rotate_angle == 90 || data[i].rotate_angle == 270) {
+            assert_equal(rows.width, sh, "i:%d width %d != %d\n", i, rows.width, sh);
+            assert_equal(rows.height, sw, "i:%d height %d != %d\n", i, rows.height, sw);
+        } else {
+            assert_equal(rows.width, sw, "i:%d width %d != %d\n", i, rows.width, sw);
+            assert_equal(rows.height, sh, "i:%d height %d != %d\n", i, rows.height, sh);
+        }
+        expected = (unsigned char *) malloc((size_t) sw * sh);
+        assert_nonnull(expected, "i:%d malloc expected fail\n", i);
+        for (row = 0; row < rows.height; row++) {
+            for (column = 0; column < rows.width; column++) {
+                int x, y;
+                switch (data[i].rotate_angle) {
+                    case 90: x = row; y = sh - column - 1; break;
+                    case 180: x = sw - column - 1; y = sh - row - 1; break;
+                    case 270: x = sw - row - 1; y = column; break;
+                    default: x = column; y = row; break;
+                }
+                if (data[i].scaler) {
+                    x = (int) stripf(x / data[i].scaler);
+                    y = (int) stripf(y / data[i].scaler);
+                }
+                expected[row * rows.width + column] = pixelbuf[y * data[i].src_width + x];
+            }
+        }
+
+        /* In order (checking previous row still valid), backwards, then every 3rd row */
+        for (pass = 0; pass < 3; pass++) {
+            prev = NULL;
+            for (row = 0; row < rows.height; row++) {
+                const int r = pass == 0 ? row : pass == 1 ? rows.height - row - 1 : (row * 3) % rows.height;
+                const unsigned char *const rp = out_raster_row(&rows, r);
+                assert_zero(memcmp(rp, expected + (size_t) r * rows.width, rows.width),
+                            "i:%d pass %d row %d memcmp != 0\n", i, pass, r);
+                if (pass == 0 && prev) {
+                    assert_zero(memcmp(prev, expected + (size_t) (r - 1) * rows.width, rows.width),
+                                "i:%d row %d previous row memcmp != 0\n", i, r);
+                }
+                prev = rp;
+            }
+        }
+
+        copied = (unsigned char *) malloc((size_t) sw * sh);
+        assert_nonnull(copied, "i:%d malloc copied fail\n", i);
+        out_raster_rows_copy(&rows, copied, 1 + (i & 3)); /* Vary number of bands (threads if available) */
+        assert_zero(memcmp(copied, expected, (size_t) sw * sh), "i:%d out_raster_rows_copy memcmp != 0\n", i);
+
+        out_raster_rows_free(&rows);
+        free(copied);
+        free(expected);
+        free(pixelbuf);
+    }
+
+    testFinish();
+}
+
 int main(int argc, char *argv[]) {
 
     testFunction funcs[] = { /* name, func */
@@ -423,6 +535,7 @@ int main(int argc, char *argv[]) {
         { "test_quiet_zones", test_quiet_zones },
         { "test_set_whitespace_offsets", test_set_whitespace_offsets },
         { "test_fopen", test_fopen },
+        { "test_raster_rows", test_raster_rows },
     };
 
     testRun(argc, argv, funcs, ARRAY_SIZE(funcs));
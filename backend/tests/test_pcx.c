@@ -30,6 +30,7 @@
 /* SPDX-License-Identifier: BSD-3-Clause */
 
 #include "testcommon.h"
+#include "../output.h"
 
 static void test_print(const testCtx *const p_ctx) {
     int debug = p_ctx->debug;
@@ -161,13 +162,14 @@ static void test_print(const testCtx *const p_ctx) {
     testFinish();
 }
 
-INTERNAL int pcx_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf);
+INTERNAL int pcx_pixel_plot(struct zint_symbol *symbol, struct out_raster_rows *rows);
 
 static void test_outfile(const testCtx *const p_ctx) {
     int ret;
     int skip_readonly_test = 0;
     struct zint_symbol symbol = {0};
     unsigned char data[] = { "1" };
+    struct out_raster_rows rows;
 
     (void)p_ctx;
 
@@ -176,6 +178,7 @@ static void test_outfile(const testCtx *const p_ctx) {
     symbol.symbology = BARCODE_CODE128;
     symbol.bitmap = data;
     symbol.bitmap_width = symbol.bitmap_height = 1;
+    (void) out_raster_rows_init(&rows, data, 1, 1, 0.0f, 0);
 
     strcpy(symbol.outfile, "test_pcx_out.pcx");
 #ifndef _WIN32
@@ -187,7 +190,7 @@ static void test_outfile(const testCtx *const p_ctx) {
         (void) testUtilRmROFile(symbol.outfile); /* In case lying around from previous fail */
         assert_nonzero(testUtilCreateROFile(symbol.outfile), "pcx_pixel_plot testUtilCreateROFile(%s) fail (%d: %s)\n", symbol.outfile, errno, strerror(errno));
 
-        ret = pcx_pixel_plot(&symbol, data);
+        ret = pcx_pixel_plot(&symbol, &rows);
         assert_equal(ret, ZINT_ERROR_FILE_ACCESS, "pcx_pixel_plot ret %d != ZINT_ERROR_FILE_ACCESS (%d) (%s)\n", ret, ZINT_ERROR_FILE_ACCESS, symbol.errtxt);
         assert_zero(testUtilRmROFile(symbol.outfile), "pcx_pixel_plot testUtilRmROFile(%s) != 0 (%d: %s)\n", symbol.outfile, errno, strerror(errno));
         assert_zero(strncmp(symbol.errtxt, expected_errtxt, sizeof(expected_errtxt) - 1), "strncmp(%s, %s) != 0\n", symbol.errtxt, expected_errtxt);
@@ -195,7 +198,7 @@ static void test_outfile(const testCtx *const p_ctx) {
 
     symbol.output_options |= BARCODE_STDOUT;
 
-    ret = pcx_pixel_plot(&symbol, data);
+    ret = pcx_pixel_plot(&symbol, &rows);
     printf(" - ignore (PCX to stdout)\n"); fflush(stdout);
     assert_zero(ret, "pcx_pixel_plot ret %d != 0 (%s)\n", ret, symbol.errtxt);
 
@@ -30,11 +30,12 @@
 /* SPDX-License-Identifier: BSD-3-Clause */
 
 #include "testcommon.h"
+#include "../output.h"
 #include <errno.h>
 #include <zlib.h> /* For ZLIBNG_VERSION define (if any) */
 #include <sys/stat.h>
 
-INTERNAL int png_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf);
+INTERNAL int png_pixel_plot(struct zint_symbol *symbol, struct out_raster_rows *rows);
 
 static void test_pixel_plot(const testCtx *const p_ctx) {
     int debug = p_ctx->debug;
@@ -59,6 +60,7 @@ static void test_pixel_plot(const testCtx *const p_ctx) {
     const int data_size = ARRAY_SIZE(data);
     int i, ret;
     struct zint_symbol *symbol = NULL;
+    struct out_raster_rows rows;
 
     const char *png = "out.png";
 
@@ -94,7 +96,8 @@ static void test_pixel_plot(const testCtx *const p_ctx) {
 
         symbol->bitmap = (unsigned char *) data_buf;
 
-        ret = png_pixel_plot(symbol, (unsigned char *) data_buf);
+        (void) out_raster_rows_init(&rows, TCU(data_buf), symbol->bitmap_width, symbol->bitmap_height, 0.0f, 0);
+        ret = png_pixel_plot(symbol, &rows);
         assert_equal(ret, data[i].ret, "i:%d png_pixel_plot ret %d != %d (%s)\n", i, ret, data[i].ret, symbol->errtxt);
 
         if (ret < ZINT_ERROR) {
@@ -372,6 +375,7 @@ static void test_outfile(const testCtx *const p_ctx) {
     int skip_readonly_test = 0;
     struct zint_symbol symbol = {0};
     unsigned char data[] = { "1" };
+    struct out_raster_rows rows;
 
     (void)p_ctx;
 
@@ -380,6 +384,7 @@ static void test_outfile(const testCtx *const p_ctx) {
     symbol.symbology = BARCODE_CODE128;
     symbol.bitmap = data;
     symbol.bitmap_width = symbol.bitmap_height = 1;
+    (void) out_raster_rows_init(&rows, data, 1, 1, 0.0f, 0);
 
     strcpy(symbol.outfile, "test_png_out.png");
 #ifndef _WIN32
@@ -391,7 +396,7 @@ static void test_outfile(const testCtx *const p_ctx) {
         (void) testUtilRmROFile(symbol.outfile); /* In case lying around from previous fail */
         assert_nonzero(testUtilCreateROFile(symbol.outfile), "png_pixel_plot testUtilCreateROFile(%s) fail (%d: %s)\n", symbol.outfile, errno, strerror(errno));
 
-        ret = png_pixel_plot(&symbol, data);
+        ret = png_pixel_plot(&symbol, &rows);
         assert_equal(ret, ZINT_ERROR_FILE_ACCESS, "png_pixel_plot ret %d != ZINT_ERROR_FILE_ACCESS (%d) (%s)\n", ret, ZINT_ERROR_FILE_ACCESS, symbol.errtxt);
         assert_zero(testUtilRmROFile(symbol.outfile), "png_pixel_plot testUtilRmROFile(%s) != 0 (%d: %s)\n", symbol.outfile, errno, strerror(errno));
         assert_zero(strncmp(symbol.errtxt, expected_errtxt, sizeof(expected_errtxt) - 1), "strncmp(%s, %s) != 0\n", symbol.errtxt, expected_errtxt);
@@ -400,7 +405,7 @@ static void test_outfile(const testCtx *const p_ctx) {
     symbol.output_options |= BARCODE_STDOUT;
 
     printf(">>>Begin ignore (PNG to stdout)\n"); fflush(stdout);
-    ret = png_pixel_plot(&symbol, data);
+    ret = png_pixel_plot(&symbol, &rows);
     printf("\n<<<End ignore (PNG to stdout)\n"); fflush(stdout);
     assert_zero(ret, "png_pixel_plot ret %d != 0 (%s)\n", ret, symbol.errtxt);
 
@@ -466,6 +471,325 @@ static void test_wpng_error_handler(const testCtx *const p_ctx) {
     testFinish();
 }
 
+/* Check encoding options give same image as default, and invalid options fail */
+static void test_options(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        float scale;
+        int rotate_angle;
+        const char *data;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, 0, 0, "A12345B" },
+        /*  1*/ { BARCODE_QRCODE, 2.5f, 90, "1234567890abcdefghijklmnopqrstuvwxyz" },
+        /*  2*/ { BARCODE_MAXICODE, 0, 0, "1234567890" },
+        /*  3*/ { BARCODE_ULTRA, 0, 180, "ABCDEFGHIJ" }, /* Bit depth 4 */
+    };
+    static const int options[] = {
+        ZINT_PNG_SMALLEST, ZINT_PNG_BALANCED, ZINT_PNG_FASTEST,
+        ZINT_PNG_FILTER_NONE, ZINT_PNG_FILTER_SUB, ZINT_PNG_FILTER_UP, ZINT_PNG_FILTER_AVG, ZINT_PNG_FILTER_PAETH,
+        ZINT_PNG_FILTER_ALL,
+        ZINT_PNG_STRATEGY_DEFAULT, ZINT_PNG_STRATEGY_FILTERED, ZINT_PNG_STRATEGY_HUFFMAN, ZINT_PNG_STRATEGY_RLE,
+        ZINT_PNG_STRATEGY_FIXED,
+        ZINT_PNG_FASTEST | ZINT_PNG_FILTER_PAETH | ZINT_PNG_STRATEGY_FILTERED,
+        ZINT_PNG_BALANCED | ZINT_PNG_FILTER_ALL,
+    };
+    static const int bad_options[] = { 0x0004, 0x0070, 0x0600, 0x2000 };
+    const int data_size = ARRAY_SIZE(data);
+    int i, j, length, ret;
+    struct zint_symbol *symbol = NULL;
+
+    const char *ref_file = "test_png_options_ref.png";
+    const char *out_file = "test_png_options.png";
+
+    testStartSymbol("test_options", &symbol);
+
+    for (i = 0; i < data_size; i++) {
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/,
+                    -1 /*option_2*/, -1 /*option_3*/, -1 /*output_options*/, data[i].data, -1, debug);
+        if (data[i].scale) {
+            symbol->scale = data[i].scale;
+        }
+
+        ret = ZBarcode_Encode(symbol, TCU(data[i].data), length);
+        assert_zero(ret, "i:%d ZBarcode_Encode ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+
+        strcpy(symbol->outfile, ref_file);
+        ret = ZBarcode_Print(symbol, data[i].rotate_angle);
+        assert_zero(ret, "i:%d ZBarcode_Print ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+
+        strcpy(symbol->outfile, out_file);
+        for (j = 0; j < ARRAY_SIZE(options); j++) {
+            symbol->png_options = options[j];
+            ret = ZBarcode_Print(symbol, data[i].rotate_angle);
+            assert_zero(ret, "i:%d j:%d ZBarcode_Print ret %d != 0 (%s)\n", i, j, ret, symbol->errtxt);
+            ret = testUtilCmpPngs(out_file, ref_file);
+            assert_zero(ret, "i:%d j:%d png_options 0x%X testUtilCmpPngs(%s, %s) %d != 0\n",
+                        i, j, options[j], out_file, ref_file, ret);
+            assert_zero(testUtilRemove(out_file), "i:%d j:%d testUtilRemove(%s) != 0\n", i, j, out_file);
+        }
+        for (j = 0; j < ARRAY_SIZE(bad_options); j++) {
+            symbol->png_options = bad_options[j];
+            ret = ZBarcode_Print(symbol, data[i].rotate_angle);
+            assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "i:%d j:%d ZBarcode_Print ret %d != ZINT_ERROR_INVALID_OPTION\n",
+                        i, j, ret);
+            assert_zero(strncmp(symbol->errtxt, "Error 639: ", 11), "i:%d j:%d errtxt %s != 639\n", i, j, symbol->errtxt);
+        }
+        assert_zero(testUtilRemove(ref_file), "i:%d testUtilRemove(%s) != 0\n", i, ref_file);
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+/* Check built-in encoder gives same image as libpng */
+static void test_native(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int output_options;
+        int border_width;
+        int whitespace_width;
+        const char *fgcolour;
+        const char *bgcolour;
+        float scale;
+        float dpmm;
+        int rotate_angle;
+        const char *data;
+        int repeat;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, -1, -1, -1, NULL, NULL, 0, 0, 0, "A", 1 },
+        /*  1*/ { BARCODE_CODE128, -1, -1, -1, NULL, NULL, 0, 12, 90, "A12345B", 1 },
+        /*  2*/ { BARCODE_QRCODE, -1, -1, -1, "112233", "EEDDCC", 2.5f, 0, 0, "1234567890abcdefghijklmnopqrstuvwxyz", 1 },
+        /*  3*/ { BARCODE_QRCODE, -1, -1, -1, "000000AA", "FFFFFF00", 0, 0, 270, "1234567890abcdefghijklmnopqrstuvwxyz", 1 },
+        /*  4*/ { BARCODE_DATAMATRIX, -1, -1, -1, "FF000080", NULL, 10, 0, 0, "1234567890abcdefghij", 40 }, /* Multiple blocks */
+        /*  5*/ { BARCODE_MAXICODE, -1, -1, -1, NULL, NULL, 0, 0, 0, "1234567890", 1 },
+        /*  6*/ { BARCODE_MAXICODE, -1, -1, -1, NULL, NULL, 7.3f, 0, 180, "1234567890", 1 },
+        /*  7*/ { BARCODE_ULTRA, -1, -1, -1, NULL, NULL, 0, 0, 0, "ABCDEFGHIJ", 1 }, /* Bit depth 4 */
+        /*  8*/ { BARCODE_ULTRA, BARCODE_BOX, 2, 1, "0000FF", "FF000077", 3, 0, 0, "ABCDEFGHIJ", 1 },
+        /*  9*/ { BARCODE_ULTRA, BARCODE_BIND, 1, 2, "00000099", "FFFF0033", 0, 0, 0, "ABCDEFGHIJ", 1 },
+        /* 10*/ { BARCODE_PDF417, -1, -1, -1, NULL, NULL, 20, 0, 0, "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789", 20 }, /* Multiple IDATs */
+        /* 11*/ { BARCODE_CODE128, -1, -1, -1, NULL, NULL, 20, 0, 0, "1234567890", 6 }, /* Wide */
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol = NULL;
+    char data_buf[1024];
+
+    const char *ref_file = "test_png_native_ref.png";
+    const char *out_file = "test_png_native.png";
+
+    testStartSymbol("test_native", &symbol);
+
+    for (i = 0; i < data_size; i++) {
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        testUtilStrCpyRepeat(data_buf, data[i].data, (int) strlen(data[i].data) * data[i].repeat);
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/,
+                    -1 /*option_2*/, -1 /*option_3*/, data[i].output_options, data_buf, -1, debug);
+        if (data[i].border_width != -1) {
+            symbol->border_width = data[i].border_width;
+        }
+        if (data[i].whitespace_width != -1) {
+            symbol->whitespace_width = data[i].whitespace_width;
+        }
+        if (data[i].fgcolour) {
+            strcpy(symbol->fgcolour, data[i].fgcolour);
+        }
+        if (data[i].bgcolour) {
+            strcpy(symbol->bgcolour, data[i].bgcolour);
+        }
+        if (data[i].scale) {
+            symbol->scale = data[i].scale;
+        }
+        symbol->dpmm = data[i].dpmm;
+
+        ret = ZBarcode_Encode(symbol, TCU(data_buf), length);
+        assert_zero(ret, "i:%d ZBarcode_Encode ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+
+        strcpy(symbol->outfile, ref_file);
+        ret = ZBarcode_Print(symbol, data[i].rotate_angle);
+        assert_zero(ret, "i:%d ZBarcode_Print ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+
+        strcpy(symbol->outfile, out_file);
+        symbol->png_options = ZINT_PNG_NATIVE;
+        ret = ZBarcode_Print(symbol, data[i].rotate_angle);
+        assert_zero(ret, "i:%d ZBarcode_Print native ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+
+        if (debug & ZINT_DEBUG_TEST_PRINT) {
+            printf("i:%d %s %dx%d\n", i, testUtilBarcodeName(data[i].symbology), symbol->bitmap_width,
+                    symbol->bitmap_height);
+        }
+
+        ret = testUtilCmpPngs(out_file, ref_file);
+        assert_zero(ret, "i:%d testUtilCmpPngs(%s, %s) %d != 0\n", i, out_file, ref_file, ret);
+
+        assert_zero(testUtilRemove(out_file), "i:%d testUtilRemove(%s) != 0\n", i, out_file);
+        assert_zero(testUtilRemove(ref_file), "i:%d testUtilRemove(%s) != 0\n", i, ref_file);
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+/* Inflate the native encoder's IDAT stream with zlib directly, checking chunk CRCs, stream length and filter bytes */
+static void test_native_inflate(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        const char *fgcolour;
+        const char *bgcolour;
+        float scale;
+        const char *data;
+        int repeat;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, NULL, NULL, 0.5f, "1", 1 }, /* Tiny, bit depth 1 */
+        /*  1*/ { BARCODE_MICROQR, NULL, NULL, 0.5f, "1", 1 },
+        /*  2*/ { BARCODE_DATAMATRIX, NULL, NULL, 0.5f, "1", 1 },
+        /*  3*/ { BARCODE_UPCE, NULL, NULL, 0.5f, "123456", 1 },
+        /*  4*/ { BARCODE_AZRUNE, NULL, NULL, 1, "1", 1 },
+        /*  5*/ { BARCODE_CODE128, "8899AA", NULL, 0.5f, "1", 1 }, /* High-byte literals (>= 144) */
+        /*  6*/ { BARCODE_MICROQR, "8899AA", "FFEEDD", 1, "1", 1 },
+        /*  7*/ { BARCODE_QRCODE, "FF00FF80", NULL, 3, "1234567890abcdefghij", 1 },
+        /*  8*/ { BARCODE_DATAMATRIX, "FEFDFC", "919293", 0.5f, "1234567890", 1 },
+        /*  9*/ { BARCODE_ULTRA, "C0C0C0", "F0F0F0", 1, "ABCDEFGHIJ", 1 }, /* Bit depth 4 */
+        /* 10*/ { BARCODE_MAXICODE, "AABBCC99", NULL, 1, "1234567890", 1 },
+        /* 11*/ { BARCODE_PDF417, "908070", NULL, 10, "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789", 20 }, /* Multiple IDATs */
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol = NULL;
+    char data_buf[1024];
+
+    const char *out_file = "test_png_native_inflate.png";
+    static const unsigned char png_sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    testStartSymbol("test_native_inflate", &symbol);
+
+    for (i = 0; i < data_size; i++) {
+        FILE *fp;
+        long file_len;
+        unsigned char *file_buf, *idat, *raw;
+        uLongf raw_len, expected_len;
+        int idat_len = 0, pos, row, row_bytes;
+        int width = 0, height = 0, bit_depth = 0, colour_type = -1, channels;
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        testUtilStrCpyRepeat(data_buf, data[i].data, (int) strlen(data[i].data) * data[i].repeat);
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/,
+                    -1 /*option_2*/, -1 /*option_3*/, -1 /*output_options*/, data_buf, -1, debug);
+        if (data[i].fgcolour) {
+            strcpy(symbol->fgcolour, data[i].fgcolour);
+        }
+        if (data[i].bgcolour) {
+            strcpy(symbol->bgcolour, data[i].bgcolour);
+        }
+        symbol->scale = data[i].scale;
+        symbol->png_options = ZINT_PNG_NATIVE;
+        strcpy(symbol->outfile, out_file);
+
+        ret = ZBarcode_Encode_and_Print(symbol, TCU(data_buf), length, 0);
+        assert_zero(ret, "i:%d ZBarcode_Encode_and_Print ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+
+        fp = testUtilOpen(out_file, "rb");
+        assert_nonnull(fp, "i:%d testUtilOpen(%s) failed\n", i, out_file);
+        assert_zero(fseek(fp, 0, SEEK_END), "i:%d fseek end fail\n", i);
+        file_len = ftell(fp);
+        assert_nonzero(file_len > 8, "i:%d file_len %ld <= 8\n", i, file_len);
+        assert_zero(fseek(fp, 0, SEEK_SET), "i:%d fseek start fail\n", i);
+        file_buf = (unsigned char *) malloc(file_len);
+        idat = (unsigned char *) malloc(file_len);
+        assert_nonnull(file_buf, "i:%d malloc file_buf fail\n", i);
+        assert_nonnull(idat, "i:%d malloc idat fail\n", i);
+        assert_equal((long) fread(file_buf, 1, file_len, fp), file_len, "i:%d fread fail\n", i);
+        assert_zero(fclose(fp), "i:%d fclose fail\n", i);
+
+        assert_zero(memcmp(file_buf, png_sig, 8), "i:%d PNG signature mismatch\n", i);
+        for (pos = 8; pos + 12 <= file_len; ) {
+            const unsigned char *const chunk = file_buf + pos;
+            const int chunk_len = (chunk[0] << 24) | (chunk[1] << 16) | (chunk[2] << 8) | chunk[3];
+            unsigned long crc;
+
+            assert_nonzero(chunk_len >= 0 && pos + 12 + chunk_len <= file_len, "i:%d chunk_len %d (pos %d) overruns\n",
+                        i, chunk_len, pos);
+            crc = ((unsigned long) chunk[8 + chunk_len] << 24) | (chunk[9 + chunk_len] << 16)
+                    | (chunk[10 + chunk_len] << 8) | chunk[11 + chunk_len];
+            assert_equal(crc32(0, chunk + 4, 4 + chunk_len), crc, "i:%d chunk %.4s CRC mismatch\n", i, chunk + 4);
+            if (memcmp(chunk + 4, "IHDR", 4) == 0) {
+                width = (chunk[8] << 24) | (chunk[9] << 16) | (chunk[10] << 8) | chunk[11];
+                height = (chunk[12] << 24) | (chunk[13] << 16) | (chunk[14] << 8) | chunk[15];
+                bit_depth = chunk[16];
+                colour_type = chunk[17];
+            } else if (memcmp(chunk + 4, "IDAT", 4) == 0) {
+                memcpy(idat + idat_len, chunk + 8, chunk_len);
+                idat_len += chunk_len;
+            }
+            pos += 12 + chunk_len;
+        }
+        assert_equal(pos, (int) file_len, "i:%d pos %d != file_len %ld\n", i, pos, file_len);
+        assert_equal(width, symbol->bitmap_width, "i:%d width %d != bitmap_width %d\n", i, width, symbol->bitmap_width);
+        assert_equal(height, symbol->bitmap_height, "i:%d height %d != bitmap_height %d\n",
+                    i, height, symbol->bitmap_height);
+        assert_nonzero(idat_len, "i:%d no IDAT\n", i);
+
+        channels = colour_type == 2 ? 3 : colour_type == 4 ? 2 : colour_type == 6 ? 4 : 1;
+        row_bytes = (width * channels * bit_depth + 7) / 8;
+        expected_len = (uLongf) height * (row_bytes + 1);
+        raw_len = expected_len + 1; /* Extra byte so overlong stream detected */
+        raw = (unsigned char *) malloc(raw_len);
+        assert_nonnull(raw, "i:%d malloc raw fail\n", i);
+
+        ret = uncompress(raw, &raw_len, idat, idat_len);
+        assert_equal(ret, Z_OK, "i:%d uncompress ret %d != Z_OK\n", i, ret);
+        assert_equal(raw_len, expected_len, "i:%d raw_len %lu != expected_len %lu\n",
+                    i, (unsigned long) raw_len, (unsigned long) expected_len);
+        for (row = 0; row < height; row++) {
+            assert_nonzero(raw[row * (row_bytes + 1)] <= 4, "i:%d row %d filter %d > 4\n",
+                        i, row, raw[row * (row_bytes + 1)]);
+        }
+
+        if (debug & ZINT_DEBUG_TEST_PRINT) {
+            printf("i:%d %s %dx%d depth %d colour type %d idat_len %d\n", i, testUtilBarcodeName(data[i].symbology),
+                    width, height, bit_depth, colour_type, idat_len);
+        }
+
+        free(raw);
+        free(idat);
+        free(file_buf);
+
+        assert_zero(testUtilRemove(out_file), "i:%d testUtilRemove(%s) != 0\n", i, out_file);
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
 /* Check compliant height printable for max CODABLOCKF with 44 rows * ((62 cols) * 0.55 + 3)) = 1632.4 */
 static void test_large_compliant_height(const testCtx *const p_ctx) {
     int ret;
@@ -502,6 +826,9 @@ int main(int argc, char *argv[]) {
         { "test_print", test_print },
         { "test_outfile", test_outfile },
         { "test_wpng_error_handler", test_wpng_error_handler },
+        { "test_options", test_options },
+        { "test_native", test_native },
+        { "test_native_inflate", test_native_inflate },
         { "test_large_compliant_height", test_large_compliant_height },
     };
 
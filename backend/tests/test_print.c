@@ -106,7 +106,10 @@ static void test_print(const testCtx *const p_ctx) {
 
     for (j = 0; j < exts_size; j++) {
 
-        if (ZBarcode_NoPng() && strcmp(exts[j], "png") == 0) continue;
+#ifdef ZINT_NO_PNG
+        /* Expected files made by libpng, so built-in encoder's output differs (and can't decode to compare) */
+        if (strcmp(exts[j], "png") == 0) continue;
+#endif
 
         assert_nonzero(sizeof(data_subdir) > strlen(data_dir) + 1 + strlen(exts[j]),
             "sizeof(data_subdir) (%d) <= strlen(data_dir) (%d) + 1 + strlen(%s) (%d)\n",
@@ -29,6 +29,8 @@
  */
 /* SPDX-License-Identifier: BSD-3-Clause */
 
+#include <limits.h>
+
 #include "testcommon.h"
 
 static int is_row_column_black(struct zint_symbol *symbol, int row, int column) {
@@ -2255,6 +2257,797 @@ static void test_buffer_plot(const testCtx *const p_ctx) {
     testFinish();
 }
 
+static void test_buffer_1bpp(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int output_options;
+        int rotate_angle;
+        int bitmap_stride;
+        const char *fgcolour;
+        const char *data;
+        int ret;
+        const char *expected_errtxt;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, -1, 0, 0, "", "A1234", 0, "" },
+        /*  1*/ { BARCODE_CODE128, -1, 0, 64, "", "A1234", 0, "" },
+        /*  2*/ { BARCODE_CODE128, -1, 0, 1, "", "A1234", ZINT_ERROR_INVALID_OPTION, "Error 666: Bitmap stride '1' too small (minimum 20 for width 158)" },
+        /*  3*/ { BARCODE_QRCODE, -1, 90, 0, "", "1234", 0, "" },
+        /*  4*/ { BARCODE_QRCODE, BARCODE_BOX, 270, 8, "FF000080", "1234", 0, "" },
+        /*  5*/ { BARCODE_PDF417, -1, 180, 0, "", "1234", 0, "" },
+        /*  6*/ { BARCODE_ULTRA, -1, 0, 0, "", "1234", 0, "" }, /* Colours, white as paper */
+        /*  7*/ { BARCODE_MAXICODE, -1, 0, 0, "", "1234", 0, "" },
+        /*  8*/ { BARCODE_EANX, -1, 0, 0, "", "123456789012", 0, "" }, /* HRT */
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol = NULL;
+    struct zint_symbol *expected = NULL;
+
+    int row, column, stride;
+
+    testStartSymbol("test_buffer_1bpp", &symbol);
+
+    for (i = 0; i < data_size; i++) {
+
+        if (testContinue(p_ctx, i)) continue;
+
+        expected = ZBarcode_Create();
+        assert_nonnull(expected, "Symbol not created\n");
+
+        /* Intermediate buffer to compare against */
+        length = testUtilSetSymbol(expected, data[i].symbology, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                    data[i].output_options == -1 ? OUT_BUFFER_INTERMEDIATE
+                                    : data[i].output_options | OUT_BUFFER_INTERMEDIATE, data[i].data, -1, debug);
+        ret = ZBarcode_Encode_and_Buffer(expected, TCU(data[i].data), length, data[i].rotate_angle);
+        assert_zero(ret, "i:%d ZBarcode_Encode_and_Buffer(%s) ret %d != 0 (%s)\n",
+                    i, testUtilBarcodeName(data[i].symbology), ret, expected->errtxt);
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                    data[i].output_options == -1 ? OUT_BUFFER_1BPP
+                                    : data[i].output_options | OUT_BUFFER_1BPP, data[i].data, -1, debug);
+        symbol->bitmap_stride = data[i].bitmap_stride;
+        if (*data[i].fgcolour) {
+            strcpy(symbol->fgcolour, data[i].fgcolour);
+        }
+        ret = ZBarcode_Encode_and_Buffer(symbol, TCU(data[i].data), length, data[i].rotate_angle);
+        assert_equal(ret, data[i].ret, "i:%d ZBarcode_Encode_and_Buffer(%s) ret %d != %d (%s)\n",
+                    i, testUtilBarcodeName(data[i].symbology), ret, data[i].ret, symbol->errtxt);
+        assert_zero(strcmp(symbol->errtxt, data[i].expected_errtxt), "i:%d errtxt %s != %s\n",
+                    i, symbol->errtxt, data[i].expected_errtxt);
+
+        if (ret < ZINT_ERROR) {
+            assert_nonnull(symbol->bitmap, "i:%d bitmap NULL\n", i);
+            assert_null(symbol->alphamap, "i:%d alphamap not NULL\n", i);
+            assert_equal(symbol->bitmap_width, expected->bitmap_width, "i:%d bitmap_width %d != %d\n",
+                        i, symbol->bitmap_width, expected->bitmap_width);
+            assert_equal(symbol->bitmap_height, expected->bitmap_height, "i:%d bitmap_height %d != %d\n",
+                        i, symbol->bitmap_height, expected->bitmap_height);
+            stride = data[i].bitmap_stride ? data[i].bitmap_stride : (symbol->bitmap_width + 7) / 8;
+            assert_nonzero(symbol->bitmap_capacity >= stride * symbol->bitmap_height,
+                        "i:%d bitmap_capacity %d < %d\n", i, symbol->bitmap_capacity, stride * symbol->bitmap_height);
+
+            for (row = 0; row < symbol->bitmap_height; row++) {
+                const unsigned char *bm = symbol->bitmap + stride * row;
+                for (column = 0; column < symbol->bitmap_width; column++) {
+                    const unsigned char ch = expected->bitmap[row * expected->bitmap_width + column];
+                    const int bit = (bm[column >> 3] >> (7 - (column & 7))) & 1;
+                    assert_equal(bit, ch != '0' && ch != 'W', "i:%d row %d column %d bit %d != '%c'\n",
+                                i, row, column, bit, ch);
+                }
+                for (; column < stride * 8; column++) { /* Padding zero */
+                    const int bit = (bm[column >> 3] >> (7 - (column & 7))) & 1;
+                    assert_zero(bit, "i:%d row %d padding column %d bit set\n", i, row, column);
+                }
+            }
+        }
+
+        ZBarcode_Delete(expected);
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+static void test_buffer_rgba(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int output_options;
+        int rotate_angle;
+        const char *fgcolour;
+        const char *bgcolour;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, OUT_BUFFER_RGBA, 0, "", "" },
+        /*  1*/ { BARCODE_CODE128, OUT_BUFFER_RGBA, 0, "FF000080", "00FF0010" },
+        /*  2*/ { BARCODE_CODE128, OUT_BUFFER_RGBA | OUT_BUFFER_PREMULTIPLIED, 0, "FF000080", "00FF0010" },
+        /*  3*/ { BARCODE_QRCODE, OUT_BUFFER_RGBA, 90, "123456", "ABCDEF00" },
+        /*  4*/ { BARCODE_QRCODE, OUT_BUFFER_RGBA | OUT_BUFFER_PREMULTIPLIED, 270, "123456", "ABCDEF00" },
+        /*  5*/ { BARCODE_ULTRA, OUT_BUFFER_RGBA, 0, "", "" },
+        /*  6*/ { BARCODE_ULTRA, OUT_BUFFER_RGBA | OUT_BUFFER_PREMULTIPLIED, 180, "000000C0", "FFFFFF40" },
+        /*  7*/ { BARCODE_MAXICODE, OUT_BUFFER_RGBA, 0, "", "FFFFFF00" },
+        /*  8*/ { BARCODE_DOTCODE, OUT_BUFFER_RGBA | BARCODE_RETAIN_BUFFERS, 0, "", "" },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol = NULL;
+    struct zint_symbol *expected = NULL;
+
+    int p, j;
+
+    testStartSymbol("test_buffer_rgba", &symbol);
+
+    for (i = 0; i < data_size; i++) {
+
+        if (testContinue(p_ctx, i)) continue;
+
+        /* Separate RGB and alphamap to compare against */
+        expected = ZBarcode_Create();
+        assert_nonnull(expected, "Symbol not created\n");
+        length = testUtilSetSymbol(expected, data[i].symbology, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                    -1 /*output_options*/, "1234", -1, debug);
+        if (*data[i].fgcolour) {
+            strcpy(expected->fgcolour, data[i].fgcolour);
+        }
+        if (*data[i].bgcolour) {
+            strcpy(expected->bgcolour, data[i].bgcolour);
+        }
+        ret = ZBarcode_Encode_and_Buffer(expected, TCU("1234"), length, data[i].rotate_angle);
+        assert_zero(ret, "i:%d ZBarcode_Encode_and_Buffer ret %d != 0 (%s)\n", i, ret, expected->errtxt);
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+        length = testUtilSetSymbol(symbol, data[i].symbology, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                    data[i].output_options, "1234", -1, debug);
+        if (*data[i].fgcolour) {
+            strcpy(symbol->fgcolour, data[i].fgcolour);
+        }
+        if (*data[i].bgcolour) {
+            strcpy(symbol->bgcolour, data[i].bgcolour);
+        }
+        ret = ZBarcode_Encode_and_Buffer(symbol, TCU("1234"), length, data[i].rotate_angle);
+        assert_zero(ret, "i:%d ZBarcode_Encode_and_Buffer ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+
+        assert_nonnull(symbol->bitmap, "i:%d bitmap NULL\n", i);
+        assert_null(symbol->alphamap, "i:%d alphamap not NULL\n", i);
+        assert_equal(symbol->bitmap_width, expected->bitmap_width, "i:%d bitmap_width %d != %d\n",
+                    i, symbol->bitmap_width, expected->bitmap_width);
+        assert_equal(symbol->bitmap_height, expected->bitmap_height, "i:%d bitmap_height %d != %d\n",
+                    i, symbol->bitmap_height, expected->bitmap_height);
+        assert_nonzero(symbol->bitmap_capacity >= symbol->bitmap_width * symbol->bitmap_height * 4,
+                    "i:%d bitmap_capacity %d too small\n", i, symbol->bitmap_capacity);
+
+        for (p = 0; p < symbol->bitmap_width * symbol->bitmap_height; p++) {
+            const unsigned char *rgba = symbol->bitmap + p * 4;
+            const unsigned char *rgb = expected->bitmap + p * 3;
+            const int a = expected->alphamap ? expected->alphamap[p] : 0xFF;
+            assert_equal(rgba[3], a, "i:%d pixel %d alpha %d != %d\n", i, p, rgba[3], a);
+            for (j = 0; j < 3; j++) {
+                const int c = (data[i].output_options & OUT_BUFFER_PREMULTIPLIED) ? (rgb[j] * a + 0x7F) / 0xFF
+                                : rgb[j];
+                assert_equal(rgba[j], c, "i:%d pixel %d channel %d %d != %d\n", i, p, j, rgba[j], c);
+            }
+        }
+
+        ZBarcode_Delete(expected);
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+static void test_buffer_into(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int rotate_angle;
+        const char *fgcolour;
+        const char *bgcolour;
+        int dst_width;
+        int dst_height;
+        int dst_stride; /* 0 means minimum */
+        int dst_format;
+        int x;
+        int y;
+        int ret;
+        const char *expected_errtxt;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, 0, "", "", 400, 200, 0, ZINT_PIXEL_RGB24, 10, 20, 0, "" },
+        /*  1*/ { BARCODE_CODE128, 0, "", "", 400, 200, 1300, ZINT_PIXEL_RGB24, 10, 20, 0, "" },
+        /*  2*/ { BARCODE_CODE128, 0, "", "", 400, 200, 0, ZINT_PIXEL_GREY8, 0, 0, 0, "" },
+        /*  3*/ { BARCODE_CODE128, 0, "", "", 400, 200, 0, ZINT_PIXEL_RGBA32, 7, 3, 0, "" },
+        /*  4*/ { BARCODE_CODE128, 0, "", "", 400, 200, 0, ZINT_PIXEL_1BPP, 3, 5, 0, "" },
+        /*  5*/ { BARCODE_CODE128, 0, "", "", 100, 60, 0, ZINT_PIXEL_RGB24, -5, -3, 0, "" }, /* Clipped */
+        /*  6*/ { BARCODE_CODE128, 0, "", "", 100, 60, 0, ZINT_PIXEL_1BPP, 90, 50, 0, "" }, /* Clipped */
+        /*  7*/ { BARCODE_CODE128, 0, "", "", 100, 60, 0, ZINT_PIXEL_GREY8, 100, 0, 0, "" }, /* All clipped */
+        /*  8*/ { BARCODE_QRCODE, 90, "112233", "FFFFFF00", 100, 100, 0, ZINT_PIXEL_RGB24, 1, 2, 0, "" }, /* Transparent */
+        /*  9*/ { BARCODE_QRCODE, 180, "11223380", "", 100, 100, 0, ZINT_PIXEL_GREY8, 1, 2, 0, "" }, /* Blended */
+        /* 10*/ { BARCODE_QRCODE, 270, "11223380", "", 100, 100, 0, ZINT_PIXEL_RGBA32, 1, 2, 0, "" }, /* Blended */
+        /* 11*/ { BARCODE_ULTRA, 0, "", "", 100, 100, 0, ZINT_PIXEL_RGB24, 0, 0, 0, "" },
+        /* 12*/ { BARCODE_ULTRA, 0, "", "", 100, 100, 0, ZINT_PIXEL_1BPP, 0, 0, 0, "" },
+        /* 13*/ { BARCODE_MAXICODE, 0, "", "", 100, 100, 0, ZINT_PIXEL_GREY8, 0, 0, 0, "" },
+        /* 14*/ { BARCODE_QRCODE, 0, "", "", 100, 100, 0, ZINT_PIXEL_RGB24, -500, 0, 0, "" }, /* Wholly outside left */
+        /* 15*/ { BARCODE_QRCODE, 0, "", "", 100, 100, 0, ZINT_PIXEL_RGB24, 200, 0, 0, "" }, /* Wholly outside right */
+        /* 16*/ { BARCODE_QRCODE, 0, "", "", 100, 100, 0, ZINT_PIXEL_RGB24, 0, -500, 0, "" }, /* Wholly outside above */
+        /* 17*/ { BARCODE_QRCODE, 0, "", "", 100, 100, 0, ZINT_PIXEL_RGB24, 0, 200, 0, "" }, /* Wholly outside below */
+        /* 18*/ { BARCODE_QRCODE, 0, "", "", 100, 100, 0, ZINT_PIXEL_1BPP, 200, 200, 0, "" },
+        /* 19*/ { BARCODE_QRCODE, 0, "11223380", "", 100, 100, 0, ZINT_PIXEL_RGBA32, -500, -500, 0, "" },
+        /* 20*/ { BARCODE_QRCODE, 0, "", "", 100, 100, 0, ZINT_PIXEL_RGB24, 0x100000, -0x100000, 0, "" }, /* Offset limits */
+        /* 21*/ { BARCODE_QRCODE, 0, "", "", 100, 100, 0, ZINT_PIXEL_GREY8, -0x100000, 0x100000, 0, "" },
+        /* 22*/ { BARCODE_CODE128, 0, "", "", 400, 200, 0, 0, 0, 0, ZINT_ERROR_INVALID_OPTION, "Error 265: Destination format '0' out of range (1 to 4)" },
+        /* 23*/ { BARCODE_CODE128, 0, "", "", 0, 200, 0, ZINT_PIXEL_RGB24, 0, 0, ZINT_ERROR_INVALID_OPTION, "Error 266: Destination size 0x200 out of range (1 to 1048576)" },
+        /* 24*/ { BARCODE_CODE128, 0, "", "", 400, 200, 1199, ZINT_PIXEL_RGB24, 0, 0, ZINT_ERROR_INVALID_OPTION, "Error 267: Destination stride '1199' too small (minimum 1200)" },
+        /* 25*/ { BARCODE_CODE128, 0, "", "", 17, 200, 2, ZINT_PIXEL_1BPP, 0, 0, ZINT_ERROR_INVALID_OPTION, "Error 267: Destination stride '2' too small (minimum 3)" },
+        /* 26*/ { BARCODE_CODE128, 0, "", "", 400, 200, 0, ZINT_PIXEL_RGB24, 0x100001, 0, ZINT_ERROR_INVALID_OPTION, "Error 268: Destination offset 1048577,0 out of range (-1048576 to 1048576)" },
+        /* 27*/ { BARCODE_CODE128, 0, "", "", 400, 200, 0, ZINT_PIXEL_RGB24, 0, -0x100001, ZINT_ERROR_INVALID_OPTION, "Error 268: Destination offset 0,-1048577 out of range (-1048576 to 1048576)" },
+        /* 28*/ { BARCODE_CODE128, 0, "", "", 400, 200, 0, ZINT_PIXEL_RGB24, INT_MAX - 10, 0, ZINT_ERROR_INVALID_OPTION, "Error 268: Destination offset 2147483637,0 out of range (-1048576 to 1048576)" },
+        /* 29*/ { BARCODE_CODE128, 0, "", "", 400, 200, 0, ZINT_PIXEL_1BPP, INT_MIN, INT_MIN, ZINT_ERROR_INVALID_OPTION, "Error 268: Destination offset -2147483648,-2147483648 out of range (-1048576 to 1048576)" },
+        /* 30*/ { BARCODE_CODE128, 0, "", "", 400, 200, 0, ZINT_PIXEL_RGBA32, 0, INT_MAX, ZINT_ERROR_INVALID_OPTION, "Error 268: Destination offset 0,2147483647 out of range (-1048576 to 1048576)" },
+    };
+    static const int bpps[5] = { 0, 1, 3, 4, 0 };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol = NULL;
+    unsigned char *dst, *orig;
+    size_t dst_size;
+    int stride, bpp, row, column, j;
+
+    testStartSymbol("test_buffer_into", &symbol);
+
+    for (i = 0; i < data_size; i++) {
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                    -1 /*output_options*/, "1234", -1, debug);
+        if (*data[i].fgcolour) {
+            strcpy(symbol->fgcolour, data[i].fgcolour);
+        }
+        if (*data[i].bgcolour) {
+            strcpy(symbol->bgcolour, data[i].bgcolour);
+        }
+        ret = ZBarcode_Encode(symbol, TCU("1234"), length);
+        assert_zero(ret, "i:%d ZBarcode_Encode ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+
+        bpp = bpps[data[i].dst_format > ZINT_PIXEL_1BPP ? 0 : data[i].dst_format];
+        stride = data[i].dst_stride ? data[i].dst_stride : data[i].dst_format == ZINT_PIXEL_1BPP
+                    ? (data[i].dst_width + 7) / 8 : data[i].dst_width * bpp;
+        dst_size = (size_t) (stride ? stride : 1) * (data[i].dst_height ? data[i].dst_height : 1);
+        dst = (unsigned char *) malloc(dst_size);
+        orig = (unsigned char *) malloc(dst_size);
+        assert_nonnull(dst, "i:%d dst NULL\n", i);
+        assert_nonnull(orig, "i:%d orig NULL\n", i);
+        for (j = 0; j < (int) dst_size; j++) {
+            orig[j] = (unsigned char) (j * 7 + 0x55); /* Background pattern */
+        }
+        memcpy(dst, orig, dst_size);
+
+        if (i == 0) {
+            ret = ZBarcode_Buffer_Into(symbol, 0, NULL, data[i].dst_width, data[i].dst_height, stride,
+                                        data[i].dst_format, 0, 0);
+            assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "i:%d ZBarcode_Buffer_Into(NULL) ret %d != %d\n",
+                        i, ret, ZINT_ERROR_INVALID_OPTION);
+            assert_zero(strcmp(symbol->errtxt, "Error 264: Destination buffer NULL"), "i:%d errtxt %s\n",
+                        i, symbol->errtxt);
+            symbol->errtxt[0] = '\0';
+        }
+
+        ret = ZBarcode_Buffer_Into(symbol, data[i].rotate_angle, dst, data[i].dst_width, data[i].dst_height, stride,
+                                    data[i].dst_format, data[i].x, data[i].y);
+        assert_equal(ret, data[i].ret, "i:%d ZBarcode_Buffer_Into ret %d != %d (%s)\n",
+                    i, ret, data[i].ret, symbol->errtxt);
+        assert_zero(strcmp(symbol->errtxt, data[i].expected_errtxt), "i:%d errtxt %s != %s\n",
+                    i, symbol->errtxt, data[i].expected_errtxt);
+        assert_null(symbol->bitmap, "i:%d bitmap not NULL\n", i);
+
+        if (ret < ZINT_ERROR) {
+            /* Compare against regular RGB buffer */
+            ret = ZBarcode_Buffer(symbol, data[i].rotate_angle);
+            assert_zero(ret, "i:%d ZBarcode_Buffer ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+
+            for (row = 0; row < data[i].dst_height; row++) {
+                for (column = 0; column < data[i].dst_width; column++) {
+                    const int sx = column - data[i].x, sy = row - data[i].y;
+                    const int inside = sx >= 0 && sx < symbol->bitmap_width && sy >= 0 && sy < symbol->bitmap_height;
+                    const unsigned char *rgb = inside ? symbol->bitmap + ((size_t) sy * symbol->bitmap_width + sx) * 3
+                                                : NULL;
+                    const int a = inside && symbol->alphamap ? symbol->alphamap[sy * symbol->bitmap_width + sx]
+                                    : 0xFF;
+                    const size_t o = (size_t) stride * row;
+                    if (data[i].dst_format == ZINT_PIXEL_1BPP) {
+                        const int bit = (dst[o + (column >> 3)] >> (7 - (column & 7))) & 1;
+                        const int orig_bit = (orig[o + (column >> 3)] >> (7 - (column & 7))) & 1;
+                        if (!inside) {
+                            assert_equal(bit, orig_bit, "i:%d row %d column %d bit %d != orig %d\n",
+                                        i, row, column, bit, orig_bit);
+                        } else {
+                            /* Default colours so ink black, Ultracode white paper */
+                            const int ink = !(rgb[0] == 0xFF && rgb[1] == 0xFF && rgb[2] == 0xFF);
+                            assert_equal(bit, ink, "i:%d row %d column %d bit %d != ink %d\n",
+                                        i, row, column, bit, ink);
+                        }
+                    } else {
+                        const unsigned char *d = dst + o + (size_t) column * bpp;
+                        const unsigned char *od = orig + o + (size_t) column * bpp;
+                        if (!inside || a == 0) {
+                            assert_zero(memcmp(d, od, bpp), "i:%d row %d column %d changed\n", i, row, column);
+                        } else if (data[i].dst_format == ZINT_PIXEL_GREY8) {
+                            const int grey = (rgb[0] * 299 + rgb[1] * 587 + rgb[2] * 114 + 500) / 1000;
+                            const int expected = (grey * a + od[0] * (0xFF - a) + 0x7F) / 0xFF;
+                            assert_equal(d[0], expected, "i:%d row %d column %d grey %d != %d\n",
+                                        i, row, column, d[0], expected);
+                        } else if (a == 0xFF) {
+                            assert_zero(memcmp(d, rgb, 3), "i:%d row %d column %d rgb %02X%02X%02X != %02X%02X%02X\n",
+                                        i, row, column, d[0], d[1], d[2], rgb[0], rgb[1], rgb[2]);
+                            if (bpp == 4) {
+                                assert_equal(d[3], 0xFF, "i:%d row %d column %d alpha %d != 255\n",
+                                            i, row, column, d[3]);
+                            }
+                        } else if (bpp == 3) {
+                            for (j = 0; j < 3; j++) {
+                                const int expected = (rgb[j] * a + od[j] * (0xFF - a) + 0x7F) / 0xFF;
+                                assert_equal(d[j], expected, "i:%d row %d column %d channel %d %d != %d\n",
+                                            i, row, column, j, d[j], expected);
+                            }
+                        } else {
+                            const int da = (od[3] * (0xFF - a) + 0x7F) / 0xFF;
+                            assert_equal(d[3], a + da, "i:%d row %d column %d alpha %d != %d\n",
+                                        i, row, column, d[3], a + da);
+                        }
+                    }
+                }
+            }
+        }
+
+        free(dst);
+        free(orig);
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+static void test_rows(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        float scale;
+        int rotate_angle;
+        const char *data;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, 1.3f, 0, "A1234" },
+        /*  1*/ { BARCODE_CODE128, 1.3f, 90, "A1234" },
+        /*  2*/ { BARCODE_CODE128, 1.3f, 180, "A1234" },
+        /*  3*/ { BARCODE_CODE128, 1.3f, 270, "A1234" },
+        /*  4*/ { BARCODE_QRCODE, 0.7f, 90, "1234" },
+        /*  5*/ { BARCODE_QRCODE, 2.5f, 270, "1234" }, /* Half-integer, not scaled on output */
+        /*  6*/ { BARCODE_PDF417, 3.2f, 180, "1234" },
+        /*  7*/ { BARCODE_EANX, 2.1f, 90, "123456789012" }, /* HRT */
+        /*  8*/ { BARCODE_MAXICODE, 1.0f, 270, "1234" },
+        /*  9*/ { BARCODE_DOTCODE, 1.6f, 90, "1234" },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol = NULL;
+    struct zint_symbol *base = NULL;
+
+    int row, column;
+
+    testStartSymbol("test_rows", &symbol);
+
+    for (i = 0; i < data_size; i++) {
+        int width, height, data_offset, row_size;
+
+        if (testContinue(p_ctx, i)) continue;
+
+        base = ZBarcode_Create();
+        assert_nonnull(base, "Symbol not created\n");
+
+        /* Unrotated buffer to compare against */
+        length = testUtilSetSymbol(base, data[i].symbology, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                    OUT_BUFFER_INTERMEDIATE, data[i].data, -1, debug);
+        base->scale = data[i].scale;
+        ret = ZBarcode_Encode_and_Buffer(base, TCU(data[i].data), length, 0 /*rotate_angle*/);
+        assert_zero(ret, "i:%d ZBarcode_Encode_and_Buffer(%s) ret %d != 0 (%s)\n",
+                    i, testUtilBarcodeName(data[i].symbology), ret, base->errtxt);
+        width = base->bitmap_width;
+        height = base->bitmap_height;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                    OUT_BUFFER_INTERMEDIATE, data[i].data, -1, debug);
+        symbol->scale = data[i].scale;
+        ret = ZBarcode_Encode_and_Buffer(symbol, TCU(data[i].data), length, data[i].rotate_angle);
+        assert_zero(ret, "i:%d ZBarcode_Encode_and_Buffer(%s) ret %d != 0 (%s)\n",
+                    i, testUtilBarcodeName(data[i].symbology), ret, symbol->errtxt);
+
+        if (data[i].rotate_angle == 90 || data[i].rotate_angle == 270) {
+            assert_equal(symbol->bitmap_width, height, "i:%d bitmap_width %d != %d\n",
+                        i, symbol->bitmap_width, height);
+            assert_equal(symbol->bitmap_height, width, "i:%d bitmap_height %d != %d\n",
+                        i, symbol->bitmap_height, width);
+        } else {
+            assert_equal(symbol->bitmap_width, width, "i:%d bitmap_width %d != %d\n", i, symbol->bitmap_width, width);
+            assert_equal(symbol->bitmap_height, height, "i:%d bitmap_height %d != %d\n",
+                        i, symbol->bitmap_height, height);
+        }
+        for (row = 0; row < symbol->bitmap_height; row++) {
+            for (column = 0; column < symbol->bitmap_width; column++) {
+                int x, y;
+                switch (data[i].rotate_angle) {
+                    case 90: x = row; y = height - column - 1; break;
+                    case 180: x = width - column - 1; y = height - row - 1; break;
+                    case 270: x = width - row - 1; y = column; break;
+                    default: x = column; y = row; break;
+                }
+                assert_equal(symbol->bitmap[row * symbol->bitmap_width + column], base->bitmap[y * width + x],
+                            "i:%d row %d column %d '%c' != '%c'\n",
+                            i, row, column, symbol->bitmap[row * symbol->bitmap_width + column],
+                            base->bitmap[y * width + x]);
+            }
+        }
+
+        /* BMP output is streamed row by row, so check it matches */
+        symbol->output_options |= BARCODE_MEMORY_FILE;
+        strcpy(symbol->outfile, "out.bmp");
+        ret = ZBarcode_Print(symbol, data[i].rotate_angle);
+        assert_zero(ret, "i:%d ZBarcode_Print(%s) ret %d != 0 (%s)\n",
+                    i, testUtilBarcodeName(data[i].symbology), ret, symbol->errtxt);
+        assert_nonnull(symbol->memfile, "i:%d memfile NULL\n", i);
+
+        data_offset = symbol->memfile[10] | (symbol->memfile[11] << 8) | (symbol->memfile[12] << 16);
+        row_size = 4 * ((symbol->bitmap_width + 31) / 32);
+        assert_equal(symbol->memfile_size, data_offset + row_size * symbol->bitmap_height,
+                    "i:%d memfile_size %d != %d\n",
+                    i, symbol->memfile_size, data_offset + row_size * symbol->bitmap_height);
+        for (row = 0; row < symbol->bitmap_height; row++) {
+            const unsigned char *bm = symbol->memfile + data_offset
+                                        + row_size * (symbol->bitmap_height - row - 1);
+            for (column = 0; column < symbol->bitmap_width; column++) {
+                const unsigned char ch = symbol->bitmap[row * symbol->bitmap_width + column];
+                const int bit = (bm[column >> 3] >> (7 - (column & 7))) & 1;
+                assert_equal(bit, ch != '0', "i:%d row %d column %d bit %d != '%c'\n", i, row, column, bit, ch);
+            }
+        }
+
+        ZBarcode_Delete(base);
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+static void test_glyph_cache(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int output_options;
+        float scale;
+        const char *data;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, -1, 0.5f, "Az{}~" }, /* `si` 1, not cached */
+        /*  1*/ { BARCODE_CODE128, -1, 1.0f, "Az{}~" },
+        /*  2*/ { BARCODE_CODE128, -1, 1.5f, "Az{}~" }, /* Odd `si` */
+        /*  3*/ { BARCODE_CODE128, -1, 3.5f, "Az{}~" },
+        /*  4*/ { BARCODE_CODE128, BOLD_TEXT, 1.0f, "Az{}~" },
+        /*  5*/ { BARCODE_CODE128, BOLD_TEXT, 2.5f, "Az{}~" },
+        /*  6*/ { BARCODE_CODE128, SMALL_TEXT, 1.5f, "Az{}~" },
+        /*  7*/ { BARCODE_CODE128, SMALL_TEXT, 4.0f, "Az{}~" },
+        /*  8*/ { BARCODE_CODE128, -1, 2.0f, "\302\241\303\277" }, /* ¡ÿ (ISO/IEC 8859-1 glyphs) */
+        /*  9*/ { BARCODE_EANX, -1, 1.0f, "123456789012+12" },
+        /* 10*/ { BARCODE_EANX, -1, 2.5f, "123456789012+12" },
+        /* 11*/ { BARCODE_EANX, SMALL_TEXT, 3.5f, "123456789012+12345" },
+        /* 12*/ { BARCODE_UPCA, -1, 1.5f, "12345678901" },
+        /* 13*/ { BARCODE_UPCE, SMALL_TEXT, 2.0f, "1234567" },
+        /* 14*/ { BARCODE_CODE11, -1, 0.5f, "1" }, /* Text wider than symbol, clipped, not cached */
+        /* 15*/ { BARCODE_CODE11, -1, 3.0f, "1" },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol = NULL;
+    struct zint_symbol *uncached = NULL;
+
+    testStartSymbol("test_glyph_cache", &symbol);
+
+    for (i = 0; i < data_size; i++) {
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                    data[i].output_options, data[i].data, -1, debug);
+        symbol->scale = data[i].scale;
+        ret = ZBarcode_Encode_and_Buffer(symbol, TCU(data[i].data), length, 0);
+        assert_zero(ret, "i:%d ZBarcode_Encode_and_Buffer(%s) ret %d != 0 (%s)\n",
+                    i, testUtilBarcodeName(data[i].symbology), ret, symbol->errtxt);
+
+        /* `ZINT_DEBUG_TEST` bypasses the glyph cache */
+        uncached = ZBarcode_Create();
+        assert_nonnull(uncached, "Symbol not created\n");
+
+        length = testUtilSetSymbol(uncached, data[i].symbology, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                    data[i].output_options, data[i].data, -1, debug | ZINT_DEBUG_TEST);
+        uncached->scale = data[i].scale;
+        ret = ZBarcode_Encode_and_Buffer(uncached, TCU(data[i].data), length, 0);
+        assert_zero(ret, "i:%d ZBarcode_Encode_and_Buffer(%s) uncached ret %d != 0 (%s)\n",
+                    i, testUtilBarcodeName(data[i].symbology), ret, uncached->errtxt);
+
+        assert_equal(symbol->bitmap_width, uncached->bitmap_width, "i:%d bitmap_width %d != %d\n",
+                    i, symbol->bitmap_width, uncached->bitmap_width);
+        assert_equal(symbol->bitmap_height, uncached->bitmap_height, "i:%d bitmap_height %d != %d\n",
+                    i, symbol->bitmap_height, uncached->bitmap_height);
+        assert_zero(memcmp(symbol->bitmap, uncached->bitmap, (size_t) symbol->bitmap_width * symbol->bitmap_height),
+                    "i:%d bitmaps differ\n", i);
+
+        ZBarcode_Delete(uncached);
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+/* Render symbols with many different dot and hexagon sizes on multiple threads at once, so that the process-wide
+   stamp cache (and glyph cache) is filled concurrently, checking against renders made afterwards on one thread.
+   Run before `test_stamp_cache()`, which fills the cache */
+static void test_stamp_cache_threads(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct zint_batch items[48];
+    const int item_count = ARRAY_SIZE(items);
+    int i, length, ret;
+    struct zint_symbol *other;
+
+    testStart("test_stamp_cache_threads");
+
+    memset(items, 0, sizeof(items));
+    for (i = 0; i < item_count; i++) {
+        const int symbology = i % 3 == 0 ? BARCODE_MAXICODE : BARCODE_DOTCODE;
+        items[i].symbol = ZBarcode_Create();
+        assert_nonnull(items[i].symbol, "i:%d Symbol not created\n", i);
+        length = testUtilSetSymbol(items[i].symbol, symbology, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                    -1 /*output_options*/, "1234", -1, debug);
+        items[i].symbol->scale = 1.0f + (i % 8) * 0.5f;
+        items[i].symbol->dot_size = 0.6f + (i / 8) * 0.3f;
+        items[i].source = TCU("1234");
+        items[i].length = length;
+    }
+
+    ret = ZBarcode_Encode_Batch(items, item_count, ZINT_BATCH_BUFFER, 0, 8 /*num_threads*/);
+    assert_zero(ret, "ZBarcode_Encode_Batch ret %d != 0\n", ret);
+
+    for (i = 0; i < item_count; i++) {
+        const struct zint_symbol *const symbol = items[i].symbol;
+        assert_zero(items[i].ret, "i:%d ret %d != 0 (%s)\n", i, items[i].ret, symbol->errtxt);
+
+        other = ZBarcode_Create();
+        assert_nonnull(other, "i:%d Symbol not created\n", i);
+        length = testUtilSetSymbol(other, symbol->symbology, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                    -1 /*output_options*/, "1234", -1, debug);
+        other->scale = symbol->scale;
+        other->dot_size = symbol->dot_size;
+        ret = ZBarcode_Encode_and_Buffer(other, TCU("1234"), length, 0);
+        assert_zero(ret, "i:%d ZBarcode_Encode_and_Buffer ret %d != 0 (%s)\n", i, ret, other->errtxt);
+
+        assert_equal(symbol->bitmap_width, other->bitmap_width, "i:%d bitmap_width %d != %d\n",
+                    i, symbol->bitmap_width, other->bitmap_width);
+        assert_equal(symbol->bitmap_height, other->bitmap_height, "i:%d bitmap_height %d != %d\n",
+                    i, symbol->bitmap_height, other->bitmap_height);
+        assert_zero(memcmp(symbol->bitmap, other->bitmap, (size_t) symbol->bitmap_width * symbol->bitmap_height * 3),
+                    "i:%d bitmaps differ\n", i);
+
+        ZBarcode_Delete(other);
+        ZBarcode_Delete(items[i].symbol);
+    }
+
+    testFinish();
+}
+
+static void test_stamp_cache(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int output_options;
+        float scale;
+        float dot_size;
+        const char *data;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_MAXICODE, -1, 0.5f, -1, "1234" },
+        /*  1*/ { BARCODE_MAXICODE, -1, 1.0f, -1, "1234" },
+        /*  2*/ { BARCODE_MAXICODE, -1, 3.7f, -1, "1234" },
+        /*  3*/ { BARCODE_DOTCODE, -1, 1.0f, -1, "1234" },
+        /*  4*/ { BARCODE_DOTCODE, -1, 4.5f, 0.5f, "1234" },
+        /*  5*/ { BARCODE_DOTCODE, -1, 2.0f, 2.5f, "1234" }, /* Dots overlap and overspill */
+        /*  6*/ { BARCODE_QRCODE, BARCODE_DOTTY_MODE, 3.0f, -1, "1234" },
+        /*  7*/ { BARCODE_QRCODE, BARCODE_DOTTY_MODE, 1.5f, 1.0f, "1234" },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, j, length, ret;
+    struct zint_symbol *symbol = NULL;
+    struct zint_symbol *other = NULL;
+    unsigned char *bitmap;
+    size_t bitmap_size;
+    int filled = 0;
+
+    testStartSymbol("test_stamp_cache", &symbol);
+
+    for (i = 0; i < data_size; i++) {
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                    data[i].output_options, data[i].data, -1, debug);
+        symbol->scale = data[i].scale;
+        if (data[i].dot_size != -1) {
+            symbol->dot_size = data[i].dot_size;
+        }
+        ret = ZBarcode_Encode_and_Buffer(symbol, TCU(data[i].data), length, 0);
+        assert_zero(ret, "i:%d ZBarcode_Encode_and_Buffer(%s) ret %d != 0 (%s)\n",
+                    i, testUtilBarcodeName(data[i].symbology), ret, symbol->errtxt);
+        bitmap_size = (size_t) symbol->bitmap_width * symbol->bitmap_height;
+        bitmap = (unsigned char *) malloc(bitmap_size);
+        assert_nonnull(bitmap, "i:%d bitmap NULL\n", i);
+        memcpy(bitmap, symbol->bitmap, bitmap_size);
+
+        /* Once only (the cache is process-wide and never emptied), render enough other sizes to fill the cache, so
+           that this symbol is re-rendered from the cache, and symbols after it from stamps made per render */
+        if (!filled) {
+            /* Each `dot_size` gives a different dot radius at scale 2, and a small image. 33 is one more than
+               STAMP_MAX_CACHED in "backend/raster.c" */
+            for (j = 0; j < 33; j++) {
+                other = ZBarcode_Create();
+                assert_nonnull(other, "Symbol not created\n");
+                length = testUtilSetSymbol(other, BARCODE_DOTCODE, UNICODE_MODE, -1 /*eci*/, -1, -1, -1,
+                                            -1 /*output_options*/, "1", -1, debug);
+                other->scale = 2.0f;
+                other->dot_size = 0.5f + j * 0.5f;
+                ret = ZBarcode_Encode_and_Buffer(other, TCU("1"), length, 0);
+                assert_zero(ret, "i:%d j:%d ZBarcode_Encode_and_Buffer ret %d != 0 (%s)\n",
+                            i, j, ret, other->errtxt);
+                ZBarcode_Delete(other);
+            }
+            filled = 1;
+        }
+
+        ret = ZBarcode_Buffer(symbol, 0);
+        assert_zero(ret, "i:%d ZBarcode_Buffer(%s) ret %d != 0 (%s)\n",
+                    i, testUtilBarcodeName(data[i].symbology), ret, symbol->errtxt);
+        assert_equal((size_t) symbol->bitmap_width * symbol->bitmap_height, bitmap_size,
+                    "i:%d bitmap size %d != %d\n",
+                    i, symbol->bitmap_width * symbol->bitmap_height, (int) bitmap_size);
+        assert_zero(memcmp(symbol->bitmap, bitmap, bitmap_size), "i:%d bitmaps differ\n", i);
+
+        free(bitmap);
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+static void test_threads(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int option_2;
+        int output_options;
+        float scale;
+        int rotate_angle;
+        const char *fgcolour;
+        const char *data;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_QRCODE, 40, -1, 3.0f, 0, "", "1234" },
+        /*  1*/ { BARCODE_QRCODE, 40, -1, 2.7f, 90, "", "1234" }, /* Fractional scaling */
+        /*  2*/ { BARCODE_QRCODE, 40, -1, 3.0f, 180, "11223380", "1234" }, /* Alphamap */
+        /*  3*/ { BARCODE_QRCODE, 40, OUT_BUFFER_RGBA, 3.0f, 0, "", "1234" },
+        /*  4*/ { BARCODE_QRCODE, 40, OUT_BUFFER_1BPP, 3.0f, 270, "", "1234" },
+        /*  5*/ { BARCODE_QRCODE, 40, BARCODE_DOTTY_MODE, 3.0f, 0, "", "1234" },
+        /*  6*/ { BARCODE_MAXICODE, -1, -1, 20.0f, 0, "", "1234" },
+        /*  7*/ { BARCODE_DOTCODE, -1, -1, 8.0f, 0, "", "1234567890123456789012345678901234567890" },
+        /*  8*/ { BARCODE_PDF417, -1, BARCODE_BOX, 3.3f, 0, "", "123456789012345678901234567890" },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, j, length, ret;
+    struct zint_symbol *symbol = NULL;
+    struct zint_symbol *threaded = NULL;
+    static const int raster_threads[] = { 4, -1 };
+
+    testStartSymbol("test_threads", &symbol);
+
+    for (i = 0; i < data_size; i++) {
+        size_t bitmap_size;
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, UNICODE_MODE, -1 /*eci*/, -1 /*option_1*/,
+                                    data[i].option_2, -1, data[i].output_options, data[i].data, -1, debug);
+        symbol->scale = data[i].scale;
+        if (*data[i].fgcolour) {
+            strcpy(symbol->fgcolour, data[i].fgcolour);
+        }
+        ret = ZBarcode_Encode_and_Buffer(symbol, TCU(data[i].data), length, data[i].rotate_angle);
+        assert_zero(ret, "i:%d ZBarcode_Encode_and_Buffer(%s) ret %d != 0 (%s)\n",
+                    i, testUtilBarcodeName(data[i].symbology), ret, symbol->errtxt);
+        if (data[i].output_options != -1 && (data[i].output_options & OUT_BUFFER_1BPP)) {
+            bitmap_size = (size_t) ((symbol->bitmap_width + 7) / 8) * symbol->bitmap_height;
+        } else {
+            bitmap_size = (size_t) symbol->bitmap_width * symbol->bitmap_height
+                            * (data[i].output_options != -1 && (data[i].output_options & OUT_BUFFER_RGBA) ? 4 : 3);
+        }
+
+        for (j = 0; j < ARRAY_SIZE(raster_threads); j++) {
+            threaded = ZBarcode_Create();
+            assert_nonnull(threaded, "Symbol not created\n");
+
+            length = testUtilSetSymbol(threaded, data[i].symbology, UNICODE_MODE, -1 /*eci*/, -1 /*option_1*/,
+                                        data[i].option_2, -1, data[i].output_options, data[i].data, -1, debug);
+            threaded->scale = data[i].scale;
+            if (*data[i].fgcolour) {
+                strcpy(threaded->fgcolour, data[i].fgcolour);
+            }
+            threaded->raster_threads = raster_threads[j];
+            ret = ZBarcode_Encode_and_Buffer(threaded, TCU(data[i].data), length, data[i].rotate_angle);
+            assert_zero(ret, "i:%d j:%d ZBarcode_Encode_and_Buffer(%s) ret %d != 0 (%s)\n",
+                        i, j, testUtilBarcodeName(data[i].symbology), ret, threaded->errtxt);
+
+            assert_equal(threaded->bitmap_width, symbol->bitmap_width, "i:%d j:%d bitmap_width %d != %d\n",
+                        i, j, threaded->bitmap_width, symbol->bitmap_width);
+            assert_equal(threaded->bitmap_height, symbol->bitmap_height, "i:%d j:%d bitmap_height %d != %d\n",
+                        i, j, threaded->bitmap_height, symbol->bitmap_height);
+            assert_zero(memcmp(threaded->bitmap, symbol->bitmap, bitmap_size), "i:%d j:%d bitmaps differ\n", i, j);
+            if (symbol->alphamap) {
+                assert_nonnull(threaded->alphamap, "i:%d j:%d alphamap NULL\n", i, j);
+                assert_zero(memcmp(threaded->alphamap, symbol->alphamap,
+                                    (size_t) symbol->bitmap_width * symbol->bitmap_height),
+                            "i:%d j:%d alphamaps differ\n", i, j);
+            } else {
+                assert_null(threaded->alphamap, "i:%d j:%d alphamap not NULL\n", i, j);
+            }
+
+            ZBarcode_Delete(threaded);
+        }
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
 static void test_height(const testCtx *const p_ctx) {
     int debug = p_ctx->debug;
 
@@ -3345,6 +4138,14 @@ int main(int argc, char *argv[]) {
         { "test_quiet_zones", test_quiet_zones, },
         { "test_text_gap", test_text_gap, },
         { "test_buffer_plot", test_buffer_plot, },
+        { "test_buffer_1bpp", test_buffer_1bpp, },
+        { "test_buffer_rgba", test_buffer_rgba, },
+        { "test_buffer_into", test_buffer_into, },
+        { "test_rows", test_rows, },
+        { "test_glyph_cache", test_glyph_cache, },
+        { "test_stamp_cache_threads", test_stamp_cache_threads, },
+        { "test_stamp_cache", test_stamp_cache, },
+        { "test_threads", test_threads, },
         { "test_height", test_height, },
         { "test_height_per_row", test_height_per_row, },
         { "test_hrt_raw_text", test_hrt_raw_text, },
@@ -30,9 +30,10 @@
 /* SPDX-License-Identifier: BSD-3-Clause */
 
 #include "testcommon.h"
+#include "../output.h"
 #include <sys/stat.h>
 
-INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf);
+INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, struct out_raster_rows *rows);
 
 /* For overview when debugging: ./test_tiff -f pixel_plot -d 5 */
 static void test_pixel_plot(const testCtx *const p_ctx) {
@@ -90,6 +91,7 @@ static void test_pixel_plot(const testCtx *const p_ctx) {
     const int data_size = ARRAY_SIZE(data);
     int i, ret;
     struct zint_symbol *symbol = NULL;
+    struct out_raster_rows rows;
 
     const char *tif = "out.tif";
 
@@ -128,7 +130,8 @@ static void test_pixel_plot(const testCtx *const p_ctx) {
 
         symbol->bitmap = (unsigned char *) data_buf;
 
-        ret = tif_pixel_plot(symbol, (unsigned char *) data_buf);
+        (void) out_raster_rows_init(&rows, TCU(data_buf), symbol->bitmap_width, symbol->bitmap_height, 0.0f, 0);
+        ret = tif_pixel_plot(symbol, &rows);
         assert_equal(ret, data[i].ret, "i:%d tif_pixel_plot ret %d != %d (%s)\n", i, ret, data[i].ret, symbol->errtxt);
 
         if (ret < ZINT_ERROR) {
@@ -328,11 +331,683 @@ static void test_print(const testCtx *const p_ctx) {
     testFinish();
 }
 
+/* Return value of SHORT tag `tag` in TIFF `buf` (IFD at offset given in header), or -1 if not found */
+static int test_tif_tag(const unsigned char *buf, const int size, const int tag) {
+    const int ifd = buf[4] | (buf[5] << 8) | (buf[6] << 16) | (buf[7] << 24);
+    int entries, i;
+
+    if (ifd + 2 > size) {
+        return -1;
+    }
+    entries = buf[ifd] | (buf[ifd + 1] << 8);
+    for (i = 0; i < entries && ifd + 2 + (i + 1) * 12 <= size; i++) {
+        const unsigned char *entry = buf + ifd + 2 + i * 12;
+        if ((entry[0] | (entry[1] << 8)) == tag) {
+            return entry[8] | (entry[9] << 8);
+        }
+    }
+    return -1;
+}
+
+static void test_compression(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int output_options;
+        float scale;
+        const char *fgcolour;
+        const char *bgcolour;
+        const char *data;
+        int expected_compression;
+        int expected_pmi;
+        const char *comment;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_QRCODE, -1, 5, "", "", "1234567890", 4, 0, "G4 smaller" },
+        /*  1*/ { BARCODE_QRCODE, BARCODE_MEMORY_FILE, 5, "", "", "1234567890", 4, 0, "" },
+        /*  2*/ { BARCODE_QRCODE, -1, 5, "FFFFFF", "000000", "1234567890", 4, 1, "BLACKISZERO" },
+        /*  3*/ { BARCODE_MAXICODE, -1, 0, "", "", "1234567890", 4, 0, "" },
+        /*  4*/ { BARCODE_HANXIN, -1, 2, "", "", "1234567890", 4, 0, "" },
+        /*  5*/ { BARCODE_DATAMATRIX, -1, 10, "", "", "1234567890", 4, 0, "Multiple strips" },
+        /*  6*/ { BARCODE_CODE128, -1, 0, "", "", "1234567890", 5, 0, "LZW smaller (rows repeat)" },
+        /*  7*/ { BARCODE_CODE128, BARCODE_MEMORY_FILE, 0, "", "", "1234567890", 5, 0, "" },
+        /*  8*/ { BARCODE_CODE128, -1, 5, "", "", "1234567890", 4, 0, "G4 smaller when wide" },
+        /*  9*/ { BARCODE_QRCODE, -1, 5, "FF0000", "", "1234567890", 5, 3, "Not bilevel, PALETTE_COLOR" },
+        /* 10*/ { BARCODE_QRCODE, CMYK_COLOUR, 5, "", "", "1234567890", 5, 5, "Not bilevel, SEPARATED" },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol = NULL;
+
+    const char *tif = "out.tif";
+    unsigned char filebuf[65536];
+    int filebuf_size;
+    const unsigned char *buf;
+    int size;
+
+    int have_tiffinfo = testUtilHaveTiffInfo();
+    const char *const have_identify = testUtilHaveIdentify();
+
+    testStartSymbol("test_compression", &symbol);
+
+    for (i = 0; i < data_size; i++) {
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/,
+                    -1 /*option_2*/, -1 /*option_3*/, data[i].output_options, data[i].data, -1, debug);
+        if (data[i].scale) {
+            symbol->scale = data[i].scale;
+        }
+        if (*data[i].fgcolour) {
+            strcpy(symbol->fgcolour, data[i].fgcolour);
+        }
+        if (*data[i].bgcolour) {
+            strcpy(symbol->bgcolour, data[i].bgcolour);
+        }
+
+        ret = ZBarcode_Encode(symbol, TCU(data[i].data), length);
+        assert_zero(ret, "i:%d %s ZBarcode_Encode ret %d != 0 %s\n", i, testUtilBarcodeName(data[i].symbology), ret, symbol->errtxt);
+
+        strcpy(symbol->outfile, tif);
+        ret = ZBarcode_Print(symbol, 0);
+        assert_zero(ret, "i:%d %s ZBarcode_Print %s ret %d != 0 (%s)\n", i, testUtilBarcodeName(data[i].symbology), symbol->outfile, ret, symbol->errtxt);
+
+        if (symbol->output_options & BARCODE_MEMORY_FILE) {
+            assert_nonnull(symbol->memfile, "i:%d %s memfile NULL\n", i, testUtilBarcodeName(data[i].symbology));
+            buf = symbol->memfile;
+            size = symbol->memfile_size;
+        } else {
+            ret = testUtilReadFile(symbol->outfile, filebuf, sizeof(filebuf), &filebuf_size);
+            assert_zero(ret, "i:%d %s testUtilReadFile(%s) %d != 0\n", i, testUtilBarcodeName(data[i].symbology), symbol->outfile, ret);
+            buf = filebuf;
+            size = filebuf_size;
+        }
+        assert_nonzero(size > 8, "i:%d %s size %d <= 8\n", i, testUtilBarcodeName(data[i].symbology), size);
+
+        ret = test_tif_tag(buf, size, 0x0103); /* Compression */
+        assert_equal(ret, data[i].expected_compression, "i:%d %s Compression %d != %d\n", i, testUtilBarcodeName(data[i].symbology), ret, data[i].expected_compression);
+        ret = test_tif_tag(buf, size, 0x0106); /* PhotometricInterpretation */
+        assert_equal(ret, data[i].expected_pmi, "i:%d %s PhotometricInterpretation %d != %d\n", i, testUtilBarcodeName(data[i].symbology), ret, data[i].expected_pmi);
+
+        if (!(symbol->output_options & BARCODE_MEMORY_FILE)) {
+            if (have_tiffinfo) {
+                ret = testUtilVerifyTiffInfo(symbol->outfile, debug);
+                assert_zero(ret, "i:%d %s tiffinfo %s ret %d != 0\n", i, testUtilBarcodeName(data[i].symbology), symbol->outfile, ret);
+            } else if (have_identify) {
+                ret = testUtilVerifyIdentify(have_identify, symbol->outfile, debug);
+                assert_zero(ret, "i:%d %s identify %s ret %d != 0\n", i, testUtilBarcodeName(data[i].symbology), symbol->outfile, ret);
+            }
+            if (!(debug & ZINT_DEBUG_TEST_KEEP_OUTFILE)) {
+                assert_zero(testUtilRemove(symbol->outfile), "i:%d testUtilRemove(%s) != 0\n", i, symbol->outfile);
+            }
+        }
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+/* Return values of SHORT or LONG tag `tag` in TIFF `buf` (IFD at offset given in header) in `values`, returning
+   count, or -1 if not found or bad */
+static int test_tif_tag_values(const unsigned char *buf, const int size, const int tag, int values[],
+            const int max) {
+    const int ifd = buf[4] | (buf[5] << 8) | (buf[6] << 16) | (buf[7] << 24);
+    int entries, i, j;
+
+    if (ifd + 2 > size) {
+        return -1;
+    }
+    entries = buf[ifd] | (buf[ifd + 1] << 8);
+    for (i = 0; i < entries && ifd + 2 + (i + 1) * 12 <= size; i++) {
+        const unsigned char *entry = buf + ifd + 2 + i * 12;
+        if ((entry[0] | (entry[1] << 8)) == tag) {
+            const int type = entry[2] | (entry[3] << 8);
+            const int count = entry[4] | (entry[5] << 8) | (entry[6] << 16) | (entry[7] << 24);
+            const int item_size = type == 3 ? 2 : 4;
+            const unsigned char *vp = entry + 8;
+            if ((type != 3 && type != 4) || count < 1 || count > max) {
+                return -1;
+            }
+            if (count * item_size > 4) {
+                const int offset = vp[0] | (vp[1] << 8) | (vp[2] << 16) | (vp[3] << 24);
+                if (offset < 8 || offset + count * item_size > size) {
+                    return -1;
+                }
+                vp = buf + offset;
+            }
+            for (j = 0; j < count; j++, vp += item_size) {
+                values[j] = type == 3 ? vp[0] | (vp[1] << 8) : vp[0] | (vp[1] << 8) | (vp[2] << 16) | (vp[3] << 24);
+            }
+            return count;
+        }
+    }
+    return -1;
+}
+
+/* ITU-T T.4 Section 4.1 run-length codes as bit strings, transcribed separately from the encoder's tables in
+   "tif_g4.h". Terminating codes 0-63, then make-up codes 64-1728 */
+static const char *const test_g4_white_codes[91] = {
+    "00110101", "000111", "0111", "1000", "1011", "1100", "1110", "1111", /* 0 */
+    "10011", "10100", "00111", "01000", "001000", "000011", "110100", "110101", /* 8 */
+    "101010", "101011", "0100111", "0001100", "0001000", "0010111", "0000011", "0000100", /* 16 */
+    "0101000", "0101011", "0010011", "0100100", "0011000", "00000010", "00000011", "00011010", /* 24 */
+    "00011011", "00010010", "00010011", "00010100", "00010101", "00010110", "00010111", "00101000", /* 32 */
+    "00101001", "00101010", "00101011", "00101100", "00101101", "00000100", "00000101", "00001010", /* 40 */
+    "00001011", "01010010", "01010011", "01010100", "01010101", "00100100", "00100101", "01011000", /* 48 */
+    "01011001", "01011010", "01011011", "01001010", "01001011", "00110010", "00110011", "00110100", /* 56 */
+    "11011", "10010", "010111", "0110111", "00110110", "00110111", "01100100", "01100101", /* 64-512 */
+    "01101000", "01100111", "011001100", "011001101", "011010010", "011010011", "011010100", /* 576-960 */
+    "011010101", "011010110", "011010111", "011011000", "011011001", "011011010", "011011011", /* 1024-1408 */
+    "010011000", "010011001", "010011010", "011000", "010011011", /* 1472-1728 */
+};
+
+static const char *const test_g4_black_codes[91] = {
+    "0000110111", "010", "11", "10", "011", "0011", "0010", "00011", /* 0 */
+    "000101", "000100", "0000100", "0000101", "0000111", "00000100", "00000111", "000011000", /* 8 */
+    "0000010111", "0000011000", "0000001000", "00001100111", "00001101000", "00001101100", /* 16 */
+    "00000110111", "00000101000", "00000010111", "00000011000", "000011001010", "000011001011", /* 22 */
+    "000011001100", "000011001101", "000001101000", "000001101001", "000001101010", "000001101011", /* 28 */
+    "000011010010", "000011010011", "000011010100", "000011010101", "000011010110", "000011010111", /* 34 */
+    "000001101100", "000001101101", "000011011010", "000011011011", "000001010100", "000001010101", /* 40 */
+    "000001010110", "000001010111", "000001100100", "000001100101", "000001010010", "000001010011", /* 46 */
+    "000000100100", "000000110111", "000000111000", "000000100111", "000000101000", "000001011000", /* 52 */
+    "000001011001", "000000101011", "000000101100", "000001011010", "000001100110", "000001100111", /* 58 */
+    "0000001111", "000011001000", "000011001001", "000001011011", "000000110011", "000000110100", /* 64-384 */
+    "000000110101", "0000001101100", "0000001101101", "0000001001010", "0000001001011", /* 448-704 */
+    "0000001001100", "0000001001101", "0000001110010", "0000001110011", "0000001110100", /* 768-1024 */
+    "0000001110101", "0000001110110", "0000001110111", "0000001010010", "0000001010011", /* 1088-1344 */
+    "0000001010100", "0000001010101", "0000001011010", "0000001011011", "0000001100100", /* 1408-1664 */
+    "0000001100101", /* 1728 */
+};
+
+/* Extended make-up codes 1792-2560, common to white and black */
+static const char *const test_g4_ext_codes[13] = {
+    "00000001000", "00000001100", "00000001101", "000000010010", "000000010011", "000000010100", /* 1792-2112 */
+    "000000010101", "000000010110", "000000010111", "000000011100", "000000011101", "000000011110", /* 2176-2496 */
+    "000000011111", /* 2560 */
+};
+
+/* Bit reader for `test_tif_g4_decode()` */
+struct test_g4_bits {
+    const unsigned char *buf;
+    int size; /* In bits */
+    int pos; /* In bits */
+};
+
+/* Return 1 if bit string `code` is next, advancing past it, else 0 */
+static int test_g4_match(struct test_g4_bits *bits, const char *code) {
+    int i;
+    for (i = 0; code[i]; i++) {
+        const int pos = bits->pos + i;
+        if (pos >= bits->size || ((bits->buf[pos >> 3] >> (7 - (pos & 7))) & 1) != code[i] - '0') {
+            return 0;
+        }
+    }
+    bits->pos += i;
+    return 1;
+}
+
+/* Read run of colour `black`: any make-up codes followed by a terminating code. Returns -1 if no valid code */
+static int test_g4_run(struct test_g4_bits *bits, const int black) {
+    const char *const *const codes = black ? test_g4_black_codes : test_g4_white_codes;
+    int run = 0;
+    int i;
+
+    for (;;) {
+        i = 0;
+        while (i < 91 && !test_g4_match(bits, codes[i])) {
+            i++;
+        }
+        if (i < 64) {
+            return run + i;
+        }
+        if (i < 91) {
+            run += (i - 63) * 64;
+            continue;
+        }
+        i = 0;
+        while (i < 13 && !test_g4_match(bits, test_g4_ext_codes[i])) {
+            i++;
+        }
+        if (i == 13) {
+            return -1;
+        }
+        run += 1792 + i * 64;
+    }
+}
+
+/* Decode G4 TIFF `buf` of `size` bytes, checking it's `width` x `height`, placing the pixel bits (1 for
+   PhotometricInterpretation 1) in `pixels`. Each strip is decoded independently, the first row against an all-white
+   reference row, and must end with EOFB. Also sets `*p_strips` to the number of strips, `modes` to the number of
+   pass, horizontal and vertical mode codes, and `*p_max_run` to the longest run coded. Returns 0 on success */
+static int test_tif_g4_decode(const unsigned char *buf, const int size, const int width, const int height,
+            unsigned char *pixels, int *p_strips, int modes[3], int *p_max_run) {
+    static const char *const vert_codes[7] = {
+        "0000010", "000010", "010", "1", "011", "000011", "0000011" /* VL3, VL2, VL1, V0, VR1, VR2, VR3 */
+    };
+    static const char eol[] = "000000000001";
+    int *offsets, *byte_counts, *ref, *cur, *temp;
+    int rows_per_strip, strip_count, strip;
+    int row = 0;
+    int ret = 0;
+
+    *p_strips = 0;
+    modes[0] = modes[1] = modes[2] = 0;
+    *p_max_run = 0;
+
+    if (size < 8 || memcmp(buf, "II\x2A\x00", 4) != 0) return 1;
+    if (test_tif_tag(buf, size, 0x0103) != 4) return 2; /* Compression */
+    if (test_tif_tag(buf, size, 0x0100) != width || test_tif_tag(buf, size, 0x0101) != height) return 3;
+    if (test_tif_tag_values(buf, size, 0x0116, &rows_per_strip, 1) != 1 || rows_per_strip < 1) return 4;
+    strip_count = (height + rows_per_strip - 1) / rows_per_strip;
+
+    offsets = (int *) malloc(sizeof(int) * strip_count);
+    byte_counts = (int *) malloc(sizeof(int) * strip_count);
+    ref = (int *) malloc(sizeof(int) * (width + 3));
+    cur = (int *) malloc(sizeof(int) * (width + 3));
+    if (!offsets || !byte_counts || !ref || !cur) {
+        ret = 5;
+    } else if (test_tif_tag_values(buf, size, 0x0111, offsets, strip_count) != strip_count
+            || test_tif_tag_values(buf, size, 0x0117, byte_counts, strip_count) != strip_count) {
+        ret = 6;
+    }
+
+    for (strip = 0; strip < strip_count && !ret; strip++) {
+        struct test_g4_bits bits;
+        const int end_row = row + rows_per_strip < height ? row + rows_per_strip : height;
+
+        if (offsets[strip] < 8 || offsets[strip] + byte_counts[strip] > size) {
+            ret = 7;
+            break;
+        }
+        bits.buf = buf + offsets[strip];
+        bits.size = byte_counts[strip] * 8;
+        bits.pos = 0;
+
+        ref[0] = ref[1] = ref[2] = width; /* All white */
+
+        for (; row < end_row && !ret; row++) {
+            unsigned char *const pixel_row = pixels + (size_t) row * width;
+            int a0 = -1, colour = 0, n = 0, bi = 0;
+            int b1, b2, x, d;
+
+            while (a0 < width) {
+                /* b1: first changing element on reference row to right of a0 and of opposite colour to a0 (even
+                   elements change to black) */
+                while (bi > 0 && ref[bi - 1] > a0) {
+                    bi--;
+                }
+                while (ref[bi] <= a0 || (bi & 1) != colour) {
+                    bi++;
+                }
+                b1 = ref[bi];
+                b2 = ref[bi + 1];
+
+                if (test_g4_match(&bits, "0001")) { /* Pass */
+                    if (b2 >= width) {
+                        ret = 8;
+                        break;
+                    }
+                    a0 = b2;
+                    modes[0]++;
+                } else if (test_g4_match(&bits, "001")) { /* Horizontal */
+                    const int start = a0 < 0 ? 0 : a0;
+                    const int run1 = test_g4_run(&bits, colour);
+                    const int run2 = run1 < 0 ? -1 : test_g4_run(&bits, !colour);
+                    if (run2 < 0 || (run1 == 0 && a0 >= 0) || start + run1 + run2 > width) {
+                        ret = 9;
+                        break;
+                    }
+                    if (start + run1 < width) {
+                        cur[n++] = start + run1;
+                    }
+                    if (start + run1 + run2 < width) {
+                        cur[n++] = start + run1 + run2;
+                    }
+                    a0 = start + run1 + run2;
+                    if (run1 > *p_max_run) {
+                        *p_max_run = run1;
+                    }
+                    if (run2 > *p_max_run) {
+                        *p_max_run = run2;
+                    }
+                    modes[1]++;
+                } else {
+                    d = 0;
+                    while (d < 7 && !test_g4_match(&bits, vert_codes[d])) {
+                        d++;
+                    }
+                    if (d == 7 || b1 + d - 3 <= a0 || b1 + d - 3 > width) {
+                        ret = 10;
+                        break;
+                    }
+                    a0 = b1 + d - 3;
+                    if (a0 < width) {
+                        cur[n++] = a0;
+                    }
+                    colour = !colour;
+                    modes[2]++;
+                }
+            }
+            cur[n] = cur[n + 1] = cur[n + 2] = width;
+
+            for (x = 0, n = 0, colour = 0; x < width; x++) {
+                if (cur[n] == x) {
+                    colour = !colour;
+                    n++;
+                }
+                pixel_row[x] = (unsigned char) colour;
+            }
+            temp = ref;
+            ref = cur;
+            cur = temp;
+        }
+
+        if (!ret && (!test_g4_match(&bits, eol) || !test_g4_match(&bits, eol))) {
+            ret = 11; /* No EOFB */
+        } else if (!ret && (bits.pos + 7) / 8 != byte_counts[strip]) {
+            ret = 12; /* Trailing data */
+        }
+        (*p_strips)++;
+    }
+
+    free(cur);
+    free(ref);
+    free(byte_counts);
+    free(offsets);
+    return ret;
+}
+
+static void test_g4_roundtrip(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int width;
+        int height;
+        int max_run; /* Runs of random length 1 to `max_run` */
+        int new_row; /* 1 in `new_row` rows new runs, the others the row above shifted by -3 to 3 pixels... */
+        int flips; /* ...with `flips` random pixels flipped */
+        const char *fgcolour;
+        const char *bgcolour;
+        int expected_pmi;
+
+        int min_strips;
+        int min_max_run;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { 600, 400, 20, 8, 2, "", "", 0, 4, 20 },
+        /*  1*/ { 600, 400, 20, 8, 2, "FFFFFF", "000000", 1, 4, 20 }, /* BLACKISZERO */
+        /*  2*/ { 6000, 40, 6000, 2, 1, "", "", 0, 4, 2561 }, /* Runs > 2560 */
+        /*  3*/ { 6000, 40, 6000, 2, 1, "FFFFFF", "000000", 1, 4, 2561 },
+        /*  4*/ { 20000, 9, 12000, 2, 3, "", "", 0, 3, 5121 }, /* Runs > 2 * 2560 */
+        /*  5*/ { 2561, 100, 2561, 3, 1, "", "", 0, 4, 1793 }, /* Runs around make-up boundaries */
+        /*  6*/ { 97, 3000, 12, 32, 0, "", "", 0, 4, 7 }, /* Narrow, short runs */
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, j, ret;
+    struct zint_symbol *symbol = NULL;
+    struct out_raster_rows rows;
+
+    testStart("test_g4_roundtrip");
+
+    for (i = 0; i < data_size; i++) {
+        const int width = data[i].width;
+        const int size = width * data[i].height;
+        unsigned int seed = 12345 + i;
+        unsigned char *pixelbuf, *expected, *decoded;
+        int strips, modes[3], max_run;
+        int row, x;
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        symbol->symbology = BARCODE_CODE128;
+        symbol->bitmap_width = width;
+        symbol->bitmap_height = data[i].height;
+        if (*data[i].fgcolour) {
+            strcpy(symbol->fgcolour, data[i].fgcolour);
+        }
+        if (*data[i].bgcolour) {
+            strcpy(symbol->bgcolour, data[i].bgcolour);
+        }
+        symbol->output_options |= BARCODE_MEMORY_FILE;
+        strcpy(symbol->outfile, "out.tif");
+        symbol->debug |= debug;
+
+        pixelbuf = (unsigned char *) malloc(size);
+        expected = (unsigned char *) malloc(size);
+        decoded = (unsigned char *) malloc(size);
+        assert_nonnull(pixelbuf, "i:%d malloc pixelbuf NULL\n", i);
+        assert_nonnull(expected, "i:%d malloc expected NULL\n", i);
+        assert_nonnull(decoded, "i:%d malloc decoded NULL\n", i);
+
+        for (row = 0; row < data[i].height; row++) {
+            unsigned char *const ep = expected + row * width;
+            seed = seed * 1103515245 + 12345;
+            if (row == 0 || (seed >> 16) % data[i].new_row == 0) {
+                for (x = 0; x < width;) {
+                    int len;
+                    seed = seed * 1103515245 + 12345;
+                    len = 1 + (int) ((seed >> 8) % data[i].max_run);
+                    seed = seed * 1103515245 + 12345;
+                    memset(ep + x, (seed >> 16) & 1, len < width - x ? len : width - x);
+                    x += len;
+                }
+            } else {
+                int shift;
+                seed = seed * 1103515245 + 12345;
+                shift = (int) ((seed >> 16) % 7) - 3;
+                for (x = 0; x < width; x++) {
+                    const int src = x - shift < 0 ? 0 : x - shift >= width ? width - 1 : x - shift;
+                    ep[x] = ep[src - width];
+                }
+                for (j = 0; j < data[i].flips; j++) {
+                    seed = seed * 1103515245 + 12345;
+                    ep[(seed >> 8) % width] ^= 1;
+                }
+            }
+        }
+        for (j = 0; j < size; j++) {
+            pixelbuf[j] = (unsigned char) ('0' + expected[j]);
+        }
+
+        (void) out_raster_rows_init(&rows, pixelbuf, width, data[i].height, 0.0f, 0);
+        ret = tif_pixel_plot(symbol, &rows);
+        assert_zero(ret, "i:%d tif_pixel_plot ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+        assert_nonnull(symbol->memfile, "i:%d memfile NULL\n", i);
+
+        ret = test_tif_tag(symbol->memfile, symbol->memfile_size, 0x0106); /* PhotometricInterpretation */
+        assert_equal(ret, data[i].expected_pmi, "i:%d PhotometricInterpretation %d != %d\n",
+                    i, ret, data[i].expected_pmi);
+
+        ret = test_tif_g4_decode(symbol->memfile, symbol->memfile_size, width, data[i].height, decoded, &strips,
+                                modes, &max_run);
+        assert_zero(ret, "i:%d test_tif_g4_decode ret %d != 0\n", i, ret);
+
+        if (debug & ZINT_DEBUG_TEST_PRINT) {
+            printf("i:%d size %d, memfile_size %d, strips %d, pass %d, horiz %d, vert %d, max_run %d\n",
+                    i, size, symbol->memfile_size, strips, modes[0], modes[1], modes[2], max_run);
+        }
+
+        j = 0;
+        while (j < size && decoded[j] == expected[j]) {
+            j++;
+        }
+        assert_equal(j, size, "i:%d decoded[%d] (row %d, column %d) %d != expected %d\n", i, j, j / width,
+                    j % width, j < size ? decoded[j] : -1, j < size ? expected[j] : -1);
+
+        assert_nonzero(strips >= data[i].min_strips, "i:%d strips %d < %d\n", i, strips, data[i].min_strips);
+        assert_nonzero(modes[0] && modes[1] && modes[2], "i:%d pass %d, horiz %d, vert %d not all used\n",
+                    i, modes[0], modes[1], modes[2]);
+        assert_nonzero(max_run >= data[i].min_max_run, "i:%d max_run %d < %d\n", i, max_run, data[i].min_max_run);
+
+        free(decoded);
+        free(expected);
+        free(pixelbuf);
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+/* Return number of IFDs in TIFF `buf`, placing SHORT tag `tag` of each (or -1 if not found) in `values` */
+static int test_tif_pages(const unsigned char *buf, const int size, const int tag, int values[], const int max) {
+    int ifd = buf[4] | (buf[5] << 8) | (buf[6] << 16) | (buf[7] << 24);
+    int pages = 0;
+    int entries, i;
+
+    while (ifd && ifd + 2 <= size && pages < max) {
+        entries = buf[ifd] | (buf[ifd + 1] << 8);
+        values[pages] = -1;
+        for (i = 0; i < entries && ifd + 2 + (i + 1) * 12 <= size; i++) {
+            const unsigned char *entry = buf + ifd + 2 + i * 12;
+            if ((entry[0] | (entry[1] << 8)) == tag) {
+                values[pages] = entry[8] | (entry[9] << 8);
+            }
+        }
+        pages++;
+        ifd += 2 + entries * 12;
+        if (ifd + 4 > size) {
+            break;
+        }
+        ifd = buf[ifd] | (buf[ifd + 1] << 8) | (buf[ifd + 2] << 16) | (buf[ifd + 3] << 24);
+    }
+    return pages;
+}
+
+static void test_append(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int symbology;
+        int output_options;
+        float scale;
+        const char *fgcolour;
+        const char *data;
+        int expected_compression;
+        const char *comment;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    static const struct item data[] = {
+        /*  0*/ { BARCODE_QRCODE, -1, 5, "", "1234567890", 4, "Not appended, so IFD not at end" },
+        /*  1*/ { BARCODE_CODE128, BARCODE_TIF_APPEND, 0, "", "1234567890", 5, "Follows IFD chain" },
+        /*  2*/ { BARCODE_QRCODE, BARCODE_TIF_APPEND, 5, "FF0000", "1234567890", 5, "Appended IFD at end" },
+        /*  3*/ { BARCODE_DATAMATRIX, BARCODE_TIF_APPEND | CMYK_COLOUR, 10, "", "1234567890", 5, "Multiple strips" },
+        /*  4*/ { BARCODE_MAXICODE, BARCODE_TIF_APPEND, 0, "", "1234567890", 4, "" },
+    };
+    const int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol = NULL;
+
+    const char *tif = "test_tif_append.tif";
+    unsigned char filebuf[131072];
+    int filebuf_size;
+    int values[ARRAY_SIZE(data) + 1];
+    int pages;
+
+    int have_tiffinfo = testUtilHaveTiffInfo();
+    const char *const have_identify = testUtilHaveIdentify();
+
+    testStartSymbol("test_append", &symbol);
+
+    if (testUtilExists(tif)) {
+        assert_zero(testUtilRemove(tif), "testUtilRemove(%s) != 0\n", tif);
+    }
+
+    for (i = 0; i < data_size; i++) {
+
+        if (testContinue(p_ctx, i)) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/,
+                    -1 /*option_2*/, -1 /*option_3*/, data[i].output_options, data[i].data, -1, debug);
+        if (data[i].scale) {
+            symbol->scale = data[i].scale;
+        }
+        if (*data[i].fgcolour) {
+            strcpy(symbol->fgcolour, data[i].fgcolour);
+        }
+
+        ret = ZBarcode_Encode(symbol, TCU(data[i].data), length);
+        assert_zero(ret, "i:%d %s ZBarcode_Encode ret %d != 0 %s\n", i, testUtilBarcodeName(data[i].symbology), ret, symbol->errtxt);
+
+        strcpy(symbol->outfile, tif);
+        ret = ZBarcode_Print(symbol, 0);
+        assert_zero(ret, "i:%d %s ZBarcode_Print %s ret %d != 0 (%s)\n", i, testUtilBarcodeName(data[i].symbology), symbol->outfile, ret, symbol->errtxt);
+
+        ret = testUtilReadFile(symbol->outfile, filebuf, sizeof(filebuf), &filebuf_size);
+        assert_zero(ret, "i:%d %s testUtilReadFile(%s) %d != 0\n", i, testUtilBarcodeName(data[i].symbology), symbol->outfile, ret);
+
+        pages = test_tif_pages(filebuf, filebuf_size, 0x0103 /*Compression*/, values, ARRAY_SIZE(values));
+        assert_equal(pages, i + 1, "i:%d %s pages %d != %d\n", i, testUtilBarcodeName(data[i].symbology), pages, i + 1);
+        assert_equal(values[i], data[i].expected_compression, "i:%d %s Compression %d != %d\n", i, testUtilBarcodeName(data[i].symbology), values[i], data[i].expected_compression);
+        if (i) {
+            assert_equal(values[i - 1], data[i - 1].expected_compression, "i:%d %s previous Compression %d != %d\n", i, testUtilBarcodeName(data[i].symbology), values[i - 1], data[i - 1].expected_compression);
+        }
+
+        if (have_tiffinfo) {
+            ret = testUtilVerifyTiffInfo(symbol->outfile, debug);
+            assert_zero(ret, "i:%d %s tiffinfo %s ret %d != 0\n", i, testUtilBarcodeName(data[i].symbology), symbol->outfile, ret);
+        } else if (have_identify) {
+            ret = testUtilVerifyIdentify(have_identify, symbol->outfile, debug);
+            assert_zero(ret, "i:%d %s identify %s ret %d != 0\n", i, testUtilBarcodeName(data[i].symbology), symbol->outfile, ret);
+        }
+
+        ZBarcode_Delete(symbol);
+    }
+
+    /* Errors */
+    symbol = ZBarcode_Create();
+    assert_nonnull(symbol, "Symbol not created\n");
+    length = testUtilSetSymbol(symbol, BARCODE_CODE128, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/,
+                -1 /*option_2*/, -1 /*option_3*/, BARCODE_TIF_APPEND | BARCODE_MEMORY_FILE, "1234", -1, debug);
+    ret = ZBarcode_Encode(symbol, TCU("1234"), length);
+    assert_zero(ret, "ZBarcode_Encode ret %d != 0 %s\n", ret, symbol->errtxt);
+    strcpy(symbol->outfile, tif);
+    ret = ZBarcode_Print(symbol, 0);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_Print ret %d != ZINT_ERROR_INVALID_OPTION (%s)\n", ret, symbol->errtxt);
+    assert_zero(strcmp(symbol->errtxt, "Error 675: Cannot append TIF page to standard output or memory file"), "errtxt %s\n", symbol->errtxt);
+
+    if (!(debug & ZINT_DEBUG_TEST_KEEP_OUTFILE)) {
+        assert_zero(testUtilRemove(tif), "testUtilRemove(%s) != 0\n", tif);
+    }
+
+    symbol->output_options &= ~BARCODE_MEMORY_FILE;
+    strcpy(symbol->outfile, "test_tif_append.png"); /* Append flag ignored if not TIF */
+    ret = ZBarcode_Print(symbol, 0);
+    assert_zero(ret, "ZBarcode_Print %s ret %d != 0 (%s)\n", symbol->outfile, ret, symbol->errtxt);
+    assert_nonzero(rename(symbol->outfile, tif) == 0, "rename(%s, %s) != 0\n", symbol->outfile, tif);
+
+    strcpy(symbol->outfile, tif);
+    ret = ZBarcode_Print(symbol, 0);
+    assert_equal(ret, ZINT_ERROR_FILE_ACCESS, "ZBarcode_Print ret %d != ZINT_ERROR_FILE_ACCESS (%s)\n", ret, symbol->errtxt);
+    assert_zero(strcmp(symbol->errtxt, "Error 676: Could not append to TIF output file, not a valid little-endian TIF file"), "errtxt %s\n", symbol->errtxt);
+    assert_zero(testUtilRemove(tif), "testUtilRemove(%s) != 0\n", tif);
+
+    ZBarcode_Delete(symbol);
+
+    testFinish();
+}
+
 static void test_outfile(const testCtx *const p_ctx) {
     int ret;
     int skip_readonly_test = 0;
     struct zint_symbol symbol = {0};
     unsigned char data[] = { "1" };
+    struct out_raster_rows rows;
 
     (void)p_ctx;
 
@@ -341,6 +1016,7 @@ static void test_outfile(const testCtx *const p_ctx) {
     symbol.symbology = BARCODE_CODE128;
     symbol.bitmap = data;
     symbol.bitmap_width = symbol.bitmap_height = 1;
+    (void) out_raster_rows_init(&rows, data, 1, 1, 0.0f, 0);
 
     strcpy(symbol.outfile, "test_tif_out.tif");
 #ifndef _WIN32
@@ -352,7 +1028,7 @@ static void test_outfile(const testCtx *const p_ctx) {
         (void) testUtilRmROFile(symbol.outfile); /* In case lying around from previous fail */
         assert_nonzero(testUtilCreateROFile(symbol.outfile), "tif_pixel_plot testUtilCreateROFile(%s) fail (%d: %s)\n", symbol.outfile, errno, strerror(errno));
 
-        ret = tif_pixel_plot(&symbol, data);
+        ret = tif_pixel_plot(&symbol, &rows);
         assert_equal(ret, ZINT_ERROR_FILE_ACCESS, "tif_pixel_plot ret %d != ZINT_ERROR_FILE_ACCESS (%d) (%s)\n", ret, ZINT_ERROR_FILE_ACCESS, symbol.errtxt);
         assert_zero(testUtilRmROFile(symbol.outfile), "tif_pixel_plot testUtilRmROFile(%s) != 0 (%d: %s)\n", symbol.outfile, errno, strerror(errno));
         assert_zero(strncmp(symbol.errtxt, expected_errtxt, sizeof(expected_errtxt) - 1), "strncmp(%s, %s) != 0\n", symbol.errtxt, expected_errtxt);
@@ -361,7 +1037,7 @@ static void test_outfile(const testCtx *const p_ctx) {
     symbol.output_options |= BARCODE_STDOUT;
 
     printf("<<<Begin ignore (TIF to stdout)\n"); fflush(stdout);
-    ret = tif_pixel_plot(&symbol, data);
+    ret = tif_pixel_plot(&symbol, &rows);
     printf("\n<<<End ignore (TIF to stdout)\n"); fflush(stdout);
     assert_zero(ret, "tif_pixel_plot ret %d != 0 (%s)\n", ret, symbol.errtxt);
 
@@ -373,6 +1049,9 @@ int main(int argc, char *argv[]) {
     testFunction funcs[] = { /* name, func */
         { "test_pixel_plot", test_pixel_plot },
         { "test_print", test_print },
+        { "test_compression", test_compression },
+        { "test_g4_roundtrip", test_g4_roundtrip },
+        { "test_append", test_append },
         { "test_outfile", test_outfile },
     };
 
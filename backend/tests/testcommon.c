@@ -687,6 +687,11 @@ const char *testUtilOutputOptionsName(int output_options) {
         { "EMBED_VECTOR_FONT", EMBED_VECTOR_FONT, 0x8000 },
         { "BARCODE_MEMORY_FILE", BARCODE_MEMORY_FILE, 0x10000 },
         { "BARCODE_RAW_TEXT", BARCODE_RAW_TEXT, 0x20000 },
+        { "BARCODE_RETAIN_BUFFERS", BARCODE_RETAIN_BUFFERS, 0x40000 },
+        { "OUT_BUFFER_1BPP", OUT_BUFFER_1BPP, 0x80000 },
+        { "OUT_BUFFER_RGBA", OUT_BUFFER_RGBA, 0x100000 },
+        { "OUT_BUFFER_PREMULTIPLIED", OUT_BUFFER_PREMULTIPLIED, 0x200000 },
+        { "BARCODE_TIF_APPEND", BARCODE_TIF_APPEND, 0x400000 },
     };
     static int const data_size = ARRAY_SIZE(data);
     int set = 0;
@@ -38,6 +38,7 @@
 #include "filemem.h"
 #include "output.h"
 #include "tif.h"
+#include "tif_g4.h"
 #include "tif_lzw.h"
 
 /* PhotometricInterpretation */
@@ -49,6 +50,7 @@
 
 /* Compression */
 #define TIF_NO_COMPRESSION      1
+#define TIF_CCITT_G4            4 /* CCITT T.6 bilevel encoding */
 #define TIF_LZW                 5
 
 static void to_color_map(const unsigned char rgb[4], tiff_color_t *color_map_entry) {
@@ -69,8 +71,101 @@ static void to_cmyk(const char *colour, unsigned char *cmyk) {
     cmyk[4] = alpha;
 }
 
+/* Little-endian input */
+#define TIF_LE_U16(b) ((b)[0] | ((b)[1] << 8))
+#define TIF_LE_U32(b) ((b)[0] | ((b)[1] << 8) | ((b)[2] << 16) | ((uint32_t) (b)[3] << 24))
+
+/* Maximum number of IFD entries written (see `tags` below) */
+#define TIF_MAX_ENTRIES 20
+
+/* For `BARCODE_TIF_APPEND`, find where in existing TIF `symbol->outfile` to link in a new page, setting `p_end` to
+   its size and `p_link` to the position of the last IFD's next IFD offset. Returns 1 if found, 0 if file doesn't
+   exist or is empty, -1 if not a valid little-endian TIF */
+static int tif_append_link(const struct zint_symbol *symbol, long *p_end, long *p_link) {
+    unsigned char buf[2 + TIF_MAX_ENTRIES * 12 + 4];
+    FILE *fp;
+    long end, ifd, link = 4;
+    long pages;
+    int len, entries, i;
+
+#ifdef _WIN32
+    fp = out_win_fopen(symbol->outfile, "rb");
+#else
+    fp = fopen(symbol->outfile, "rb");
+#endif
+    if (!fp) {
+        return 0;
+    }
+    if (fseek(fp, 0, SEEK_END) != 0 || (end = ftell(fp)) < 0) {
+        (void) fclose(fp);
+        return -1;
+    }
+    if (end == 0) {
+        (void) fclose(fp);
+        return 0;
+    }
+    *p_end = end;
+    if (end < 8 + 2 + 12 + 4 || fseek(fp, 0, SEEK_SET) != 0 || fread(buf, 1, 8, fp) != 8
+            || buf[0] != 'I' || buf[1] != 'I' || TIF_LE_U16(buf + 2) != 42) {
+        (void) fclose(fp);
+        return -1;
+    }
+    ifd = (long) TIF_LE_U32(buf + 4);
+
+    /* Pages appended by us end with their IFD, so first check if file ends with an IFD (starting with ImageWidth,
+       tags ascending, no next IFD), which avoids following the chain */
+    len = end - 8 < (long) sizeof(buf) ? (int) (end - 8) : (int) sizeof(buf);
+    if (fseek(fp, end - len, SEEK_SET) == 0 && fread(buf, 1, len, fp) == (size_t) len
+            && TIF_LE_U32(buf + len - 4) == 0) {
+        for (entries = 1; entries <= TIF_MAX_ENTRIES && 2 + entries * 12 + 4 <= len; entries++) {
+            const unsigned char *const ifd_buf = buf + len - 4 - entries * 12 - 2;
+            if (TIF_LE_U16(ifd_buf) == entries && TIF_LE_U16(ifd_buf + 2) == 0x0100) {
+                for (i = 1; i < entries && TIF_LE_U16(ifd_buf + 2 + i * 12) > TIF_LE_U16(ifd_buf + 2 + (i - 1) * 12);
+                        i++);
+                if (i == entries) {
+                    (void) fclose(fp);
+                    *p_link = end - 4;
+                    return 1;
+                }
+            }
+        }
+    }
+
+    /* Otherwise follow the chain (at most `end / 18` IFDs, the minimum IFD size, to guard against loops) */
+    for (pages = 0; ifd; pages++) {
+        if ((ifd & 1) || ifd < 8 || ifd > end - (2 + 12 + 4) || pages > end / 18
+                || fseek(fp, ifd, SEEK_SET) != 0 || fread(buf, 1, 2, fp) != 2) {
+            (void) fclose(fp);
+            return -1;
+        }
+        link = ifd + 2 + TIF_LE_U16(buf) * 12;
+        if (link > end - 4 || fseek(fp, link, SEEK_SET) != 0 || fread(buf, 1, 4, fp) != 4) {
+            (void) fclose(fp);
+            return -1;
+        }
+        ifd = (long) TIF_LE_U32(buf);
+    }
+    (void) fclose(fp);
+    if (!pages) {
+        return -1;
+    }
+    *p_link = link;
+    return 1;
+}
+
+/* Write IFD `tags` with no next IFD */
+static void tif_write_ifd(struct filemem *fmp, const tiff_tag_t *tags, const uint16_t entries) {
+    uint16_t temp16;
+    uint32_t offset = 0;
+
+    out_le_u16(temp16, entries);
+    fm_write(&temp16, sizeof(entries), 1, fmp);
+    fm_write(tags, sizeof(tiff_tag_t), entries, fmp);
+    fm_write(&offset, sizeof(offset), 1, fmp);
+}
+
 /* TIFF Revision 6.0 https://www.adobe.io/content/dam/udp/en/open/standards/tiff/TIFF6.pdf */
-INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf) {
+INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, struct out_raster_rows *rows) {
     unsigned char fg[4], bg[4];
     int i;
     int pmi; /* PhotometricInterpretation */
@@ -95,21 +190,35 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
     const unsigned char *pb;
     int compression = TIF_NO_COMPRESSION;
     tif_lzw_state lzw_state;
+    tif_g4_state g4_state = {0};
+    int try_g4 = 0;
     long file_pos;
     const int output_to_stdout = symbol->output_options & BARCODE_STDOUT;
+    const int append = symbol->output_options & BARCODE_TIF_APPEND;
+    int append_existing = 0;
+    long append_end = 0, append_link = 4; /* Size of existing file, position of offset to new page's IFD */
     uint32_t *strip_offset;
     uint32_t *strip_bytes;
     unsigned char *strip_buf;
 
     tiff_header_t header;
     uint16_t entries = 0;
-    tiff_tag_t tags[20];
-    uint32_t offset = 0;
-    int update_offsets[20];
+    tiff_tag_t tags[TIF_MAX_ENTRIES];
+    int update_offsets[TIF_MAX_ENTRIES];
     int offsets = 0;
     int ifd_size;
     uint32_t temp32;
-    uint16_t temp16;
+
+    if (append) {
+        if (symbol->output_options & (BARCODE_STDOUT | BARCODE_MEMORY_FILE)) {
+            return errtxt(ZINT_ERROR_INVALID_OPTION, symbol, 675,
+                            "Cannot append TIF page to standard output or memory file");
+        }
+        if ((append_existing = tif_append_link(symbol, &append_end, &append_link)) < 0) {
+            return errtxt(ZINT_ERROR_FILE_ACCESS, symbol, 676,
+                            "Could not append to TIF output file, not a valid little-endian TIF file");
+        }
+    }
 
     (void) out_colour_get_rgb(symbol->fgcolour, &fg[0], &fg[1], &fg[2], &fg[3]);
     (void) out_colour_get_rgb(symbol->bgcolour, &bg[0], &bg[1], &bg[2], &bg[3]);
@@ -283,7 +392,8 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
     strip_bytes = (uint32_t *) z_alloca(sizeof(uint32_t) * strip_count);
     strip_buf = (unsigned char *) z_alloca(bytes_per_strip + 1);
 
-    free_memory = sizeof(tiff_header_t);
+    /* Appended page starts at (word-aligned) end of existing file */
+    free_memory = append_existing ? (size_t) (append_end + (append_end & 1)) : sizeof(tiff_header_t);
 
     for (i = 0; i < strip_count; i++) {
         strip_offset[i] = (uint32_t) free_memory;
@@ -309,29 +419,46 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
     }
 
     /* Open output file in binary mode */
-    if (!fm_open(fmp, symbol, "wb")) {
+    if (!fm_open(fmp, symbol, append_existing ? "r+b" : "wb")) {
         return ZEXT errtxtf(ZINT_ERROR_FILE_ACCESS, symbol, 672, "Could not open TIF output file (%1$d: %2$s)",
                             fmp->err, strerror(fmp->err));
     }
+    /* Compression requires seeking to update strip sizes after writing */
     if (!output_to_stdout) {
         compression = TIF_LZW;
         tif_lzw_init(&lzw_state);
+        if (bits_per_sample == 1) { /* WHITEISZERO or BLACKISZERO, so can try CCITT G4 */
+            if (!tif_g4_init(&g4_state, symbol->bitmap_width)) {
+                (void) fm_close(fmp, symbol);
+                return errtxt(ZINT_ERROR_MEMORY, symbol, 671, "Insufficient memory for TIF G4 buffers");
+            }
+            try_g4 = 1;
+        }
     }
 
-    /* Header */
-    out_le_u16(header.byte_order, 0x4949); /* "II" little-endian */
-    out_le_u16(header.identity, 42);
-    out_le_u32(header.offset, free_memory);
+    if (append_existing) {
+        fm_seek(fmp, append_end, SEEK_SET);
+        total_bytes_put = append_end;
+        if (total_bytes_put & 1) {
+            fm_putc(0, fmp); /* Strips (and IFD) must be on word boundary */
+            total_bytes_put++;
+        }
+    } else {
+        /* Header */
+        out_le_u16(header.byte_order, 0x4949); /* "II" little-endian */
+        out_le_u16(header.identity, 42);
+        out_le_u32(header.offset, append ? 0 : free_memory); /* If append, set after writing IFD below */
 
-    fm_write(&header, sizeof(tiff_header_t), 1, fmp);
-    total_bytes_put = sizeof(tiff_header_t);
+        fm_write(&header, sizeof(tiff_header_t), 1, fmp);
+        total_bytes_put = sizeof(tiff_header_t);
+    }
 
     /* Pixel data */
-    pb = pixelbuf;
     strip = 0;
     strip_row = 0;
     bytes_put = 0;
     for (row = 0; row < symbol->bitmap_height; row++) {
+        pb = out_raster_row(rows, row);
         if (samples_per_pixel == 1) {
             if (bits_per_sample == 1) { /* WHITEISZERO or BLACKISZERO */
                 for (column = 0; column < symbol->bitmap_width; column += 8) {
@@ -368,10 +495,26 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
 
         if (strip_row == rows_per_strip || (strip == strip_count - 1 && strip_row == rows_last_strip)) {
             /* End of strip */
-            if (compression == TIF_LZW) {
+            if (try_g4) {
+                /* G4 beats LZW on most barcodes but not all (e.g. when rows repeat a lot at small sizes), so count
+                   both on first strip and use smaller */
+                try_g4 = 0;
+                tif_g4_encode(&g4_state, NULL /*op_fmp*/, strip_buf, strip_row);
+                if (tif_lzw_encode(&lzw_state, NULL /*op_fmp*/, strip_buf, bytes_put)
+                        && g4_state.bytes_out < lzw_state.bytes_out) {
+                    compression = TIF_CCITT_G4;
+                }
+                if (symbol->debug & ZINT_DEBUG_PRINT) {
+                    printf("TIFF first strip G4 %ld bytes, LZW %ld bytes\n", g4_state.bytes_out, lzw_state.bytes_out);
+                }
+            }
+            if (compression != TIF_NO_COMPRESSION) {
                 file_pos = fm_tell(fmp);
-                if (!tif_lzw_encode(&lzw_state, fmp, strip_buf, bytes_put)) { /* Only fails if can't malloc */
+                if (compression == TIF_CCITT_G4) {
+                    tif_g4_encode(&g4_state, fmp, strip_buf, strip_row);
+                } else if (!tif_lzw_encode(&lzw_state, fmp, strip_buf, bytes_put)) { /* Only fails if can't malloc */
                     tif_lzw_cleanup(&lzw_state);
+                    tif_g4_cleanup(&g4_state);
                     (void) fm_close(fmp, symbol);
                     return errtxt(ZINT_ERROR_MEMORY, symbol, 673, "Insufficient memory for TIF LZW hash table");
                 }
@@ -400,11 +543,11 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
         total_bytes_put++;
     }
 
-    if (compression == TIF_LZW) {
+    if (compression != TIF_NO_COMPRESSION) {
         tif_lzw_cleanup(&lzw_state);
+        tif_g4_cleanup(&g4_state);
 
         file_pos = fm_tell(fmp);
-        fm_seek(fmp, 4, SEEK_SET);
         free_memory = file_pos;
         temp32 = (uint32_t) free_memory;
         /* Shouldn't happen as `free_memory` checked above to be <= 0xffff0000 & should only decrease */
@@ -412,9 +555,12 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
             (void) fm_close(fmp, symbol);
             return errtxt(ZINT_ERROR_MEMORY, symbol, 982, "TIF output file size too big");
         }
-        out_le_u32(temp32, temp32);
-        fm_write(&temp32, 4, 1, fmp);
-        fm_seek(fmp, file_pos, SEEK_SET);
+        if (!append) {
+            fm_seek(fmp, 4, SEEK_SET);
+            out_le_u32(temp32, temp32);
+            fm_write(&temp32, 4, 1, fmp);
+            fm_seek(fmp, file_pos, SEEK_SET);
+        }
     }
 
     /* Image File Directory */
@@ -526,17 +672,16 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
         out_le_u32(tags[entries++].offset, extra_samples);
     }
 
-    ifd_size = sizeof(entries) + sizeof(tiff_tag_t) * entries + sizeof(offset);
+    /* If appending, IFD goes after the data it references, so that the file ends with the next IFD offset */
+    ifd_size = sizeof(entries) + sizeof(tiff_tag_t) * entries + 4 /*next IFD offset*/;
     for (i = 0; i < offsets; i++) {
-        out_le_u32(tags[update_offsets[i]].offset, tags[update_offsets[i]].offset + ifd_size);
+        out_le_u32(tags[update_offsets[i]].offset, tags[update_offsets[i]].offset + (append ? 0 : ifd_size));
     }
 
-    out_le_u16(temp16, entries);
-    fm_write(&temp16, sizeof(entries), 1, fmp);
-    fm_write(&tags, sizeof(tiff_tag_t), entries, fmp);
-    out_le_u32(offset, offset);
-    fm_write(&offset, sizeof(offset), 1, fmp);
-    total_bytes_put += ifd_size;
+    if (!append) {
+        tif_write_ifd(fmp, tags, entries);
+        total_bytes_put += ifd_size;
+    }
 
     if (samples_per_pixel > 2) {
         out_le_u16(bits_per_sample, bits_per_sample);
@@ -588,6 +733,21 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, const unsigned char *pix
         total_bytes_put += 6 * color_map_size;
     }
 
+    if (append) {
+        /* Link in IFD (from header if new file) */
+        file_pos = total_bytes_put;
+        tif_write_ifd(fmp, tags, entries);
+        total_bytes_put += ifd_size;
+        if ((uint32_t) total_bytes_put != total_bytes_put) {
+            (void) fm_close(fmp, symbol);
+            return errtxt(ZINT_ERROR_MEMORY, symbol, 677, "TIF output file size too big");
+        }
+        fm_seek(fmp, append_link, SEEK_SET);
+        out_le_u32(temp32, file_pos);
+        fm_write(&temp32, 4, 1, fmp);
+        fm_seek(fmp, total_bytes_put, SEEK_SET);
+    }
+
     if (fm_error(fmp)) {
         ZEXT errtxtf(0, symbol, 679, "Incomplete write of TIF output (%1$d: %2$s)", fmp->err, strerror(fmp->err));
         (void) fm_close(fmp, symbol);
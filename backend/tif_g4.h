@@ -0,0 +1,260 @@
+/*  tif_g4.h - CCITT Group 4 (T.6) compression for bilevel TIFF */
+/*
+    libzint - the open source barcode library
+    Copyright (C) 2025 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+#ifndef Z_TIF_G4_H
+#define Z_TIF_G4_H
+
+#ifdef  __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* ITU-T Recommendation T.6 (11/88) "Facsimile coding schemes and coding control functions for Group 4 facsimile
+   apparatus", using the run-length code tables of ITU-T Recommendation T.4 (07/2003) Section 4.1.
+   Each row is coded two-dimensionally against the row above (the first row of each strip against an imaginary
+   all-white row), in terms of "changing elements", i.e. the columns where the pixel value differs from the one to
+   its left (pixels left of the row being taken as 0, which TIFF calls white regardless of PhotometricInterpretation).
+   FillOrder is 1 (most significant bit first) */
+
+/* Code values and bit lengths of white runs 0-63 (terminating codes), then 64-1728 (make-up codes) */
+static const unsigned short tif_g4_white_codes[91][2] = {
+    { 0x35, 8 }, { 0x07, 6 }, { 0x07, 4 }, { 0x08, 4 }, { 0x0B, 4 }, { 0x0C, 4 }, { 0x0E, 4 }, { 0x0F, 4 }, /* 0 */
+    { 0x13, 5 }, { 0x14, 5 }, { 0x07, 5 }, { 0x08, 5 }, { 0x08, 6 }, { 0x03, 6 }, { 0x34, 6 }, { 0x35, 6 }, /* 8 */
+    { 0x2A, 6 }, { 0x2B, 6 }, { 0x27, 7 }, { 0x0C, 7 }, { 0x08, 7 }, { 0x17, 7 }, { 0x03, 7 }, { 0x04, 7 }, /* 16 */
+    { 0x28, 7 }, { 0x2B, 7 }, { 0x13, 7 }, { 0x24, 7 }, { 0x18, 7 }, { 0x02, 8 }, { 0x03, 8 }, { 0x1A, 8 }, /* 24 */
+    { 0x1B, 8 }, { 0x12, 8 }, { 0x13, 8 }, { 0x14, 8 }, { 0x15, 8 }, { 0x16, 8 }, { 0x17, 8 }, { 0x28, 8 }, /* 32 */
+    { 0x29, 8 }, { 0x2A, 8 }, { 0x2B, 8 }, { 0x2C, 8 }, { 0x2D, 8 }, { 0x04, 8 }, { 0x05, 8 }, { 0x0A, 8 }, /* 40 */
+    { 0x0B, 8 }, { 0x52, 8 }, { 0x53, 8 }, { 0x54, 8 }, { 0x55, 8 }, { 0x24, 8 }, { 0x25, 8 }, { 0x58, 8 }, /* 48 */
+    { 0x59, 8 }, { 0x5A, 8 }, { 0x5B, 8 }, { 0x4A, 8 }, { 0x4B, 8 }, { 0x32, 8 }, { 0x33, 8 }, { 0x34, 8 }, /* 56 */
+    { 0x1B, 5 }, { 0x12, 5 }, { 0x17, 6 }, { 0x37, 7 }, { 0x36, 8 }, { 0x37, 8 }, { 0x64, 8 }, /* 64-448 */
+    { 0x65, 8 }, { 0x68, 8 }, { 0x67, 8 }, { 0xCC, 9 }, { 0xCD, 9 }, { 0xD2, 9 }, { 0xD3, 9 }, /* 512-896 */
+    { 0xD4, 9 }, { 0xD5, 9 }, { 0xD6, 9 }, { 0xD7, 9 }, { 0xD8, 9 }, { 0xD9, 9 }, { 0xDA, 9 }, /* 960-1344 */
+    { 0xDB, 9 }, { 0x98, 9 }, { 0x99, 9 }, { 0x9A, 9 }, { 0x18, 6 }, { 0x9B, 9 }, /* 1408-1728 */
+};
+
+/* Code values and bit lengths of black runs 0-63 (terminating codes), then 64-1728 (make-up codes) */
+static const unsigned short tif_g4_black_codes[91][2] = {
+    { 0x37, 10 }, { 0x02, 3 }, { 0x03, 2 }, { 0x02, 2 }, { 0x03, 3 }, { 0x03, 4 }, { 0x02, 4 }, /* 0-6 */
+    { 0x03, 5 }, { 0x05, 6 }, { 0x04, 6 }, { 0x04, 7 }, { 0x05, 7 }, { 0x07, 7 }, { 0x04, 8 }, /* 7-13 */
+    { 0x07, 8 }, { 0x18, 9 }, { 0x17, 10 }, { 0x18, 10 }, { 0x08, 10 }, { 0x67, 11 }, { 0x68, 11 }, /* 14-20 */
+    { 0x6C, 11 }, { 0x37, 11 }, { 0x28, 11 }, { 0x17, 11 }, { 0x18, 11 }, { 0xCA, 12 }, { 0xCB, 12 }, /* 21-27 */
+    { 0xCC, 12 }, { 0xCD, 12 }, { 0x68, 12 }, { 0x69, 12 }, { 0x6A, 12 }, { 0x6B, 12 }, { 0xD2, 12 }, /* 28-34 */
+    { 0xD3, 12 }, { 0xD4, 12 }, { 0xD5, 12 }, { 0xD6, 12 }, { 0xD7, 12 }, { 0x6C, 12 }, { 0x6D, 12 }, /* 35-41 */
+    { 0xDA, 12 }, { 0xDB, 12 }, { 0x54, 12 }, { 0x55, 12 }, { 0x56, 12 }, { 0x57, 12 }, { 0x64, 12 }, /* 42-48 */
+    { 0x65, 12 }, { 0x52, 12 }, { 0x53, 12 }, { 0x24, 12 }, { 0x37, 12 }, { 0x38, 12 }, { 0x27, 12 }, /* 49-55 */
+    { 0x28, 12 }, { 0x58, 12 }, { 0x59, 12 }, { 0x2B, 12 }, { 0x2C, 12 }, { 0x5A, 12 }, { 0x66, 12 }, /* 56-62 */
+    { 0x67, 12 }, /* 63 */
+    { 0x0F, 10 }, { 0xC8, 12 }, { 0xC9, 12 }, { 0x5B, 12 }, { 0x33, 12 }, { 0x34, 12 }, { 0x35, 12 }, /* 64-448 */
+    { 0x6C, 13 }, { 0x6D, 13 }, { 0x4A, 13 }, { 0x4B, 13 }, { 0x4C, 13 }, { 0x4D, 13 }, { 0x72, 13 }, /* 512-896 */
+    { 0x73, 13 }, { 0x74, 13 }, { 0x75, 13 }, { 0x76, 13 }, { 0x77, 13 }, { 0x52, 13 }, { 0x53, 13 }, /* 960-1344 */
+    { 0x54, 13 }, { 0x55, 13 }, { 0x5A, 13 }, { 0x5B, 13 }, { 0x64, 13 }, { 0x65, 13 }, /* 1408-1728 */
+};
+
+/* Code values and bit lengths of extended make-up runs 1792-2560, common to white and black */
+static const unsigned short tif_g4_ext_codes[13][2] = {
+    { 0x08, 11 }, { 0x0C, 11 }, { 0x0D, 11 }, { 0x12, 12 }, { 0x13, 12 }, { 0x14, 12 }, { 0x15, 12 }, /* 1792-2176 */
+    { 0x16, 12 }, { 0x17, 12 }, { 0x1C, 12 }, { 0x1D, 12 }, { 0x1E, 12 }, { 0x1F, 12 }, /* 2240-2560 */
+};
+
+/* Vertical mode codes VL3, VL2, VL1, V0, VR1, VR2, VR3, indexed by a1 - b1 + 3 */
+static const unsigned char tif_g4_vert_codes[7][2] = {
+    { 0x02, 7 }, { 0x02, 6 }, { 0x02, 3 }, { 0x01, 1 }, { 0x03, 3 }, { 0x03, 6 }, { 0x03, 7 },
+};
+
+#define TIF_G4_PASS     0x1, 4  /* Pass mode code, bit length */
+#define TIF_G4_HORIZ    0x1, 3  /* Horizontal mode code, bit length */
+#define TIF_G4_EOL      0x1, 12 /* End-of-line code (twice for end-of-facsimile-block EOFB), bit length */
+
+/*
+ * State block.
+ */
+typedef struct {
+    int width;          /* Row width in pixels */
+    int *ref;           /* Changing elements of reference row, followed by 3 `width` sentinels */
+    int *cur;           /* Changing elements of coding row, ditto */
+    uint32_t bit_buf;   /* Pending output bits (lowest `bit_cnt`) */
+    int bit_cnt;        /* Number of pending output bits (< 8 between calls) */
+    long bytes_out;     /* Bytes output by last strip encoded */
+} tif_g4_state;
+
+/* Output `len` low bits of `code`, most significant first, or just count them if no `op_fmp` */
+static void tif_g4_put_bits(tif_g4_state *sp, struct filemem *op_fmp, const unsigned int code, const int len) {
+    sp->bit_buf = (sp->bit_buf << len) | code;
+    sp->bit_cnt += len;
+    while (sp->bit_cnt >= 8) {
+        sp->bit_cnt -= 8;
+        if (op_fmp) {
+            fm_putc((sp->bit_buf >> sp->bit_cnt) & 0xFF, op_fmp);
+        }
+        sp->bytes_out++;
+    }
+}
+
+/* Output run of `run` pixels of colour `black` as make-up code(s) (if any) followed by a terminating code */
+static void tif_g4_put_run(tif_g4_state *sp, struct filemem *op_fmp, int run, const int black) {
+    const unsigned short (*codes)[2] = black ? tif_g4_black_codes : tif_g4_white_codes;
+
+    while (run >= 2560) {
+        tif_g4_put_bits(sp, op_fmp, tif_g4_ext_codes[12][0], tif_g4_ext_codes[12][1]);
+        run -= 2560;
+    }
+    if (run >= 1792) {
+        tif_g4_put_bits(sp, op_fmp, tif_g4_ext_codes[(run >> 6) - 28][0], tif_g4_ext_codes[(run >> 6) - 28][1]);
+        run &= 0x3F;
+    } else if (run >= 64) {
+        tif_g4_put_bits(sp, op_fmp, codes[63 + (run >> 6)][0], codes[63 + (run >> 6)][1]);
+        run &= 0x3F;
+    }
+    tif_g4_put_bits(sp, op_fmp, codes[run][0], codes[run][1]);
+}
+
+/* Set `changes` to the changing elements of packed row `bp`, followed by 3 `width` sentinels. Pad bits of the last
+   byte must be 0 */
+static void tif_g4_changes(const unsigned char *bp, const int width, int *changes) {
+    int x = 0, n = 0;
+    int colour = 0;
+
+    while (x < width) {
+        const unsigned char byte = bp[x >> 3];
+        if ((x & 7) == 0 && byte == (colour ? 0xFF : 0)) {
+            x += 8; /* Skip whole byte of current colour */
+            continue;
+        }
+        if (((byte >> (7 - (x & 7))) & 1) != colour) {
+            changes[n++] = x;
+            colour = !colour;
+        }
+        x++;
+    }
+    changes[n] = changes[n + 1] = changes[n + 2] = width;
+}
+
+/* Code the row whose changing elements are in `sp->cur` against the reference row in `sp->ref` (T.6 Section 2.2) */
+static void tif_g4_encode_row(tif_g4_state *sp, struct filemem *op_fmp) {
+    const int *const cur = sp->cur;
+    const int *const ref = sp->ref;
+    const int width = sp->width;
+    int a0 = -1; /* Imaginary changing element before the row */
+    int colour = 0; /* Colour of `a0` */
+    int ai = 0, bi = 0;
+    int a1, b1, b2;
+
+    while (a0 < width) {
+        /* a1: next changing element on coding row to right of a0 */
+        while (cur[ai] <= a0) {
+            ai++;
+        }
+        a1 = cur[ai];
+        /* b1: next changing element on reference row to right of a0 and of opposite colour to a0 (even elements
+           change to black). May be the element before last time's b1 if vertical mode changed colour */
+        if (bi) {
+            bi--;
+        }
+        while (ref[bi] <= a0 || (bi & 1) != colour) {
+            bi++;
+        }
+        b1 = ref[bi];
+        b2 = ref[bi + 1];
+
+        if (b2 < a1) {
+            tif_g4_put_bits(sp, op_fmp, TIF_G4_PASS);
+            a0 = b2;
+        } else if (a1 - b1 <= 3 && b1 - a1 <= 3) {
+            tif_g4_put_bits(sp, op_fmp, tif_g4_vert_codes[a1 - b1 + 3][0], tif_g4_vert_codes[a1 - b1 + 3][1]);
+            a0 = a1;
+            colour = !colour;
+        } else {
+            const int a2 = cur[ai + 1]; /* Next changing element after a1 */
+            tif_g4_put_bits(sp, op_fmp, TIF_G4_HORIZ);
+            tif_g4_put_run(sp, op_fmp, a1 - (a0 < 0 ? 0 : a0), colour);
+            tif_g4_put_run(sp, op_fmp, a2 - a1, !colour);
+            a0 = a2;
+        }
+    }
+}
+
+/*
+ * Encode a strip of `rows` packed rows `bp` (each `(width + 7) / 8` bytes, pad bits 0), terminated by EOFB and
+ * padded to a byte boundary. If `op_fmp` is NULL, the output is only counted (in `bytes_out`).
+ */
+static void tif_g4_encode(tif_g4_state *sp, struct filemem *op_fmp, const unsigned char *bp, const int rows) {
+    const int row_bytes = (sp->width + 7) >> 3;
+    int row;
+
+    /* Reference row for first row is all white */
+    sp->ref[0] = sp->ref[1] = sp->ref[2] = sp->width;
+    sp->bytes_out = 0;
+
+    for (row = 0; row < rows; row++, bp += row_bytes) {
+        int *temp;
+        tif_g4_changes(bp, sp->width, sp->cur);
+        tif_g4_encode_row(sp, op_fmp);
+        temp = sp->ref;
+        sp->ref = sp->cur;
+        sp->cur = temp;
+    }
+
+    tif_g4_put_bits(sp, op_fmp, TIF_G4_EOL);
+    tif_g4_put_bits(sp, op_fmp, TIF_G4_EOL);
+    if (sp->bit_cnt) {
+        tif_g4_put_bits(sp, op_fmp, 0, 8 - sp->bit_cnt);
+    }
+}
+
+/* Free buffers allocated by `tif_g4_init()` */
+static void tif_g4_cleanup(tif_g4_state *sp) {
+    z_free(sp->ref);
+    z_free(sp->cur);
+    sp->ref = sp->cur = NULL;
+}
+
+/* Set up to encode rows `width` pixels wide. Returns 0 if memory allocation fails */
+static int tif_g4_init(tif_g4_state *sp, const int width) {
+    sp->width = width;
+    /* At most `width` changing elements plus 3 sentinels */
+    sp->ref = (int *) z_malloc(sizeof(int) * (width + 3));
+    sp->cur = (int *) z_malloc(sizeof(int) * (width + 3));
+    sp->bit_buf = 0;
+    sp->bit_cnt = 0;
+    sp->bytes_out = 0;
+    if (!sp->ref || !sp->cur) {
+        tif_g4_cleanup(sp);
+        return 0;
+    }
+    return 1;
+}
+
+#ifdef  __cplusplus
+}
+#endif /* __cplusplus */
+
+/* vim: set ts=4 sw=4 et : */
+#endif /* Z_TIF_G4_H */
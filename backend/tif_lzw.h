@@ -125,6 +125,7 @@ typedef struct {
  */
 typedef struct {
     tif_lzw_hash *enc_hashtab;  /* kept separate for small machines */
+    long bytes_out;             /* bytes output by last strip encoded */
 } tif_lzw_state;
 
 /*
@@ -164,14 +165,22 @@ static void tif_lzw_cl_hash(tif_lzw_state *sp) {
         rat = (incount << 8) / outcount; \
 }
 
+/* Output byte, or just count it if no `op_fmp` */
+#define PutNextByte(op_fmp, b) { \
+    if (op_fmp) { \
+        fm_putc(b, op_fmp); \
+    } \
+    sp->bytes_out++; \
+}
+
 /* Explicit 0xff masking to make icc -check=conversions happy */
 #define PutNextCode(op_fmp, c) { \
     nextdata = (nextdata << nbits) | c; \
     nextbits += nbits; \
-    fm_putc((nextdata >> (nextbits - 8)) & 0xff, op_fmp); \
+    PutNextByte(op_fmp, (nextdata >> (nextbits - 8)) & 0xff); \
     nextbits -= 8; \
     if (nextbits >= 8) { \
-        fm_putc((nextdata >> (nextbits - 8)) & 0xff, op_fmp); \
+        PutNextByte(op_fmp, (nextdata >> (nextbits - 8)) & 0xff); \
         nextbits -= 8; \
     } \
     outcount += nbits; \
@@ -190,6 +199,8 @@ static void tif_lzw_cl_hash(tif_lzw_state *sp) {
  * but after the table fills.  The variable-length output codes
  * are re-sized at this point, and a CODE_CLEAR is generated
  * for the decoder.
+ *
+ * If `op_fmp` is NULL, the output is only counted (in `bytes_out`).
  */
 static int tif_lzw_encode(tif_lzw_state *sp, struct filemem *op_fmp, const unsigned char *bp, int cc) {
     register long fcode;
@@ -212,7 +223,7 @@ static int tif_lzw_encode(tif_lzw_state *sp, struct filemem *op_fmp, const unsig
      * Reset encoding state at the start of a strip.
      */
     if (sp->enc_hashtab == NULL) {
-        sp->enc_hashtab = (tif_lzw_hash *) malloc(HSIZE * sizeof(tif_lzw_hash));
+        sp->enc_hashtab = (tif_lzw_hash *) z_malloc(HSIZE * sizeof(tif_lzw_hash));
         if (sp->enc_hashtab == NULL) {
             return 0;
         }
@@ -229,6 +240,7 @@ static int tif_lzw_encode(tif_lzw_state *sp, struct filemem *op_fmp, const unsig
     ratio = 0;
     incount = 0;
     outcount = 0;
+    sp->bytes_out = 0;
 
     ent = (tif_lzw_hcode) -1;
 
@@ -358,7 +370,7 @@ static int tif_lzw_encode(tif_lzw_state *sp, struct filemem *op_fmp, const unsig
     PutNextCode(op_fmp, CODE_EOI);
     /* Explicit 0xff masking to make icc -check=conversions happy */
     if (nextbits > 0) {
-        fm_putc((nextdata << (8 - nextbits)) & 0xff, op_fmp);
+        PutNextByte(op_fmp, (nextdata << (8 - nextbits)) & 0xff);
     }
 
     return 1;
@@ -366,12 +378,13 @@ static int tif_lzw_encode(tif_lzw_state *sp, struct filemem *op_fmp, const unsig
 
 static void tif_lzw_cleanup(tif_lzw_state *sp) {
     if (sp->enc_hashtab) {
-        free(sp->enc_hashtab);
+        z_free(sp->enc_hashtab);
     }
 }
 
 static void tif_lzw_init(tif_lzw_state *sp) {
     sp->enc_hashtab = NULL;
+    sp->bytes_out = 0;
 }
 
 #ifdef  __cplusplus
@@ -42,7 +42,7 @@ static int vector_add_rect(struct zint_symbol *symbol, const float x, const floa
             const float height, struct zint_vector_rect **last_rect) {
     struct zint_vector_rect *rect;
 
-    if (!(rect = (struct zint_vector_rect *) malloc(sizeof(struct zint_vector_rect)))) {
+    if (!(rect = (struct zint_vector_rect *) z_malloc(sizeof(struct zint_vector_rect)))) {
         /* NOTE: clang-tidy-20 gets confused about return value of function returning a function unfortunately,
            so put on 2 lines (see also "postal.c" `postnet_enc()` & `planet_enc()`, same issue) */
         errtxt(0, symbol, 691, "Insufficient memory for vector rectangle");
@@ -73,7 +73,7 @@ static int vector_add_hexagon(struct zint_symbol *symbol, const float x, const f
             const float diameter, struct zint_vector_hexagon **last_hexagon) {
     struct zint_vector_hexagon *hexagon;
 
-    if (!(hexagon = (struct zint_vector_hexagon *) malloc(sizeof(struct zint_vector_hexagon)))) {
+    if (!(hexagon = (struct zint_vector_hexagon *) z_malloc(sizeof(struct zint_vector_hexagon)))) {
         return errtxt(0, symbol, 692, "Insufficient memory for vector hexagon");
     }
 #ifdef ZINT_SANITIZEM /* Suppress clang -fsanitize=memory false positive */
@@ -99,7 +99,7 @@ static int vector_add_circle(struct zint_symbol *symbol, const float x, const fl
             const float width, const int colour, struct zint_vector_circle **last_circle) {
     struct zint_vector_circle *circle;
 
-    if (!(circle = (struct zint_vector_circle *) malloc(sizeof(struct zint_vector_circle)))) {
+    if (!(circle = (struct zint_vector_circle *) z_malloc(sizeof(struct zint_vector_circle)))) {
         return errtxt(0, symbol, 693, "Insufficient memory for vector circle");
     }
 #ifdef ZINT_SANITIZEM /* Suppress clang -fsanitize=memory false positive */
@@ -127,7 +127,7 @@ static int vector_add_string(struct zint_symbol *symbol, const unsigned char *te
             struct zint_vector_string **last_string) {
     struct zint_vector_string *string;
 
-    if (!(string = (struct zint_vector_string *) malloc(sizeof(struct zint_vector_string)))) {
+    if (!(string = (struct zint_vector_string *) z_malloc(sizeof(struct zint_vector_string)))) {
         return errtxt(0, symbol, 694, "Insufficient memory for vector string");
     }
 #ifdef ZINT_SANITIZEM /* Suppress clang -fsanitize=memory false positive */
@@ -141,8 +141,8 @@ static int vector_add_string(struct zint_symbol *symbol, const unsigned char *te
     string->length = length == -1 ? (int) ustrlen(text) : length;
     string->rotation = 0;
     string->halign = halign;
-    if (!(string->text = (unsigned char *) malloc(string->length + 1))) {
-        free(string);
+    if (!(string->text = (unsigned char *) z_malloc(string->length + 1))) {
+        z_free(string);
         return errtxt(0, symbol, 695, "Insufficient memory for vector string text");
     }
 #ifdef ZINT_SANITIZEM /* Suppress clang -fsanitize=memory false positive */
@@ -173,7 +173,7 @@ INTERNAL void vector_free(struct zint_symbol *symbol) {
         while (rect) {
             struct zint_vector_rect *r = rect;
             rect = rect->next;
-            free(r);
+            z_free(r);
         }
 
         /* Free Hexagons */
@@ -181,7 +181,7 @@ INTERNAL void vector_free(struct zint_symbol *symbol) {
         while (hex) {
             struct zint_vector_hexagon *h = hex;
             hex = hex->next;
-            free(h);
+            z_free(h);
         }
 
         /* Free Circles */
@@ -189,7 +189,7 @@ INTERNAL void vector_free(struct zint_symbol *symbol) {
         while (circle) {
             struct zint_vector_circle *c = circle;
             circle = circle->next;
-            free(c);
+            z_free(c);
         }
 
         /* Free Strings */
@@ -197,12 +197,12 @@ INTERNAL void vector_free(struct zint_symbol *symbol) {
         while (string) {
             struct zint_vector_string *s = string;
             string = string->next;
-            free(s->text);
-            free(s);
+            z_free(s->text);
+            z_free(s);
         }
 
         /* Free vector */
-        free(symbol->vector);
+        z_free(symbol->vector);
         symbol->vector = NULL;
     }
 }
@@ -376,7 +376,7 @@ static void vector_reduce_rectangles(struct zint_symbol *symbol) {
                     && (stripf(rect->y + rect->height) == target->y) && (rect->colour == target->colour)) {
                 rect->height += target->height;
                 prev->next = target->next;
-                free(target);
+                z_free(target);
             } else {
                 prev = target;
             }
@@ -456,7 +456,7 @@ INTERNAL int plot_vector(struct zint_symbol *symbol, int rotate_angle, int file_
     }
 
     /* Allocate memory */
-    if (!(vector = symbol->vector = (struct zint_vector *) malloc(sizeof(struct zint_vector)))) {
+    if (!(vector = symbol->vector = (struct zint_vector *) z_malloc(sizeof(struct zint_vector)))) {
         return errtxt(ZINT_ERROR_MEMORY, symbol, 696, "Insufficient memory for vector header");
     }
 #ifdef ZINT_SANITIZEM /* Suppress clang -fsanitize=memory false positive */
@@ -1025,9 +1025,12 @@ INTERNAL int plot_vector(struct zint_symbol *symbol, int rotate_angle, int file_
 
     if (file_type != OUT_EMF_FILE) {
         /* EMF does its own rotation (with mixed results in various apps) */
+        STATS_BEGIN(symbol, ZINT_STATS_ROTATE);
         vector_rotate(symbol, rotate_angle);
+        STATS_END(symbol, ZINT_STATS_ROTATE);
     }
 
+    STATS_BEGIN(symbol, ZINT_STATS_OUTPUT);
     switch (file_type) {
         case OUT_EPS_FILE:
             error_number = ps_plot(symbol);
@@ -1040,6 +1043,7 @@ INTERNAL int plot_vector(struct zint_symbol *symbol, int rotate_angle, int file_
             break;
         /* case OUT_BUFFER: No more work needed */
     }
+    STATS_END(symbol, ZINT_STATS_OUTPUT);
 
     return error_number ? error_number : warn_number;
 }
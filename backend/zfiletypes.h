@@ -35,6 +35,7 @@
 
 /* File types */
 #define OUT_BUFFER              0
+#define OUT_BUFFER_DEST         1   /* Caller-supplied buffer (`ZBarcode_Buffer_Into()`) */
 #define OUT_SVG_FILE            10
 #define OUT_EPS_FILE            20
 #define OUT_EMF_FILE            30
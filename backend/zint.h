@@ -40,6 +40,16 @@
 #ifndef ZINT_H
 #define ZINT_H
 
+#include <stddef.h> /* For size_t */
+
+/* 64-bit unsigned type (used by `zint_modules` below) */
+#ifdef _MSC_VER
+typedef unsigned __int64 zint_uint64;
+#else
+#include <stdint.h>
+typedef uint64_t zint_uint64;
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -94,6 +104,21 @@ extern "C" {
         char id[32];        /* Optional ID to distinguish sequence, ASCII, NUL-terminated unless max 32 long */
     };
 
+    /* Per-stage timing statistics (see `symbol->stats` below) - only gathered if built with ZINT_STATS */
+    struct zint_stats {
+        zint_uint64 ns[8];  /* Accumulated wall-clock nanoseconds per stage, indexed by ZINT_STATS_XXX below */
+        zint_uint64 calls[8]; /* Number of times each stage entered */
+    };
+
+    /* Symbol size predicted by `ZBarcode_Estimate()` (see `symbol->estimate` below) */
+    struct zint_estimate {
+        int version;        /* Size/version selected, as fed back in `option_2` */
+        int rows;           /* Number of rows the symbol will have */
+        int width;          /* Width of the symbol in modules */
+        int data_codewords; /* Number of data codewords (including padding) if known, else 0 */
+        int codewords;      /* Total number of codewords (data and error correction) if known, else 0 */
+    };
+
     /* Main symbol structure */
     struct zint_symbol {
         int symbology;      /* Symbol to use (see BARCODE_XXX below) */
@@ -136,6 +161,15 @@ extern "C" {
         struct zint_vector *vector; /* Pointer to vector header (vector output only) */
         unsigned char *memfile; /* Pointer to in-memory file buffer if BARCODE_MEMORY_FILE (output only) */
         int memfile_size;   /* Length of in-memory file buffer (output only) */
+        int bitmap_capacity; /* Allocated size of `bitmap` in bytes (output only) */
+        int alphamap_capacity; /* Allocated size of `alphamap` in bytes (output only) */
+        int memfile_capacity; /* Allocated size of `memfile` in bytes (output only) */
+        struct zint_stats stats; /* Per-stage timings, accumulated over encodes until reset (output only) */
+        struct zint_estimate estimate; /* Size selected by last encode if estimation supported (output only) */
+        int bitmap_stride;  /* Bytes per row of `bitmap` if OUT_BUFFER_1BPP. Default 0 ((bitmap_width + 7) / 8) */
+        int raster_threads; /* Max threads to render large raster images with (negative for number of processors).
+                               Default 0 (none) */
+        int png_options;    /* PNG compression profile, filter and strategy (see ZINT_PNG_XXX below). Default 0 */
     };
 
     /* Segment for use with `ZBarcode_Encode_Segs()` below */
@@ -145,6 +179,33 @@ extern "C" {
         int eci;            /* Extended Channel Interpretation */
     };
 
+    /* Compact module matrix sized to symbol, see `ZBarcode_Modules()` below */
+    struct zint_modules {
+        int rows;           /* Number of rows, as `symbol->rows` */
+        int width;          /* Number of modules per row, as `symbol->width` */
+        int stride;         /* Number of 64-bit words per row in `bits`, i.e. (`width` + 63) / 64 */
+        zint_uint64 *bits;  /* Modules packed 64 per word, least significant bit first, 1 for set (dark) */
+        unsigned char *colours; /* Ultracode only (else NULL): `rows` x `width` colours 1-8 */
+    };
+
+    /* Memory allocation functions for use with `ZBarcode_SetAllocator()` below, passed its `opaque` argument */
+    typedef void *(*zint_malloc_func_t)(void *opaque, size_t size);
+    typedef void *(*zint_realloc_func_t)(void *opaque, void *ptr, size_t size);
+    typedef void (*zint_free_func_t)(void *opaque, void *ptr);
+
+    /* Batch item for use with `ZBarcode_Encode_Batch()` below */
+    struct zint_batch {
+        struct zint_symbol *symbol; /* Symbol (with options set) to encode into, one per item */
+        const struct zint_seg *segs; /* Segments to encode. If NULL `source` and `length` used instead */
+        int seg_count;      /* Number of `segs` */
+        const unsigned char *source; /* Data to encode if `segs` NULL */
+        int length;         /* Length of `source`. If 0 or negative, `source` must be NUL-terminated */
+        int ret;            /* Error/warning value returned for this item (output only) */
+    };
+
+    /* Opaque handle to a symbol with validated settings, see `ZBarcode_Prepare()` below */
+    struct zint_prepared;
+
 /* Symbologies (`symbol->symbology`) */
     /* Tbarcode 7 codes */
 #define BARCODE_CODE11          1   /* Code 11 */
@@ -303,6 +364,41 @@ extern "C" {
                                            separators as needed), complete with any control chars and check chars, and
                                            for all linear and DataBar Stacked symbologies, including those that
                                            normally don't set it */
+#define BARCODE_RETAIN_BUFFERS  0x40000 /* Keep `bitmap`, `alphamap` and `memfile` allocated between encodes
+                                           (including over `ZBarcode_Clear()`), re-using them if big enough */
+#define OUT_BUFFER_1BPP         0x80000 /* Return bitmap buffer packed 1 bit per pixel, MSB first, 1 ink, 0 paper,
+                                           each row `bitmap_stride` bytes (OUT_BUFFER only) */
+#define OUT_BUFFER_RGBA         0x100000 /* Return bitmap buffer as interleaved RGBA, 4 bytes per pixel, with no
+                                            `alphamap` (OUT_BUFFER only) */
+#define OUT_BUFFER_PREMULTIPLIED 0x200000 /* Premultiply RGB by alpha (OUT_BUFFER_RGBA only) */
+#define BARCODE_TIF_APPEND      0x400000 /* Append symbol as new page to TIF file `outfile` if it exists, else create
+                                            (TIF only) */
+
+/* Destination pixel formats (`ZBarcode_Buffer_Into()`) */
+#define ZINT_PIXEL_GREY8        1       /* 8-bit greyscale (luma), 1 byte per pixel */
+#define ZINT_PIXEL_RGB24        2       /* 8-bit red, green, blue, 3 bytes per pixel */
+#define ZINT_PIXEL_RGBA32       3       /* 8-bit red, green, blue, alpha (unpremultiplied), 4 bytes per pixel */
+#define ZINT_PIXEL_1BPP         4       /* 1 bit per pixel, MSB first, 1 ink, 0 paper */
+
+/* PNG encoding options (`symbol->png_options`), one of each of profile, filter and strategy OR-ed together */
+#define ZINT_PNG_SMALLEST       0x0001  /* Maximum compression, choosing strategy by trying sample rows */
+#define ZINT_PNG_BALANCED       0x0002  /* Medium compression, choosing strategy by trying sample rows */
+#define ZINT_PNG_FASTEST        0x0003  /* Minimum compression, default strategy */
+#define ZINT_PNG_PROFILE_MASK   0x000F  /* Default 0 is maximum compression with strategy guessed from symbology */
+#define ZINT_PNG_FILTER_NONE    0x0010  /* Row filters (default 0 is libpng's choice) */
+#define ZINT_PNG_FILTER_SUB     0x0020
+#define ZINT_PNG_FILTER_UP      0x0030
+#define ZINT_PNG_FILTER_AVG     0x0040
+#define ZINT_PNG_FILTER_PAETH   0x0050
+#define ZINT_PNG_FILTER_ALL     0x0060  /* Adaptive, choosing filter per row */
+#define ZINT_PNG_FILTER_MASK    0x00F0
+#define ZINT_PNG_STRATEGY_DEFAULT 0x0100 /* zlib deflate strategies (default 0 is profile's choice) */
+#define ZINT_PNG_STRATEGY_FILTERED 0x0200
+#define ZINT_PNG_STRATEGY_HUFFMAN 0x0300
+#define ZINT_PNG_STRATEGY_RLE   0x0400
+#define ZINT_PNG_STRATEGY_FIXED 0x0500
+#define ZINT_PNG_STRATEGY_MASK  0x0F00
+#define ZINT_PNG_NATIVE         0x1000  /* Use built-in encoder even if have libpng (always used if not) */
 
 /* Input data types (`symbol->input_mode`) */
 #define DATA_MODE               0       /* Binary */
@@ -375,6 +471,23 @@ extern "C" {
 /* Maximum number of segments allowed for (`seg_count`) */
 #define ZINT_MAX_SEG_COUNT      256
 
+/* Batch actions (ZBarcode_Encode_Batch() `action`) */
+#define ZINT_BATCH_ENCODE       0   /* Encode only */
+#define ZINT_BATCH_BUFFER       1   /* Encode and output to memory as raster (`symbol->bitmap`) */
+#define ZINT_BATCH_BUFFER_VECTOR 2  /* Encode and output to memory as vector (`symbol->vector`) */
+#define ZINT_BATCH_PRINT        3   /* Encode and output to file `symbol->outfile` */
+
+/* Timing statistics stages (`symbol->stats` indexes, see `ZBarcode_GetStats()`) */
+#define ZINT_STATS_ENCODE       0   /* Whole encode (`ZBarcode_Encode()` etc) */
+#define ZINT_STATS_ECI          1   /* Input conversion (UTF-8 to ECI/other character sets) */
+#define ZINT_STATS_MODES        2   /* Encodation mode optimisation */
+#define ZINT_STATS_RS           3   /* Reed-Solomon error correction */
+#define ZINT_STATS_MASK         4   /* Mask evaluation and selection */
+#define ZINT_STATS_PLOT         5   /* Raster/vector plotting */
+#define ZINT_STATS_ROTATE       6   /* Raster/vector rotation */
+#define ZINT_STATS_OUTPUT       7   /* Output formatting, i.e. buffer conversion or file compression (PNG, GIF etc) */
+#define ZINT_STATS_STAGES       8   /* Number of stages */
+
 /* Debug flags (`symbol->debug`) */
 #define ZINT_DEBUG_PRINT        0x0001  /* Print debug info (if any) to stdout */
 #define ZINT_DEBUG_TEST         0x0002  /* For internal test use only */
@@ -449,6 +562,13 @@ extern "C" {
                         int rotate_angle);
 
 
+    /* Output a previously encoded symbol as raster directly into caller-supplied `dst` of `dst_width` x `dst_height`
+       pixels, `dst_stride` bytes per row, in pixel format `dst_format` (see ZINT_PIXEL_XXX above), with its top left
+       at `x`, `y` (which may be negative, -1048576 to 1048576), clipping to `dst`, and blending by the colours'
+       alpha (if any) */
+    ZINT_EXTERN int ZBarcode_Buffer_Into(struct zint_symbol *symbol, int rotate_angle, unsigned char *dst,
+                        int dst_width, int dst_height, int dst_stride, int dst_format, int x, int y);
+
     /* Output a previously encoded symbol to memory as vector (`symbol->vector`) */
     ZINT_EXTERN int ZBarcode_Buffer_Vector(struct zint_symbol *symbol, int rotate_angle);
 
@@ -465,6 +585,57 @@ extern "C" {
                         int rotate_angle);
 
 
+    /* Encode (and output according to `action`, see ZINT_BATCH_XXX above) `item_count` batch `items`, using up to
+       `num_threads` threads (if 0 or negative, the number of processors). Each item must have its own `symbol`, and
+       its result is placed in `items[i].ret`. Returns the highest item return value, or ZINT_ERROR_INVALID_OPTION if
+       arguments invalid */
+    ZINT_EXTERN int ZBarcode_Encode_Batch(struct zint_batch items[], const int item_count, const int action,
+                        int rotate_angle, const int num_threads);
+
+
+    /* Validate the settings of `symbol` (options, input mode, colours etc.) once, returning in `p_prepared` a handle
+       for encoding data repeatedly with those settings without re-validating them. `symbol` must not then be changed
+       (other than by encoding and outputting) until the handle is freed. Returns any warning or error from
+       validation, with `*p_prepared` set to NULL on error */
+    ZINT_EXTERN int ZBarcode_Prepare(struct zint_symbol *symbol, struct zint_prepared **p_prepared);
+
+    /* Encode a barcode using a handle from `ZBarcode_Prepare()`, first clearing its symbol and restoring its
+       settings. If `length` is 0 or negative, `source` must be NUL-terminated */
+    ZINT_EXTERN int ZBarcode_Encode_Prepared(struct zint_prepared *prepared, const unsigned char *source, int length);
+
+    /* Encode a barcode with multiple ECI segments using a handle from `ZBarcode_Prepare()` */
+    ZINT_EXTERN int ZBarcode_Encode_Segs_Prepared(struct zint_prepared *prepared, const struct zint_seg segs[],
+                        const int seg_count);
+
+    /* Free a handle from `ZBarcode_Prepare()` (but not its symbol) */
+    ZINT_EXTERN void ZBarcode_Prepared_Free(struct zint_prepared *prepared);
+
+    /* Predict the size of the symbol that encoding `source` of length `length` would produce, placing it in
+       `estimate`. Clears `symbol` first. For Data Matrix, MicroPDF417, PDF417 and QR Code only the data analysis and
+       size selection are done, with `symbol` left unencoded (but its options fed back); for other symbologies a full
+       encode is done and `estimate->data_codewords` and `estimate->codewords` are 0. If `length` is 0 or negative,
+       `source` must be NUL-terminated. Returns any warning or error that encoding would return */
+    ZINT_EXTERN int ZBarcode_Estimate(struct zint_symbol *symbol, const unsigned char *source, int length,
+                        struct zint_estimate *estimate);
+
+
+    /* Return module at `row`, `column` of a previously encoded symbol: 1 if set (dark) or 0 if not, or, for
+       Ultracode, the colour 1-8 (Cyan, Blue, Magenta, Red, Yellow, Green, Black, White) or 0 if not set.
+       Returns -1 if `row` or `column` out of range */
+    ZINT_EXTERN int ZBarcode_Module(const struct zint_symbol *symbol, int row, int column);
+
+    /* Return a compact copy of the module matrix of a previously encoded symbol, allocated to its actual `rows` x
+       `width`, or NULL if none or memory allocation failure. Free with `ZBarcode_Modules_Free()`.
+       Note `symbol->encoded_data` itself remains fixed-size */
+    ZINT_EXTERN struct zint_modules *ZBarcode_Modules(const struct zint_symbol *symbol);
+
+    /* Return module at `row`, `column` of `modules`, with values and range check as `ZBarcode_Module()` */
+    ZINT_EXTERN int ZBarcode_Modules_Get(const struct zint_modules *modules, int row, int column);
+
+    /* Free a compact module matrix returned by `ZBarcode_Modules()` */
+    ZINT_EXTERN void ZBarcode_Modules_Free(struct zint_modules *modules);
+
+
     /* Is `symbol_id` a recognized symbology? */
     ZINT_EXTERN int ZBarcode_ValidID(int symbol_id);
 
@@ -500,8 +671,39 @@ extern "C" {
        ZINT_ERROR_INVALID_OPTION or ZINT_ERROR_INVALID_DATA. Compatible with libzueci `zueci_dest_len_eci()` */
     ZINT_EXTERN int ZBarcode_Dest_Len_ECI(int eci, const unsigned char *source, int length, int *p_dest_length);
 
-
-    /* Whether Zint built without PNG support */
+    /* Process escape sequences in `source` of length `length` as for ESCAPE_MODE (and EXTRA_ESCAPE_MODE if set in
+       `symbol->input_mode` and `symbol->symbology` is BARCODE_CODE128), placing the result in `dest`, which must be
+       at least `length` + 1 bytes long, and its length in `p_dest_length`. If `length` is 0 or negative, `source`
+       must be NUL-terminated. Returns 0 on success, else ZINT_ERROR_INVALID_DATA with `symbol->errtxt` set.
+       `symbol` must be non-NULL (if NULL, ZINT_ERROR_INVALID_DATA is returned and nothing else done) */
+    ZINT_EXTERN int ZBarcode_Unescape(struct zint_symbol *symbol, const unsigned char *source, int length,
+                        unsigned char dest[], int *p_dest_length);
+
+
+    /* Set the memory allocation functions used by libzint for all its allocations, including symbols and their
+       output buffers. `realloc_func` may be NULL, in which case `malloc_func` and `free_func` are used instead. Pass
+       NULL `malloc_func` and `free_func` to restore the defaults. Process-wide (not per-symbol), so the functions
+       must be thread-safe if libzint is used by multiple threads. Not thread-safe: call before any other use of
+       libzint, or when none of its memory is outstanding. The process-wide encode cache and raster glyph and stamp
+       caches, which outlive any allocator, always use `malloc()`. Returns 0 on success, else
+       ZINT_ERROR_INVALID_OPTION if only one of `malloc_func` and `free_func` NULL */
+    ZINT_EXTERN int ZBarcode_SetAllocator(zint_malloc_func_t malloc_func, zint_realloc_func_t realloc_func,
+                        zint_free_func_t free_func, void *opaque);
+
+    /* Enable an LRU cache of up to `max_entries` (max 1048576) encode results, keyed on the data and the symbol
+       settings affecting encodation, so that re-encoding the same data with the same settings just copies the
+       result. Shared by all threads (if thread support built in). 0 (the default) disables and frees the cache. Not
+       thread-safe: call when no encoding is in progress. Returns 0 on success, else ZINT_ERROR_INVALID_OPTION or
+       ZINT_ERROR_MEMORY */
+    ZINT_EXTERN int ZBarcode_SetEncodeCache(const int max_entries);
+
+    /* Copy the per-stage timing statistics accumulated in `symbol->stats` since it was created or last reset (by
+       `ZBarcode_Reset()` or by zeroing `symbol->stats`) to `stats`. Returns 0 on success, else
+       ZINT_ERROR_INVALID_OPTION (with `stats` zeroed) if Zint not built with ZINT_STATS */
+    ZINT_EXTERN int ZBarcode_GetStats(const struct zint_symbol *symbol, struct zint_stats *stats);
+
+
+    /* Whether Zint built without PNG support - always 0, as a built-in encoder is used if no libpng */
     ZINT_EXTERN int ZBarcode_NoPng(void);
 
     /* Return the version of Zint linked to */
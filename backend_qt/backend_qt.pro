@@ -24,9 +24,16 @@ DEFINES += ZINT_VERSION="\\\"2.15.0.9\\\""
     INCLUDEPATH += ../../zlib
 }
 
+# POSIX threads for `ZBarcode_Encode_Batch()` and locking the process-wide caches
+unix {
+    DEFINES += ZINT_USE_PTHREADS
+    LIBS += -lpthread
+}
+
 HEADERS +=  ../backend/aztec.h \
             ../backend/big5.h \
             ../backend/bmp.h \
+            ../backend/cache.h \
             ../backend/channel_precalcs.h \
             ../backend/code1.h \
             ../backend/code128.h \
@@ -64,6 +71,7 @@ HEADERS +=  ../backend/aztec.h \
             ../backend/rss.h \
             ../backend/sjis.h \
             ../backend/tif.h \
+            ../backend/tif_g4.h \
             ../backend/tif_lzw.h \
             ../backend/zfiletypes.h \
             ../backend/zintconfig.h \
@@ -77,6 +85,7 @@ SOURCES += ../backend/2of5.c \
            ../backend/aztec.c \
            ../backend/bc412.c \
            ../backend/bmp.c \
+           ../backend/cache.c \
            ../backend/channel.c \
            ../backend/codabar.c \
            ../backend/codablock.c \
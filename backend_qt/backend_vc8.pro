@@ -13,12 +13,9 @@ INCLUDEPATH += ../backend d:\\opt\\include
 
 DEFINES +=  _CRT_SECURE_NO_WARNINGS _CRT_NONSTDC_NO_WARNINGS ZINT_VERSION=\\\"$$VERSION\\\" include=""
 
-!contains(DEFINES, ZINT_NO_PNG) {
-    SOURCES += ../backend/png.c
-}
-
 HEADERS +=  ../backend/aztec.h \
             ../backend/bmp.h \
+            ../backend/cache.h \
             ../backend/channel_precalcs.h \
             ../backend/code1.h \
             ../backend/code128.h \
@@ -60,6 +57,7 @@ SOURCES += ../backend/2of5.c \
            ../backend/aztec.c \
            ../backend/bc412.c \
            ../backend/bmp.c \
+           ../backend/cache.c \
            ../backend/channel.c \
            ../backend/codabar.c \
            ../backend/codablock.c \
@@ -93,6 +91,7 @@ SOURCES += ../backend/2of5.c \
            ../backend/pcx.c \
            ../backend/pdf417.c \
            ../backend/plessey.c \
+           ../backend/png.c \
            ../backend/postal.c \
            ../backend/ps.c \
            ../backend/qr.c \
@@ -191,11 +191,17 @@ static void usage(const int no_png) {
            "  --init                Create Reader Initialisation (Programming) symbol\n"
            "  --mask=INTEGER        Set masking pattern to use (QR/Han Xin/DotCode)\n"
            "  --mirror              Use batch data to determine filename\n"
-           "  --mode=INTEGER        Set encoding mode (MaxiCode/Composite)\n", stdout);
+           "  --mode=INTEGER        Set encoding mode (MaxiCode/Composite)\n"
+           "  --multipage           Output batch as pages of single file (TIF only)\n", stdout);
     printf("  --nobackground        Remove background (EMF/EPS/GIF%s/SVG/TIF only)\n", no_png_type);
     fputs( "  --noquietzones        Disable default quiet zones\n"
            "  --notext              Remove human readable text (HRT)\n", stdout);
     printf("  -o, --output=FILE     Send output to FILE. Default is out.%s\n", no_png_ext);
+    if (!no_png) {
+        fputs( "  --pngfilter=FILTER    Set PNG row filter (none/sub/up/avg/paeth/all)\n"
+               "  --pngprofile=PROFILE  Set PNG compression profile (fastest/balanced/smallest)\n"
+               "  --pngstrategy=STRAT   Set PNG deflate strategy (default/filtered/huffman/rle/fixed)\n", stdout);
+    }
     fputs( "  --primary=STRING      Set primary message (MaxiCode/Composite)\n"
            "  --quietzones          Add compliant quiet zones\n"
            "  -r, --reverse         Reverse colours (white on black)\n"
@@ -732,6 +738,25 @@ static int is_raster(const char *filetype, const int no_png) {
     return 0;
 }
 
+/* Return index of `arg` (case-insensitive) in `keywords`, or -1 if not found */
+static int validate_keyword(const char *arg, const char keywords[][9], const int keywords_size) {
+    char lc_arg[9];
+    int i;
+
+    if (strlen(arg) >= ARRAY_SIZE(lc_arg)) {
+        return -1;
+    }
+    cpy_str(lc_arg, ARRAY_SIZE(lc_arg), arg);
+    to_lower(lc_arg);
+
+    for (i = 0; i < keywords_size; i++) {
+        if (strcmp(lc_arg, keywords[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 /* Helper for `validate_scalexdimdp()` to search for units, returning -2 on error, -1 if not found, else index */
 static int validate_units(char *buf, const char units[][5], int units_size) {
     int i;
@@ -900,9 +925,9 @@ static int validate_seg(const char *arg, const int N, struct zint_seg segs[10])
 static FILE *win_fopen(const char *filename, const char *mode); /* Forward ref */
 #endif
 
-/* Batch mode - output symbol for each line of text in `filename` */
+/* Batch mode - output symbol for each line of text in `filename`, or if `multipage` each as a page of the one TIF */
 static int batch_process(struct zint_symbol *symbol, const char *filename, const int mirror_mode,
-            const char *filetype, const int output_given, const int rotate_angle) {
+            const int multipage, const char *filetype, const int output_given, const int rotate_angle) {
     FILE *file;
     unsigned char buffer[ZINT_MAX_DATA_LEN] = {0}; /* Maximum HanXin input */
     unsigned char character = 0;
@@ -912,7 +937,11 @@ static int batch_process(struct zint_symbol *symbol, const char *filename, const
     int format_len, i, o, mirror_start_o = 0;
     const int from_stdin = strcmp(filename, "-") == 0; /* Suppress clang-19 warning clang-analyzer-unix.Stream */
 
-    if (mirror_mode) {
+    if (multipage) {
+        /* All pages go to outfile (default "out.tif") */
+        cpy_str(output_file, ARRAY_SIZE(output_file), symbol->outfile);
+        set_extension(output_file, filetype);
+    } else if (mirror_mode) {
         /* Use directory if any from outfile */
         if (output_given && symbol->outfile[0]) {
 #ifndef _WIN32
@@ -974,7 +1003,9 @@ static int batch_process(struct zint_symbol *symbol, const char *filename, const
                 buffer[--buf_posn] = '\0';
             }
 
-            if (mirror_mode == 0) {
+            if (multipage) {
+                /* Same `output_file` for all */
+            } else if (mirror_mode == 0) {
                 char number[12], reverse_number[12];
                 char reversed_string[ARRAY_SIZE(output_file)];
                 char *rs = reversed_string;
@@ -1092,6 +1123,10 @@ static int batch_process(struct zint_symbol *symbol, const char *filename, const
                     error_number = warn_number;
                 }
             }
+            if (multipage && warn_number < ZINT_ERROR) {
+                /* First page written (overwriting any existing file), so append subsequent */
+                symbol->output_options |= BARCODE_TIF_APPEND;
+            }
             ZBarcode_Clear(symbol);
             memset(buffer, 0, ARRAY_SIZE(buffer));
             buf_posn = 0;
@@ -1424,6 +1459,7 @@ int main(int argc, char **argv) {
     int input_cnt = 0;
     int batch_mode = 0;
     int mirror_mode = 0;
+    int multipage = 0;
     int fullmultibyte = 0;
     int mask = 0;
     int separator = 0;
@@ -1441,6 +1477,9 @@ int main(int argc, char **argv) {
     float x_dim_mm = 0.0f, dpmm = 0.0f;
     float float_opt;
     char errbuf[64]; /* For `validate_float()` */
+    static const char png_profiles[][9] = { "smallest", "balanced", "fastest" };
+    static const char png_filters[][9] = { "none", "sub", "up", "avg", "paeth", "all" };
+    static const char png_strategies[][9] = { "default", "filtered", "huffman", "rle", "fixed" };
     arg_opt *arg_opts = (arg_opt *) z_alloca(sizeof(arg_opt) * argc);
 
     const int no_png = ZBarcode_NoPng();
@@ -1469,8 +1508,9 @@ int main(int argc, char **argv) {
             OPT_DIRECT, OPT_DMISO144, OPT_DMRE, OPT_DOTSIZE, OPT_DOTTY, OPT_DUMP,
             OPT_ECI, OPT_EMBEDFONT, OPT_ESC, OPT_EXTRAESC, OPT_FAST, OPT_FG, OPT_FILETYPE, OPT_FULLMULTIBYTE,
             OPT_GS1, OPT_GS1NOCHECK, OPT_GS1PARENS, OPT_GSSEP, OPT_GUARDDESCENT, OPT_GUARDWHITESPACE,
-            OPT_HEIGHT, OPT_HEIGHTPERROW, OPT_INIT, OPT_MIRROR, OPT_MASK, OPT_MODE,
-            OPT_NOBACKGROUND, OPT_NOQUIETZONES, OPT_NOTEXT, OPT_PRIMARY, OPT_QUIETZONES,
+            OPT_HEIGHT, OPT_HEIGHTPERROW, OPT_INIT, OPT_MIRROR, OPT_MASK, OPT_MODE, OPT_MULTIPAGE,
+            OPT_NOBACKGROUND, OPT_NOQUIETZONES, OPT_NOTEXT,
+            OPT_PNGFILTER, OPT_PNGPROFILE, OPT_PNGSTRATEGY, OPT_PRIMARY, OPT_QUIETZONES,
             OPT_ROTATE, OPT_ROWS, OPT_SCALE, OPT_SCALEXDIM, OPT_SCMVV, OPT_SECURE,
             OPT_SEG1, OPT_SEG2, OPT_SEG3, OPT_SEG4, OPT_SEG5, OPT_SEG6, OPT_SEG7, OPT_SEG8, OPT_SEG9,
             OPT_SEPARATOR, OPT_SMALL, OPT_SQUARE, OPT_STRUCTAPP, OPT_TEXTGAP,
@@ -1524,10 +1564,14 @@ int main(int argc, char **argv) {
             {"mirror", 0, NULL, OPT_MIRROR},
             {"mask", 1, NULL, OPT_MASK},
             {"mode", 1, NULL, OPT_MODE},
+            {"multipage", 0, NULL, OPT_MULTIPAGE},
             {"nobackground", 0, NULL, OPT_NOBACKGROUND},
             {"noquietzones", 0, NULL, OPT_NOQUIETZONES},
             {"notext", 0, NULL, OPT_NOTEXT},
             {"output", 1, NULL, 'o'},
+            {"pngfilter", 1, NULL, OPT_PNGFILTER},
+            {"pngprofile", 1, NULL, OPT_PNGPROFILE},
+            {"pngstrategy", 1, NULL, OPT_PNGSTRATEGY},
             {"primary", 1, NULL, OPT_PRIMARY},
             {"quietzones", 0, NULL, OPT_QUIETZONES},
             {"reverse", 0, NULL, 'r'},
@@ -1794,6 +1838,10 @@ int main(int argc, char **argv) {
                     warn_number = ZINT_WARN_INVALID_OPTION;
                 }
                 break;
+            case OPT_MULTIPAGE:
+                /* Output all batch symbols to the one (TIF) file */
+                multipage = 1;
+                break;
             case OPT_NOBACKGROUND:
                 cpy_str(my_symbol->bgcolour, ARRAY_SIZE(my_symbol->bgcolour), "ffffff00");
                 break;
@@ -1803,6 +1851,38 @@ int main(int argc, char **argv) {
             case OPT_NOTEXT:
                 my_symbol->show_hrt = 0;
                 break;
+            case OPT_PNGFILTER:
+                if ((val = validate_keyword(optarg, png_filters, ARRAY_SIZE(png_filters))) >= 0) {
+                    my_symbol->png_options = (my_symbol->png_options & ~ZINT_PNG_FILTER_MASK)
+                                                | ((val + 1) << 4);
+                } else {
+                    fprintf(stderr, "Warning 197: Invalid PNG filter '%s' (none, sub, up, avg, paeth or all"
+                            " only), ignoring\n", optarg);
+                    fflush(stderr);
+                    warn_number = ZINT_WARN_INVALID_OPTION;
+                }
+                break;
+            case OPT_PNGPROFILE:
+                if ((val = validate_keyword(optarg, png_profiles, ARRAY_SIZE(png_profiles))) >= 0) {
+                    my_symbol->png_options = (my_symbol->png_options & ~ZINT_PNG_PROFILE_MASK) | (val + 1);
+                } else {
+                    fprintf(stderr, "Warning 198: Invalid PNG profile '%s' (fastest, balanced or smallest"
+                            " only), ignoring\n", optarg);
+                    fflush(stderr);
+                    warn_number = ZINT_WARN_INVALID_OPTION;
+                }
+                break;
+            case OPT_PNGSTRATEGY:
+                if ((val = validate_keyword(optarg, png_strategies, ARRAY_SIZE(png_strategies))) >= 0) {
+                    my_symbol->png_options = (my_symbol->png_options & ~ZINT_PNG_STRATEGY_MASK)
+                                                | ((val + 1) << 8);
+                } else {
+                    fprintf(stderr, "Warning 199: Invalid PNG strategy '%s' (default, filtered, huffman, rle"
+                            " or fixed only), ignoring\n", optarg);
+                    fflush(stderr);
+                    warn_number = ZINT_WARN_INVALID_OPTION;
+                }
+                break;
             case OPT_PRIMARY:
                 cpy_str(my_symbol->primary, ARRAY_SIZE(my_symbol->primary), optarg);
                 if (strlen(optarg) >= ARRAY_SIZE(my_symbol->primary)) {
@@ -2176,6 +2256,22 @@ int main(int argc, char **argv) {
                     cpy_str(filetype, ARRAY_SIZE(filetype), no_png ? "gif" : "png");
                 }
             }
+            if (multipage) {
+                char lc_filetype[4];
+                cpy_str(lc_filetype, ARRAY_SIZE(lc_filetype), filetype);
+                to_lower(lc_filetype);
+                if (strcmp(lc_filetype, "tif") != 0) {
+                    fprintf(stderr, "Warning 129: '--multipage' only available for TIF output, ignoring\n");
+                    fflush(stderr);
+                    warn_number = ZINT_WARN_INVALID_OPTION;
+                    multipage = 0;
+                } else if (mirror_mode || (my_symbol->output_options & BARCODE_STDOUT)) {
+                    fprintf(stderr, "Warning 130: Can't use '--multipage' with '--mirror' or '--direct', ignoring\n");
+                    fflush(stderr);
+                    warn_number = ZINT_WARN_INVALID_OPTION;
+                    multipage = 0;
+                }
+            }
             if (dpmm) { /* Allow `x_dim_mm` to be zero */
                 if (x_dim_mm == 0.0f) {
                     x_dim_mm = ZBarcode_Default_Xdim(symbology);
@@ -2199,9 +2295,14 @@ int main(int argc, char **argv) {
                 fflush(stderr);
                 warn_number = ZINT_WARN_INVALID_OPTION;
             }
-            error_number = batch_process(my_symbol, arg_opts[0].arg, mirror_mode, filetype, output_given,
+            error_number = batch_process(my_symbol, arg_opts[0].arg, mirror_mode, multipage, filetype, output_given,
                             rotate_angle);
         } else {
+            if (multipage) {
+                fprintf(stderr, "Warning 189: '--multipage' only available in batch mode, ignoring\n");
+                fflush(stderr);
+                warn_number = ZINT_WARN_INVALID_OPTION;
+            }
             if (seg_count) {
                 if (data_arg_num > 1) {
                     fprintf(stderr, "Error 170: Cannot specify segments and multiple data arguments together\n");
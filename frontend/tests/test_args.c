@@ -780,6 +780,86 @@ static void test_batch_large(const testCtx *const p_ctx) {
     testFinish();
 }
 
+static void test_batch_multipage(const testCtx *const p_ctx) {
+    int debug = p_ctx->debug;
+
+    struct item {
+        int mirror;
+        const char *filetype;
+        const char *outfile;
+        const char *input;
+
+        const char *expected;
+        int num_expected;
+        const char *expected_outfile;
+        int expected_pages;
+    };
+    /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
+    struct item data[] = {
+        /*  0*/ { 0, "tif", NULL, "123\n456\n789\n", "", 1, "out.tif", 3 },
+        /*  1*/ { 0, NULL, "test_multipage.tif", "123\n456\n", "", 1, "test_multipage.tif", 2 },
+        /*  2*/ { 0, "tif", "test_multipage.gif", "123\n", "", 1, "test_multipage.tif", 1 },
+        /*  3*/ { 0, NULL, "test_multipage.tif", "123\n\n456\n", "On line 2: Error 778: No input data", 1, "test_multipage.tif", 2 },
+        /*  4*/ { 0, "gif", NULL, "123\n456\n", "Warning 129: '--multipage' only available for TIF output, ignoring", 2, "00001.gif\00000002.gif", 0 },
+        /*  5*/ { 1, "tif", NULL, "123\n456\n", "Warning 130: Can't use '--multipage' with '--mirror' or '--direct', ignoring", 2, "123.tif\000456.tif", 1 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i;
+
+    char cmd[4096];
+    char buf[4096];
+    unsigned char filebuf[32768];
+    int filebuf_size;
+
+    const char *input_filename = "test_batch_multipage.txt";
+    const char *outfile;
+
+    testStart("test_batch_multipage");
+
+    for (i = 0; i < data_size; i++) {
+        int j, ret, pages, ifd;
+
+        if (testContinue(p_ctx, i)) continue;
+
+        strcpy(cmd, "zint --batch --multipage");
+
+        arg_bool(cmd, "--mirror", data[i].mirror);
+        arg_data(cmd, "--filetype=", data[i].filetype);
+        arg_input(cmd, input_filename, data[i].input);
+        arg_data(cmd, "-o ", data[i].outfile);
+
+        strcat(cmd, " 2>&1");
+
+        assert_nonnull(exec(cmd, buf, sizeof(buf) - 1, debug, i, NULL), "i:%d exec(%s) NULL\n", i, cmd);
+        assert_zero(strcmp(buf, data[i].expected), "i:%d buf (%s) != expected (%s) (%s)\n", i, buf, data[i].expected, cmd);
+
+        outfile = data[i].expected_outfile;
+        if (data[i].expected_pages) {
+            ret = testUtilReadFile(outfile, filebuf, sizeof(filebuf), &filebuf_size);
+            assert_zero(ret, "i:%d testUtilReadFile(%s) %d != 0\n", i, outfile, ret);
+            /* Count IFDs */
+            pages = 0;
+            ifd = filebuf[4] | (filebuf[5] << 8) | (filebuf[6] << 16) | (filebuf[7] << 24);
+            while (ifd && ifd + 2 <= filebuf_size && pages < 10) {
+                ifd += 2 + (filebuf[ifd] | (filebuf[ifd + 1] << 8)) * 12;
+                assert_nonzero(ifd + 4 <= filebuf_size, "i:%d %s ifd %d + 4 > size %d\n", i, outfile, ifd, filebuf_size);
+                ifd = filebuf[ifd] | (filebuf[ifd + 1] << 8) | (filebuf[ifd + 2] << 16) | (filebuf[ifd + 3] << 24);
+                pages++;
+            }
+            assert_equal(pages, data[i].expected_pages, "i:%d %s pages %d != %d\n", i, outfile, pages, data[i].expected_pages);
+        }
+        for (j = 0; j < data[i].num_expected; j++) {
+            assert_nonzero(testUtilExists(outfile), "i:%d j:%d testUtilExists(%s) != 1\n", i, j, outfile);
+            assert_zero(testUtilRemove(outfile), "i:%d j:%d testUtilRemove(%s) != 0 (%d: %s)\n", i, j, outfile, errno, strerror(errno));
+            outfile += strlen(outfile) + 1;
+        }
+
+        assert_zero(testUtilRemove(input_filename), "i:%d testUtilRemove(%s) != 0 (%d: %s)\n", i, input_filename, errno, strerror(errno));
+    }
+
+    testFinish();
+}
+
 static void test_checks(const testCtx *const p_ctx) {
     int debug = p_ctx->debug;
 
@@ -1238,6 +1318,13 @@ static void test_other_opts(const testCtx *const p_ctx) {
         /* 62*/ { BARCODE_EANX, "501234567890", -1, " --scalexdimdp=", "12,123.45678", "Error 180: scalexdimdp resolution invalid floating point (7 significant digits maximum)", 0 },
         /* 63*/ { BARCODE_EANX, "501234567890", -1, " --scalexdimdp=", "10.1,1000", "Warning 185: scalexdimdp X-dim '10.1' out of range (greater than 10), ignoring", 0 },
         /* 64*/ { BARCODE_EANX, "501234567890", -1, " --scalexdimdp=", "10,1000.1", "Warning 186: scalexdimdp resolution '1000.1' out of range (greater than 1000), ignoring", 0 },
+        /* 65*/ { BARCODE_CODE128, "1", -1, " --pngprofile=", "fastest", "", 0 },
+        /* 66*/ { BARCODE_CODE128, "1", -1, " --pngprofile=", "Balanced", "", 0 },
+        /* 67*/ { BARCODE_CODE128, "1", -1, " --pngprofile=", "small", "Warning 198: Invalid PNG profile 'small' (fastest, balanced or smallest only), ignoring", 0 },
+        /* 68*/ { BARCODE_CODE128, "1", -1, " --pngfilter=", "paeth", "", 0 },
+        /* 69*/ { BARCODE_CODE128, "1", -1, " --pngfilter=", "average", "Warning 197: Invalid PNG filter 'average' (none, sub, up, avg, paeth or all only), ignoring", 0 },
+        /* 70*/ { BARCODE_CODE128, "1", -1, " --pngstrategy=", "rle", "", 0 },
+        /* 71*/ { BARCODE_CODE128, "1", -1, " --pngstrategy=", "huffmanonly", "Warning 199: Invalid PNG strategy 'huffmanonly' (default, filtered, huffman, rle or fixed only), ignoring", 0 },
     };
     int data_size = ARRAY_SIZE(data);
     int i;
@@ -1294,6 +1381,7 @@ static void test_combos(const testCtx *const p_ctx) {
     /* s/\/\*[ 0-9]*\*\//\=printf("\/\*%3d*\/", line(".") - line("'<")): */
     struct item data[] = {
         /*  0*/ { -1, "1", " --direct -o direct.gif", "Warning 193: Output file given, ignoring '--direct' option", "direct.gif", 0 },
+        /*  1*/ { -1, "1", " --multipage -o multipage.tif", "Warning 189: '--multipage' only available in batch mode, ignoring", "multipage.tif", 0 },
     };
     int data_size = ARRAY_SIZE(data);
     int i;
@@ -1399,6 +1487,7 @@ int main(int argc, char *argv[]) {
         { "test_stdin_input", test_stdin_input },
         { "test_batch_input", test_batch_input },
         { "test_batch_large", test_batch_large },
+        { "test_batch_multipage", test_batch_multipage },
         { "test_checks", test_checks },
         { "test_barcode_symbology", test_barcode_symbology },
         { "test_other_opts", test_other_opts },
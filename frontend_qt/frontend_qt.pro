@@ -85,6 +85,7 @@ CONFIG += warn_on thread qt
 
 LIBS += -lQtZint
 QMAKE_LIBDIR += ../backend_qt/release
+unix:LIBS += -lpthread # For QtZint (see "backend_qt/backend_qt.pro")
 LIBS += -lQt5Core
 QMAKE_LIBDIR += C:/qt/5.15.16static/lib
 
@@ -116,6 +116,10 @@ SOURCE=..\..\backend\bmp.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\backend\cache.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\backend\channel.c
 # End Source File
 # Begin Source File